@@ -16,10 +16,13 @@
 #include <memory>
 #include <vector>
 
+#include "ecs/Light.h"
 #include "ecs/SceneLighting.h"
+#include "ecs/Transform.h"
 #include "ecs/AnimatorComponent.h"
 #include "render/Material.h"
 #include "render/Mesh.h"
+#include "render/ModelFile.h"
 #include "render/Renderable.h"
 
 const uint32_t WIDTH = 2400;
@@ -58,6 +61,7 @@ void Application::init() {
   auto* renderAPI = m_engine->getRenderAPI();
 
   m_scene = m_engine->createScene();
+  m_transformSystem = std::make_unique<ailo::TransformSystem>(*m_scene);
 
   ImGui::CreateContext();
 
@@ -91,12 +95,35 @@ void Application::init() {
   sceneLighting.prefilteredEnvMap = iblPrefilter;
   sceneLighting.lightDirection = normalize(glm::vec3(0.1, 1.4, 0.1));
 
+  auto pointLightEntity = m_scene->addEntity();
+  m_scene->addComponent<ailo::Transform>(pointLightEntity).setPosition(glm::vec3(3.0f, 1.5f, 0.5f));
+  auto& pointLight = m_scene->addComponent<ailo::Light>(pointLightEntity);
+  pointLight.color = glm::vec3(1.0f, 1.0f, 0.0f);
+  pointLight.radius = 3.0f;
+
+  auto spotLightEntity = m_scene->addEntity();
+  auto& spotLightTransform = m_scene->addComponent<ailo::Transform>(spotLightEntity);
+  spotLightTransform.setPosition(glm::vec3(0.0f, 1.5f, 2.5f));
+  spotLightTransform.setRotation(glm::quatLookAt(normalize(glm::vec3(0.0f, 1.0f, 0.5f)), glm::vec3(1.0f, 0.0f, 0.0f)));
+  auto& spotLight = m_scene->addComponent<ailo::Light>(spotLightEntity);
+  spotLight.type = ailo::LightType::Spot;
+  spotLight.color = glm::vec3(1.0f, 0.0f, 0.0f);
+  spotLight.radius = 3.0f;
+  spotLight.innerAngle = glm::radians(42.0f);
+  spotLight.outerAngle = glm::radians(66.0f);
+
   auto scale = glm::scale(glm::mat4(1.0f), glm::vec3(0.01f));
   // scale = glm::translate(scale, glm::vec3(200.0f, 0.0f, 0.0f));
   scale = glm::rotate(scale, glm::radians(90.0f), glm::vec3(0.0f, 1.0f, 0.0f));
 
-  ailo::MeshReader::instantiate(m_engine->getAssetManager(), m_engine->getRenderAPI(), *m_scene, "assets/models/sponza/sponza.gltf");
-  ailo::MeshReader::instantiate(m_engine->getAssetManager(), m_engine->getRenderAPI(), *m_scene, "assets/models/Roundhouse Kick.fbx", scale);
+  // a model baked next to the source one (see add_baked_mesh) is mapped instead of imported
+  auto modelPath = [](const std::string& source) {
+    auto baked = std::filesystem::path(source).replace_extension(ailo::kModelFileExtension);
+    return std::filesystem::exists(baked) ? baked.string() : source;
+  };
+  const ailo::MeshImportOptions importOptions { .quantizeVertices = true };
+  ailo::MeshReader::instantiate(m_engine->getAssetManager(), m_engine->getRenderAPI(), *m_scene, modelPath("assets/models/sponza/Sponza.gltf"), glm::mat4(1.0f), importOptions, m_engine->getJobSystem());
+  ailo::MeshReader::instantiate(m_engine->getAssetManager(), m_engine->getRenderAPI(), *m_scene, modelPath("assets/models/Roundhouse Kick.fbx"), scale, importOptions, m_engine->getJobSystem());
 
   auto inputSystem = m_engine->getInputSystem();
   inputSystem->subscribe<ailo::KeyPressedEvent>([](const ailo::KeyPressedEvent& e) {
@@ -131,6 +158,7 @@ void Application::mainLoop() {
 
     m_platform->pumpEvents(m_window, m_engine->getInputSystem());
     m_engine->getInputSystem()->processEvents();
+    m_engine->update();
 
     drawFrame();
 
@@ -262,6 +290,37 @@ void Application::drawFrame() {
 
   ImGui::Text("FPS: %f", io.Framerate);
 
+  const auto& stats = renderer->getStats();
+  ImGui::Text("Draw calls: %u", stats.drawCalls);
+  ImGui::Text("Pipeline binds: %u", stats.pipelineBinds);
+  ImGui::Text("Material binds: %u", stats.materialBinds);
+  ImGui::Text("Buffer binds: %u", stats.bufferBinds);
+  ImGui::Text("Visible: %u, culled: %u", stats.visibleObjects, stats.culledObjects);
+  ImGui::Text("Visible triangles: %u, reduced LOD draws: %u", stats.visibleTriangles, stats.reducedLodDraws);
+  ImGui::Text("Shadow casters: %u, cascades rendered: %u", stats.shadowCasters, stats.shadowCascadesRendered);
+  ImGui::Text("Object uploads: %u ranges, %u bytes", stats.objectUploadRanges, stats.objectUploadBytes);
+  ImGui::Text("Lights: %u, cluster light indices: %u", stats.lights, stats.clusterLightIndices);
+
+  ImGui::Text("Shaded fragments: %llu, overdraw: %.2f", static_cast<unsigned long long>(stats.shadedFragments), stats.overdraw);
+  ImGui::Text("Depth pre-pass draws: %u", stats.depthPrepassDraws);
+  ImGui::Text("Occlusion tested: %u, visible: %u", stats.occlusionTestedDraws, stats.occlusionVisibleDraws);
+  ImGui::Text("Software occluders: %u, occluded: %u", stats.softwareOccluders, stats.softwareOccludedObjects);
+  ImGui::Text("Meshlets tested: %u, visible: %u", stats.meshletsTested, stats.meshletsVisible);
+  ImGui::Text("Extract and prepare: %.3f ms", stats.prepareMs);
+
+  ImGui::Checkbox("Depth pre-pass", &m_camera->depthPrepass);
+  ImGui::Checkbox("Occlusion culling", &m_camera->occlusionCulling);
+  ImGui::Checkbox("Software occlusion", &m_camera->softwareOcclusion);
+  ImGui::Checkbox("Meshlet culling", &m_camera->meshletCulling);
+  bool deferredShading = renderer->getShadingMode() == ailo::ShadingMode::Deferred;
+  if (ImGui::Checkbox("Deferred shading", &deferredShading)) {
+    renderer->setShadingMode(deferredShading ? ailo::ShadingMode::Deferred : ailo::ShadingMode::Forward);
+  }
+  float lodBias = renderer->getLodBias();
+  if (ImGui::SliderFloat("LOD bias", &lodBias, -2.0f, 4.0f)) {
+    renderer->setLodBias(lodBias);
+  }
+
   ImGui::End();
 
   ImGui::Render();
@@ -284,8 +343,10 @@ void Application::drawFrame() {
     return;
   }
 
-  renderer->shadowPass(*m_scene);
-  renderer->colorPass(*m_scene, *m_camera);
+  m_transformSystem->update();
+  renderer->extract(*m_scene, *m_camera);
+  renderer->shadowPass();
+  renderer->colorPass();
 
   drawImGui();
 
@@ -299,6 +360,7 @@ void Application::drawImGui() {
 void Application::cleanup() {
   m_imguiProcessor.reset();
 
+  m_transformSystem.reset();
   m_scene.reset();
 
   m_engine.reset();
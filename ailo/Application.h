@@ -8,6 +8,7 @@
 #include "render/ImGuiProcessor.h"
 #include "input/InputTypes.h"
 #include "ecs/Scene.h"
+#include "ecs/TransformSystem.h"
 #include "platform/Platform.h"
 #include "render/Renderer.h"
 #include "render/Texture.h"
@@ -22,6 +23,7 @@ class Application {
     std::unique_ptr<ailo::Platform> m_platform;
     std::unique_ptr<ailo::Engine> m_engine;
     std::unique_ptr<ailo::Scene> m_scene;
+    std::unique_ptr<ailo::TransformSystem> m_transformSystem;
     std::unique_ptr<ailo::ImGuiProcessor> m_imguiProcessor;
     std::unique_ptr<ailo::Camera> m_camera;
     ailo::Entity m_cubeEntity {};
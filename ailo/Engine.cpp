@@ -6,17 +6,19 @@
 #include "input/InputSystem.h"
 #include "assets/Assets.h"
 #include "render/Texture.h"
+#include "common/JobSystem.h"
 
 namespace ailo {
 
 Engine::Engine(Platform::WindowHandle window) :
+  m_jobSystem(std::make_unique<JobSystem>()),
   m_renderAPI(std::make_unique<RenderAPI>(window)),
-  m_assetManager(std::make_unique<AssetManager>()),
+  m_assetManager(std::make_unique<AssetManager>(m_jobSystem.get())),
   m_inputSystem(std::make_unique<InputSystem>()) {
 
   m_assetManager->registerLoader<Texture>(std::make_unique<TextureLoader>(m_renderAPI.get()));
 
-  m_renderer = std::make_unique<Renderer>(m_renderAPI.get(), m_assetManager.get());
+  m_renderer = std::make_unique<Renderer>(m_renderAPI.get(), m_assetManager.get(), m_jobSystem.get());
 }
 
 Engine::~Engine() {
@@ -28,6 +30,12 @@ Engine::~Engine() {
   m_assetManager.reset();
   m_renderAPI.reset();
   m_inputSystem.reset();
+  m_jobSystem.reset();
+}
+
+void Engine::update() {
+  m_jobSystem->executeMainThreadJobs();
+  m_assetManager->update();
 }
 
 void Engine::gc() {
@@ -38,6 +46,7 @@ Renderer* Engine::getRenderer() { return m_renderer.get(); }
 RenderAPI* Engine::getRenderAPI() { return m_renderAPI.get(); }
 InputSystem* Engine::getInputSystem() { return m_inputSystem.get(); }
 AssetManager* Engine::getAssetManager() { return m_assetManager.get(); }
+JobSystem* Engine::getJobSystem() { return m_jobSystem.get(); }
 
 std::unique_ptr<Scene> Engine::createScene() {
   auto scene = std::make_unique<Scene>();
@@ -17,6 +17,7 @@ class Shader;
 class Texture;
 class Material;
 class AssetManager;
+class JobSystem;
 struct Camera;
 
 class Engine {
@@ -24,16 +25,20 @@ class Engine {
   Engine(Platform::WindowHandle);
   ~Engine();
 
+ // Runs jobs queued for the main thread, call once per frame
+ void update();
  void gc();
 
   Renderer* getRenderer();
   RenderAPI* getRenderAPI();
   InputSystem* getInputSystem();
   AssetManager* getAssetManager();
+  JobSystem* getJobSystem();
 
   [[nodiscard]] std::unique_ptr<Scene> createScene();
 
  private:
+  std::unique_ptr<JobSystem> m_jobSystem;
   std::unique_ptr<RenderAPI> m_renderAPI;
   std::unique_ptr<AssetManager> m_assetManager;
   std::unique_ptr<Renderer> m_renderer;
@@ -1,6 +1,18 @@
 #include "OS.h"
 
 #include <fstream>
+#include <stdexcept>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
 
 namespace ailo::os {
 
@@ -20,4 +32,73 @@ std::vector<char> readFile(const std::string& filename) {
   return buffer;
 }
 
-}
\ No newline at end of file
+#ifdef _WIN32
+
+MappedFile::MappedFile(const std::string& filename) {
+  m_file = CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+  if (m_file == INVALID_HANDLE_VALUE) {
+    m_file = nullptr;
+    throw std::runtime_error("failed to open file: " + filename);
+  }
+
+  LARGE_INTEGER size;
+  GetFileSizeEx(m_file, &size);
+  m_size = static_cast<size_t>(size.QuadPart);
+  if (m_size == 0) {
+    return;
+  }
+
+  m_mapping = CreateFileMappingA(m_file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+  if (m_mapping) {
+    m_data = static_cast<const std::byte*>(MapViewOfFile(m_mapping, FILE_MAP_READ, 0, 0, 0));
+  }
+  if (!m_data) {
+    if (m_mapping) CloseHandle(m_mapping);
+    CloseHandle(m_file);
+    throw std::runtime_error("failed to map file: " + filename);
+  }
+}
+
+MappedFile::~MappedFile() {
+  if (m_data) UnmapViewOfFile(m_data);
+  if (m_mapping) CloseHandle(m_mapping);
+  if (m_file) CloseHandle(m_file);
+}
+
+#else
+
+MappedFile::MappedFile(const std::string& filename) {
+  int fd = open(filename.c_str(), O_RDONLY);
+  if (fd < 0) {
+    throw std::runtime_error("failed to open file: " + filename);
+  }
+
+  struct stat info {};
+  if (fstat(fd, &info) != 0) {
+    close(fd);
+    throw std::runtime_error("failed to open file: " + filename);
+  }
+  m_size = static_cast<size_t>(info.st_size);
+  if (m_size == 0) {
+    close(fd);
+    return;
+  }
+
+  // the mapping keeps the file referenced, the descriptor isn't needed after this
+  void* data = mmap(nullptr, m_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (data == MAP_FAILED) {
+    throw std::runtime_error("failed to map file: " + filename);
+  }
+  m_data = static_cast<const std::byte*>(data);
+}
+
+MappedFile::~MappedFile() {
+  if (m_data) {
+    munmap(const_cast<std::byte*>(m_data), m_size);
+  }
+}
+
+#endif
+
+}
@@ -1,9 +1,17 @@
 #pragma once
 #include <cstdint>
+#include <deque>
+#include <exception>
 #include <functional>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
 
 #include <entt/entt.hpp>
 #include "Assets.h"
+#include "../common/JobSystem.h"
 
 namespace ailo {
 
@@ -32,15 +40,30 @@ private:
 };
 
 class Asset {
+public:
+    Asset() = default;
+
+    // Moving contents into an asset keeps its identity, so the asset_ptrs to it stay valid
+    Asset(Asset&&) noexcept {}
+    Asset& operator=(Asset&&) noexcept { return *this; }
+
+    // Incremented when an asynchronous load replaces the placeholder contents of the asset
+    [[nodiscard]] uint32_t getGeneration() const { return generation; }
+
+private:
     std::atomic<uint32_t> ref_count {0};
     asset_key key = {};
     AssetGCQueue* gc_queue = nullptr;
+    uint32_t generation = 0;
 
     template<typename T>
     friend class asset_ptr;
 
     template<typename T>
     friend class AssetPool;
+
+    template<typename T>
+    friend class LoadContext;
 };
 
 template<typename T>
@@ -166,6 +189,14 @@ public:
 template<typename T>
 class AssetPool : public AssetPoolBase {
 public:
+    using LoadCallback = std::function<void(const asset_ptr<T>&)>;
+
+    // Asynchronous load still running, at most one per path
+    struct PendingLoad {
+        asset_ptr<T> asset; // the placeholder, kept alive until the load finishes
+        std::vector<LoadCallback> callbacks;
+    };
+
     AssetPool() = default;
 
     template<class ...Args>
@@ -201,6 +232,20 @@ public:
         return m_assets.get(key);
     }
 
+    PendingLoad* findPendingLoad(const std::string& path) {
+        auto it = m_pendingLoads.find(path);
+        return it != m_pendingLoads.end() ? &it->second : nullptr;
+    }
+
+    PendingLoad& addPendingLoad(const std::string& path) {
+        return m_pendingLoads[path];
+    }
+
+    PendingLoad takePendingLoad(const std::string& path) {
+        auto node = m_pendingLoads.extract(path);
+        return node ? std::move(node.mapped()) : PendingLoad {};
+    }
+
     void erase(asset_key key) {
         m_assets.erase(key);
     }
@@ -216,6 +261,7 @@ public:
     }
 
     void clear() override {
+        m_pendingLoads.clear();
         m_assets.clear();
         m_pathIndex.clear();
         m_gcQueue.clear();
@@ -227,6 +273,8 @@ private:
     dod::slot_map<T, key_type> m_assets;
     std::unordered_map<std::string, key_type> m_pathIndex;
     AssetGCQueue m_gcQueue;
+    // after m_assets, its asset_ptrs are released before the assets are destroyed
+    std::unordered_map<std::string, PendingLoad> m_pendingLoads;
 };
 
 class AssetManager;
@@ -245,6 +293,9 @@ public:
     template<typename U>
     asset_ptr<U> load(const std::string& path);
 
+    template<typename U>
+    asset_ptr<U> get(const std::string& path);
+
 private:
     AssetManager* m_assetManager;
     std::string m_path;
@@ -258,11 +309,45 @@ public:
 template<typename T>
 class AssetLoader : public AssetLoaderBase {
 public:
+    using FinishLoad = std::function<void(LoadContext<T>&)>;
+
+    // Result of decode: the part of the load left for the main thread and the bytes it holds
+    // until then, counted against AssetManager's decode budget
+    struct Decoded {
+        FinishLoad finish;
+        size_t size = 0;
+    };
+
     virtual void load(LoadContext<T>& context, const std::string& path) = 0;
+
+    // Asynchronous loads split load(): decode runs on a worker thread and does the I/O and
+    // decoding, finish creates the asset on the main thread. Throws when the asset can't be
+    // read. By default all of load() runs on the main thread.
+    virtual Decoded decode(const std::string& path) {
+        return { [this, path](LoadContext<T>& context) { load(context, path); } };
+    }
+
+    // Constructs the stand-in that loadAsync hands out until the load finishes.
+    // Returns false when there is none, loadAsync returns null until then.
+    virtual bool placeholder(LoadContext<T>& context, const std::string& path) { return false; }
 };
 
 class AssetManager {
 public:
+    template<class T>
+    using LoadCallback = typename AssetPool<T>::LoadCallback;
+
+    // Decoded assets waiting for update() hold at most about this much memory, plus one
+    // decode per worker that started below it
+    static constexpr size_t kDefaultDecodeBudget = size_t(256) << 20;
+
+    // Without a job system loadAsync loads synchronously
+    explicit AssetManager(JobSystem* jobSystem = nullptr) : m_jobSystem(jobSystem) {}
+
+    ~AssetManager() {
+        cancelLoads();
+    }
+
     template<class T>
     void registerLoader(std::unique_ptr<AssetLoader<T>> loader) {
         const id_type id = entt::type_hash<T>::value();
@@ -296,6 +381,91 @@ public:
         return asset_ptr<T> { pool.get(path) };
     }
 
+    // Returns right away with the placeholder of the loader. The asset is decoded on a worker
+    // and created by update(), which moves it into the placeholder: asset_ptrs to it stay valid
+    // and its generation is incremented. Loads of a path already in flight are joined, load()
+    // returns the placeholder meanwhile. onLoaded runs in update() once the asset is ready or
+    // failed to load and kept the placeholder, right away if it was loaded before.
+    // Call from the main thread.
+    template<class T>
+    asset_ptr<T> loadAsync(const std::string& path, LoadCallback<T> onLoaded = {}) {
+        assert(!m_jobSystem || m_jobSystem->isMainThread());
+        auto& pool = ensurePool<T>();
+        if (auto* pending = pool.findPendingLoad(path)) {
+            if (onLoaded) pending->callbacks.push_back(std::move(onLoaded));
+            return pending->asset;
+        }
+
+        if (!m_jobSystem || pool.get(path)) {
+            auto asset = load<T>(path);
+            if (onLoaded) onLoaded(asset);
+            return asset;
+        }
+
+        auto loader = tryGetLoader<T>();
+        if (!loader) return {};
+
+        LoadContext<T> context { this, path };
+        loader->placeholder(context, path);
+
+        auto& pending = pool.addPendingLoad(path);
+        pending.asset = asset_ptr<T> { pool.get(path) };
+        if (onLoaded) pending.callbacks.push_back(std::move(onLoaded));
+
+        std::lock_guard lock(m_decodeMutex);
+        m_queuedDecodes.push_back([this, loader, path] {
+            typename AssetLoader<T>::Decoded decoded;
+            std::string error;
+            try {
+                decoded = loader->decode(path);
+            } catch (const std::exception& e) {
+                error = e.what();
+            }
+
+            std::lock_guard lock(m_decodeMutex);
+            m_decoded.push_back({ [this, path, finish = std::move(decoded.finish), error = std::move(error)] {
+                finishLoad<T>(path, finish, error);
+            }, decoded.size });
+            m_decodedBytes += decoded.size;
+            m_runningDecodes--;
+            startDecodes();
+        });
+        startDecodes();
+
+        return pending.asset;
+    }
+
+    // Creates the assets of the asynchronous loads that finished decoding and lets queued
+    // decodes start in the memory they held. Called once a frame on the main thread, outside
+    // of rendering, as the assets upload through the RenderAPI.
+    void update() {
+        std::vector<DecodedLoad> decoded;
+        {
+            std::lock_guard lock(m_decodeMutex);
+            decoded.swap(m_decoded);
+        }
+
+        size_t finishedBytes = 0;
+        for (auto& load : decoded) {
+            load.finish();
+            // the decoded data is released with the finishing function
+            load.finish = {};
+            finishedBytes += load.size;
+        }
+
+        std::lock_guard lock(m_decodeMutex);
+        m_decodedBytes -= finishedBytes;
+        startDecodes();
+    }
+
+    void setDecodeBudget(size_t bytes) {
+        std::lock_guard lock(m_decodeMutex);
+        m_decodeBudget = bytes;
+        startDecodes();
+    }
+
+    [[nodiscard]] JobSystem* getJobSystem() const { return m_jobSystem; }
+
     template<class T>
     asset_ptr<T> get(const std::string& path) {
         auto& pool = ensurePool<T>();
@@ -322,7 +492,9 @@ public:
         }
     }
 
+    // Drops the asynchronous loads in flight, their placeholders stay
     void reset() {
+        cancelLoads();
         for (auto [id, pool] : m_pools) {
             pool->clear();
         }
@@ -331,9 +503,72 @@ public:
 private:
     using id_type = entt::id_type;
 
+    struct DecodedLoad {
+        std::function<void()> finish;
+        size_t size;
+    };
+
+    JobSystem* m_jobSystem = nullptr;
+    JobCounter m_decoding;
+    std::mutex m_decodeMutex;
+    std::deque<JobSystem::Job> m_queuedDecodes;
+    std::vector<DecodedLoad> m_decoded;
+    size_t m_decodedBytes = 0;
+    size_t m_decodeBudget = kDefaultDecodeBudget;
+    uint32_t m_runningDecodes = 0;
     entt::dense_map<id_type, std::unique_ptr<AssetLoaderBase>> m_loaders;
     entt::dense_map<id_type, std::unique_ptr<AssetPoolBase>> m_pools;
 
+    // Decoding is CPU bound, one decode per worker keeps the others free for frame work.
+    // Called with m_decodeMutex held.
+    void startDecodes() {
+        const uint32_t maxDecodes = std::max(m_jobSystem->getWorkerCount(), 1u);
+        while (!m_queuedDecodes.empty() && m_runningDecodes < maxDecodes && m_decodedBytes < m_decodeBudget) {
+            m_runningDecodes++;
+            m_jobSystem->run(std::move(m_queuedDecodes.front()), &m_decoding);
+            m_queuedDecodes.pop_front();
+        }
+    }
+
+    // Drops the queued decodes and the finished ones without creating their assets, the
+    // decodes already running are joined as a worker can't be interrupted
+    void cancelLoads() {
+        if (!m_jobSystem) {
+            return;
+        }
+        {
+            std::lock_guard lock(m_decodeMutex);
+            m_queuedDecodes.clear();
+        }
+        m_jobSystem->wait(m_decoding);
+
+        std::lock_guard lock(m_decodeMutex);
+        m_decoded.clear();
+        m_decodedBytes = 0;
+    }
+
+    template<class T>
+    void finishLoad(const std::string& path, const typename AssetLoader<T>::FinishLoad& finish, std::string error) {
+        auto& pool = ensurePool<T>();
+        if (finish) {
+            LoadContext<T> context { this, path };
+            try {
+                finish(context);
+            } catch (const std::exception& e) {
+                error = e.what();
+            }
+        }
+        if (!error.empty()) {
+            std::cerr << "Failed to load '" << path << "', keeping its placeholder: " << error << std::endl;
+        }
+
+        auto pending = pool.takePendingLoad(path);
+        asset_ptr<T> asset { pool.get(path) };
+        for (auto& callback : pending.callbacks) {
+            callback(asset);
+        }
+    }
+
     template<class T>
     AssetPool<T>& ensurePool() {
         const id_type id = entt::type_hash<T>::value();
@@ -363,10 +598,18 @@ private:
     friend class LoadContext;
 };
 
+// An asset that is already there is a placeholder finished by an asynchronous load,
+// its contents are replaced in place
 template <typename T>
 template <typename ...Args>
 T& LoadContext<T>::construct(Args&&... args) {
-    return *m_assetManager->ensurePool<T>().emplaceWithPath(m_path, std::forward<Args>(args)...);
+    auto& pool = m_assetManager->ensurePool<T>();
+    if (T* asset = pool.get(m_path)) {
+        *asset = T(std::forward<Args>(args)...);
+        asset->generation++;
+        return *asset;
+    }
+    return *pool.emplaceWithPath(m_path, std::forward<Args>(args)...);
 }
 
 template <typename T>
@@ -375,4 +618,10 @@ asset_ptr<U> LoadContext<T>::load(const std::string& path) {
     return m_assetManager->load<U>(path);
 }
 
+template <typename T>
+template <typename U>
+asset_ptr<U> LoadContext<T>::get(const std::string& path) {
+    return m_assetManager->get<U>(path);
+}
+
 }
@@ -0,0 +1,209 @@
+#include "JobSystem.h"
+
+#include <algorithm>
+#include <cassert>
+
+namespace ailo {
+
+namespace {
+
+struct ThreadContext {
+    const JobSystem* system = nullptr;
+    uint32_t queueIndex = 0;
+};
+
+thread_local ThreadContext t_context;
+
+}
+
+JobSystem::JobSystem(uint32_t workerCount)
+    : m_mainThreadId(std::this_thread::get_id()) {
+    if (workerCount == 0) {
+        workerCount = std::max(std::thread::hardware_concurrency(), 2u) - 1;
+    }
+
+    m_queues.reserve(workerCount + 1);
+    for (uint32_t i = 0; i < workerCount + 1; i++) {
+        m_queues.push_back(std::make_unique<Queue>());
+    }
+
+    m_workers.reserve(workerCount);
+    for (uint32_t i = 0; i < workerCount; i++) {
+        m_workers.emplace_back([this, i] { workerLoop(i + 1); });
+    }
+}
+
+JobSystem::~JobSystem() {
+    {
+        std::lock_guard lock(m_sleepMutex);
+        m_stop = true;
+    }
+    m_wakeCondition.notify_all();
+
+    for (auto& worker : m_workers) {
+        worker.join();
+    }
+}
+
+uint32_t JobSystem::getThreadIndex() const {
+    return t_context.system == this ? t_context.queueIndex : 0;
+}
+
+void JobSystem::run(Job job, JobCounter* counter) {
+    if (counter) {
+        counter->m_pending.fetch_add(1, std::memory_order_relaxed);
+    }
+    push({ std::move(job), counter });
+}
+
+void JobSystem::then(JobCounter& counter, Job continuation, JobCounter* continuationCounter) {
+    if (continuationCounter) {
+        continuationCounter->m_pending.fetch_add(1, std::memory_order_relaxed);
+    }
+    {
+        std::lock_guard lock(counter.m_mutex);
+        if (counter.m_pending.load(std::memory_order_acquire) != 0) {
+            counter.m_continuations.emplace_back(std::move(continuation), continuationCounter);
+            return;
+        }
+    }
+    push({ std::move(continuation), continuationCounter });
+}
+
+void JobSystem::wait(JobCounter& counter) {
+    const bool mainThread = isMainThread();
+
+    while (!counter.isDone()) {
+        if (mainThread) {
+            executeMainThreadJobs();
+        }
+        if (!tryExecuteOne()) {
+            std::this_thread::yield();
+        }
+    }
+
+    // finish() decrements under the lock, taking it once here makes sure that
+    // the finishing thread is done with the counter before the caller destroys it
+    std::lock_guard lock(counter.m_mutex);
+}
+
+void JobSystem::runOnMainThread(Job job, JobCounter* counter) {
+    if (counter) {
+        counter->m_pending.fetch_add(1, std::memory_order_relaxed);
+    }
+    std::lock_guard lock(m_mainThreadMutex);
+    m_mainThreadTasks.push_back({ std::move(job), counter });
+}
+
+void JobSystem::executeMainThreadJobs() {
+    assert(isMainThread());
+
+    std::vector<Task> tasks;
+    {
+        std::lock_guard lock(m_mainThreadMutex);
+        tasks.swap(m_mainThreadTasks);
+    }
+
+    for (auto& task : tasks) {
+        execute(task);
+    }
+}
+
+void JobSystem::push(Task task) {
+    // counted before it becomes visible to thieves, so the count never drops below the queued tasks
+    m_queuedTasks.fetch_add(1, std::memory_order_release);
+    {
+        auto& queue = *m_queues[getThreadIndex()];
+        std::lock_guard lock(queue.mutex);
+        queue.tasks.push_back(std::move(task));
+    }
+
+    {
+        // pairs with the predicate check in workerLoop so the wake up isn't lost
+        std::lock_guard lock(m_sleepMutex);
+    }
+    m_wakeCondition.notify_one();
+}
+
+bool JobSystem::tryPop(Task& task) {
+    auto& queue = *m_queues[getThreadIndex()];
+    std::lock_guard lock(queue.mutex);
+    if (queue.tasks.empty()) {
+        return false;
+    }
+
+    // newest first, its data is most likely still in cache
+    task = std::move(queue.tasks.back());
+    queue.tasks.pop_back();
+    return true;
+}
+
+bool JobSystem::trySteal(uint32_t thiefIndex, Task& task) {
+    const uint32_t count = static_cast<uint32_t>(m_queues.size());
+    for (uint32_t i = 1; i < count; i++) {
+        auto& queue = *m_queues[(thiefIndex + i) % count];
+        std::lock_guard lock(queue.mutex);
+        if (!queue.tasks.empty()) {
+            // oldest first, usually the biggest piece of remaining work
+            task = std::move(queue.tasks.front());
+            queue.tasks.pop_front();
+            return true;
+        }
+    }
+    return false;
+}
+
+bool JobSystem::tryExecuteOne() {
+    Task task;
+    if (!tryPop(task) && !trySteal(getThreadIndex(), task)) {
+        return false;
+    }
+
+    m_queuedTasks.fetch_sub(1, std::memory_order_relaxed);
+    execute(task);
+    return true;
+}
+
+void JobSystem::execute(Task& task) {
+    task.job();
+    finish(task.counter);
+}
+
+void JobSystem::finish(JobCounter* counter) {
+    if (!counter) {
+        return;
+    }
+
+    decltype(counter->m_continuations) continuations;
+    {
+        std::lock_guard lock(counter->m_mutex);
+        if (counter->m_pending.fetch_sub(1, std::memory_order_acq_rel) != 1) {
+            return;
+        }
+        continuations.swap(counter->m_continuations);
+    }
+
+    for (auto& [continuation, continuationCounter] : continuations) {
+        push({ std::move(continuation), continuationCounter });
+    }
+}
+
+void JobSystem::workerLoop(uint32_t index) {
+    t_context = { this, index };
+
+    while (true) {
+        if (tryExecuteOne()) {
+            continue;
+        }
+
+        std::unique_lock lock(m_sleepMutex);
+        m_wakeCondition.wait(lock, [this] {
+            return m_stop || m_queuedTasks.load(std::memory_order_acquire) > 0;
+        });
+        if (m_stop) {
+            return;
+        }
+    }
+}
+
+}
@@ -0,0 +1,134 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace ailo {
+
+class JobSystem;
+
+// Counts unfinished jobs. Continuations attached with JobSystem::then run once it drops to zero.
+// Must outlive the jobs that reference it.
+class JobCounter {
+public:
+    JobCounter() = default;
+    JobCounter(const JobCounter&) = delete;
+    JobCounter& operator=(const JobCounter&) = delete;
+
+    [[nodiscard]] bool isDone() const { return m_pending.load(std::memory_order_acquire) == 0; }
+
+private:
+    friend class JobSystem;
+
+    std::atomic<uint32_t> m_pending { 0 };
+    std::mutex m_mutex;
+    std::vector<std::pair<std::function<void()>, JobCounter*>> m_continuations;
+};
+
+// Work-stealing job system. Each worker owns a deque: it pushes and pops jobs
+// at the back, idle workers steal from the front of the others. Threads that
+// aren't workers (the main thread) submit to a shared queue and help with the
+// work while they wait on a counter.
+class JobSystem {
+public:
+    using Job = std::function<void()>;
+
+    // 0 - one worker per hardware thread, minus the main thread
+    explicit JobSystem(uint32_t workerCount = 0);
+    ~JobSystem();
+
+    JobSystem(const JobSystem&) = delete;
+    JobSystem& operator=(const JobSystem&) = delete;
+
+    // counter, if set, is incremented now and decremented once the job finishes
+    void run(Job job, JobCounter* counter = nullptr);
+
+    // Schedules continuation once counter reaches zero, right away if it already did.
+    // continuationCounter is incremented now, so waiting on it covers the whole chain.
+    void then(JobCounter& counter, Job continuation, JobCounter* continuationCounter = nullptr);
+
+    // Blocks until counter reaches zero, executing pending jobs in the meantime.
+    // On the main thread main-thread jobs are executed as well.
+    void wait(JobCounter& counter);
+
+    // Jobs that must run on the main thread, e.g. anything recording or submitting
+    // Vulkan commands. Executed by executeMainThreadJobs() or while the main thread waits.
+    void runOnMainThread(Job job, JobCounter* counter = nullptr);
+    void executeMainThreadJobs();
+
+    // Calls fn(first, last) for chunks of at most grainSize elements of [begin, end)
+    // in parallel and returns once all of them are done
+    template<typename Fn>
+    void parallelFor(uint32_t begin, uint32_t end, uint32_t grainSize, Fn&& fn);
+
+    [[nodiscard]] uint32_t getWorkerCount() const { return static_cast<uint32_t>(m_workers.size()); }
+    [[nodiscard]] uint32_t getThreadCount() const { return getWorkerCount() + 1; }
+    [[nodiscard]] bool isMainThread() const { return std::this_thread::get_id() == m_mainThreadId; }
+
+    // Index of the calling thread in [0, getThreadCount()), 0 for non-worker threads.
+    // Useful for per-thread scratch data.
+    [[nodiscard]] uint32_t getThreadIndex() const;
+
+private:
+    struct Task {
+        Job job;
+        JobCounter* counter = nullptr;
+    };
+
+    struct alignas(64) Queue {
+        std::mutex mutex;
+        std::deque<Task> tasks;
+    };
+
+    void push(Task task);
+    bool tryPop(Task& task);
+    bool trySteal(uint32_t thiefIndex, Task& task);
+    bool tryExecuteOne();
+    void execute(Task& task);
+    void finish(JobCounter* counter);
+    void workerLoop(uint32_t index);
+
+    // queue 0 is shared by non-worker threads, queue i + 1 belongs to worker i
+    std::vector<std::unique_ptr<Queue>> m_queues;
+    std::vector<std::thread> m_workers;
+
+    std::mutex m_mainThreadMutex;
+    std::vector<Task> m_mainThreadTasks;
+    std::thread::id m_mainThreadId;
+
+    std::mutex m_sleepMutex;
+    std::condition_variable m_wakeCondition;
+    std::atomic<uint32_t> m_queuedTasks { 0 };
+    bool m_stop = false;
+};
+
+template<typename Fn>
+void JobSystem::parallelFor(uint32_t begin, uint32_t end, uint32_t grainSize, Fn&& fn) {
+    if (begin >= end) {
+        return;
+    }
+
+    grainSize = std::max(grainSize, 1u);
+    if (end - begin <= grainSize || m_workers.empty()) {
+        fn(begin, end);
+        return;
+    }
+
+    JobCounter counter;
+    for (uint32_t first = begin; first < end; first += grainSize) {
+        uint32_t last = std::min(end, first + grainSize);
+        run([&fn, first, last] { fn(first, last); }, &counter);
+    }
+    wait(counter);
+}
+
+}
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace ailo {
+
+// LSD radix sort over 64-bit keys, 8 bits per pass. Stable.
+// Passes where every element shares the same digit are skipped, so keys
+// with mostly constant high bits (e.g. pass / pipeline ids) stay cheap.
+// `scratch` is resized to match `items` and may be kept around between calls.
+template<typename T, typename KeyFn>
+void radixSort(std::vector<T>& items, std::vector<T>& scratch, KeyFn&& keyOf) {
+    constexpr uint32_t kRadixBits = 8;
+    constexpr uint32_t kBuckets = 1u << kRadixBits;
+    constexpr uint32_t kPasses = 64 / kRadixBits;
+
+    const size_t count = items.size();
+    if (count < 2) {
+        return;
+    }
+
+    std::array<std::array<uint32_t, kBuckets>, kPasses> histograms {};
+    for (const T& item : items) {
+        uint64_t key = keyOf(item);
+        for (uint32_t pass = 0; pass < kPasses; pass++) {
+            histograms[pass][(key >> (pass * kRadixBits)) & (kBuckets - 1)]++;
+        }
+    }
+
+    scratch.resize(count);
+    std::vector<T>* src = &items;
+    std::vector<T>* dst = &scratch;
+
+    for (uint32_t pass = 0; pass < kPasses; pass++) {
+        auto& histogram = histograms[pass];
+        const uint32_t shift = pass * kRadixBits;
+
+        // all keys fall into one bucket, this digit doesn't change the order
+        if (histogram[(keyOf((*src)[0]) >> shift) & (kBuckets - 1)] == count) {
+            continue;
+        }
+
+        uint32_t offset = 0;
+        for (auto& bucket : histogram) {
+            uint32_t bucketCount = bucket;
+            bucket = offset;
+            offset += bucketCount;
+        }
+
+        for (const T& item : *src) {
+            (*dst)[histogram[(keyOf(item) >> shift) & (kBuckets - 1)]++] = item;
+        }
+        std::swap(src, dst);
+    }
+
+    if (src != &items) {
+        items.swap(scratch);
+    }
+}
+
+}
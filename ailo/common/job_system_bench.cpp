@@ -0,0 +1,68 @@
+#include "JobSystem.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <thread>
+#include <vector>
+
+// Scaling benchmark: runs the same parallelFor workloads with 1..N workers and
+// reports the speedup over the single threaded run.
+
+using namespace ailo;
+
+namespace {
+
+// ~ a renderable worth of work: a handful of matrix-like multiply adds
+void work(std::vector<float>& data, uint32_t first, uint32_t last) {
+    for (uint32_t i = first; i < last; i++) {
+        float v = data[i];
+        for (uint32_t k = 0; k < 64; k++) {
+            v = std::sqrt(v * 1.0001f + 0.5f);
+        }
+        data[i] = v;
+    }
+}
+
+double measure(uint32_t workerCount, uint32_t itemCount, uint32_t grainSize, uint32_t iterations) {
+    JobSystem jobs(workerCount);
+    std::vector<float> data(itemCount, 1.0f);
+
+    // warm up threads and caches
+    jobs.parallelFor(0, itemCount, grainSize, [&data](uint32_t first, uint32_t last) { work(data, first, last); });
+
+    auto start = std::chrono::steady_clock::now();
+    for (uint32_t i = 0; i < iterations; i++) {
+        jobs.parallelFor(0, itemCount, grainSize, [&data](uint32_t first, uint32_t last) { work(data, first, last); });
+    }
+    auto end = std::chrono::steady_clock::now();
+    return std::chrono::duration<double, std::milli>(end - start).count() / iterations;
+}
+
+}
+
+int main() {
+    const uint32_t maxWorkers = std::max(std::thread::hardware_concurrency(), 2u) - 1;
+    const uint32_t itemCount = 100000;
+    const uint32_t iterations = 20;
+
+    for (uint32_t grainSize : { 64u, 256u, 1024u }) {
+        std::printf("items: %u, grain: %u\n", itemCount, grainSize);
+
+        // workerCount == 0 would pick the default, so the serial baseline is a plain loop
+        std::vector<float> data(itemCount, 1.0f);
+        auto start = std::chrono::steady_clock::now();
+        for (uint32_t i = 0; i < iterations; i++) {
+            work(data, 0, itemCount);
+        }
+        double serial = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count() / iterations;
+        std::printf("  serial     %8.3f ms\n", serial);
+
+        for (uint32_t workers = 1; workers <= maxWorkers; workers *= 2) {
+            double ms = measure(workers, itemCount, grainSize, iterations);
+            std::printf("  %2u threads %8.3f ms  x%.2f\n", workers + 1, ms, serial / ms);
+        }
+        std::printf("\n");
+    }
+    return 0;
+}
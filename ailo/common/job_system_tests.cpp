@@ -0,0 +1,189 @@
+#include "JobSystem.h"
+#include <iostream>
+#include <cassert>
+#include <atomic>
+#include <numeric>
+#include <vector>
+
+using namespace ailo;
+
+void test_run_and_wait() {
+    std::cout << "=== test_run_and_wait ===\n";
+
+    JobSystem jobs(3);
+    std::atomic<uint32_t> sum { 0 };
+    JobCounter counter;
+    for (uint32_t i = 1; i <= 1000; i++) {
+        jobs.run([&sum, i] { sum += i; }, &counter);
+    }
+    jobs.wait(counter);
+
+    assert(counter.isDone());
+    assert(sum == 500500);
+    std::cout << "sum: " << sum << "\n\n";
+}
+
+void test_nested_jobs() {
+    std::cout << "=== test_nested_jobs ===\n";
+
+    // jobs spawning jobs land in the worker's own deque and get stolen from there
+    JobSystem jobs(3);
+    std::atomic<uint32_t> leaves { 0 };
+    JobCounter counter;
+    for (uint32_t i = 0; i < 16; i++) {
+        jobs.run([&] {
+            for (uint32_t j = 0; j < 64; j++) {
+                jobs.run([&leaves] { leaves++; }, &counter);
+            }
+        }, &counter);
+    }
+    jobs.wait(counter);
+
+    assert(leaves == 16 * 64);
+    std::cout << "leaves: " << leaves << "\n\n";
+}
+
+void test_wait_inside_job() {
+    std::cout << "=== test_wait_inside_job ===\n";
+
+    // a waiting worker keeps executing jobs instead of blocking, so this can't deadlock
+    // even with a single worker
+    JobSystem jobs(1);
+    std::atomic<uint32_t> count { 0 };
+    JobCounter outer;
+    for (uint32_t i = 0; i < 8; i++) {
+        jobs.run([&] {
+            JobCounter inner;
+            for (uint32_t j = 0; j < 8; j++) {
+                jobs.run([&count] { count++; }, &inner);
+            }
+            jobs.wait(inner);
+        }, &outer);
+    }
+    jobs.wait(outer);
+
+    assert(count == 64);
+    std::cout << "count: " << count << "\n\n";
+}
+
+void test_parallel_for() {
+    std::cout << "=== test_parallel_for ===\n";
+
+    JobSystem jobs(3);
+    std::vector<uint32_t> values(100000, 0);
+    jobs.parallelFor(0, static_cast<uint32_t>(values.size()), 64, [&values](uint32_t first, uint32_t last) {
+        for (uint32_t i = first; i < last; i++) {
+            values[i] += i;
+        }
+    });
+
+    for (uint32_t i = 0; i < values.size(); i++) {
+        assert(values[i] == i);
+    }
+
+    // empty and single chunk ranges
+    uint32_t calls = 0;
+    jobs.parallelFor(5, 5, 16, [&calls](uint32_t, uint32_t) { calls++; });
+    assert(calls == 0);
+    jobs.parallelFor(0, 10, 16, [&calls](uint32_t first, uint32_t last) { calls++; assert(first == 0 && last == 10); });
+    assert(calls == 1);
+    std::cout << "ok\n\n";
+}
+
+void test_continuations() {
+    std::cout << "=== test_continuations ===\n";
+
+    JobSystem jobs(2);
+    std::atomic<uint32_t> produced { 0 };
+    uint32_t observed = 0;
+    JobCounter first;
+    JobCounter second;
+
+    for (uint32_t i = 0; i < 100; i++) {
+        jobs.run([&produced] { produced++; }, &first);
+    }
+    // second is incremented right away, waiting on it covers both stages
+    jobs.then(first, [&] { observed = produced.load(); }, &second);
+    jobs.wait(second);
+
+    assert(first.isDone());
+    assert(observed == 100);
+
+    // attaching to a finished counter schedules right away
+    bool ran = false;
+    JobCounter done;
+    JobCounter after;
+    jobs.then(done, [&ran] { ran = true; }, &after);
+    jobs.wait(after);
+    assert(ran);
+    std::cout << "observed: " << observed << "\n\n";
+}
+
+void test_main_thread_jobs() {
+    std::cout << "=== test_main_thread_jobs ===\n";
+
+    JobSystem jobs(3);
+    assert(jobs.isMainThread());
+
+    std::atomic<uint32_t> onMain { 0 };
+    std::atomic<uint32_t> offMain { 0 };
+    JobCounter counter;
+    for (uint32_t i = 0; i < 32; i++) {
+        jobs.run([&] {
+            // e.g. a worker finished decoding and needs the upload recorded on the main thread
+            jobs.runOnMainThread([&] {
+                if (jobs.isMainThread()) {
+                    onMain++;
+                } else {
+                    offMain++;
+                }
+            }, &counter);
+        }, &counter);
+    }
+    jobs.wait(counter);
+
+    assert(onMain == 32);
+    assert(offMain == 0);
+
+    uint32_t pumped = 0;
+    jobs.runOnMainThread([&pumped] { pumped++; });
+    assert(pumped == 0);
+    jobs.executeMainThreadJobs();
+    assert(pumped == 1);
+    std::cout << "main thread jobs: " << onMain << "\n\n";
+}
+
+void test_thread_index() {
+    std::cout << "=== test_thread_index ===\n";
+
+    JobSystem jobs(3);
+    assert(jobs.getThreadCount() == 4);
+    assert(jobs.getThreadIndex() == 0);
+
+    std::vector<uint64_t> perThread(jobs.getThreadCount(), 0);
+    jobs.parallelFor(0, 10000, 16, [&](uint32_t first, uint32_t last) {
+        uint32_t index = jobs.getThreadIndex();
+        assert(index < jobs.getThreadCount());
+        // each thread only touches its own slot, no synchronization needed
+        for (uint32_t i = first; i < last; i++) {
+            perThread[index] += i;
+        }
+    });
+
+    uint64_t total = std::accumulate(perThread.begin(), perThread.end(), uint64_t(0));
+    assert(total == uint64_t(9999) * 10000 / 2);
+    std::cout << "total: " << total << "\n\n";
+}
+
+int main() {
+    test_run_and_wait();
+    test_nested_jobs();
+    test_wait_inside_job();
+    test_parallel_for();
+    test_continuations();
+    test_main_thread_jobs();
+    test_thread_index();
+
+    std::cout << "All tests passed!\n";
+    return 0;
+}
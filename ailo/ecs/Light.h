@@ -0,0 +1,21 @@
+#pragma once
+#include <glm/glm.hpp>
+
+namespace ailo {
+
+enum class LightType : uint32_t {
+    Point = 0,
+    Spot = 1
+};
+
+// Punctual light placed by the WorldTransform of its entity, spot lights shine along local -Z
+struct Light {
+    LightType type = LightType::Point;
+    glm::vec3 color { 1.0f };
+    float intensity = 1.0f;
+    float radius = 1.0f; // world units, the light fades out to zero at this distance
+    float innerAngle = 0.0f; // spot only, radians from the axis
+    float outerAngle = 0.785398f;
+};
+
+}
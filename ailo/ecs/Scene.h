@@ -31,13 +31,32 @@ class Scene {
     m_registry.remove<Type>(entity);
   }
 
+    template<typename Type>
+    decltype(auto) onConstruct() {
+        return m_registry.on_construct<Type>();
+    }
+
     template<typename Type>
     decltype(auto) onDestroy() {
         return m_registry.on_destroy<Type>();
     }
 
+  // Reorders the storage of Type, views over it iterate in this order
+  template<typename Type, typename Compare>
+  void sort(Compare compare) {
+    m_registry.sort<Type>(std::move(compare));
+  }
+
+  // Orders the storage of To the same way as the storage of From
+  template<typename To, typename From>
+  void sortAs() {
+    m_registry.sort<To, From>();
+  }
+
   decltype(auto) single() const { return m_singleEntity; }
 
+  entt::registry& registry() { return m_registry; }
+
   template<typename Type>
   decltype(auto) get(entt::entity entity) {
     return m_registry.get<Type>(entity);
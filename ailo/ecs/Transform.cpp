@@ -1 +1,37 @@
-#include "Transform.h"
\ No newline at end of file
+#include "Transform.h"
+
+#include <glm/glm.hpp>
+
+namespace ailo {
+
+void Transform::setLocalMatrix(const glm::mat4& matrix) {
+  glm::vec3 axisX(matrix[0]);
+  glm::vec3 axisY(matrix[1]);
+  glm::vec3 axisZ(matrix[2]);
+
+  position = glm::vec3(matrix[3]);
+  scale = { glm::length(axisX), glm::length(axisY), glm::length(axisZ) };
+  if (glm::dot(glm::cross(axisX, axisY), axisZ) < 0.0f) {
+    scale.x = -scale.x; // mirrored basis
+  }
+
+  glm::mat3 basis(1.0f);
+  if (scale.x != 0.0f && scale.y != 0.0f && scale.z != 0.0f) {
+    basis = glm::mat3(axisX / scale.x, axisY / scale.y, axisZ / scale.z);
+  }
+  rotation = glm::normalize(glm::quat_cast(basis));
+  dirty = true;
+}
+
+glm::mat4 Transform::getLocalMatrix() const {
+  // translate * rotate * scale without the matrix products
+  glm::mat3 r = glm::mat3_cast(rotation);
+  return {
+    glm::vec4(r[0] * scale.x, 0.0f),
+    glm::vec4(r[1] * scale.y, 0.0f),
+    glm::vec4(r[2] * scale.z, 0.0f),
+    glm::vec4(position, 1.0f)
+  };
+}
+
+}
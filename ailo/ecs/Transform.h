@@ -1,10 +1,36 @@
 #pragma once
 #include "glm/mat4x4.hpp"
+#include "glm/gtc/quaternion.hpp"
+#include <entt/entity/entity.hpp>
 
 namespace ailo {
 
+// Local transform, relative to the parent or to the world for roots.
+// Go through the setters so TransformSystem picks up the change.
 struct Transform {
-  glm::mat4 transform = glm::mat4(1.0f); // world transform
+  glm::vec3 position { 0.0f };
+  glm::quat rotation { 1.0f, 0.0f, 0.0f, 0.0f };
+  glm::vec3 scale { 1.0f };
+
+  // Can be assigned when the entity is created, use TransformSystem::setParent afterwards
+  entt::entity parent = entt::null;
+  uint32_t depth = 0; // number of ancestors, maintained by TransformSystem
+  bool dirty = true;
+
+  void setPosition(const glm::vec3& value) { position = value; dirty = true; }
+  void setRotation(const glm::quat& value) { rotation = value; dirty = true; }
+  void setScale(const glm::vec3& value) { scale = value; dirty = true; }
+  // Decomposes an affine matrix without shear into TRS
+  void setLocalMatrix(const glm::mat4& matrix);
+
+  [[nodiscard]] glm::mat4 getLocalMatrix() const;
+};
+
+// Cached world space matrices, written by TransformSystem::update
+struct WorldTransform {
+  glm::mat4 matrix = glm::mat4(1.0f);
+  glm::mat4 inverse = glm::mat4(1.0f);
+  bool changed = true; // matrix changed during the last update
 };
 
 }
@@ -0,0 +1,94 @@
+#include "TransformSystem.h"
+
+#include <cassert>
+
+#include "Scene.h"
+#include "Transform.h"
+
+namespace ailo {
+
+TransformSystem::TransformSystem(Scene& scene) : m_scene(scene) {
+  m_scene.onConstruct<Transform>().connect<&TransformSystem::onConstructTransform>(*this);
+  m_scene.onDestroy<Transform>().connect<&TransformSystem::onDestroyTransform>(*this);
+
+  for (auto entity : m_scene.view<Transform>()) {
+    onConstructTransform(m_scene.registry(), entity);
+  }
+}
+
+TransformSystem::~TransformSystem() {
+  m_scene.onConstruct<Transform>().disconnect(this);
+  m_scene.onDestroy<Transform>().disconnect(this);
+}
+
+void TransformSystem::setParent(entt::entity child, entt::entity parent) {
+  auto& transform = m_scene.get<Transform>(child);
+
+#ifndef NDEBUG
+  for (auto ancestor = parent; ancestor != entt::null; ancestor = m_scene.get<Transform>(ancestor).parent) {
+    assert(ancestor != child && "Transform can't be parented to its descendant");
+  }
+#endif
+
+  transform.parent = parent;
+  transform.dirty = true;
+  m_orderDirty = true;
+}
+
+void TransformSystem::update() {
+  if (m_orderDirty) {
+    sortByDepth();
+    m_orderDirty = false;
+  }
+
+  for (const auto& [entity, transform] : m_scene.view<Transform>().each()) {
+    auto& world = m_scene.get<WorldTransform>(entity);
+    const WorldTransform* parentWorld = transform.parent != entt::null ? &m_scene.get<WorldTransform>(transform.parent) : nullptr;
+
+    if (!transform.dirty && !(parentWorld && parentWorld->changed)) {
+      world.changed = false;
+      continue;
+    }
+
+    glm::mat4 local = transform.getLocalMatrix();
+    world.matrix = parentWorld ? parentWorld->matrix * local : local;
+    world.inverse = glm::inverse(world.matrix);
+    world.changed = true;
+    transform.dirty = false;
+  }
+}
+
+void TransformSystem::onConstructTransform(entt::registry& registry, entt::entity entity) {
+  registry.emplace_or_replace<WorldTransform>(entity);
+  m_orderDirty = true;
+}
+
+void TransformSystem::onDestroyTransform(entt::registry& registry, entt::entity entity) {
+  registry.remove<WorldTransform>(entity);
+  m_orderDirty = true;
+}
+
+void TransformSystem::sortByDepth() {
+  auto view = m_scene.view<Transform>();
+
+  // children of destroyed parents become roots
+  for (auto [entity, transform] : view.each()) {
+    if (transform.parent != entt::null && !m_scene.tryGet<Transform>(transform.parent)) {
+      transform.parent = entt::null;
+      transform.dirty = true;
+    }
+  }
+
+  for (auto [entity, transform] : view.each()) {
+    uint32_t depth = 0;
+    for (auto ancestor = transform.parent; ancestor != entt::null; ancestor = m_scene.get<Transform>(ancestor).parent) {
+      depth++;
+    }
+    transform.depth = depth;
+  }
+
+  m_scene.sort<Transform>([](const Transform& lhs, const Transform& rhs) { return lhs.depth < rhs.depth; });
+  m_scene.sortAs<WorldTransform, Transform>();
+}
+
+}
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <entt/entt.hpp>
+
+namespace ailo {
+
+class Scene;
+
+// Keeps WorldTransform of every Transform up to date. Transforms are stored
+// sorted by depth, so a single pass over the storage visits parents before
+// their children. Only dirty transforms and descendants of changed ones are
+// recomputed, a static scene costs one flag check per entity.
+class TransformSystem {
+public:
+  explicit TransformSystem(Scene&);
+  ~TransformSystem();
+
+  TransformSystem(const TransformSystem&) = delete;
+  TransformSystem& operator=(const TransformSystem&) = delete;
+
+  // entt::null makes child a root, its local transform is kept as is
+  void setParent(entt::entity child, entt::entity parent);
+
+  void update();
+
+private:
+  void onConstructTransform(entt::registry&, entt::entity);
+  void onDestroyTransform(entt::registry&, entt::entity);
+  void sortByDepth();
+
+  Scene& m_scene;
+  bool m_orderDirty = true;
+};
+
+}
@@ -3,7 +3,16 @@
 namespace ailo {
 
 static constexpr uint8_t kMaxColorAttachments = 8u;
+static constexpr uint8_t kMaxSubpasses = 4u;
 
 
-static constexpr uint32_t kLightUniformArraySize = 2u;
+// Clustered lighting grid: screen tiles x exponential depth slices
+static constexpr uint32_t kClusterGridX = 16u;
+static constexpr uint32_t kClusterGridY = 9u;
+static constexpr uint32_t kClusterGridZ = 24u;
+static constexpr uint32_t kClusterCount = kClusterGridX * kClusterGridY * kClusterGridZ;
+
+// Cascades are laid out in a kShadowAtlasGrid x kShadowAtlasGrid depth atlas
+static constexpr uint32_t kShadowCascadeCount = 4u;
+static constexpr uint32_t kShadowAtlasGrid = 2u;
 }
@@ -0,0 +1,185 @@
+#include "Culling.h"
+
+#include <algorithm>
+#include <cmath>
+
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#define AILO_CULLING_SSE 1
+#include <xmmintrin.h>
+#endif
+
+namespace ailo {
+
+Aabb Aabb::transform(const glm::mat4& m) const {
+    glm::vec3 c = center();
+    glm::vec3 e = extent();
+
+    glm::vec3 worldCenter = glm::vec3(m * glm::vec4(c, 1.0f));
+    glm::vec3 worldExtent {
+        glm::abs(m[0][0]) * e.x + glm::abs(m[1][0]) * e.y + glm::abs(m[2][0]) * e.z,
+        glm::abs(m[0][1]) * e.x + glm::abs(m[1][1]) * e.y + glm::abs(m[2][1]) * e.z,
+        glm::abs(m[0][2]) * e.x + glm::abs(m[1][2]) * e.y + glm::abs(m[2][2]) * e.z
+    };
+
+    return { worldCenter - worldExtent, worldCenter + worldExtent };
+}
+
+Frustum Frustum::fromViewProjection(const glm::mat4& m) {
+    auto row = [&m](int i) { return glm::vec4(m[0][i], m[1][i], m[2][i], m[3][i]); };
+
+    Frustum frustum {};
+    frustum.planes[Left]   = row(3) + row(0);
+    frustum.planes[Right]  = row(3) - row(0);
+    frustum.planes[Bottom] = row(3) + row(1);
+    frustum.planes[Top]    = row(3) - row(1);
+    frustum.planes[Near]   = row(2);
+    frustum.planes[Far]    = row(3) - row(2);
+
+    for (auto& plane : frustum.planes) {
+        plane /= glm::length(glm::vec3(plane));
+    }
+    return frustum;
+}
+
+std::array<glm::vec3, 8> Frustum::corners(const glm::mat4& viewProjection) {
+    glm::mat4 inverseViewProjection = glm::inverse(viewProjection);
+
+    std::array<glm::vec3, 8> result;
+    for (uint32_t i = 0; i < 8; i++) {
+        glm::vec4 ndc { (i & 1) ? 1.0f : -1.0f, (i & 2) ? 1.0f : -1.0f, (i & 4) ? 1.0f : 0.0f, 1.0f };
+        glm::vec4 world = inverseViewProjection * ndc;
+        result[i] = glm::vec3(world) / world.w;
+    }
+    return result;
+}
+
+Aabb computeAabb(const float* positions, size_t stride, const uint16_t* indices, size_t indexCount) {
+    Aabb aabb {};
+    for (size_t i = 0; i < indexCount; i++) {
+        const float* p = positions + indices[i] * stride;
+        aabb.extend(glm::vec3(p[0], p[1], p[2]));
+    }
+    return aabb;
+}
+
+BoundingSphere computeBoundingSphere(const float* positions, size_t stride, const uint16_t* indices, size_t indexCount, const Aabb& aabb) {
+    BoundingSphere sphere { aabb.center(), 0.0f };
+    float radiusSq = 0.0f;
+    for (size_t i = 0; i < indexCount; i++) {
+        const float* p = positions + indices[i] * stride;
+        glm::vec3 d = glm::vec3(p[0], p[1], p[2]) - sphere.center;
+        radiusSq = std::max(radiusSq, glm::dot(d, d));
+    }
+    sphere.radius = std::sqrt(radiusSq);
+    return sphere;
+}
+
+void CullingBounds::clear() {
+    m_centerX.clear();
+    m_centerY.clear();
+    m_centerZ.clear();
+    m_extentX.clear();
+    m_extentY.clear();
+    m_extentZ.clear();
+    m_count = 0;
+}
+
+void CullingBounds::reserve(size_t count) {
+    m_centerX.reserve(count);
+    m_centerY.reserve(count);
+    m_centerZ.reserve(count);
+    m_extentX.reserve(count);
+    m_extentY.reserve(count);
+    m_extentZ.reserve(count);
+}
+
+void CullingBounds::resize(size_t count) {
+    m_centerX.resize(count);
+    m_centerY.resize(count);
+    m_centerZ.resize(count);
+    m_extentX.resize(count);
+    m_extentY.resize(count);
+    m_extentZ.resize(count);
+    m_count = count;
+}
+
+uint32_t CullingBounds::add(const Aabb& worldBounds) {
+    glm::vec3 c = worldBounds.center();
+    glm::vec3 e = worldBounds.extent();
+    m_centerX.push_back(c.x);
+    m_centerY.push_back(c.y);
+    m_centerZ.push_back(c.z);
+    m_extentX.push_back(e.x);
+    m_extentY.push_back(e.y);
+    m_extentZ.push_back(e.z);
+    return static_cast<uint32_t>(m_count++);
+}
+
+void CullingBounds::set(size_t i, const Aabb& worldBounds) {
+    glm::vec3 c = worldBounds.center();
+    glm::vec3 e = worldBounds.extent();
+    m_centerX[i] = c.x;
+    m_centerY[i] = c.y;
+    m_centerZ[i] = c.z;
+    m_extentX[i] = e.x;
+    m_extentY[i] = e.y;
+    m_extentZ[i] = e.z;
+}
+
+Aabb CullingBounds::get(size_t i) const {
+    glm::vec3 c { m_centerX[i], m_centerY[i], m_centerZ[i] };
+    glm::vec3 e { m_extentX[i], m_extentY[i], m_extentZ[i] };
+    return { c - e, c + e };
+}
+
+void CullingBounds::cull(const Frustum& frustum, std::vector<uint8_t>& visibility) const {
+    visibility.resize(m_count);
+
+    size_t i = 0;
+#if AILO_CULLING_SSE
+    // Box is outside when for some plane: dot(n, c) + d + dot(|n|, e) < 0
+    struct SplatPlane { __m128 x, y, z, w, absX, absY, absZ; };
+    SplatPlane planes[Frustum::Count];
+    for (size_t p = 0; p < Frustum::Count; p++) {
+        const glm::vec4& plane = frustum.planes[p];
+        planes[p] = {
+            _mm_set1_ps(plane.x), _mm_set1_ps(plane.y), _mm_set1_ps(plane.z), _mm_set1_ps(plane.w),
+            _mm_set1_ps(std::abs(plane.x)), _mm_set1_ps(std::abs(plane.y)), _mm_set1_ps(std::abs(plane.z))
+        };
+    }
+
+    for (; i + kLanes <= m_count; i += kLanes) {
+        __m128 cx = _mm_loadu_ps(m_centerX.data() + i);
+        __m128 cy = _mm_loadu_ps(m_centerY.data() + i);
+        __m128 cz = _mm_loadu_ps(m_centerZ.data() + i);
+        __m128 ex = _mm_loadu_ps(m_extentX.data() + i);
+        __m128 ey = _mm_loadu_ps(m_extentY.data() + i);
+        __m128 ez = _mm_loadu_ps(m_extentZ.data() + i);
+
+        __m128 outside = _mm_setzero_ps();
+        for (const auto& p : planes) {
+            __m128 distance = _mm_add_ps(_mm_add_ps(_mm_mul_ps(p.x, cx), _mm_mul_ps(p.y, cy)), _mm_add_ps(_mm_mul_ps(p.z, cz), p.w));
+            __m128 radius = _mm_add_ps(_mm_add_ps(_mm_mul_ps(p.absX, ex), _mm_mul_ps(p.absY, ey)), _mm_mul_ps(p.absZ, ez));
+            outside = _mm_or_ps(outside, _mm_cmplt_ps(_mm_add_ps(distance, radius), _mm_setzero_ps()));
+        }
+
+        int mask = _mm_movemask_ps(outside);
+        visibility[i + 0] = (mask & 1) ? 0 : 1;
+        visibility[i + 1] = (mask & 2) ? 0 : 1;
+        visibility[i + 2] = (mask & 4) ? 0 : 1;
+        visibility[i + 3] = (mask & 8) ? 0 : 1;
+    }
+#endif
+
+    for (; i < m_count; i++) {
+        bool inside = true;
+        for (const glm::vec4& plane : frustum.planes) {
+            float distance = plane.x * m_centerX[i] + plane.y * m_centerY[i] + plane.z * m_centerZ[i] + plane.w;
+            float radius = std::abs(plane.x) * m_extentX[i] + std::abs(plane.y) * m_extentY[i] + std::abs(plane.z) * m_extentZ[i];
+            inside &= distance + radius >= 0.0f;
+        }
+        visibility[i] = inside ? 1 : 0;
+    }
+}
+
+}
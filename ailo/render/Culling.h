@@ -0,0 +1,83 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <array>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+namespace ailo {
+
+struct Aabb {
+    glm::vec3 min { std::numeric_limits<float>::max() };
+    glm::vec3 max { std::numeric_limits<float>::lowest() };
+
+    void extend(const glm::vec3& point) {
+        min = glm::min(min, point);
+        max = glm::max(max, point);
+    }
+
+    void extend(const Aabb& other) {
+        min = glm::min(min, other.min);
+        max = glm::max(max, other.max);
+    }
+
+    [[nodiscard]] bool isEmpty() const { return min.x > max.x || min.y > max.y || min.z > max.z; }
+    [[nodiscard]] glm::vec3 center() const { return (min + max) * 0.5f; }
+    [[nodiscard]] glm::vec3 extent() const { return (max - min) * 0.5f; }
+
+    // Bounds of this box after an affine transform (Arvo's method)
+    [[nodiscard]] Aabb transform(const glm::mat4& m) const;
+};
+
+struct BoundingSphere {
+    glm::vec3 center { 0.0f };
+    float radius = 0.0f;
+};
+
+struct Frustum {
+    enum Plane { Left, Right, Bottom, Top, Near, Far, Count };
+
+    // xyz - inward facing normal, w - distance: dot(xyz, p) + w >= 0 inside
+    std::array<glm::vec4, Count> planes;
+
+    // Expects a [0, 1] clip space depth range
+    static Frustum fromViewProjection(const glm::mat4& viewProjection);
+
+    // World space corners, near plane first
+    static std::array<glm::vec3, 8> corners(const glm::mat4& viewProjection);
+};
+
+// Positions are read with the given stride, starting at the float pointer
+Aabb computeAabb(const float* positions, size_t stride, const uint16_t* indices, size_t indexCount);
+BoundingSphere computeBoundingSphere(const float* positions, size_t stride, const uint16_t* indices, size_t indexCount, const Aabb& aabb);
+
+// World space bounds stored as SoA so the frustum can be tested 4 boxes at a time
+class CullingBounds {
+public:
+    void clear();
+    void reserve(size_t count);
+    void resize(size_t count);
+    uint32_t add(const Aabb& worldBounds);
+    // Distinct indices can be set from different threads
+    void set(size_t i, const Aabb& worldBounds);
+    [[nodiscard]] size_t size() const { return m_count; }
+    [[nodiscard]] Aabb get(size_t i) const;
+
+    // Writes 1 to visibility[i] when box i intersects the frustum, 0 otherwise
+    void cull(const Frustum& frustum, std::vector<uint8_t>& visibility) const;
+
+private:
+    static constexpr size_t kLanes = 4;
+
+    std::vector<float> m_centerX;
+    std::vector<float> m_centerY;
+    std::vector<float> m_centerZ;
+    std::vector<float> m_extentX;
+    std::vector<float> m_extentY;
+    std::vector<float> m_extentZ;
+    size_t m_count = 0;
+};
+
+}
@@ -0,0 +1,217 @@
+#include "GeometryArena.h"
+
+#include <algorithm>
+#include <cassert>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
+
+namespace ailo {
+
+RangeAllocator::RangeAllocator(uint32_t capacity) : m_capacity(capacity), m_freeSize(0) {
+    if (capacity > 0) {
+        insertFree(0, capacity);
+    }
+}
+
+uint32_t RangeAllocator::allocate(uint32_t size) {
+    if (size == 0) {
+        return 0;
+    }
+    auto best = m_freeBySize.lower_bound({ size, 0 });
+    if (best == m_freeBySize.end()) {
+        return kInvalidOffset;
+    }
+
+    const auto [rangeSize, offset] = *best;
+    eraseFree(m_freeByOffset.find(offset));
+    if (rangeSize > size) {
+        insertFree(offset + size, rangeSize - size);
+    }
+    return offset;
+}
+
+void RangeAllocator::free(uint32_t offset, uint32_t size) {
+    if (size == 0) {
+        return;
+    }
+    assert(offset + size <= m_capacity);
+
+    auto next = m_freeByOffset.lower_bound(offset);
+    if (next != m_freeByOffset.begin()) {
+        auto previous = std::prev(next);
+        assert(previous->first + previous->second <= offset);
+        if (previous->first + previous->second == offset) {
+            offset = previous->first;
+            size += previous->second;
+            eraseFree(previous);
+        }
+    }
+    if (next != m_freeByOffset.end() && offset + size == next->first) {
+        size += next->second;
+        eraseFree(next);
+    }
+    insertFree(offset, size);
+}
+
+void RangeAllocator::insertFree(uint32_t offset, uint32_t size) {
+    m_freeByOffset.emplace(offset, size);
+    m_freeBySize.emplace(size, offset);
+    m_freeSize += size;
+}
+
+void RangeAllocator::eraseFree(std::map<uint32_t, uint32_t>::iterator it) {
+    m_freeSize -= it->second;
+    m_freeBySize.erase({ it->second, it->first });
+    m_freeByOffset.erase(it);
+}
+
+GeometryRange::GeometryRange(std::shared_ptr<GeometryArena> arena, uint32_t vertexCount, uint32_t indexCount)
+    : m_arena(std::move(arena)), m_vertexCount(vertexCount), m_indexCount(indexCount) {
+    m_block = m_arena->allocate(vertexCount, indexCount, m_baseVertex, m_firstIndex);
+}
+
+GeometryRange::GeometryRange(GeometryRange&& other) noexcept
+    : m_arena(std::move(other.m_arena)),
+      m_block(other.m_block),
+      m_baseVertex(other.m_baseVertex),
+      m_vertexCount(other.m_vertexCount),
+      m_firstIndex(other.m_firstIndex),
+      m_indexCount(other.m_indexCount) {
+    other.m_arena = nullptr;
+}
+
+GeometryRange& GeometryRange::operator=(GeometryRange&& other) noexcept {
+    if (this != &other) {
+        release();
+        m_arena = std::move(other.m_arena);
+        m_block = other.m_block;
+        m_baseVertex = other.m_baseVertex;
+        m_vertexCount = other.m_vertexCount;
+        m_firstIndex = other.m_firstIndex;
+        m_indexCount = other.m_indexCount;
+        other.m_arena = nullptr;
+    }
+    return *this;
+}
+
+GeometryRange::~GeometryRange() {
+    release();
+}
+
+void GeometryRange::release() {
+    if (m_arena) {
+        m_arena->free(m_block, m_baseVertex, m_vertexCount, m_firstIndex, m_indexCount);
+        m_arena = nullptr;
+    }
+}
+
+void GeometryRange::updateVertices(const void* data, uint64_t byteSize) {
+    assert(byteSize <= uint64_t(m_vertexCount) * m_arena->m_vertexStride);
+    m_arena->m_renderAPI->updateBuffer(m_arena->m_blocks[m_block].vertexBuffer, data, byteSize,
+        uint64_t(m_baseVertex) * m_arena->m_vertexStride);
+}
+
+void GeometryRange::updateIndices(const uint16_t* indices, uint32_t count) {
+    assert(count <= m_indexCount);
+    m_arena->m_renderAPI->updateBuffer(m_arena->m_blocks[m_block].indexBuffer, indices, count * sizeof(uint16_t),
+        uint64_t(m_firstIndex) * sizeof(uint16_t));
+}
+
+BufferHandle GeometryRange::getVertexBuffer() const {
+    return m_arena->m_blocks[m_block].vertexBuffer;
+}
+
+BufferHandle GeometryRange::getIndexBuffer() const {
+    return m_arena->m_blocks[m_block].indexBuffer;
+}
+
+VertexBufferLayoutHandle GeometryRange::getLayout() const {
+    return m_arena->m_layout;
+}
+
+GeometryArena::GeometryArena(RenderAPI* renderApi, const VertexInputDescription& description)
+    : m_renderAPI(renderApi),
+      m_layout(renderApi->createVertexBufferLayout(description)),
+      m_vertexStride(description.bindings.at(0).stride) {
+}
+
+GeometryArena::~GeometryArena() {
+    for (auto& block : m_blocks) {
+        m_renderAPI->destroyBuffer(block.vertexBuffer);
+        m_renderAPI->destroyBuffer(block.indexBuffer);
+    }
+    m_renderAPI->destroyVertexBufferLayout(m_layout);
+}
+
+std::shared_ptr<GeometryArena> GeometryArena::get(RenderAPI* renderApi, const VertexInputDescription& description) {
+    // the layout of a single interleaved binding identifies the format
+    std::string key = std::to_string(reinterpret_cast<uintptr_t>(renderApi));
+    for (const auto& binding : description.bindings) {
+        key += "|" + std::to_string(binding.binding) + ":" + std::to_string(binding.stride);
+    }
+    for (const auto& attribute : description.attributes) {
+        key += "|" + std::to_string(attribute.location) + ":" + std::to_string(std::to_underlying(attribute.format))
+             + ":" + std::to_string(attribute.offset);
+    }
+
+    static std::mutex mutex;
+    static std::unordered_map<std::string, std::weak_ptr<GeometryArena>> arenas;
+    std::lock_guard lock(mutex);
+    // drop the arenas whose last range is gone, keys of old RenderAPIs and layouts would pile up
+    std::erase_if(arenas, [](const auto& arena) { return arena.second.expired(); });
+    auto& entry = arenas[key];
+    auto arena = entry.lock();
+    if (!arena) {
+        arena = std::make_shared<GeometryArena>(renderApi, description);
+        entry = arena;
+    }
+    return arena;
+}
+
+uint32_t GeometryArena::allocate(uint32_t vertexCount, uint32_t indexCount, uint32_t& baseVertex, uint32_t& firstIndex) {
+    for (uint32_t i = 0; i < m_blocks.size(); i++) {
+        Block& block = m_blocks[i];
+        uint32_t vertices = block.vertices.allocate(vertexCount);
+        if (vertices == RangeAllocator::kInvalidOffset) {
+            continue;
+        }
+        uint32_t indices = block.indices.allocate(indexCount);
+        if (indices == RangeAllocator::kInvalidOffset) {
+            block.vertices.free(vertices, vertexCount);
+            continue;
+        }
+        baseVertex = vertices;
+        firstIndex = indices;
+        return i;
+    }
+
+    uint64_t vertexCapacity = std::max<uint64_t>(kMinBlockVertexBytes / m_vertexStride, 1);
+    uint64_t indexCapacity = kMinBlockIndices;
+    if (!m_blocks.empty()) {
+        vertexCapacity = uint64_t(m_blocks.back().vertices.getCapacity()) * 2;
+        indexCapacity = uint64_t(m_blocks.back().indices.getCapacity()) * 2;
+    }
+    vertexCapacity = std::min<uint64_t>(std::max<uint64_t>(vertexCapacity, vertexCount), kMaxBlockVertices);
+    indexCapacity = std::min<uint64_t>(std::max<uint64_t>(indexCapacity, indexCount), std::numeric_limits<uint32_t>::max() / sizeof(uint16_t));
+
+    Block block {
+        .vertexBuffer = m_renderAPI->createBuffer(BufferBinding::VERTEX, vertexCapacity * m_vertexStride),
+        .indexBuffer = m_renderAPI->createBuffer(BufferBinding::INDEX, indexCapacity * sizeof(uint16_t)),
+        .vertices = RangeAllocator(static_cast<uint32_t>(vertexCapacity)),
+        .indices = RangeAllocator(static_cast<uint32_t>(indexCapacity)),
+    };
+    baseVertex = block.vertices.allocate(vertexCount);
+    firstIndex = block.indices.allocate(indexCount);
+    assert(baseVertex != RangeAllocator::kInvalidOffset && firstIndex != RangeAllocator::kInvalidOffset);
+    m_blocks.push_back(std::move(block));
+    return static_cast<uint32_t>(m_blocks.size() - 1);
+}
+
+void GeometryArena::free(uint32_t block, uint32_t baseVertex, uint32_t vertexCount, uint32_t firstIndex, uint32_t indexCount) {
+    m_blocks[block].vertices.free(baseVertex, vertexCount);
+    m_blocks[block].indices.free(firstIndex, indexCount);
+}
+
+}
@@ -0,0 +1,113 @@
+#pragma once
+
+#include "RenderAPI.h"
+
+#include <limits>
+#include <map>
+#include <memory>
+#include <set>
+#include <vector>
+
+namespace ailo {
+
+// Best fit suballocator of [0, capacity), freed ranges merge with their free neighbours
+class RangeAllocator {
+public:
+    static constexpr uint32_t kInvalidOffset = std::numeric_limits<uint32_t>::max();
+
+    explicit RangeAllocator(uint32_t capacity);
+
+    // kInvalidOffset when no free range is large enough
+    uint32_t allocate(uint32_t size);
+    void free(uint32_t offset, uint32_t size);
+
+    uint32_t getCapacity() const { return m_capacity; }
+    uint32_t getFreeSize() const { return m_freeSize; }
+
+private:
+    void insertFree(uint32_t offset, uint32_t size);
+    void eraseFree(std::map<uint32_t, uint32_t>::iterator it);
+
+    std::map<uint32_t, uint32_t> m_freeByOffset; // offset -> size
+    std::set<std::pair<uint32_t, uint32_t>> m_freeBySize; // (size, offset)
+    uint32_t m_capacity;
+    uint32_t m_freeSize;
+};
+
+class GeometryArena;
+
+// Vertex and index ranges of one mesh in a GeometryArena, returned to it on destruction.
+// Indices are relative to the first vertex, draws pass getBaseVertex() as the vertex offset.
+class GeometryRange {
+public:
+    GeometryRange() = default;
+    GeometryRange(std::shared_ptr<GeometryArena> arena, uint32_t vertexCount, uint32_t indexCount);
+    GeometryRange(GeometryRange&& other) noexcept;
+    GeometryRange& operator=(GeometryRange&& other) noexcept;
+    GeometryRange(const GeometryRange&) = delete;
+    GeometryRange& operator=(const GeometryRange&) = delete;
+    ~GeometryRange();
+
+    void updateVertices(const void* data, uint64_t byteSize);
+    void updateIndices(const uint16_t* indices, uint32_t count);
+
+    BufferHandle getVertexBuffer() const;
+    BufferHandle getIndexBuffer() const;
+    VertexBufferLayoutHandle getLayout() const;
+    int32_t getBaseVertex() const { return static_cast<int32_t>(m_baseVertex); }
+    uint32_t getFirstIndex() const { return m_firstIndex; }
+    uint32_t getVertexCount() const { return m_vertexCount; }
+    uint32_t getIndexCount() const { return m_indexCount; }
+    explicit operator bool() const { return m_arena != nullptr; }
+
+private:
+    void release();
+
+    std::shared_ptr<GeometryArena> m_arena;
+    uint32_t m_block = 0;
+    uint32_t m_baseVertex = 0;
+    uint32_t m_vertexCount = 0;
+    uint32_t m_firstIndex = 0;
+    uint32_t m_indexCount = 0;
+};
+
+// Large vertex and index buffers shared by the meshes of one vertex format, so their draws
+// don't rebind buffers. When a block is full the next one is twice as large.
+class GeometryArena {
+public:
+    GeometryArena(RenderAPI*, const VertexInputDescription&);
+    ~GeometryArena();
+
+    // One arena per vertex format, alive while a range of it is
+    static std::shared_ptr<GeometryArena> get(RenderAPI*, const VertexInputDescription&);
+
+    VertexBufferLayoutHandle getLayout() const { return m_layout; }
+    uint32_t getVertexStride() const { return m_vertexStride; }
+    size_t getBlockCount() const { return m_blocks.size(); }
+
+private:
+    friend class GeometryRange;
+
+    struct Block {
+        BufferHandle vertexBuffer;
+        BufferHandle indexBuffer;
+        RangeAllocator vertices;
+        RangeAllocator indices;
+    };
+
+    // Returns the block and fills the offsets, a new block is created when none fits
+    uint32_t allocate(uint32_t vertexCount, uint32_t indexCount, uint32_t& baseVertex, uint32_t& firstIndex);
+    void free(uint32_t block, uint32_t baseVertex, uint32_t vertexCount, uint32_t firstIndex, uint32_t indexCount);
+
+    static constexpr uint64_t kMinBlockVertexBytes = 8ull << 20;
+    static constexpr uint32_t kMinBlockIndices = 2u << 20;
+    // vertex offsets are signed in draw commands
+    static constexpr uint32_t kMaxBlockVertices = std::numeric_limits<int32_t>::max();
+
+    RenderAPI* m_renderAPI;
+    VertexBufferLayoutHandle m_layout;
+    uint32_t m_vertexStride;
+    std::vector<Block> m_blocks;
+};
+
+}
@@ -0,0 +1,192 @@
+#include "Ktx2.h"
+
+#include <algorithm>
+#include <bit>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <stdexcept>
+
+namespace ailo {
+
+static constexpr uint8_t kIdentifier[12] = { 0xAB, 0x4B, 0x54, 0x58, 0x20, 0x32, 0x30, 0xBB, 0x0D, 0x0A, 0x1A, 0x0A };
+
+struct Ktx2Header {
+    uint8_t identifier[12];
+    uint32_t vkFormat;
+    uint32_t typeSize;
+    uint32_t pixelWidth;
+    uint32_t pixelHeight;
+    uint32_t pixelDepth;
+    uint32_t layerCount;
+    uint32_t faceCount;
+    uint32_t levelCount;
+    uint32_t supercompressionScheme;
+    uint32_t dfdByteOffset;
+    uint32_t dfdByteLength;
+    uint32_t kvdByteOffset;
+    uint32_t kvdByteLength;
+    uint64_t sgdByteOffset;
+    uint64_t sgdByteLength;
+};
+static_assert(sizeof(Ktx2Header) == 80);
+
+struct Ktx2LevelIndex {
+    uint64_t byteOffset;
+    uint64_t byteLength;
+    uint64_t uncompressedByteLength;
+};
+
+// Khronos data format descriptor values of the formats above
+static constexpr uint32_t kColorModelBC1A = 128;
+static constexpr uint32_t kColorModelBC4 = 131;
+static constexpr uint32_t kColorModelBC5 = 132;
+static constexpr uint32_t kColorModelBC7 = 134;
+static constexpr uint32_t kPrimariesBT709 = 1;
+static constexpr uint32_t kTransferLinear = 1;
+static constexpr uint32_t kTransferSrgb = 2;
+
+uint32_t getBlockSize(Ktx2Format format) {
+    switch (format) {
+        case Ktx2Format::BC1RgbUnorm:
+        case Ktx2Format::BC1RgbSrgb:
+        case Ktx2Format::BC4Unorm:
+            return 8;
+        case Ktx2Format::BC5Unorm:
+        case Ktx2Format::BC7Unorm:
+        case Ktx2Format::BC7Srgb:
+            return 16;
+    }
+    return 0;
+}
+
+static uint64_t getLevelSize(Ktx2Format format, uint32_t width, uint32_t height) {
+    return uint64_t((width + 3) / 4) * ((height + 3) / 4) * getBlockSize(format);
+}
+
+// Basic descriptor block, one sample per 64 or 128 bit channel of the block
+static std::vector<uint32_t> makeDescriptor(Ktx2Format format) {
+    uint32_t colorModel = kColorModelBC7;
+    uint32_t transfer = kTransferLinear;
+    std::vector<uint32_t> channels = { 0 };
+    switch (format) {
+        case Ktx2Format::BC1RgbSrgb: transfer = kTransferSrgb; [[fallthrough]];
+        case Ktx2Format::BC1RgbUnorm: colorModel = kColorModelBC1A; break;
+        case Ktx2Format::BC4Unorm: colorModel = kColorModelBC4; break;
+        case Ktx2Format::BC5Unorm: colorModel = kColorModelBC5; channels = { 0, 1 }; break;
+        case Ktx2Format::BC7Srgb: transfer = kTransferSrgb; [[fallthrough]];
+        case Ktx2Format::BC7Unorm: colorModel = kColorModelBC7; break;
+    }
+
+    const uint32_t blockSize = getBlockSize(format);
+    const uint32_t sampleBits = blockSize * 8 / static_cast<uint32_t>(channels.size());
+    const uint32_t descriptorBlockSize = 24 + 16 * static_cast<uint32_t>(channels.size());
+
+    std::vector<uint32_t> words;
+    words.push_back(4 + descriptorBlockSize); // dfdTotalSize
+    words.push_back(0);                       // vendor and descriptor type: Khronos basic
+    words.push_back(2 | (descriptorBlockSize << 16));
+    words.push_back(colorModel | (kPrimariesBT709 << 8) | (transfer << 16));
+    words.push_back(3 | (3 << 8));            // 4x4 texel block, dimensions minus one
+    words.push_back(blockSize);               // bytesPlane0
+    words.push_back(0);
+    for (size_t i = 0; i < channels.size(); i++) {
+        const uint32_t bitOffset = static_cast<uint32_t>(i) * sampleBits;
+        words.push_back(bitOffset | ((sampleBits - 1) << 16) | (channels[i] << 24));
+        words.push_back(0);          // sample position
+        words.push_back(0);          // sampleLower
+        words.push_back(0xFFFFFFFF); // sampleUpper
+    }
+    return words;
+}
+
+bool isKtx2File(const std::string& path) {
+    return std::filesystem::path(path).extension() == kKtx2Extension;
+}
+
+Ktx2Image parseKtx2(std::span<const std::byte> data) {
+    Ktx2Header header {};
+    if (data.size() < sizeof(header)) {
+        throw std::runtime_error("Not a KTX2 file");
+    }
+    std::memcpy(&header, data.data(), sizeof(header));
+    if (std::memcmp(header.identifier, kIdentifier, sizeof(kIdentifier)) != 0) {
+        throw std::runtime_error("Not a KTX2 file");
+    }
+
+    const auto format = static_cast<Ktx2Format>(header.vkFormat);
+    if (getBlockSize(format) == 0) {
+        throw std::runtime_error("Unsupported KTX2 format " + std::to_string(header.vkFormat));
+    }
+    if (header.pixelWidth == 0 || header.pixelHeight == 0 || header.pixelDepth != 0 || header.layerCount > 1 ||
+        header.faceCount != 1 || header.supercompressionScheme != 0) {
+        throw std::runtime_error("Unsupported KTX2 layout, expected one 2D image without supercompression");
+    }
+    // a level count of 0 asks the loader to generate the mips, texture-compress always writes them
+    const uint32_t maxLevels = 32 - static_cast<uint32_t>(std::countl_zero(std::max(header.pixelWidth, header.pixelHeight)));
+    if (header.levelCount == 0 || header.levelCount > maxLevels ||
+        (data.size() - sizeof(header)) / sizeof(Ktx2LevelIndex) < header.levelCount) {
+        throw std::runtime_error("Corrupt KTX2 level count");
+    }
+
+    Ktx2Image image { format, header.pixelWidth, header.pixelHeight, {} };
+    for (uint32_t level = 0; level < header.levelCount; level++) {
+        Ktx2LevelIndex index {};
+        std::memcpy(&index, data.data() + sizeof(header) + level * sizeof(index), sizeof(index));
+
+        const uint64_t expected = getLevelSize(format, std::max(header.pixelWidth >> level, 1u), std::max(header.pixelHeight >> level, 1u));
+        if (index.byteLength != expected || index.byteOffset > data.size() || index.byteLength > data.size() - index.byteOffset) {
+            throw std::runtime_error("Corrupt KTX2 level " + std::to_string(level));
+        }
+        image.levels.push_back(data.subspan(index.byteOffset, index.byteLength));
+    }
+    return image;
+}
+
+bool writeKtx2(const std::string& path, Ktx2Format format, uint32_t width, uint32_t height,
+               const std::vector<std::vector<std::byte>>& levels) {
+    const uint32_t levelCount = static_cast<uint32_t>(levels.size());
+    for (uint32_t level = 0; level < levelCount; level++) {
+        if (levels[level].size() != getLevelSize(format, std::max(width >> level, 1u), std::max(height >> level, 1u))) {
+            return false;
+        }
+    }
+
+    const std::vector<uint32_t> descriptor = makeDescriptor(format);
+    Ktx2Header header {};
+    std::memcpy(header.identifier, kIdentifier, sizeof(kIdentifier));
+    header.vkFormat = static_cast<uint32_t>(format);
+    header.typeSize = 1;
+    header.pixelWidth = width;
+    header.pixelHeight = height;
+    header.faceCount = 1;
+    header.levelCount = levelCount;
+    header.dfdByteOffset = static_cast<uint32_t>(sizeof(header) + levelCount * sizeof(Ktx2LevelIndex));
+    header.dfdByteLength = static_cast<uint32_t>(descriptor.size() * sizeof(uint32_t));
+
+    // level data goes smallest first, each level aligned to its block size
+    const uint64_t alignment = getBlockSize(format);
+    std::vector<Ktx2LevelIndex> index(levelCount);
+    uint64_t offset = header.dfdByteOffset + header.dfdByteLength;
+    for (uint32_t level = levelCount; level-- > 0;) {
+        offset = (offset + alignment - 1) / alignment * alignment;
+        index[level] = { offset, levels[level].size(), levels[level].size() };
+        offset += levels[level].size();
+    }
+
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    if (!file.is_open()) {
+        return false;
+    }
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    file.write(reinterpret_cast<const char*>(index.data()), static_cast<std::streamsize>(index.size() * sizeof(Ktx2LevelIndex)));
+    file.write(reinterpret_cast<const char*>(descriptor.data()), header.dfdByteLength);
+    for (uint32_t level = levelCount; level-- > 0;) {
+        const std::vector<char> padding(index[level].byteOffset - static_cast<uint64_t>(file.tellp()), 0);
+        file.write(padding.data(), static_cast<std::streamsize>(padding.size()));
+        file.write(reinterpret_cast<const char*>(levels[level].data()), static_cast<std::streamsize>(levels[level].size()));
+    }
+    return file.good();
+}
+
+}
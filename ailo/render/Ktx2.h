@@ -0,0 +1,44 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <string>
+#include <vector>
+
+namespace ailo {
+
+// Khronos KTX 2.0 container, the subset `resgen texture-compress` writes: one 2D image and
+// its mip chain in a block compressed format, without supercompression.
+inline constexpr const char* kKtx2Extension = ".ktx2";
+
+// VkFormat values, so resgen doesn't need the Vulkan headers
+enum class Ktx2Format : uint32_t {
+    BC1RgbUnorm = 131,
+    BC1RgbSrgb = 132,
+    BC4Unorm = 139,
+    BC5Unorm = 141,
+    BC7Unorm = 145,
+    BC7Srgb = 146,
+};
+
+// Bytes of a 4x4 block
+uint32_t getBlockSize(Ktx2Format format);
+
+struct Ktx2Image {
+    Ktx2Format format;
+    uint32_t width;
+    uint32_t height;
+    std::vector<std::span<const std::byte>> levels; // largest first, views into the parsed data
+};
+
+bool isKtx2File(const std::string& path);
+
+// Throws std::runtime_error when data isn't a KTX2 file of a format above
+Ktx2Image parseKtx2(std::span<const std::byte> data);
+
+// levels are largest first. Returns false when the file can't be written
+bool writeKtx2(const std::string& path, Ktx2Format format, uint32_t width, uint32_t height,
+               const std::vector<std::vector<std::byte>>& levels);
+
+}
@@ -0,0 +1,194 @@
+#include "LightClusters.h"
+
+#include "common/JobSystem.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace ailo {
+
+namespace {
+
+constexpr uint32_t kTilesPerSlice = kClusterGridX * kClusterGridY;
+constexpr uint32_t kLightsPerJob = 256;
+
+bool intersects(const BoundingSphere& sphere, const Aabb& aabb) {
+    glm::vec3 closest = glm::min(glm::max(sphere.center, aabb.min), aabb.max);
+    glm::vec3 d = sphere.center - closest;
+    return glm::dot(d, d) <= sphere.radius * sphere.radius;
+}
+
+uint32_t getTile(float ndc, uint32_t count) {
+    float tile = std::floor((ndc * 0.5f + 0.5f) * float(count));
+    return uint32_t(std::clamp(tile, 0.0f, float(count - 1)));
+}
+
+}
+
+void LightClusters::setProjection(const glm::mat4& projection, float nearDistance, float farDistance) {
+    if (projection == m_projection && !m_bounds.empty()) {
+        return;
+    }
+
+    m_projection = projection;
+    m_near = nearDistance;
+    m_far = farDistance;
+
+    // slice k starts at near * (far / near) ^ (k / kClusterGridZ)
+    float logRange = std::log(m_far / m_near);
+    m_depthSliceScaleBias = { float(kClusterGridZ) / logRange, -float(kClusterGridZ) * std::log(m_near) / logRange };
+
+    // Corners of every tile on the near plane, scaled along their view rays to the slice depths
+    glm::mat4 inverseProjection = glm::inverse(projection);
+    auto nearPoint = [&inverseProjection](float x, float y) {
+        glm::vec4 p = inverseProjection * glm::vec4(x, y, 0.0f, 1.0f);
+        return glm::vec3(p) / p.w;
+    };
+
+    m_bounds.resize(kClusterCount);
+    for (uint32_t y = 0; y < kClusterGridY; y++) {
+        float y0 = -1.0f + 2.0f * float(y) / kClusterGridY;
+        float y1 = -1.0f + 2.0f * float(y + 1) / kClusterGridY;
+        for (uint32_t x = 0; x < kClusterGridX; x++) {
+            float x0 = -1.0f + 2.0f * float(x) / kClusterGridX;
+            float x1 = -1.0f + 2.0f * float(x + 1) / kClusterGridX;
+            const glm::vec3 corners[4] = { nearPoint(x0, y0), nearPoint(x1, y0), nearPoint(x0, y1), nearPoint(x1, y1) };
+
+            for (uint32_t z = 0; z < kClusterGridZ; z++) {
+                float sliceNear = m_near * std::pow(m_far / m_near, float(z) / kClusterGridZ);
+                float sliceFar = m_near * std::pow(m_far / m_near, float(z + 1) / kClusterGridZ);
+
+                Aabb& aabb = m_bounds[x + kClusterGridX * (y + kClusterGridY * z)];
+                aabb = {};
+                for (const auto& corner : corners) {
+                    aabb.extend(corner * (sliceNear / m_near));
+                    aabb.extend(corner * (sliceFar / m_near));
+                }
+            }
+        }
+    }
+}
+
+uint32_t LightClusters::getSlice(float viewDepth) const {
+    float slice = std::floor(std::log(std::max(viewDepth, m_near)) * m_depthSliceScaleBias.x + m_depthSliceScaleBias.y);
+    return uint32_t(std::clamp(slice, 0.0f, float(kClusterGridZ - 1)));
+}
+
+LightClusters::LightRange LightClusters::computeRange(const BoundingSphere& light) const {
+    LightRange range { { 0, 0, 1 }, { kClusterGridX - 1, kClusterGridY - 1, 0 } };
+
+    // view space looks down -z
+    float minDepth = -light.center.z - light.radius;
+    float maxDepth = -light.center.z + light.radius;
+    if (maxDepth <= m_near || minDepth >= m_far) {
+        return range;
+    }
+    range.min[2] = getSlice(minDepth);
+    range.max[2] = getSlice(maxDepth);
+
+    // Spheres crossing the near plane can't be projected, they keep the full screen
+    if (minDepth <= m_near) {
+        return range;
+    }
+
+    glm::vec2 ndcMin { std::numeric_limits<float>::max() };
+    glm::vec2 ndcMax { std::numeric_limits<float>::lowest() };
+    for (uint32_t i = 0; i < 8; i++) {
+        glm::vec3 corner = light.center + glm::vec3(
+            (i & 1) ? light.radius : -light.radius,
+            (i & 2) ? light.radius : -light.radius,
+            (i & 4) ? light.radius : -light.radius);
+        glm::vec4 clip = m_projection * glm::vec4(corner, 1.0f);
+        glm::vec2 ndc = glm::vec2(clip) / clip.w;
+        ndcMin = glm::min(ndcMin, ndc);
+        ndcMax = glm::max(ndcMax, ndc);
+    }
+
+    if (ndcMax.x < -1.0f || ndcMin.x > 1.0f || ndcMax.y < -1.0f || ndcMin.y > 1.0f) {
+        range.min[2] = 1;
+        range.max[2] = 0;
+        return range;
+    }
+
+    range.min[0] = getTile(ndcMin.x, kClusterGridX);
+    range.max[0] = getTile(ndcMax.x, kClusterGridX);
+    range.min[1] = getTile(ndcMin.y, kClusterGridY);
+    range.max[1] = getTile(ndcMax.y, kClusterGridY);
+    return range;
+}
+
+void LightClusters::assignSlice(uint32_t slice, const std::vector<BoundingSphere>& lights) {
+    Slice& output = m_slices[slice];
+    output.pairs.clear();
+
+    const Aabb* bounds = m_bounds.data() + slice * kTilesPerSlice;
+    for (uint32_t l = 0; l < lights.size(); l++) {
+        const LightRange& range = m_ranges[l];
+        if (slice < range.min[2] || slice > range.max[2]) {
+            continue;
+        }
+        for (uint32_t y = range.min[1]; y <= range.max[1]; y++) {
+            for (uint32_t x = range.min[0]; x <= range.max[0]; x++) {
+                uint32_t tile = x + kClusterGridX * y;
+                if (intersects(lights[l], bounds[tile])) {
+                    output.pairs.emplace_back(tile, l);
+                }
+            }
+        }
+    }
+
+    // Counting sort by tile, lights stay in ascending order within a cluster
+    LightCluster* clusters = m_clusters.data() + slice * kTilesPerSlice;
+    std::fill(clusters, clusters + kTilesPerSlice, LightCluster { 0, 0 });
+    for (const auto& [tile, light] : output.pairs) {
+        clusters[tile].count++;
+    }
+    uint32_t offset = 0;
+    for (uint32_t tile = 0; tile < kTilesPerSlice; tile++) {
+        clusters[tile].offset = offset;
+        offset += clusters[tile].count;
+    }
+
+    output.lightIndices.resize(output.pairs.size());
+    output.cursors.resize(kTilesPerSlice);
+    for (uint32_t tile = 0; tile < kTilesPerSlice; tile++) {
+        output.cursors[tile] = clusters[tile].offset;
+    }
+    for (const auto& [tile, light] : output.pairs) {
+        output.lightIndices[output.cursors[tile]++] = light;
+    }
+}
+
+void LightClusters::assign(const std::vector<BoundingSphere>& lights, JobSystem& jobSystem) {
+    const uint32_t lightCount = static_cast<uint32_t>(lights.size());
+
+    m_ranges.resize(lightCount);
+    jobSystem.parallelFor(0, lightCount, kLightsPerJob, [&lights, this](uint32_t first, uint32_t last) {
+        for (uint32_t i = first; i < last; i++) {
+            m_ranges[i] = computeRange(lights[i]);
+        }
+    });
+
+    // Every slice owns its clusters, so slices are filled in parallel with slice local offsets
+    m_clusters.resize(kClusterCount);
+    m_slices.resize(kClusterGridZ);
+    jobSystem.parallelFor(0, kClusterGridZ, 1, [&lights, this](uint32_t first, uint32_t last) {
+        for (uint32_t slice = first; slice < last; slice++) {
+            assignSlice(slice, lights);
+        }
+    });
+
+    // Stitch slices into one list
+    m_lightIndices.clear();
+    for (uint32_t slice = 0; slice < kClusterGridZ; slice++) {
+        const uint32_t sliceOffset = static_cast<uint32_t>(m_lightIndices.size());
+        LightCluster* clusters = m_clusters.data() + slice * kTilesPerSlice;
+        for (uint32_t tile = 0; tile < kTilesPerSlice; tile++) {
+            clusters[tile].offset += sliceOffset;
+        }
+        const auto& sliceIndices = m_slices[slice].lightIndices;
+        m_lightIndices.insert(m_lightIndices.end(), sliceIndices.begin(), sliceIndices.end());
+    }
+}
+
+}
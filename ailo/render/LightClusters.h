@@ -0,0 +1,68 @@
+#pragma once
+
+#include "Culling.h"
+#include "Constants.h"
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+namespace ailo {
+
+class JobSystem;
+
+struct LightCluster {
+    uint32_t offset; // into the light index list
+    uint32_t count;
+};
+
+// Froxel grid over the view frustum: kClusterGridX x kClusterGridY screen tiles split into
+// kClusterGridZ slices, exponentially distributed in depth. Every cluster gets the list of
+// lights whose bounding sphere touches it, so shading only walks the lights of its cluster.
+class LightClusters {
+public:
+    // Cluster bounds only depend on the projection and are rebuilt when it changes
+    void setProjection(const glm::mat4& projection, float nearDistance, float farDistance);
+
+    // Spheres are in view space, the light indices of the output refer to this array
+    void assign(const std::vector<BoundingSphere>& lights, JobSystem& jobSystem);
+
+    // Indexed by x + kClusterGridX * (y + kClusterGridY * slice)
+    [[nodiscard]] const std::vector<LightCluster>& getClusters() const { return m_clusters; }
+    [[nodiscard]] const std::vector<uint32_t>& getLightIndices() const { return m_lightIndices; }
+
+    // slice = log(viewDepth) * scale + bias
+    [[nodiscard]] glm::vec2 getDepthSliceScaleBias() const { return m_depthSliceScaleBias; }
+
+private:
+    // Inclusive cluster coordinates covered by the light, empty when min.z > max.z
+    struct LightRange {
+        uint32_t min[3];
+        uint32_t max[3];
+    };
+
+    struct Slice {
+        std::vector<std::pair<uint32_t, uint32_t>> pairs; // (tile, light)
+        std::vector<uint32_t> lightIndices;
+        std::vector<uint32_t> cursors;
+    };
+
+    [[nodiscard]] LightRange computeRange(const BoundingSphere& light) const;
+    [[nodiscard]] uint32_t getSlice(float viewDepth) const;
+    void assignSlice(uint32_t slice, const std::vector<BoundingSphere>& lights);
+
+    glm::mat4 m_projection { 0.0f };
+    float m_near = 0.0f;
+    float m_far = 0.0f;
+    glm::vec2 m_depthSliceScaleBias { 0.0f };
+
+    std::vector<Aabb> m_bounds; // view space, indexed as m_clusters
+    std::vector<LightRange> m_ranges;
+    std::vector<Slice> m_slices;
+    std::vector<LightCluster> m_clusters;
+    std::vector<uint32_t> m_lightIndices;
+};
+
+}
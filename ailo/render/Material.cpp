@@ -26,10 +26,13 @@ void ailo::Material::setBuffer(uint32_t binding, BufferObject* buffer) {
 
 void ailo::Material::updateTextures(RenderAPI& renderAPI) {
     for (auto& [binding, texture] : m_textures) {
-        if(!m_pendingBindings.test(binding)) {
+        // a texture loaded with loadAsync changes its image when the load finishes
+        uint32_t& generation = m_textureGenerations[binding];
+        if(!m_pendingBindings.test(binding) && generation == texture->getGeneration()) {
             continue;
         }
         renderAPI.updateDescriptorSetTexture(m_descriptorSet, texture->getHandle(), binding);
+        generation = texture->getGeneration();
         m_pendingBindings.reset(binding);
     }
 }
@@ -29,6 +29,7 @@ public:
 private:
     DescriptorSetHandle m_descriptorSet;
     std::unordered_map<uint32_t, asset_ptr<Texture>> m_textures;
+    std::unordered_map<uint32_t, uint32_t> m_textureGenerations; // as bound, see Asset::getGeneration
     std::unordered_map<uint32_t, BufferObject*> m_buffers;
     std::bitset<64> m_pendingBindings;
     asset_ptr<Shader> m_shader;
@@ -1,16 +1,17 @@
 #include "Mesh.h"
 
-#include <assimp/Importer.hpp>
-#include <assimp/scene.h>
-#include <assimp/postprocess.h>
-#include <assimp/material.h>
+#include <algorithm>
+#include <chrono>
+#include <exception>
 #include <stdexcept>
 #include <iostream>
+#include <span>
+#include <utility>
 #include <vector>
-#include <unordered_set>
 #include <filesystem>
-#include <functional>
 
+#include "ModelFile.h"
+#include "ModelImport.h"
 #include "Renderable.h"
 #include "Shader.h"
 #include "Skeleton.h"
@@ -18,71 +19,13 @@
 #include "Texture.h"
 #include "Material.h"
 #include "assets/Assets.h"
+#include "common/JobSystem.h"
 #include "ecs/AnimatorComponent.h"
 #include "ecs/Scene.h"
 #include "ecs/Transform.h"
 
 namespace ailo {
 
-struct Vertex {
-    glm::vec3 pos;
-    glm::vec3 color;
-    glm::vec2 texCoord;
-    glm::vec3 normal;
-    glm::vec4 tangent;
-};
-
-struct SkinnedVertex {
-    glm::vec3 pos;
-    glm::vec3 color;
-    glm::vec2 texCoord;
-    glm::vec3 normal;
-    glm::vec4 tangent;
-    glm::ivec4 boneIndices;  // location 5
-    glm::vec4  boneWeights;  // location 6
-};
-
-static glm::mat4 aiMatrixToGlm(const aiMatrix4x4& m) {
-    return glm::mat4(
-        m.a1, m.b1, m.c1, m.d1,
-        m.a2, m.b2, m.c2, m.d2,
-        m.a3, m.b3, m.c3, m.d3,
-        m.a4, m.b4, m.c4, m.d4
-    );
-}
-
-struct MeshData {
-    glm::mat4 transform;
-    uint32_t meshIndex;
-    uint32_t materialIndex;
-};
-
-static asset_ptr<Texture> loadTexture(AssetManager* assetManager, const std::string& texturePath, const std::string& modelDirectory, vk::Format format = vk::Format::eR8G8B8A8Srgb) {
-    std::filesystem::path fullPath;
-    if (std::filesystem::path(texturePath).is_absolute()) {
-        fullPath = texturePath;
-    } else {
-        fullPath = std::filesystem::path(modelDirectory) / texturePath;
-    }
-    return assetManager->load<Texture>(fullPath.string());
-}
-
-static void processNode(
-    const aiNode* node,
-    const aiScene* aiscene,
-    const glm::mat4& parentTransform,
-    std::vector<MeshData>& meshDataList
-) {
-    glm::mat4 worldTransform = parentTransform * aiMatrixToGlm(node->mTransformation);
-    for (unsigned int i = 0; i < node->mNumMeshes; i++) {
-        auto meshIdx = node->mMeshes[i];
-        meshDataList.push_back({ worldTransform, meshIdx, aiscene->mMeshes[meshIdx]->mMaterialIndex });
-    }
-    for (unsigned int i = 0; i < node->mNumChildren; i++) {
-        processNode(node->mChildren[i], aiscene, worldTransform, meshDataList);
-    }
-}
-
 static constexpr glm::vec3 sCubeVertices[] = {
     {-10.0f,  10.0f, -10.0f}, {-10.0f, -10.0f, -10.0f}, { 10.0f, -10.0f, -10.0f},
     { 10.0f, -10.0f, -10.0f}, { 10.0f,  10.0f, -10.0f}, {-10.0f,  10.0f, -10.0f},
@@ -118,168 +61,185 @@ asset_ptr<Mesh> Mesh::cube(AssetManager* assetManager, RenderAPI* renderApi) {
     posAttr.format = vk::Format::eR32G32B32Sfloat;
     posAttr.offset = 0;
 
-    auto vb = std::make_shared<VertexBuffer>(renderApi,
-        VertexInputDescription{ .bindings = {binding}, .attributes = {posAttr} },
-        sizeof(sCubeVertices));
-    vb->updateBuffer(renderApi, sCubeVertices, sizeof(sCubeVertices));
-
-    auto ib = std::make_shared<BufferObject>(renderApi, BufferBinding::INDEX, sizeof(sCubeIndices));
-    ib->updateBuffer(renderApi, sCubeIndices, sizeof(sCubeIndices));
-
-    mesh->vertexBuffer = vb;
-    mesh->indexBuffer = ib;
-    mesh->faces.emplace_back(0, 36);
+    auto arena = GeometryArena::get(renderApi, VertexInputDescription{ .bindings = {binding}, .attributes = {posAttr} });
+    mesh->geometry = GeometryRange(std::move(arena), std::size(sCubeVertices), std::size(sCubeIndices));
+    mesh->geometry.updateVertices(sCubeVertices, sizeof(sCubeVertices));
+    mesh->geometry.updateIndices(sCubeIndices, std::size(sCubeIndices));
+    auto positions = reinterpret_cast<const float*>(sCubeVertices);
+    Aabb bounds = computeAabb(positions, 3, sCubeIndices, std::size(sCubeIndices));
+    BoundingSphere sphere = computeBoundingSphere(positions, 3, sCubeIndices, std::size(sCubeIndices), bounds);
+    mesh->faces.push_back({ 0, 36, bounds, sphere });
+    mesh->bounds = bounds;
+    mesh->sphere = sphere;
     return mesh;
 }
 
-asset_ptr<Texture> load(AssetManager* assetManager, RenderAPI* renderApi, const aiScene* scene, const aiMaterial* material, aiTextureType textureType, vk::Format format, const std::string& modelDirectory) {
-    if (material->GetTextureCount(textureType) <= 0) return {};
-    aiString texturePath;
-    if (material->GetTexture(textureType, 0, &texturePath) != AI_SUCCESS) return {};
-
-    auto embedded = scene->GetEmbeddedTexture(texturePath.C_Str());
-    if (embedded) {
-        if (embedded->mHeight > 0)
-            return Texture::fromEmbedded(assetManager, renderApi, embedded->pcData, embedded->mWidth * embedded->mHeight * sizeof(aiTexel), format, embedded->mWidth, embedded->mHeight);
-        return Texture::fromEmbeddedCompressed(assetManager, renderApi, embedded->pcData, embedded->mWidth, format);
+static VertexInputDescription vertexInputDescription(VertexFormat format) {
+    VertexInputDescription description;
+    vk::VertexInputBindingDescription bd{};
+    bd.binding = 0; bd.stride = getVertexSize(format); bd.inputRate = vk::VertexInputRate::eVertex;
+    description.bindings.push_back(bd);
+    auto addAttr = [&](VertexLocation loc, vk::Format fmt, uint32_t off) {
+        vk::VertexInputAttributeDescription a{}; a.binding=0; a.location=std::to_underlying(loc); a.format=fmt; a.offset=off;
+        description.attributes.push_back(a);
+    };
+
+    switch (format) {
+        case VertexFormat::Standard:
+            addAttr(VertexLocation::Position,  vk::Format::eR32G32B32Sfloat,    offsetof(Vertex, pos));
+            addAttr(VertexLocation::Color,     vk::Format::eR32G32B32Sfloat,    offsetof(Vertex, color));
+            addAttr(VertexLocation::TexCoord,  vk::Format::eR32G32Sfloat,       offsetof(Vertex, texCoord));
+            addAttr(VertexLocation::Normal,    vk::Format::eR32G32B32Sfloat,    offsetof(Vertex, normal));
+            addAttr(VertexLocation::Tangent,   vk::Format::eR32G32B32A32Sfloat, offsetof(Vertex, tangent));
+            break;
+        case VertexFormat::Skinned:
+            addAttr(VertexLocation::Position,    vk::Format::eR32G32B32Sfloat,    offsetof(SkinnedVertex, pos));
+            addAttr(VertexLocation::Color,       vk::Format::eR32G32B32Sfloat,    offsetof(SkinnedVertex, color));
+            addAttr(VertexLocation::TexCoord,    vk::Format::eR32G32Sfloat,       offsetof(SkinnedVertex, texCoord));
+            addAttr(VertexLocation::Normal,      vk::Format::eR32G32B32Sfloat,    offsetof(SkinnedVertex, normal));
+            addAttr(VertexLocation::Tangent,     vk::Format::eR32G32B32A32Sfloat, offsetof(SkinnedVertex, tangent));
+            addAttr(VertexLocation::BoneIndices, vk::Format::eR32G32B32A32Sint,   offsetof(SkinnedVertex, boneIndices));
+            addAttr(VertexLocation::BoneWeights, vk::Format::eR32G32B32A32Sfloat, offsetof(SkinnedVertex, boneWeights));
+            break;
+        case VertexFormat::Quantized:
+            addAttr(VertexLocation::Position,  vk::Format::eR16G16B16A16Unorm, offsetof(QuantizedVertex, pos));
+            addAttr(VertexLocation::TexCoord,  vk::Format::eR16G16Sfloat,      offsetof(QuantizedVertex, texCoord));
+            addAttr(VertexLocation::Normal,    vk::Format::eR16G16Snorm,       offsetof(QuantizedVertex, normal));
+            addAttr(VertexLocation::Tangent,   vk::Format::eR16G16Snorm,       offsetof(QuantizedVertex, tangent));
+            break;
+        case VertexFormat::QuantizedSkinned:
+            addAttr(VertexLocation::Position,    vk::Format::eR16G16B16A16Sfloat, offsetof(QuantizedSkinnedVertex, pos));
+            addAttr(VertexLocation::TexCoord,    vk::Format::eR16G16Sfloat,       offsetof(QuantizedSkinnedVertex, texCoord));
+            addAttr(VertexLocation::Normal,      vk::Format::eR16G16Snorm,        offsetof(QuantizedSkinnedVertex, normal));
+            addAttr(VertexLocation::Tangent,     vk::Format::eR16G16Snorm,        offsetof(QuantizedSkinnedVertex, tangent));
+            addAttr(VertexLocation::BoneIndices, vk::Format::eR8G8B8A8Uint,       offsetof(QuantizedSkinnedVertex, boneIndices));
+            addAttr(VertexLocation::BoneWeights, vk::Format::eR16G16B16A16Unorm,  offsetof(QuantizedSkinnedVertex, boneWeights));
+            break;
     }
-
-    std::string key { texturePath.C_Str() };
-    if (textureType == aiTextureType_NORMALS) {
-        key.append("@norm");
-    }
-    return loadTexture(assetManager, key, modelDirectory, format);
+    return description;
 }
 
-std::vector<Entity> MeshReader::instantiate(
-    AssetManager* assetManager, RenderAPI* renderApi, Scene& scene, const std::string& path, const glm::mat4& transform) {
-    Assimp::Importer importer;
-
-    const aiScene* aiscene = importer.ReadFile(path,
-        aiProcess_Triangulate |
-        aiProcess_OptimizeMeshes |
-        aiProcess_FlipUVs |
-        aiProcess_GenNormals |
-        aiProcess_CalcTangentSpace |
-        aiProcess_LimitBoneWeights);
-
-    if (!aiscene || aiscene->mFlags & AI_SCENE_FLAGS_INCOMPLETE || !aiscene->mRootNode)
-        throw std::runtime_error("Failed to load mesh: " + std::string(importer.GetErrorString()));
-
-    std::filesystem::path modelPath(path);
-    std::string modelDirectory = modelPath.parent_path().string();
-
-    // -------------------------------------------------------------------------
-    // Skinning: collect bone names and build skeleton
-    // -------------------------------------------------------------------------
+// Textures of the model in ModelData::textures order. Files stream in through loadAsync and show
+// a placeholder until then. Embedded images live in the model streams, which may be gone by the
+// time an asynchronous load finishes, so the encoded ones are decoded here on the job system a
+// batch at a time, holding about one image per thread in memory.
+static std::vector<asset_ptr<Texture>> loadTextures(
+    AssetManager* assetManager, RenderAPI* renderApi, const ModelData& model, const std::string& modelDirectory,
+    JobSystem* jobSystem) {
+    const std::span<const std::byte> streams = model.getStreams();
+    std::vector<asset_ptr<Texture>> textures(model.textures.size());
+    std::vector<uint32_t> encoded;
+
+    for (uint32_t i = 0; i < model.textures.size(); i++) {
+        const ModelTexture& texture = model.textures[i];
+        const vk::Format format = texture.linear ? vk::Format::eR8G8B8A8Unorm : vk::Format::eR8G8B8A8Srgb;
+
+        if (texture.path.empty()) {
+            if (texture.height > 0) {
+                textures[i] = Texture::fromEmbedded(assetManager, renderApi, streams.data() + texture.dataOffset, texture.dataSize,
+                    format, texture.width, texture.height);
+            } else {
+                encoded.push_back(i);
+            }
+            continue;
+        }
 
-    // Step 1: collect all bone names
-    std::unordered_set<std::string> boneNameSet;
-    for (unsigned int i = 0; i < aiscene->mNumMeshes; i++) {
-        aiMesh* m = aiscene->mMeshes[i];
-        for (unsigned int j = 0; j < m->mNumBones; j++)
-            boneNameSet.insert(m->mBones[j]->mName.C_Str());
+        std::filesystem::path fullPath;
+        if (std::filesystem::path(texture.path).is_absolute()) {
+            fullPath = texture.path;
+        } else {
+            fullPath = std::filesystem::path(modelDirectory) / texture.path;
+        }
+        textures[i] = assetManager->loadAsync<Texture>(fullPath.string() + (texture.linear ? "@norm" : ""));
     }
 
-    const bool hasAnySkinning = !boneNameSet.empty();
-
-    // Step 2: mark nodes to include — bones AND their non-bone ancestors.
-    // We need ALL ancestors so that intermediate node transforms (e.g. "Armature")
-    // are accumulated into bone world transforms. Without this, inverseBindPose
-    // (which was computed from the full hierarchy) won't cancel correctly at bind pose.
-    std::unordered_set<std::string> includedNodeNames;
-    if (hasAnySkinning) {
-        std::function<bool(const aiNode*)> markAncestors = [&](const aiNode* node) -> bool {
-            bool anyChildIncluded = false;
-            for (unsigned int i = 0; i < node->mNumChildren; i++)
-                if (markAncestors(node->mChildren[i])) anyChildIncluded = true;
-            std::string name = node->mName.C_Str();
-            if (boneNameSet.count(name) || anyChildIncluded) {
-                includedNodeNames.insert(name);
-                return true;
+    const uint32_t batchSize = jobSystem ? jobSystem->getThreadCount() : 1;
+    std::vector<Texture::Image> images(batchSize);
+    std::vector<std::exception_ptr> errors(batchSize);
+
+    for (uint32_t batch = 0; batch < encoded.size(); batch += batchSize) {
+        const uint32_t count = std::min<uint32_t>(batchSize, static_cast<uint32_t>(encoded.size()) - batch);
+        // a job can't throw into the job system, failures are rethrown here
+        auto decodeRange = [&](uint32_t first, uint32_t last) {
+            for (uint32_t k = first; k < last; k++) {
+                const ModelTexture& texture = model.textures[encoded[batch + k]];
+                const vk::Format format = texture.linear ? vk::Format::eR8G8B8A8Unorm : vk::Format::eR8G8B8A8Srgb;
+                try {
+                    images[k] = Texture::decode(streams.data() + texture.dataOffset, texture.dataSize, format);
+                } catch (...) {
+                    errors[k] = std::current_exception();
+                }
             }
-            return false;
         };
-        markAncestors(aiscene->mRootNode);
-    }
-
-    // Step 3: build skeleton — all included nodes in parent-first DFS order.
-    //   globalBoneRegistry: bone name → boneOutputIndex (index in BonesUniform::bones[])
-    //   non-bone nodes get boneOutputIndex = -1 and don't write to BonesUniform.
-    auto skeleton = std::make_shared<Skeleton>();
-    std::unordered_map<std::string, uint32_t> globalBoneRegistry; // bone name → boneOutputIndex
-
-    if (hasAnySkinning) {
-        uint32_t nextBoneOutputIndex = 0;
-        std::function<void(const aiNode*, int)> buildSkeleton = [&](const aiNode* node, int parentNodeIdx) {
-            std::string name = node->mName.C_Str();
-            if (!includedNodeNames.count(name)) return;
-
-            uint32_t nodeIdx = static_cast<uint32_t>(skeleton->nodes.size());
-            skeleton->nodeNameToIndex[name] = nodeIdx;
-
-            NodeInfo ni;
-            ni.name = name;
-            ni.parentIndex = parentNodeIdx;
-            ni.localTransform = aiMatrixToGlm(node->mTransformation);
-            ni.inverseBindPose = glm::mat4(1.0f);
-            if (boneNameSet.count(name)) {
-                ni.boneOutputIndex = static_cast<int>(nextBoneOutputIndex);
-                globalBoneRegistry[name] = nextBoneOutputIndex++;
-            } else {
-                ni.boneOutputIndex = -1;
-            }
-            skeleton->nodes.push_back(ni);
+        if (jobSystem) {
+            jobSystem->parallelFor(0, count, 1, decodeRange);
+        } else {
+            decodeRange(0, count);
+        }
 
-            for (unsigned int i = 0; i < node->mNumChildren; i++)
-                buildSkeleton(node->mChildren[i], static_cast<int>(nodeIdx));
-        };
-        buildSkeleton(aiscene->mRootNode, -1);
-
-        // Step 4: fill inverseBindPose from mesh bone data
-        for (unsigned int i = 0; i < aiscene->mNumMeshes; i++) {
-            aiMesh* m = aiscene->mMeshes[i];
-            for (unsigned int j = 0; j < m->mNumBones; j++) {
-                aiBone* bone = m->mBones[j];
-                auto it = skeleton->nodeNameToIndex.find(bone->mName.C_Str());
-                if (it != skeleton->nodeNameToIndex.end())
-                    skeleton->nodes[it->second].inverseBindPose = aiMatrixToGlm(bone->mOffsetMatrix);
+        for (uint32_t k = 0; k < count; k++) {
+            if (errors[k]) {
+                std::rethrow_exception(errors[k]);
             }
+            textures[encoded[batch + k]] = Texture::fromImage(assetManager, renderApi, images[k]);
+            images[k] = {};
         }
     }
+    return textures;
+}
 
-    // Which material indices are used by skinned meshes?
-    std::unordered_set<uint32_t> skinnedMaterialIndices;
-    for (unsigned int i = 0; i < aiscene->mNumMeshes; i++) {
-        if (aiscene->mMeshes[i]->mNumBones > 0)
-            skinnedMaterialIndices.insert(aiscene->mMeshes[i]->mMaterialIndex);
-    }
+std::vector<Entity> MeshReader::instantiate(
+    AssetManager* assetManager, RenderAPI* renderApi, Scene& scene, const std::string& path,
+    const glm::mat4& transform, const MeshImportOptions& options, JobSystem* jobSystem) {
+    const auto start = std::chrono::steady_clock::now();
+    const ModelData model = isModelFile(path) ? readModelFile(path) : importModel(path, options, jobSystem);
+    const auto imported = std::chrono::steady_clock::now();
+
+    auto entities = instantiate(assetManager, renderApi, scene, model, std::filesystem::path(path).parent_path().string(), transform, jobSystem);
+
+    const auto end = std::chrono::steady_clock::now();
+    std::cout << "Loaded '" << path << "' in " << std::chrono::duration<double, std::milli>(end - start).count() << " ms, import "
+              << std::chrono::duration<double, std::milli>(imported - start).count() << " ms, "
+              << (jobSystem ? jobSystem->getThreadCount() : 1) << " threads" << std::endl;
+    return entities;
+}
+
+std::vector<Entity> MeshReader::instantiate(
+    AssetManager* assetManager, RenderAPI* renderApi, Scene& scene, const ModelData& model,
+    const std::string& modelDirectory, const glm::mat4& transform, JobSystem* jobSystem) {
+    const bool hasAnySkinning = model.hasSkinning();
 
     // -------------------------------------------------------------------------
     // Shaders
     // -------------------------------------------------------------------------
-    auto shader = Shader::load(assetManager, renderApi, Shader::getDefaultShaderDescription());
+    auto shader = Shader::load(assetManager, renderApi,
+        model.quantized ? Shader::getQuantizedShaderDescription() : Shader::getDefaultShaderDescription());
     asset_ptr<Shader> skinnedShader;
     if (hasAnySkinning)
-        skinnedShader = Shader::load(assetManager, renderApi, Shader::getSkinnedShaderDescription());
+        skinnedShader = Shader::load(assetManager, renderApi,
+            model.quantized ? Shader::getSkinnedQuantizedShaderDescription() : Shader::getSkinnedShaderDescription());
 
     // -------------------------------------------------------------------------
     // Materials
     // -------------------------------------------------------------------------
-    std::vector<asset_ptr<Material>> materials(aiscene->mNumMaterials);
-    std::vector<asset_ptr<Material>> skinnedMaterials(aiscene->mNumMaterials);
+    const std::vector<asset_ptr<Texture>> textures = loadTextures(assetManager, renderApi, model, modelDirectory, jobSystem);
+    auto getTexture = [&](int32_t index) {
+        return index == ModelMaterial::kNoTexture ? asset_ptr<Texture>() : textures[index];
+    };
 
-    for (unsigned int i = 0; i < aiscene->mNumMaterials; i++) {
-        aiMaterial* mat = aiscene->mMaterials[i];
+    std::vector<asset_ptr<Material>> materials(model.materials.size());
+    std::vector<asset_ptr<Material>> skinnedMaterials(model.materials.size());
 
-        auto diffuse = load(assetManager, renderApi, aiscene, mat, aiTextureType_BASE_COLOR, vk::Format::eR8G8B8A8Srgb, modelDirectory);
-        if (!diffuse) diffuse = load(assetManager, renderApi, aiscene, mat, aiTextureType_DIFFUSE, vk::Format::eR8G8B8A8Srgb, modelDirectory);
+    for (size_t i = 0; i < model.materials.size(); i++) {
+        const ModelMaterial& mat = model.materials[i];
+
+        auto diffuse = getTexture(mat.baseColor);
         if (!diffuse) diffuse = assetManager->load<Texture>("builtin://textures/white");
 
-        auto normalMap = load(assetManager, renderApi, aiscene, mat, aiTextureType_NORMALS, vk::Format::eR8G8B8A8Unorm, modelDirectory);
+        auto normalMap = getTexture(mat.normal);
         if (!normalMap) normalMap = assetManager->load<Texture>("builtin://textures/normal@norm");
 
-        auto metallicRoughness = load(assetManager, renderApi, aiscene, mat, aiTextureType_GLTF_METALLIC_ROUGHNESS, vk::Format::eR8G8B8A8Srgb, modelDirectory);
+        auto metallicRoughness = getTexture(mat.metallicRoughness);
         if (!metallicRoughness) metallicRoughness = assetManager->load<Texture>("builtin://textures/default_metallic_roughness");
 
         auto createMat = [&](asset_ptr<Shader> sh) {
@@ -291,178 +251,48 @@ std::vector<Entity> MeshReader::instantiate(
         };
 
         materials[i] = createMat(shader);
-        if (hasAnySkinning && skinnedMaterialIndices.count(i))
+        if (hasAnySkinning && mat.skinned)
             skinnedMaterials[i] = createMat(skinnedShader);
     }
 
     // -------------------------------------------------------------------------
-    // Vertex input descriptions
+    // Meshes, the streams are uploaded as they are
     // -------------------------------------------------------------------------
-    VertexInputDescription vertexInput;
-    {
-        vk::VertexInputBindingDescription bd{};
-        bd.binding = 0; bd.stride = sizeof(Vertex); bd.inputRate = vk::VertexInputRate::eVertex;
-        vertexInput.bindings.push_back(bd);
-        auto addAttr = [&](uint32_t loc, vk::Format fmt, uint32_t off) {
-            vk::VertexInputAttributeDescription a{}; a.binding=0; a.location=loc; a.format=fmt; a.offset=off;
-            vertexInput.attributes.push_back(a);
-        };
-        addAttr(std::to_underlying(VertexLocation::Position),  vk::Format::eR32G32B32Sfloat,    offsetof(Vertex, pos));
-        addAttr(std::to_underlying(VertexLocation::Color),     vk::Format::eR32G32B32Sfloat,    offsetof(Vertex, color));
-        addAttr(std::to_underlying(VertexLocation::TexCoord),  vk::Format::eR32G32Sfloat,       offsetof(Vertex, texCoord));
-        addAttr(std::to_underlying(VertexLocation::Normal),    vk::Format::eR32G32B32Sfloat,    offsetof(Vertex, normal));
-        addAttr(std::to_underlying(VertexLocation::Tangent),   vk::Format::eR32G32B32A32Sfloat, offsetof(Vertex, tangent));
-    }
-
-    VertexInputDescription skinnedVertexInput;
-    if (hasAnySkinning) {
-        vk::VertexInputBindingDescription bd{};
-        bd.binding = 0; bd.stride = sizeof(SkinnedVertex); bd.inputRate = vk::VertexInputRate::eVertex;
-        skinnedVertexInput.bindings.push_back(bd);
-        auto addAttr = [&](uint32_t loc, vk::Format fmt, uint32_t off) {
-            vk::VertexInputAttributeDescription a{}; a.binding=0; a.location=loc; a.format=fmt; a.offset=off;
-            skinnedVertexInput.attributes.push_back(a);
-        };
-        addAttr(std::to_underlying(VertexLocation::Position),    vk::Format::eR32G32B32Sfloat,    offsetof(SkinnedVertex, pos));
-        addAttr(std::to_underlying(VertexLocation::Color),       vk::Format::eR32G32B32Sfloat,    offsetof(SkinnedVertex, color));
-        addAttr(std::to_underlying(VertexLocation::TexCoord),    vk::Format::eR32G32Sfloat,       offsetof(SkinnedVertex, texCoord));
-        addAttr(std::to_underlying(VertexLocation::Normal),      vk::Format::eR32G32B32Sfloat,    offsetof(SkinnedVertex, normal));
-        addAttr(std::to_underlying(VertexLocation::Tangent),     vk::Format::eR32G32B32A32Sfloat, offsetof(SkinnedVertex, tangent));
-        addAttr(std::to_underlying(VertexLocation::BoneIndices), vk::Format::eR32G32B32A32Sint,   offsetof(SkinnedVertex, boneIndices));
-        addAttr(std::to_underlying(VertexLocation::BoneWeights), vk::Format::eR32G32B32A32Sfloat, offsetof(SkinnedVertex, boneWeights));
-    }
-
-    // -------------------------------------------------------------------------
-    // Build per-aiMesh vertex/index buffers
-    // -------------------------------------------------------------------------
-    std::vector<bool> meshHasBones(aiscene->mNumMeshes, false);
-    for (unsigned int i = 0; i < aiscene->mNumMeshes; i++)
-        meshHasBones[i] = aiscene->mMeshes[i]->mNumBones > 0;
-
+    const std::span<const std::byte> streams = model.getStreams();
     std::vector<asset_ptr<Mesh>> meshes;
-    meshes.reserve(aiscene->mNumMeshes);
+    meshes.reserve(model.meshes.size());
 
-    for (unsigned int i = 0; i < aiscene->mNumMeshes; i++) {
-        aiMesh* aiMesh = aiscene->mMeshes[i];
+    for (const ModelMesh& source : model.meshes) {
         meshes.push_back(assetManager->emplace<Mesh>());
         auto mesh = meshes.back();
 
-        std::vector<uint16_t> indices;
-        indices.reserve(aiMesh->mNumFaces * 3);
-        for (unsigned int f = 0; f < aiMesh->mNumFaces; f++) {
-            for (unsigned int j = 0; j < aiMesh->mFaces[f].mNumIndices; j++)
-                indices.push_back(static_cast<uint16_t>(aiMesh->mFaces[f].mIndices[j]));
-        }
-
-        if (meshHasBones[i]) {
-            // Accumulate per-vertex bone weights
-            struct VBW { std::vector<std::pair<uint32_t, float>> weights; };
-            std::vector<VBW> vbw(aiMesh->mNumVertices);
-            for (unsigned int j = 0; j < aiMesh->mNumBones; j++) {
-                aiBone* bone = aiMesh->mBones[j];
-                auto it = globalBoneRegistry.find(bone->mName.C_Str());
-                if (it == globalBoneRegistry.end()) continue;
-                uint32_t boneOutputIdx = it->second;
-                for (unsigned int k = 0; k < bone->mNumWeights; k++)
-                    vbw[bone->mWeights[k].mVertexId].weights.push_back({boneOutputIdx, bone->mWeights[k].mWeight});
-            }
-
-            std::vector<SkinnedVertex> verts;
-            verts.reserve(aiMesh->mNumVertices);
-            for (unsigned int v = 0; v < aiMesh->mNumVertices; v++) {
-                SkinnedVertex sv{};
-                sv.pos = {aiMesh->mVertices[v].x, aiMesh->mVertices[v].y, aiMesh->mVertices[v].z};
-                sv.texCoord = aiMesh->mTextureCoords[0]
-                    ? glm::vec2(aiMesh->mTextureCoords[0][v].x, aiMesh->mTextureCoords[0][v].y)
-                    : glm::vec2(0.0f);
-                sv.color = aiMesh->mColors[0]
-                    ? glm::vec3(aiMesh->mColors[0][v].r, aiMesh->mColors[0][v].g, aiMesh->mColors[0][v].b)
-                    : glm::vec3(1.0f);
-                if (aiMesh->mNormals)
-                    sv.normal = {aiMesh->mNormals[v].x, aiMesh->mNormals[v].y, aiMesh->mNormals[v].z};
-                if (aiMesh->mTangents) {
-                    glm::vec3 t(aiMesh->mTangents[v].x, aiMesh->mTangents[v].y, aiMesh->mTangents[v].z);
-                    glm::vec3 b(aiMesh->mBitangents[v].x, aiMesh->mBitangents[v].y, aiMesh->mBitangents[v].z);
-                    sv.tangent = glm::vec4(t, glm::dot(glm::cross(sv.normal, t), b));
-                } else {
-                    sv.tangent = glm::vec4(1.0f, 0.0f, 0.0f, 1.0f);
-                }
-                sv.boneIndices = glm::ivec4(0);
-                sv.boneWeights = glm::vec4(0.0f);
-                const auto& bws = vbw[v].weights;
-                for (int k = 0; k < std::min(4, static_cast<int>(bws.size())); k++) {
-                    sv.boneIndices[k] = static_cast<int>(bws[k].first);
-                    sv.boneWeights[k] = bws[k].second;
-                }
-                verts.push_back(sv);
-            }
-            mesh->vertexBuffer = std::make_shared<VertexBuffer>(renderApi, skinnedVertexInput, sizeof(SkinnedVertex) * verts.size());
-            mesh->vertexBuffer->updateBuffer(renderApi, verts.data(), sizeof(SkinnedVertex) * verts.size());
-        } else {
-            std::vector<Vertex> verts;
-            verts.reserve(aiMesh->mNumVertices);
-            for (unsigned int v = 0; v < aiMesh->mNumVertices; v++) {
-                Vertex vx{};
-                vx.pos = {aiMesh->mVertices[v].x, aiMesh->mVertices[v].y, aiMesh->mVertices[v].z};
-                vx.texCoord = aiMesh->mTextureCoords[0]
-                    ? glm::vec2(aiMesh->mTextureCoords[0][v].x, aiMesh->mTextureCoords[0][v].y)
-                    : glm::vec2(0.0f);
-                if (aiMesh->mColors[0]) {
-                    vx.color = {aiMesh->mColors[v]->r, aiMesh->mColors[v]->r, aiMesh->mColors[v]->b};
-                } else {
-                    vx.color = glm::vec3(1.0f);
-                }
-                if (aiMesh->mNormals)
-                    vx.normal = {aiMesh->mNormals[v].x, aiMesh->mNormals[v].y, aiMesh->mNormals[v].z};
-                if (aiMesh->mTangents) {
-                    glm::vec3 t(aiMesh->mTangents[v].x, aiMesh->mTangents[v].y, aiMesh->mTangents[v].z);
-                    glm::vec3 b(aiMesh->mBitangents[v].x, aiMesh->mBitangents[v].y, aiMesh->mBitangents[v].z);
-                    vx.tangent = glm::vec4(t, glm::dot(glm::cross(vx.normal, t), b));
-                } else {
-                    vx.tangent = glm::vec4(1.0f, 0.0f, 0.0f, 1.0f);
-                }
-                verts.push_back(vx);
-            }
-            mesh->vertexBuffer = std::make_shared<VertexBuffer>(renderApi, vertexInput, sizeof(Vertex) * verts.size());
-            mesh->vertexBuffer->updateBuffer(renderApi, verts.data(), sizeof(Vertex) * verts.size());
-        }
-
-        mesh->indexBuffer = std::make_shared<BufferObject>(renderApi, BufferBinding::INDEX, sizeof(uint16_t) * indices.size());
-        mesh->indexBuffer->updateBuffer(renderApi, indices.data(), sizeof(uint16_t) * indices.size());
-        mesh->faces.push_back({0, static_cast<uint32_t>(indices.size())});
+        mesh->geometry = GeometryRange(GeometryArena::get(renderApi, vertexInputDescription(source.format)),
+            source.vertexCount, source.indexCount);
+        mesh->geometry.updateVertices(streams.data() + source.vertexOffset, uint64_t(source.vertexCount) * getVertexSize(source.format));
+        mesh->geometry.updateIndices(reinterpret_cast<const uint16_t*>(streams.data() + source.indexOffset), source.indexCount);
+        mesh->faces = source.faces;
+        mesh->bounds = source.bounds;
+        mesh->sphere = source.sphere;
+        mesh->occluder = source.occluder;
+        mesh->lodErrors = source.lodErrors;
+        mesh->quantized = source.format == VertexFormat::Quantized || source.format == VertexFormat::QuantizedSkinned;
+        mesh->positionDecode = source.positionDecode;
     }
 
     // -------------------------------------------------------------------------
-    // Parse animation clips
+    // Skeleton
     // -------------------------------------------------------------------------
-    std::vector<AnimationClip> animationClips;
-    if (hasAnySkinning) {
-        animationClips.reserve(aiscene->mNumAnimations);
-        for (unsigned int i = 0; i < aiscene->mNumAnimations; i++) {
-            aiAnimation* aiAnim = aiscene->mAnimations[i];
-            AnimationClip clip;
-            clip.name = aiAnim->mName.C_Str();
-            clip.ticksPerSecond = aiAnim->mTicksPerSecond > 0.0 ? static_cast<float>(aiAnim->mTicksPerSecond) : 25.0f;
-            clip.duration = static_cast<float>(aiAnim->mDuration) / clip.ticksPerSecond;
-
-            for (unsigned int j = 0; j < aiAnim->mNumChannels; j++) {
-                aiNodeAnim* ch = aiAnim->mChannels[j];
-                BoneChannel bc;
-                bc.boneName = ch->mNodeName.C_Str();
-                for (unsigned int k = 0; k < ch->mNumPositionKeys; k++)
-                    bc.positionKeys.push_back({ static_cast<float>(ch->mPositionKeys[k].mTime) / clip.ticksPerSecond,
-                        {ch->mPositionKeys[k].mValue.x, ch->mPositionKeys[k].mValue.y, ch->mPositionKeys[k].mValue.z} });
-                for (unsigned int k = 0; k < ch->mNumRotationKeys; k++)
-                    bc.rotationKeys.push_back({ static_cast<float>(ch->mRotationKeys[k].mTime) / clip.ticksPerSecond,
-                        glm::quat(ch->mRotationKeys[k].mValue.w, ch->mRotationKeys[k].mValue.x,
-                                  ch->mRotationKeys[k].mValue.y, ch->mRotationKeys[k].mValue.z) });
-                for (unsigned int k = 0; k < ch->mNumScalingKeys; k++)
-                    bc.scaleKeys.push_back({ static_cast<float>(ch->mScalingKeys[k].mTime) / clip.ticksPerSecond,
-                        {ch->mScalingKeys[k].mValue.x, ch->mScalingKeys[k].mValue.y, ch->mScalingKeys[k].mValue.z} });
-                clip.channels.push_back(std::move(bc));
-            }
-            animationClips.push_back(std::move(clip));
-        }
+    auto skeleton = std::make_shared<Skeleton>();
+    for (const ModelBone& bone : model.skeleton) {
+        skeleton->nodeNameToIndex[bone.name] = static_cast<uint32_t>(skeleton->nodes.size());
+        NodeInfo ni;
+        ni.name = bone.name;
+        ni.parentIndex = bone.parent;
+        ni.localTransform = bone.localTransform;
+        ni.inverseBindPose = bone.inverseBindPose;
+        ni.worldTransform = glm::mat4(1.0f);
+        ni.boneOutputIndex = bone.boneOutputIndex;
+        skeleton->nodes.push_back(std::move(ni));
     }
 
     std::shared_ptr<BufferObject> sharedBoneBuffer;
@@ -472,40 +302,57 @@ std::vector<Entity> MeshReader::instantiate(
     // -------------------------------------------------------------------------
     // Create entities from scene hierarchy
     // -------------------------------------------------------------------------
-    std::vector<MeshData> meshDataList;
-    processNode(aiscene->mRootNode, aiscene, transform, meshDataList);
-
     std::vector<Entity> entities;
-    entities.reserve(meshDataList.size() + (hasAnySkinning ? 1 : 0));
 
-    uint32_t renderableCount = 0;
-    for (const auto& md : meshDataList) {
+    // the instance root carries the placement, nodes keep their local transforms below it
+    auto rootEntity = scene.addEntity();
+    entities.push_back(rootEntity);
+    scene.addComponent<Transform>(rootEntity).setLocalMatrix(transform);
+
+    // an entity with a local Transform for every node, parented as in the file
+    std::vector<Entity> nodeEntities;
+    nodeEntities.reserve(model.nodes.size());
+    for (const ModelNode& node : model.nodes) {
         auto entity = scene.addEntity();
         entities.push_back(entity);
+        nodeEntities.push_back(entity);
+
+        Transform& tr = scene.addComponent<Transform>(entity);
+        tr.setLocalMatrix(node.localMatrix);
+        tr.parent = node.parent >= 0 ? nodeEntities[node.parent] : rootEntity;
+    }
 
-        Renderable& renderable = scene.addComponent<Renderable>(entity);
-        renderable.mesh = meshes[md.meshIndex];
+    uint32_t renderableCount = 0;
+    for (size_t n = 0; n < model.nodes.size(); n++) {
+        for (uint32_t meshIndex : model.nodes[n].meshes) {
+            const ModelMesh& source = model.meshes[meshIndex];
+            auto entity = scene.addEntity();
+            entities.push_back(entity);
 
-        bool isSkinned = meshHasBones[md.meshIndex];
-        if (isSkinned && skinnedMaterials[md.materialIndex])
-            renderable.materials.push_back(skinnedMaterials[md.materialIndex]);
-        else
-            renderable.materials.push_back(materials[md.materialIndex]);
+            Renderable& renderable = scene.addComponent<Renderable>(entity);
+            renderable.mesh = meshes[meshIndex];
 
-        Transform& tr = scene.addComponent<Transform>(entity);
-        tr.transform = md.transform;
+            bool isSkinned = source.format == VertexFormat::Skinned || source.format == VertexFormat::QuantizedSkinned;
+            if (isSkinned && skinnedMaterials[source.materialIndex])
+                renderable.materials.push_back(skinnedMaterials[source.materialIndex]);
+            else
+                renderable.materials.push_back(materials[source.materialIndex]);
 
-        if (isSkinned)
-            scene.addComponent<Skin>(entity, sharedBoneBuffer);
+            Transform& tr = scene.addComponent<Transform>(entity);
+            tr.parent = nodeEntities[n];
 
-        renderableCount++;
+            if (isSkinned)
+                scene.addComponent<Skin>(entity, sharedBoneBuffer);
+
+            renderableCount++;
+        }
     }
 
-    if (hasAnySkinning && !animationClips.empty()) {
+    if (hasAnySkinning && !model.clips.empty()) {
         auto skelEntity = scene.addEntity();
         auto& animator = scene.addComponent<AnimatorComponent>(skelEntity);
         animator.skeleton = skeleton;
-        animator.clips = std::move(animationClips);
+        animator.clips = model.clips;
         animator.boneBuffer = sharedBoneBuffer;
         entities.push_back(skelEntity);
     }
@@ -1,6 +1,11 @@
 #pragma once
 #include "RenderAPI.h"
 #include "RenderPrimitive.h"
+#include "Culling.h"
+#include "GeometryArena.h"
+#include "Meshlets.h"
+#include "ModelData.h"
+#include "SoftwareOcclusion.h"
 #include <memory>
 
 #include "assets/Assets.h"
@@ -9,23 +14,39 @@
 namespace ailo {
 
 class Engine;
+class JobSystem;
 
 struct Mesh : public Asset {
-    struct Face {
-        uint32_t indexOffset;
-        uint32_t indexCount;
-    };
+    static constexpr uint32_t kMaxLods = kMaxMeshLods;
 
-    std::shared_ptr<VertexBuffer> vertexBuffer;
-    std::shared_ptr<BufferObject> indexBuffer;
+    using Lod = MeshLod;
+    using Face = MeshFace;
+
+    GeometryRange geometry; // face and level offsets are relative to its first index
     std::vector<Face> faces;
+    Aabb bounds;            // local space, union of the faces
+    BoundingSphere sphere;  // local space
+    OccluderMesh occluder;  // simplified at import, empty when the mesh doesn't occlude
+    std::vector<float> lodErrors; // largest error of every level over the faces, relative to sphere.radius
+    bool quantized = false;       // vertices use the packed layout, drawn with the quantized shader variants
+    glm::mat4 positionDecode {1.0f}; // maps stored positions to local space, applied with the object matrix
 
     static asset_ptr<Mesh> cube(AssetManager* assetManager, RenderAPI* renderApi);
 };
 
 class MeshReader {
 public:
-    static std::vector<Entity> instantiate(AssetManager* assetManager, RenderAPI* renderApi, Scene&, const std::string& path, const glm::mat4& transform = glm::mat4(1.0f));
+    // Imports any format Assimp reads, or maps a file baked by `resgen mesh-bake` whose
+    // import options were applied when baking. With a jobSystem meshes are converted and
+    // embedded textures decoded on its workers; buffers and entities are created on the
+    // calling thread. Texture files stream in through AssetManager::loadAsync.
+    static std::vector<Entity> instantiate(AssetManager* assetManager, RenderAPI* renderApi, Scene&, const std::string& path,
+        const glm::mat4& transform = glm::mat4(1.0f), const MeshImportOptions& options = {}, JobSystem* jobSystem = nullptr);
+
+    // Creates the meshes, materials and entities of imported or baked model data. Texture
+    // paths are relative to modelDirectory.
+    static std::vector<Entity> instantiate(AssetManager* assetManager, RenderAPI* renderApi, Scene&, const ModelData& model,
+        const std::string& modelDirectory, const glm::mat4& transform = glm::mat4(1.0f), JobSystem* jobSystem = nullptr);
 };
 
 }
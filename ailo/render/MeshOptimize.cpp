@@ -0,0 +1,316 @@
+#include "MeshOptimize.h"
+
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <numeric>
+#include <string_view>
+#include <unordered_map>
+
+namespace ailo {
+
+namespace {
+
+constexpr uint32_t kInvalidIndex = std::numeric_limits<uint32_t>::max();
+
+// Forsyth's scoring: the most recent triangle's vertices score flat so the next triangle
+// doesn't always continue the last strip, vertices with few triangles left are preferred
+constexpr uint32_t kScoreCacheSize = 32;
+constexpr float kLastTriangleScore = 0.75f;
+constexpr float kCacheDecayPower = 1.5f;
+constexpr float kValenceBoostScale = 2.0f;
+constexpr float kValenceBoostPower = 0.5f;
+
+float vertexScore(int32_t cachePosition, uint32_t remainingTriangles) {
+    if (remainingTriangles == 0) {
+        return -1.0f;
+    }
+
+    float score = 0.0f;
+    if (cachePosition >= 0) {
+        if (cachePosition < 3) {
+            score = kLastTriangleScore;
+        } else {
+            float scale = 1.0f / float(kScoreCacheSize - 3);
+            score = std::pow(1.0f - float(cachePosition - 3) * scale, kCacheDecayPower);
+        }
+    }
+    return score + kValenceBoostScale * std::pow(float(remainingTriangles), -kValenceBoostPower);
+}
+
+// Number of cache misses of every triangle, in order
+std::vector<uint8_t> simulateCacheMisses(const std::vector<uint16_t>& indices, size_t vertexCount, uint32_t cacheSize) {
+    std::vector<uint32_t> timestamps(vertexCount, 0);
+    std::vector<uint8_t> misses(indices.size() / 3);
+    uint32_t time = cacheSize + 1;
+    for (size_t i = 0; i + 2 < indices.size(); i += 3) {
+        uint8_t triangleMisses = 0;
+        for (size_t k = 0; k < 3; k++) {
+            // FIFO: a vertex is in the cache while fewer than cacheSize misses happened since it was loaded
+            uint16_t v = indices[i + k];
+            if (time - timestamps[v] > cacheSize) {
+                timestamps[v] = time++;
+                triangleMisses++;
+            }
+        }
+        misses[i / 3] = triangleMisses;
+    }
+    return misses;
+}
+
+}
+
+VertexCacheStats analyzeVertexCache(const std::vector<uint16_t>& indices, size_t vertexCount, uint32_t cacheSize) {
+    VertexCacheStats stats;
+    if (indices.size() < 3) {
+        return stats;
+    }
+
+    size_t transformed = 0;
+    for (uint8_t misses : simulateCacheMisses(indices, vertexCount, cacheSize)) {
+        transformed += misses;
+    }
+
+    std::vector<uint8_t> referenced(vertexCount, 0);
+    size_t uniqueVertices = 0;
+    for (uint16_t v : indices) {
+        uniqueVertices += referenced[v] ? 0 : 1;
+        referenced[v] = 1;
+    }
+
+    stats.acmr = float(transformed) / float(indices.size() / 3);
+    stats.atvr = float(transformed) / float(uniqueVertices);
+    return stats;
+}
+
+size_t weldVertices(void* vertices, size_t vertexCount, size_t vertexSize, std::vector<uint16_t>& indices) {
+    auto* bytes = static_cast<char*>(vertices);
+
+    // keys point at the compacted copies, which never move once written
+    std::unordered_map<std::string_view, uint32_t> unique;
+    unique.reserve(vertexCount);
+    std::vector<uint32_t> remap(vertexCount);
+    size_t count = 0;
+    for (size_t v = 0; v < vertexCount; v++) {
+        const char* vertex = bytes + v * vertexSize;
+        auto it = unique.find(std::string_view(vertex, vertexSize));
+        if (it != unique.end()) {
+            remap[v] = it->second;
+            continue;
+        }
+
+        char* target = bytes + count * vertexSize;
+        if (target != vertex) {
+            std::memmove(target, vertex, vertexSize);
+        }
+        unique.emplace(std::string_view(target, vertexSize), static_cast<uint32_t>(count));
+        remap[v] = static_cast<uint32_t>(count++);
+    }
+
+    for (uint16_t& index : indices) {
+        index = static_cast<uint16_t>(remap[index]);
+    }
+    return count;
+}
+
+void optimizeVertexCache(std::vector<uint16_t>& indices, size_t vertexCount) {
+    const size_t triangleCount = indices.size() / 3;
+    if (triangleCount == 0) {
+        return;
+    }
+
+    // Triangles of every vertex, the first remaining[v] of them aren't emitted yet
+    std::vector<uint32_t> remaining(vertexCount, 0);
+    for (uint16_t v : indices) {
+        remaining[v]++;
+    }
+    std::vector<uint32_t> offsets(vertexCount + 1, 0);
+    std::partial_sum(remaining.begin(), remaining.end(), offsets.begin() + 1);
+    std::vector<uint32_t> vertexTriangles(offsets.back());
+    {
+        std::vector<uint32_t> cursors(offsets.begin(), offsets.end() - 1);
+        for (size_t i = 0; i < triangleCount * 3; i++) {
+            vertexTriangles[cursors[indices[i]]++] = static_cast<uint32_t>(i / 3);
+        }
+    }
+
+    std::vector<int32_t> cachePositions(vertexCount, -1);
+    std::vector<float> scores(vertexCount);
+    for (size_t v = 0; v < vertexCount; v++) {
+        scores[v] = vertexScore(-1, remaining[v]);
+    }
+    std::vector<float> triangleScores(triangleCount);
+    std::vector<uint8_t> emitted(triangleCount, 0);
+    for (size_t t = 0; t < triangleCount; t++) {
+        triangleScores[t] = scores[indices[t * 3]] + scores[indices[t * 3 + 1]] + scores[indices[t * 3 + 2]];
+    }
+
+    std::vector<uint16_t> result;
+    result.reserve(indices.size());
+    std::vector<uint16_t> cache;
+    std::vector<uint16_t> nextCache;
+    cache.reserve(kScoreCacheSize + 3);
+    nextCache.reserve(kScoreCacheSize + 3);
+
+    uint32_t best = static_cast<uint32_t>(std::max_element(triangleScores.begin(), triangleScores.end()) - triangleScores.begin());
+    size_t scanCursor = 0;
+    while (best != kInvalidIndex) {
+        emitted[best] = 1;
+        const uint16_t* triangle = indices.data() + best * 3;
+        result.insert(result.end(), triangle, triangle + 3);
+
+        for (size_t k = 0; k < 3; k++) {
+            uint16_t v = triangle[k];
+            uint32_t* first = vertexTriangles.data() + offsets[v];
+            uint32_t* last = first + remaining[v];
+            std::iter_swap(std::find(first, last, best), last - 1);
+            remaining[v]--;
+        }
+
+        // the emitted triangle moves to the front, the rest keep their order
+        nextCache.assign(triangle, triangle + 3);
+        for (uint16_t v : cache) {
+            if (v != triangle[0] && v != triangle[1] && v != triangle[2]) {
+                nextCache.push_back(v);
+            }
+        }
+        for (size_t i = kScoreCacheSize; i < nextCache.size(); i++) {
+            cachePositions[nextCache[i]] = -1;
+            scores[nextCache[i]] = vertexScore(-1, remaining[nextCache[i]]);
+        }
+        nextCache.resize(std::min<size_t>(nextCache.size(), kScoreCacheSize));
+        std::swap(cache, nextCache);
+
+        for (size_t i = 0; i < cache.size(); i++) {
+            cachePositions[cache[i]] = static_cast<int32_t>(i);
+            scores[cache[i]] = vertexScore(static_cast<int32_t>(i), remaining[cache[i]]);
+        }
+
+        // Only triangles around cached vertices changed their score
+        best = kInvalidIndex;
+        float bestScore = -std::numeric_limits<float>::max();
+        for (uint16_t v : cache) {
+            for (uint32_t i = offsets[v]; i < offsets[v] + remaining[v]; i++) {
+                uint32_t t = vertexTriangles[i];
+                float score = scores[indices[t * 3]] + scores[indices[t * 3 + 1]] + scores[indices[t * 3 + 2]];
+                triangleScores[t] = score;
+                if (score > bestScore) {
+                    bestScore = score;
+                    best = t;
+                }
+            }
+        }
+
+        // nothing left around the cache, continue with the next triangle in input order
+        if (best == kInvalidIndex) {
+            while (scanCursor < triangleCount && emitted[scanCursor]) {
+                scanCursor++;
+            }
+            if (scanCursor < triangleCount) {
+                best = static_cast<uint32_t>(scanCursor);
+            }
+        }
+    }
+
+    indices = std::move(result);
+}
+
+void optimizeOverdraw(std::vector<uint16_t>& indices, const float* positions, size_t stride, size_t vertexCount, float threshold) {
+    const size_t triangleCount = indices.size() / 3;
+    if (triangleCount < 2) {
+        return;
+    }
+
+    auto position = [&](uint16_t v) {
+        const float* p = positions + v * stride;
+        return glm::vec3(p[0], p[1], p[2]);
+    };
+
+    // a triangle missing all three vertices starts over in the cache, so clusters can move freely
+    std::vector<uint8_t> misses = simulateCacheMisses(indices, vertexCount, 16);
+    std::vector<uint32_t> clusterStarts;
+    for (uint32_t t = 0; t < triangleCount; t++) {
+        if (t == 0 || misses[t] == 3) {
+            clusterStarts.push_back(t);
+        }
+    }
+    if (clusterStarts.size() < 2) {
+        return;
+    }
+    clusterStarts.push_back(static_cast<uint32_t>(triangleCount));
+
+    // Area weighted centroid and normal of the mesh and of every cluster
+    const size_t clusterCount = clusterStarts.size() - 1;
+    std::vector<glm::vec3> clusterCentroids(clusterCount, glm::vec3(0.0f));
+    std::vector<glm::vec3> clusterNormals(clusterCount, glm::vec3(0.0f));
+    glm::vec3 meshCentroid { 0.0f };
+    float meshArea = 0.0f;
+    for (size_t c = 0; c < clusterCount; c++) {
+        float clusterArea = 0.0f;
+        for (uint32_t t = clusterStarts[c]; t < clusterStarts[c + 1]; t++) {
+            glm::vec3 p0 = position(indices[t * 3]);
+            glm::vec3 p1 = position(indices[t * 3 + 1]);
+            glm::vec3 p2 = position(indices[t * 3 + 2]);
+            glm::vec3 normal = glm::cross(p1 - p0, p2 - p0);
+            float area = glm::length(normal);
+            glm::vec3 center = (p0 + p1 + p2) / 3.0f;
+            clusterCentroids[c] = clusterCentroids[c] + center * area;
+            clusterNormals[c] = clusterNormals[c] + normal;
+            clusterArea += area;
+        }
+        meshCentroid = meshCentroid + clusterCentroids[c];
+        meshArea += clusterArea;
+        if (clusterArea > 0.0f) {
+            clusterCentroids[c] = clusterCentroids[c] / clusterArea;
+        }
+    }
+    if (meshArea > 0.0f) {
+        meshCentroid = meshCentroid / meshArea;
+    }
+
+    // clusters that face away from the center are likely to occlude the ones facing inward
+    std::vector<float> sortKeys(clusterCount);
+    for (size_t c = 0; c < clusterCount; c++) {
+        float length = glm::length(clusterNormals[c]);
+        glm::vec3 normal = length > 0.0f ? clusterNormals[c] / length : glm::vec3(0.0f);
+        sortKeys[c] = glm::dot(clusterCentroids[c] - meshCentroid, normal);
+    }
+    std::vector<uint32_t> order(clusterCount);
+    std::iota(order.begin(), order.end(), 0u);
+    std::stable_sort(order.begin(), order.end(), [&sortKeys](uint32_t a, uint32_t b) { return sortKeys[a] > sortKeys[b]; });
+
+    std::vector<uint16_t> result;
+    result.reserve(indices.size());
+    for (uint32_t c : order) {
+        result.insert(result.end(), indices.begin() + clusterStarts[c] * 3, indices.begin() + clusterStarts[c + 1] * 3);
+    }
+
+    if (analyzeVertexCache(result, vertexCount).acmr <= analyzeVertexCache(indices, vertexCount).acmr * threshold) {
+        indices = std::move(result);
+    }
+}
+
+size_t optimizeVertexFetch(void* vertices, size_t vertexCount, size_t vertexSize, std::vector<uint16_t>& indices) {
+    std::vector<uint32_t> remap(vertexCount, kInvalidIndex);
+    uint32_t count = 0;
+    for (uint16_t& index : indices) {
+        if (remap[index] == kInvalidIndex) {
+            remap[index] = count++;
+        }
+        index = static_cast<uint16_t>(remap[index]);
+    }
+
+    auto* bytes = static_cast<char*>(vertices);
+    std::vector<char> source(bytes, bytes + vertexCount * vertexSize);
+    for (size_t v = 0; v < vertexCount; v++) {
+        if (remap[v] != kInvalidIndex) {
+            std::memcpy(bytes + remap[v] * vertexSize, source.data() + v * vertexSize, vertexSize);
+        }
+    }
+    return count;
+}
+
+}
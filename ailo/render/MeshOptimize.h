@@ -0,0 +1,34 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace ailo {
+
+// Post-transform cache statistics of an index list, simulated with a FIFO cache
+struct VertexCacheStats {
+    float acmr = 0.0f; // transformed vertices per triangle, 0.5 at best, 3 at worst
+    float atvr = 0.0f; // transformed vertices per referenced vertex, 1 at best
+};
+
+VertexCacheStats analyzeVertexCache(const std::vector<uint16_t>& indices, size_t vertexCount, uint32_t cacheSize = 16);
+
+// Merges vertices that are identical byte for byte. Rewrites the indices and compacts
+// vertices in place, returns the new vertex count.
+size_t weldVertices(void* vertices, size_t vertexCount, size_t vertexSize, std::vector<uint16_t>& indices);
+
+// Reorders triangles for the post-transform cache (Forsyth's linear-speed algorithm)
+void optimizeVertexCache(std::vector<uint16_t>& indices, size_t vertexCount);
+
+// Splits cache optimized triangles into clusters where the cache starts over and draws
+// outward facing clusters first, so they occlude the rest. Positions are read with the
+// given stride, in floats. The input order is kept when the new one makes the ACMR worse
+// than threshold times the input's.
+void optimizeOverdraw(std::vector<uint16_t>& indices, const float* positions, size_t stride, size_t vertexCount, float threshold = 1.05f);
+
+// Renumbers vertices in order of first use so fetches walk the vertex buffer linearly.
+// Unreferenced vertices are dropped, returns the new vertex count.
+size_t optimizeVertexFetch(void* vertices, size_t vertexCount, size_t vertexSize, std::vector<uint16_t>& indices);
+
+}
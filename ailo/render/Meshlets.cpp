@@ -0,0 +1,190 @@
+#include "Meshlets.h"
+
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace ailo {
+
+namespace {
+
+// The cone contains the unit normals of the triangles, culling needs it narrower than a half space
+void computeCone(Meshlet& meshlet, const std::vector<uint16_t>& indices, const float* positions, size_t stride) {
+    auto position = [&](uint32_t v) {
+        const float* p = positions + v * stride;
+        return glm::vec3(p[0], p[1], p[2]);
+    };
+
+    meshlet.coneAxis = glm::vec3(0.0f);
+    meshlet.coneCutoff = 1.0f;
+
+    std::vector<glm::vec3> normals;
+    normals.reserve(meshlet.indexCount / 3);
+    glm::vec3 sum(0.0f);
+    for (uint32_t i = meshlet.indexOffset; i + 2 < meshlet.indexOffset + meshlet.indexCount; i += 3) {
+        glm::vec3 p0 = position(indices[i]);
+        glm::vec3 normal = glm::cross(position(indices[i + 1]) - p0, position(indices[i + 2]) - p0);
+        float length = glm::length(normal);
+        if (length > 0.0f) {
+            normals.push_back(normal / length);
+            sum += normals.back();
+        }
+    }
+
+    float length = glm::length(sum);
+    if (normals.empty() || length < 1e-6f) {
+        return;
+    }
+    glm::vec3 axis = sum / length;
+    float minDot = 1.0f;
+    for (const glm::vec3& normal : normals) {
+        minDot = std::min(minDot, glm::dot(axis, normal));
+    }
+
+    meshlet.coneAxis = axis;
+    if (minDot > 0.0f) {
+        meshlet.coneCutoff = std::sqrt(1.0f - minDot * minDot);
+    }
+}
+
+}
+
+std::vector<Meshlet> buildMeshlets(
+    std::vector<uint16_t>& indices, uint32_t indexOffset, uint32_t indexCount,
+    const float* positions, size_t stride, size_t vertexCount,
+    uint32_t maxVertices, uint32_t maxTriangles) {
+
+    auto position = [&](uint32_t v) {
+        const float* p = positions + v * stride;
+        return glm::vec3(p[0], p[1], p[2]);
+    };
+
+    const uint32_t triangleCount = indexCount / 3;
+    const uint16_t* source = indices.data() + indexOffset;
+
+    // triangles around every vertex
+    std::vector<uint32_t> adjacencyOffsets(vertexCount + 1, 0);
+    for (uint32_t i = 0; i < triangleCount * 3; i++) {
+        adjacencyOffsets[source[i] + 1]++;
+    }
+    for (size_t v = 0; v < vertexCount; v++) {
+        adjacencyOffsets[v + 1] += adjacencyOffsets[v];
+    }
+    std::vector<uint32_t> adjacency(triangleCount * 3);
+    {
+        std::vector<uint32_t> cursor(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+        for (uint32_t i = 0; i < triangleCount * 3; i++) {
+            adjacency[cursor[source[i]]++] = i / 3;
+        }
+    }
+
+    std::vector<uint8_t> emitted(triangleCount, 0);
+    std::vector<uint32_t> vertexMeshlet(vertexCount, std::numeric_limits<uint32_t>::max());
+    std::vector<uint16_t> reordered;
+    reordered.reserve(triangleCount * 3);
+    std::vector<uint32_t> candidates;
+    std::vector<Meshlet> meshlets;
+
+    uint32_t seed = 0;
+    while (true) {
+        while (seed < triangleCount && emitted[seed]) {
+            seed++;
+        }
+        if (seed == triangleCount) {
+            break;
+        }
+
+        const auto id = static_cast<uint32_t>(meshlets.size());
+        const auto start = static_cast<uint32_t>(reordered.size());
+        auto newVertices = [&](uint32_t t) {
+            uint32_t count = 0;
+            for (uint32_t k = 0; k < 3; k++) {
+                count += vertexMeshlet[source[t * 3 + k]] != id ? 1 : 0;
+            }
+            return count;
+        };
+
+        uint32_t vertices = 0;
+        uint32_t triangles = 0;
+        glm::vec3 vertexSum(0.0f);
+        candidates.clear();
+        uint32_t next = seed;
+        while (true) {
+            emitted[next] = 1;
+            for (uint32_t k = 0; k < 3; k++) {
+                uint16_t v = source[next * 3 + k];
+                reordered.push_back(v);
+                if (vertexMeshlet[v] != id) {
+                    vertexMeshlet[v] = id;
+                    vertexSum += position(v);
+                    vertices++;
+                }
+                for (uint32_t a = adjacencyOffsets[v]; a < adjacencyOffsets[v + 1]; a++) {
+                    if (!emitted[adjacency[a]]) {
+                        candidates.push_back(adjacency[a]);
+                    }
+                }
+            }
+            if (++triangles == maxTriangles) {
+                break;
+            }
+
+            // Neighbours adding the fewest vertices first, the closest to the center among them
+            const glm::vec3 center = vertexSum / float(vertices);
+            uint32_t best = triangleCount;
+            uint32_t bestAdded = 4;
+            float bestDistance = std::numeric_limits<float>::max();
+            size_t kept = 0;
+            for (uint32_t t : candidates) {
+                if (emitted[t]) {
+                    continue;
+                }
+                candidates[kept++] = t;
+                uint32_t added = newVertices(t);
+                if (vertices + added > maxVertices || added > bestAdded) {
+                    continue;
+                }
+                glm::vec3 centroid = (position(source[t * 3]) + position(source[t * 3 + 1]) + position(source[t * 3 + 2])) / 3.0f;
+                glm::vec3 offset = centroid - center;
+                float distance = glm::dot(offset, offset);
+                if (added < bestAdded || distance < bestDistance) {
+                    best = t;
+                    bestAdded = added;
+                    bestDistance = distance;
+                }
+            }
+            candidates.resize(kept);
+
+            // a disconnected piece continues with the next triangle in the input order
+            if (best == triangleCount) {
+                while (seed < triangleCount && emitted[seed]) {
+                    seed++;
+                }
+                if (seed == triangleCount || vertices + newVertices(seed) > maxVertices) {
+                    break;
+                }
+                best = seed;
+            }
+            next = best;
+        }
+
+        Meshlet meshlet {};
+        meshlet.indexOffset = indexOffset + start;
+        meshlet.indexCount = triangles * 3;
+        meshlets.push_back(meshlet);
+    }
+
+    std::copy(reordered.begin(), reordered.end(), indices.begin() + indexOffset);
+
+    for (Meshlet& meshlet : meshlets) {
+        const uint16_t* range = indices.data() + meshlet.indexOffset;
+        Aabb bounds = computeAabb(positions, stride, range, meshlet.indexCount);
+        meshlet.sphere = computeBoundingSphere(positions, stride, range, meshlet.indexCount, bounds);
+        computeCone(meshlet, indices, positions, stride);
+    }
+    return meshlets;
+}
+
+}
@@ -0,0 +1,29 @@
+#pragma once
+
+#include "Culling.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace ailo {
+
+// Cluster of triangles culled as a unit. Triangles of a meshlet are contiguous in the
+// index buffer, so it's drawn with a plain indexed draw of its range.
+struct Meshlet {
+    uint32_t indexOffset;
+    uint32_t indexCount;
+    BoundingSphere sphere; // local space
+    glm::vec3 coneAxis;    // average facing of the triangles
+    float coneCutoff;      // sine of the normal cone half angle, 1 when the cone can't be culled
+};
+
+// Groups indices[indexOffset, indexOffset + indexCount) into meshlets of at most maxVertices unique
+// vertices and maxTriangles triangles. Meshlets grow over shared vertices, the triangles are reordered
+// in place so every meshlet is a range. Positions are read with the given stride, in floats.
+std::vector<Meshlet> buildMeshlets(
+    std::vector<uint16_t>& indices, uint32_t indexOffset, uint32_t indexCount,
+    const float* positions, size_t stride, size_t vertexCount,
+    uint32_t maxVertices = 64, uint32_t maxTriangles = 124);
+
+}
@@ -0,0 +1,170 @@
+#pragma once
+
+#include "Animation.h"
+#include "Culling.h"
+#include "Meshlets.h"
+#include "SoftwareOcclusion.h"
+#include "OS.h"
+
+#include <glm/glm.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <span>
+#include <string>
+#include <vector>
+
+namespace ailo {
+
+struct MeshImportOptions {
+    // Packs positions to 16 bits, normals and tangents to octahedral snorm16, UVs to half and
+    // bone data to 8/16 bits. Files with vertex colors keep the full layout.
+    bool quantizeVertices = false;
+    // Prints vertex cache stats of every mesh instead of one line per model
+    bool logMeshStats = false;
+};
+
+// Vertex layouts of imported meshes, the streams of a ModelData hold them as is
+enum class VertexFormat : uint32_t {
+    Standard,
+    Skinned,
+    Quantized,
+    QuantizedSkinned,
+};
+
+struct Vertex {
+    glm::vec3 pos;
+    glm::vec3 color;
+    glm::vec2 texCoord;
+    glm::vec3 normal;
+    glm::vec4 tangent;
+};
+
+struct SkinnedVertex {
+    glm::vec3 pos;
+    glm::vec3 color;
+    glm::vec2 texCoord;
+    glm::vec3 normal;
+    glm::vec4 tangent;
+    glm::ivec4 boneIndices;  // location 5
+    glm::vec4  boneWeights;  // location 6
+};
+
+// Packed layouts of MeshImportOptions::quantizeVertices, there is no color
+struct QuantizedVertex {
+    uint16_t pos[4];        // unorm over the mesh bounds, w - tangent sign as 0 or 1
+    int16_t normal[2];      // octahedral, snorm
+    int16_t tangent[2];     // octahedral, snorm
+    uint16_t texCoord[2];   // half
+};
+
+// Skinned positions go through the bones before the object matrix, so they stay in half floats
+struct QuantizedSkinnedVertex {
+    uint16_t pos[4];        // half, w - tangent sign as 0 or 1
+    int16_t normal[2];
+    int16_t tangent[2];
+    uint16_t texCoord[2];
+    uint8_t boneIndices[4];
+    uint16_t boneWeights[4]; // unorm, sum up to one
+};
+
+static_assert(sizeof(QuantizedVertex) == 20 && sizeof(QuantizedSkinnedVertex) == 32);
+
+inline uint32_t getVertexSize(VertexFormat format) {
+    switch (format) {
+        case VertexFormat::Standard: return sizeof(Vertex);
+        case VertexFormat::Skinned: return sizeof(SkinnedVertex);
+        case VertexFormat::Quantized: return sizeof(QuantizedVertex);
+        case VertexFormat::QuantizedSkinned: return sizeof(QuantizedSkinnedVertex);
+    }
+    return 0;
+}
+
+static constexpr uint32_t kMaxMeshLods = 4;
+
+struct MeshLod {
+    uint32_t indexOffset;
+    uint32_t indexCount;
+};
+
+struct MeshFace {
+    uint32_t indexOffset;   // level 0
+    uint32_t indexCount;
+    Aabb bounds;            // local space
+    BoundingSphere sphere;  // local space
+    std::vector<MeshLod> lods;     // coarser levels in the same index buffer, level n is lods[n - 1]
+    std::vector<Meshlet> meshlets; // ranges of level 0, empty for small and skinned meshes
+};
+
+struct ModelMesh {
+    VertexFormat format;
+    uint32_t materialIndex;
+    uint32_t vertexCount;
+    uint32_t indexCount;     // all levels
+    uint64_t vertexOffset;   // bytes into ModelData::getStreams()
+    uint64_t indexOffset;    // bytes into ModelData::getStreams(), 16 bit indices
+    std::vector<MeshFace> faces;
+    Aabb bounds;
+    BoundingSphere sphere;
+    OccluderMesh occluder;
+    std::vector<float> lodErrors;
+    glm::mat4 positionDecode {1.0f};
+};
+
+struct ModelTexture {
+    std::string path;        // as referenced by the source file, relative to the model directory; empty when embedded
+    uint64_t dataOffset = 0; // embedded data, bytes into ModelData::getStreams()
+    uint64_t dataSize = 0;
+    uint32_t width = 0;      // embedded texels, 0 when the data is an encoded image
+    uint32_t height = 0;
+    bool linear = false;     // normal maps
+};
+
+struct ModelMaterial {
+    static constexpr int32_t kNoTexture = -1;
+
+    int32_t baseColor = kNoTexture; // into ModelData::textures
+    int32_t normal = kNoTexture;
+    int32_t metallicRoughness = kNoTexture;
+    bool skinned = false;           // used by a skinned mesh and needs the skinned shader too
+};
+
+// Node of the file hierarchy, nodes are in parent-first order
+struct ModelNode {
+    glm::mat4 localMatrix;
+    int32_t parent;                // -1 for the root
+    std::vector<uint32_t> meshes;  // drawn at this node
+};
+
+// Skinning node, see NodeInfo
+struct ModelBone {
+    std::string name;
+    int32_t parent;
+    glm::mat4 localTransform;
+    glm::mat4 inverseBindPose;
+    int32_t boneOutputIndex;
+};
+
+// CPU side of a model: everything MeshReader needs to create the GPU resources and entities, without Assimp.
+// Vertex, index and embedded texture data live in one block of streams, either owned or in a mapped model file.
+struct ModelData {
+    std::vector<ModelMesh> meshes;
+    std::vector<ModelMaterial> materials;
+    std::vector<ModelTexture> textures;
+    std::vector<ModelNode> nodes;
+    std::vector<ModelBone> skeleton; // bones and their ancestors in parent-first order, empty without skinning
+    std::vector<AnimationClip> clips;
+    bool quantized = false;
+
+    std::vector<std::byte> ownedStreams;
+    std::shared_ptr<os::MappedFile> mappedFile;
+    std::span<const std::byte> mappedStreams; // part of mappedFile
+
+    [[nodiscard]] std::span<const std::byte> getStreams() const {
+        return mappedFile ? mappedStreams : std::span<const std::byte>(ownedStreams);
+    }
+    [[nodiscard]] bool hasSkinning() const { return !skeleton.empty(); }
+};
+
+}
@@ -0,0 +1,365 @@
+#include "ModelFile.h"
+
+#include <concepts>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <stdexcept>
+#include <type_traits>
+
+namespace ailo {
+
+static constexpr uint32_t kModelFileMagic = 0x48534d41; // "AMSH"
+static constexpr uint64_t kStreamsAlignment = 64;
+
+struct ModelFileHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint64_t tablesOffset;
+    uint64_t tablesSize;
+    uint64_t streamsOffset;
+    uint64_t streamsSize;
+};
+
+// The tables are the fields of ModelData in declaration order. Plain structs are stored as
+// they are in memory, bools as one byte, vectors and strings are prefixed with their element count.
+class TableWriter {
+public:
+    template<typename T>
+    void value(const T& value) {
+        static_assert(std::is_trivially_copyable_v<T>);
+        append(&value, sizeof(T));
+    }
+
+    void value(bool flag) {
+        value<uint8_t>(flag ? 1 : 0);
+    }
+
+    template<typename T>
+    void array(const std::vector<T>& values) {
+        static_assert(std::is_trivially_copyable_v<T>);
+        value<uint64_t>(values.size());
+        append(values.data(), values.size() * sizeof(T));
+    }
+
+    void string(const std::string& string) {
+        value<uint64_t>(string.size());
+        append(string.data(), string.size());
+    }
+
+    template<typename T>
+    void objects(const std::vector<T>& values) {
+        value<uint64_t>(values.size());
+        for (const T& v : values) {
+            transfer(*this, v);
+        }
+    }
+
+    const std::vector<std::byte>& getData() const { return m_data; }
+
+private:
+    void append(const void* data, size_t size) {
+        const auto bytes = static_cast<const std::byte*>(data);
+        m_data.insert(m_data.end(), bytes, bytes + size);
+    }
+
+    std::vector<std::byte> m_data;
+};
+
+class TableReader {
+public:
+    explicit TableReader(std::span<const std::byte> data) : m_data(data) {}
+
+    template<typename T>
+    void value(T& value) {
+        static_assert(std::is_trivially_copyable_v<T>);
+        read(&value, sizeof(T));
+    }
+
+    // a byte, copying any other value than 0 or 1 into a bool is undefined
+    void value(bool& flag) {
+        uint8_t byte = 0;
+        value(byte);
+        if (byte > 1) {
+            throw std::runtime_error("Corrupt model file tables");
+        }
+        flag = byte != 0;
+    }
+
+    template<typename T>
+    void array(std::vector<T>& values) {
+        static_assert(std::is_trivially_copyable_v<T>);
+        values.resize(count(sizeof(T)));
+        read(values.data(), values.size() * sizeof(T));
+    }
+
+    void string(std::string& string) {
+        string.resize(count(1));
+        read(string.data(), string.size());
+    }
+
+    template<typename T>
+    void objects(std::vector<T>& values) {
+        values.resize(count(1));
+        for (T& v : values) {
+            transfer(*this, v);
+        }
+    }
+
+private:
+    // element count, checked against the bytes left so a corrupt count can't allocate
+    size_t count(size_t minElementSize) {
+        uint64_t n = 0;
+        value(n);
+        if (n > (m_data.size() - m_offset) / minElementSize) {
+            throw std::runtime_error("Corrupt model file tables");
+        }
+        return static_cast<size_t>(n);
+    }
+
+    void read(void* data, size_t size) {
+        if (size > m_data.size() - m_offset) {
+            throw std::runtime_error("Corrupt model file tables");
+        }
+        if (size == 0) {
+            return; // empty vectors have no storage to copy into
+        }
+        std::memcpy(data, m_data.data() + m_offset, size);
+        m_offset += size;
+    }
+
+    std::span<const std::byte> m_data;
+    size_t m_offset = 0;
+};
+
+// Shared by both directions, T is const when writing
+template<typename Archive, typename T> requires std::same_as<std::remove_const_t<T>, MeshFace>
+static void transfer(Archive& ar, T& face) {
+    ar.value(face.indexOffset);
+    ar.value(face.indexCount);
+    ar.value(face.bounds);
+    ar.value(face.sphere);
+    ar.array(face.lods);
+    ar.array(face.meshlets);
+}
+
+template<typename Archive, typename T> requires std::same_as<std::remove_const_t<T>, ModelMesh>
+static void transfer(Archive& ar, T& mesh) {
+    ar.value(mesh.format);
+    ar.value(mesh.materialIndex);
+    ar.value(mesh.vertexCount);
+    ar.value(mesh.indexCount);
+    ar.value(mesh.vertexOffset);
+    ar.value(mesh.indexOffset);
+    ar.objects(mesh.faces);
+    ar.value(mesh.bounds);
+    ar.value(mesh.sphere);
+    ar.array(mesh.occluder.positions);
+    ar.array(mesh.occluder.indices);
+    ar.array(mesh.lodErrors);
+    ar.value(mesh.positionDecode);
+}
+
+template<typename Archive, typename T> requires std::same_as<std::remove_const_t<T>, ModelTexture>
+static void transfer(Archive& ar, T& texture) {
+    ar.string(texture.path);
+    ar.value(texture.dataOffset);
+    ar.value(texture.dataSize);
+    ar.value(texture.width);
+    ar.value(texture.height);
+    ar.value(texture.linear);
+}
+
+template<typename Archive, typename T> requires std::same_as<std::remove_const_t<T>, ModelMaterial>
+static void transfer(Archive& ar, T& material) {
+    ar.value(material.baseColor);
+    ar.value(material.normal);
+    ar.value(material.metallicRoughness);
+    ar.value(material.skinned);
+}
+
+template<typename Archive, typename T> requires std::same_as<std::remove_const_t<T>, ModelNode>
+static void transfer(Archive& ar, T& node) {
+    ar.value(node.localMatrix);
+    ar.value(node.parent);
+    ar.array(node.meshes);
+}
+
+template<typename Archive, typename T> requires std::same_as<std::remove_const_t<T>, ModelBone>
+static void transfer(Archive& ar, T& bone) {
+    ar.string(bone.name);
+    ar.value(bone.parent);
+    ar.value(bone.localTransform);
+    ar.value(bone.inverseBindPose);
+    ar.value(bone.boneOutputIndex);
+}
+
+template<typename Archive, typename T> requires std::same_as<std::remove_const_t<T>, BoneChannel>
+static void transfer(Archive& ar, T& channel) {
+    ar.string(channel.boneName);
+    ar.array(channel.positionKeys);
+    ar.array(channel.rotationKeys);
+    ar.array(channel.scaleKeys);
+}
+
+template<typename Archive, typename T> requires std::same_as<std::remove_const_t<T>, AnimationClip>
+static void transfer(Archive& ar, T& clip) {
+    ar.string(clip.name);
+    ar.value(clip.duration);
+    ar.value(clip.ticksPerSecond);
+    ar.objects(clip.channels);
+}
+
+template<typename Archive, typename T> requires std::same_as<std::remove_const_t<T>, ModelData>
+static void transfer(Archive& ar, T& model) {
+    ar.objects(model.meshes);
+    ar.objects(model.materials);
+    ar.objects(model.textures);
+    ar.objects(model.nodes);
+    ar.objects(model.skeleton);
+    ar.objects(model.clips);
+    ar.value(model.quantized);
+}
+
+bool isModelFile(const std::string& path) {
+    return std::filesystem::path(path).extension() == kModelFileExtension;
+}
+
+bool writeModelFile(const ModelData& model, const std::string& path) {
+    TableWriter tables;
+    transfer(tables, model);
+
+    const std::span<const std::byte> streams = model.getStreams();
+    ModelFileHeader header {
+        .magic = kModelFileMagic,
+        .version = kModelFileVersion,
+        .tablesOffset = sizeof(ModelFileHeader),
+        .tablesSize = tables.getData().size(),
+        .streamsOffset = 0,
+        .streamsSize = streams.size(),
+    };
+    header.streamsOffset = (header.tablesOffset + header.tablesSize + kStreamsAlignment - 1) & ~(kStreamsAlignment - 1);
+
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    if (!file.is_open()) {
+        return false;
+    }
+    const std::vector<char> padding(header.streamsOffset - header.tablesOffset - header.tablesSize, 0);
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    file.write(reinterpret_cast<const char*>(tables.getData().data()), static_cast<std::streamsize>(header.tablesSize));
+    file.write(padding.data(), static_cast<std::streamsize>(padding.size()));
+    file.write(reinterpret_cast<const char*>(streams.data()), static_cast<std::streamsize>(streams.size()));
+    return file.good();
+}
+
+ModelData readModelFile(const std::string& path) {
+    auto mappedFile = std::make_shared<os::MappedFile>(path);
+    const std::span<const std::byte> data = mappedFile->getData();
+
+    ModelFileHeader header {};
+    if (data.size() < sizeof(header)) {
+        throw std::runtime_error("Not a model file: " + path);
+    }
+    std::memcpy(&header, data.data(), sizeof(header));
+    if (header.magic != kModelFileMagic) {
+        throw std::runtime_error("Not a model file: " + path);
+    }
+    if (header.version != kModelFileVersion) {
+        throw std::runtime_error("Model file " + path + " has version " + std::to_string(header.version)
+            + ", expected " + std::to_string(kModelFileVersion) + ", bake it again");
+    }
+    if (header.tablesOffset > data.size() || header.tablesSize > data.size() - header.tablesOffset ||
+        header.streamsOffset > data.size() || header.streamsSize > data.size() - header.streamsOffset) {
+        throw std::runtime_error("Truncated model file: " + path);
+    }
+
+    ModelData model;
+    TableReader tables(data.subspan(header.tablesOffset, header.tablesSize));
+    transfer(tables, model);
+
+    // MeshReader indexes the streams and tables with these values as they are, check them once here
+    const std::span<const std::byte> streams = data.subspan(header.streamsOffset, header.streamsSize);
+    auto inStreams = [&](uint64_t offset, uint64_t size) {
+        return offset <= streams.size() && size <= streams.size() - offset;
+    };
+    auto inRange = [](uint64_t offset, uint64_t count, uint64_t size) {
+        return offset <= size && count <= size - offset;
+    };
+    auto isTexture = [&](int32_t index) {
+        return index == ModelMaterial::kNoTexture || (index >= 0 && static_cast<size_t>(index) < model.textures.size());
+    };
+    auto corrupt = [&](const char* table) {
+        return std::runtime_error(std::string("Corrupt model file ") + table + ": " + path);
+    };
+
+    for (const ModelMesh& mesh : model.meshes) {
+        const uint32_t vertexSize = getVertexSize(mesh.format);
+        bool valid =
+            vertexSize != 0 &&
+            inStreams(mesh.vertexOffset, uint64_t(mesh.vertexCount) * vertexSize) &&
+            inStreams(mesh.indexOffset, uint64_t(mesh.indexCount) * sizeof(uint16_t)) &&
+            mesh.materialIndex < model.materials.size() &&
+            mesh.lodErrors.size() <= kMaxMeshLods &&
+            mesh.occluder.indices.size() % 3 == 0;
+        for (const MeshFace& face : mesh.faces) {
+            valid = valid && inRange(face.indexOffset, face.indexCount, mesh.indexCount) && face.lods.size() < kMaxMeshLods;
+            for (const MeshLod& lod : face.lods) {
+                valid = valid && inRange(lod.indexOffset, lod.indexCount, mesh.indexCount);
+            }
+            for (const Meshlet& meshlet : face.meshlets) {
+                valid = valid && inRange(meshlet.indexOffset, meshlet.indexCount, mesh.indexCount);
+            }
+        }
+        for (uint16_t index : mesh.occluder.indices) {
+            valid = valid && index < mesh.occluder.positions.size();
+        }
+        if (!valid) {
+            throw corrupt("meshes");
+        }
+
+        // indices address the vertices of their own mesh only
+        for (uint32_t i = 0; i < mesh.indexCount; i++) {
+            uint16_t index;
+            std::memcpy(&index, streams.data() + mesh.indexOffset + i * sizeof(uint16_t), sizeof(index));
+            if (index >= mesh.vertexCount) {
+                throw corrupt("indices");
+            }
+        }
+    }
+    for (const ModelMaterial& material : model.materials) {
+        if (!isTexture(material.baseColor) || !isTexture(material.normal) || !isTexture(material.metallicRoughness)) {
+            throw corrupt("materials");
+        }
+    }
+    for (const ModelTexture& texture : model.textures) {
+        // raw embedded texels are RGBA8, uploaded width * height at a time
+        const bool raw = texture.height > 0;
+        if (texture.path.empty() && (!inStreams(texture.dataOffset, texture.dataSize) ||
+                                     (raw && texture.dataSize < uint64_t(texture.width) * texture.height * 4))) {
+            throw corrupt("textures");
+        }
+    }
+    // parent-first order, a parent comes before its children
+    for (size_t i = 0; i < model.nodes.size(); i++) {
+        const ModelNode& node = model.nodes[i];
+        bool valid = node.parent >= -1 && node.parent < static_cast<int64_t>(i);
+        for (uint32_t meshIndex : node.meshes) {
+            valid = valid && meshIndex < model.meshes.size();
+        }
+        if (!valid) {
+            throw corrupt("nodes");
+        }
+    }
+    for (size_t i = 0; i < model.skeleton.size(); i++) {
+        const ModelBone& bone = model.skeleton[i];
+        if (bone.parent < -1 || bone.parent >= static_cast<int64_t>(i)) {
+            throw corrupt("skeleton");
+        }
+    }
+
+    model.mappedStreams = streams;
+    model.mappedFile = std::move(mappedFile);
+    return model;
+}
+
+}
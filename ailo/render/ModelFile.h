@@ -0,0 +1,25 @@
+#pragma once
+
+#include "ModelData.h"
+
+#include <string>
+
+namespace ailo {
+
+// Binary container of a ModelData, written by `resgen mesh-bake`. The header is followed by
+// the tables and then by the streams, 64 byte aligned, so readModelFile maps the file and the
+// vertex, index and embedded texture data go to the GPU straight from the mapping.
+// Little endian; a file of another version is rejected and has to be baked again.
+inline constexpr const char* kModelFileExtension = ".amesh";
+inline constexpr uint32_t kModelFileVersion = 3;
+
+bool isModelFile(const std::string& path);
+
+// Returns false when the file can't be written
+bool writeModelFile(const ModelData& model, const std::string& path);
+
+// Throws std::runtime_error when the file is missing, truncated or of another version, or when a
+// range, index or parent in it is out of bounds
+ModelData readModelFile(const std::string& path);
+
+}
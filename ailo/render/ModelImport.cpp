@@ -0,0 +1,579 @@
+#include "ModelImport.h"
+
+#include <assimp/Importer.hpp>
+#include <assimp/scene.h>
+#include <assimp/postprocess.h>
+#include <assimp/material.h>
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/packing.hpp>
+#include <algorithm>
+#include <cstring>
+#include <functional>
+#include <iostream>
+#include <limits>
+#include <span>
+#include <stdexcept>
+#include <unordered_map>
+#include <unordered_set>
+
+#include "common/JobSystem.h"
+#include "MeshOptimize.h"
+#include "Meshlets.h"
+#include "Simplify.h"
+
+namespace ailo {
+
+// 8 bit bone indices of the quantized skinned layout
+static constexpr size_t kMaxQuantizedBones = 256;
+static constexpr size_t kMinMeshletTriangles = 512;
+
+static glm::mat4 aiMatrixToGlm(const aiMatrix4x4& m) {
+    return glm::mat4(
+        m.a1, m.b1, m.c1, m.d1,
+        m.a2, m.b2, m.c2, m.d2,
+        m.a3, m.b3, m.c3, m.d3,
+        m.a4, m.b4, m.c4, m.d4
+    );
+}
+
+// Appends data to the streams at a 16 byte boundary, returns its offset
+static uint64_t appendStream(std::vector<std::byte>& streams, const void* data, size_t size) {
+    const uint64_t offset = (streams.size() + 15) & ~uint64_t(15);
+    streams.resize(offset + size);
+    std::memcpy(streams.data() + offset, data, size);
+    return offset;
+}
+
+// Vertex counts and post-transform cache efficiency of a mesh before and after optimizeMesh
+struct MeshOptimizeStats {
+    size_t sourceVertexCount = 0;
+    size_t vertexCount = 0;
+    size_t triangleCount = 0;
+    VertexCacheStats before;
+    VertexCacheStats after;
+};
+
+// Welds identical vertices, then orders triangles for the post-transform cache and overdraw
+// and vertices for fetch locality.
+template<typename V>
+static MeshOptimizeStats optimizeMesh(std::vector<V>& vertices, std::vector<uint16_t>& indices) {
+    static_assert(offsetof(V, pos) == 0 && sizeof(V) % sizeof(float) == 0);
+    MeshOptimizeStats stats { vertices.size(), vertices.size(), indices.size() / 3 };
+    if (indices.empty()) return stats;
+
+    stats.before = analyzeVertexCache(indices, vertices.size());
+
+    vertices.resize(weldVertices(vertices.data(), vertices.size(), sizeof(V), indices));
+    optimizeVertexCache(indices, vertices.size());
+    optimizeOverdraw(indices, &vertices[0].pos.x, sizeof(V) / sizeof(float), vertices.size());
+    vertices.resize(optimizeVertexFetch(vertices.data(), vertices.size(), sizeof(V), indices));
+
+    stats.vertexCount = vertices.size();
+    stats.after = analyzeVertexCache(indices, vertices.size());
+    return stats;
+}
+
+// Octahedral encoding of a unit vector in [-1, 1]^2, the inverse of octDecodeSnorm in common_math.glsl
+static glm::vec2 octEncode(glm::vec3 n) {
+    float sum = std::abs(n.x) + std::abs(n.y) + std::abs(n.z);
+    if (sum == 0.0f) {
+        return glm::vec2(0.0f);
+    }
+    n /= sum;
+    glm::vec2 e(n.x, n.y);
+    if (n.z < 0.0f) {
+        e = glm::vec2((1.0f - std::abs(n.y)) * (n.x >= 0.0f ? 1.0f : -1.0f),
+                      (1.0f - std::abs(n.x)) * (n.y >= 0.0f ? 1.0f : -1.0f));
+    }
+    return e;
+}
+
+template<typename Q, typename V>
+static void packCommon(Q& q, const V& v) {
+    const glm::vec2 normal = octEncode(v.normal);
+    const glm::vec2 tangent = octEncode(glm::vec3(v.tangent));
+    for (int k = 0; k < 2; k++) {
+        q.normal[k] = static_cast<int16_t>(glm::packSnorm1x16(normal[k]));
+        q.tangent[k] = static_cast<int16_t>(glm::packSnorm1x16(tangent[k]));
+        q.texCoord[k] = glm::packHalf1x16(v.texCoord[k]);
+    }
+}
+
+// Positions are stored relative to the bounds of the vertices, positionDecode maps them back
+static std::vector<QuantizedVertex> quantizeVertices(const std::vector<Vertex>& vertices, glm::mat4& positionDecode) {
+    glm::vec3 min(std::numeric_limits<float>::max());
+    glm::vec3 max(std::numeric_limits<float>::lowest());
+    for (const auto& v : vertices) {
+        min = glm::min(min, v.pos);
+        max = glm::max(max, v.pos);
+    }
+    glm::vec3 extent = max - min;
+    for (int k = 0; k < 3; k++) {
+        extent[k] = extent[k] > 0.0f ? extent[k] : 1.0f;
+    }
+    positionDecode = glm::scale(glm::translate(glm::mat4(1.0f), min), extent);
+
+    std::vector<QuantizedVertex> result(vertices.size());
+    for (size_t i = 0; i < vertices.size(); i++) {
+        const Vertex& v = vertices[i];
+        QuantizedVertex& q = result[i];
+        const glm::vec3 normalized = (v.pos - min) / extent;
+        for (int k = 0; k < 3; k++) {
+            q.pos[k] = glm::packUnorm1x16(normalized[k]);
+        }
+        q.pos[3] = v.tangent.w < 0.0f ? 0 : 65535;
+        packCommon(q, v);
+    }
+    return result;
+}
+
+static std::vector<QuantizedSkinnedVertex> quantizeVertices(const std::vector<SkinnedVertex>& vertices) {
+    std::vector<QuantizedSkinnedVertex> result(vertices.size());
+    for (size_t i = 0; i < vertices.size(); i++) {
+        const SkinnedVertex& v = vertices[i];
+        QuantizedSkinnedVertex& q = result[i];
+        for (int k = 0; k < 3; k++) {
+            q.pos[k] = glm::packHalf1x16(v.pos[k]);
+        }
+        q.pos[3] = glm::packHalf1x16(v.tangent.w < 0.0f ? 0.0f : 1.0f);
+        packCommon(q, v);
+
+        // weights are renormalized after rounding so the skinned vertex doesn't drift
+        const float sum = v.boneWeights.x + v.boneWeights.y + v.boneWeights.z + v.boneWeights.w;
+        int total = 0;
+        int largest = 0;
+        for (int k = 0; k < 4; k++) {
+            q.boneIndices[k] = static_cast<uint8_t>(v.boneIndices[k]);
+            q.boneWeights[k] = sum > 0.0f ? glm::packUnorm1x16(v.boneWeights[k] / sum) : 0;
+            total += q.boneWeights[k];
+            largest = v.boneWeights[k] > v.boneWeights[largest] ? k : largest;
+        }
+        if (sum > 0.0f) {
+            q.boneWeights[largest] = static_cast<uint16_t>(q.boneWeights[largest] + 65535 - total);
+        }
+    }
+    return result;
+}
+
+// Appends coarser levels of the face to indices, each one keeps about half the triangles of
+// the previous. Levels are simplified from level 0 so their errors don't add up.
+static void buildLods(ModelMesh& mesh, MeshFace& face, const float* positions, size_t vertexCount, std::vector<uint16_t>& indices) {
+    static constexpr size_t kMinLodTriangles = 32;
+
+    const std::vector<uint16_t> lod0(indices.begin() + face.indexOffset, indices.begin() + face.indexOffset + face.indexCount);
+    mesh.lodErrors.resize(std::max<size_t>(mesh.lodErrors.size(), 1), 0.0f);
+    size_t previousCount = lod0.size();
+    for (size_t level = 1; level < kMaxMeshLods && previousCount / 3 >= kMinLodTriangles * 2; level++) {
+        float error = 0.0f;
+        auto lod = simplifyMesh(positions, 3, vertexCount, lod0, previousCount / 2 / 3 * 3, mesh.sphere.radius, &error);
+        // locked borders and seams can stop the simplifier early, a level that barely shrinks isn't worth a draw
+        if (lod.empty() || lod.size() > previousCount * 3 / 4) {
+            break;
+        }
+        optimizeVertexCache(lod, vertexCount);
+        face.lods.push_back({ static_cast<uint32_t>(indices.size()), static_cast<uint32_t>(lod.size()) });
+        indices.insert(indices.end(), lod.begin(), lod.end());
+
+        mesh.lodErrors.resize(std::max(mesh.lodErrors.size(), level + 1), 0.0f);
+        mesh.lodErrors[level] = std::max(mesh.lodErrors[level], mesh.sphere.radius > 0.0f ? error / mesh.sphere.radius : 0.0f);
+        previousCount = lod.size();
+    }
+}
+
+template<typename V>
+static void readCommon(V& vertex, const aiMesh* aiMesh, unsigned int v) {
+    vertex.pos = {aiMesh->mVertices[v].x, aiMesh->mVertices[v].y, aiMesh->mVertices[v].z};
+    vertex.texCoord = aiMesh->mTextureCoords[0]
+        ? glm::vec2(aiMesh->mTextureCoords[0][v].x, aiMesh->mTextureCoords[0][v].y)
+        : glm::vec2(0.0f);
+    if (aiMesh->mNormals)
+        vertex.normal = {aiMesh->mNormals[v].x, aiMesh->mNormals[v].y, aiMesh->mNormals[v].z};
+    if (aiMesh->mTangents) {
+        glm::vec3 t(aiMesh->mTangents[v].x, aiMesh->mTangents[v].y, aiMesh->mTangents[v].z);
+        glm::vec3 b(aiMesh->mBitangents[v].x, aiMesh->mBitangents[v].y, aiMesh->mBitangents[v].z);
+        vertex.tangent = glm::vec4(t, glm::dot(glm::cross(vertex.normal, t), b));
+    } else {
+        vertex.tangent = glm::vec4(1.0f, 0.0f, 0.0f, 1.0f);
+    }
+}
+
+// Streams of one mesh, converted on any thread. importModel appends them in mesh order so
+// the offsets don't depend on which mesh finished first.
+struct MeshStaging {
+    ModelMesh mesh;
+    std::vector<std::byte> vertices;
+    std::vector<uint16_t> indices;
+    size_t sourceVertexBytes = 0;
+    MeshOptimizeStats stats;
+};
+
+// Reads only the aiMesh and the bone registry, so meshes convert concurrently
+static void convertMesh(const aiMesh* aiMesh, const std::unordered_map<std::string, uint32_t>& globalBoneRegistry,
+                        bool quantize, MeshStaging& staging) {
+    ModelMesh& mesh = staging.mesh;
+    mesh.materialIndex = aiMesh->mMaterialIndex;
+    const bool skinned = aiMesh->mNumBones > 0;
+
+    std::vector<uint16_t>& indices = staging.indices;
+    indices.reserve(aiMesh->mNumFaces * 3);
+    for (unsigned int f = 0; f < aiMesh->mNumFaces; f++) {
+        for (unsigned int j = 0; j < aiMesh->mFaces[f].mNumIndices; j++)
+            indices.push_back(static_cast<uint16_t>(aiMesh->mFaces[f].mIndices[j]));
+    }
+
+    // positions of the optimized vertices, for bounds, LODs and the occluder
+    std::vector<glm::vec3> positions;
+
+    auto keepVertices = [&](const auto& vertices, VertexFormat format) {
+        auto bytes = std::as_bytes(std::span(vertices));
+        mesh.format = format;
+        mesh.vertexCount = static_cast<uint32_t>(vertices.size());
+        staging.vertices.assign(bytes.begin(), bytes.end());
+    };
+
+    if (skinned) {
+        // Accumulate per-vertex bone weights
+        struct VBW { std::vector<std::pair<uint32_t, float>> weights; };
+        std::vector<VBW> vbw(aiMesh->mNumVertices);
+        for (unsigned int j = 0; j < aiMesh->mNumBones; j++) {
+            aiBone* bone = aiMesh->mBones[j];
+            auto it = globalBoneRegistry.find(bone->mName.C_Str());
+            if (it == globalBoneRegistry.end()) continue;
+            uint32_t boneOutputIdx = it->second;
+            for (unsigned int k = 0; k < bone->mNumWeights; k++)
+                vbw[bone->mWeights[k].mVertexId].weights.push_back({boneOutputIdx, bone->mWeights[k].mWeight});
+        }
+
+        std::vector<SkinnedVertex> verts;
+        verts.reserve(aiMesh->mNumVertices);
+        for (unsigned int v = 0; v < aiMesh->mNumVertices; v++) {
+            SkinnedVertex sv{};
+            readCommon(sv, aiMesh, v);
+            sv.color = aiMesh->mColors[0]
+                ? glm::vec3(aiMesh->mColors[0][v].r, aiMesh->mColors[0][v].g, aiMesh->mColors[0][v].b)
+                : glm::vec3(1.0f);
+            sv.boneIndices = glm::ivec4(0);
+            sv.boneWeights = glm::vec4(0.0f);
+            const auto& bws = vbw[v].weights;
+            for (int k = 0; k < std::min(4, static_cast<int>(bws.size())); k++) {
+                sv.boneIndices[k] = static_cast<int>(bws[k].first);
+                sv.boneWeights[k] = bws[k].second;
+            }
+            verts.push_back(sv);
+        }
+        staging.stats = optimizeMesh(verts, indices);
+        for (const auto& v : verts) positions.push_back(v.pos);
+        staging.sourceVertexBytes = sizeof(SkinnedVertex) * verts.size();
+        if (quantize) {
+            keepVertices(quantizeVertices(verts), VertexFormat::QuantizedSkinned);
+        } else {
+            keepVertices(verts, VertexFormat::Skinned);
+        }
+    } else {
+        std::vector<Vertex> verts;
+        verts.reserve(aiMesh->mNumVertices);
+        for (unsigned int v = 0; v < aiMesh->mNumVertices; v++) {
+            Vertex vx{};
+            readCommon(vx, aiMesh, v);
+            if (aiMesh->mColors[0]) {
+                vx.color = {aiMesh->mColors[v]->r, aiMesh->mColors[v]->r, aiMesh->mColors[v]->b};
+            } else {
+                vx.color = glm::vec3(1.0f);
+            }
+            verts.push_back(vx);
+        }
+        staging.stats = optimizeMesh(verts, indices);
+        for (const auto& v : verts) positions.push_back(v.pos);
+        staging.sourceVertexBytes = sizeof(Vertex) * verts.size();
+        if (quantize) {
+            keepVertices(quantizeVertices(verts, mesh.positionDecode), VertexFormat::Quantized);
+        } else {
+            keepVertices(verts, VertexFormat::Standard);
+        }
+    }
+
+    static_assert(sizeof(glm::vec3) == 3 * sizeof(float));
+    const float* positionData = reinterpret_cast<const float*>(positions.data());
+
+    // large static meshes are culled per meshlet, this reorders level 0 into meshlet ranges
+    std::vector<Meshlet> meshlets;
+    if (!skinned && indices.size() / 3 >= kMinMeshletTriangles) {
+        meshlets = buildMeshlets(indices, 0, static_cast<uint32_t>(indices.size()), positionData, 3, positions.size());
+    }
+    Aabb bounds = computeAabb(positionData, 3, indices.data(), indices.size());
+    BoundingSphere sphere = computeBoundingSphere(positionData, 3, indices.data(), indices.size(), bounds);
+    mesh.faces.push_back({0, static_cast<uint32_t>(indices.size()), bounds, sphere});
+    mesh.faces.back().meshlets = std::move(meshlets);
+    mesh.bounds = bounds;
+    mesh.sphere = sphere;
+    if (!skinned) {
+        mesh.occluder = simplifyOccluder(positionData, 3, indices.data(), indices.size());
+    }
+
+    // all levels share the vertex stream and live one after another in the index stream
+    buildLods(mesh, mesh.faces.back(), positionData, positions.size(), indices);
+    mesh.indexCount = static_cast<uint32_t>(indices.size());
+}
+
+// Collects the textures of the materials, every file or embedded texture is listed once
+class TextureTable {
+public:
+    TextureTable(const aiScene* scene, ModelData& model) : m_scene(scene), m_model(model) {}
+
+    int32_t add(const aiMaterial* material, aiTextureType textureType, bool linear) {
+        if (material->GetTextureCount(textureType) <= 0) return ModelMaterial::kNoTexture;
+        aiString texturePath;
+        if (material->GetTexture(textureType, 0, &texturePath) != AI_SUCCESS) return ModelMaterial::kNoTexture;
+
+        std::string key = std::string(texturePath.C_Str()) + (linear ? "@norm" : "");
+        auto [it, inserted] = m_indices.emplace(key, static_cast<int32_t>(m_model.textures.size()));
+        if (!inserted) {
+            return it->second;
+        }
+
+        ModelTexture texture { .linear = linear };
+        if (auto embedded = m_scene->GetEmbeddedTexture(texturePath.C_Str())) {
+            const size_t size = embedded->mHeight > 0 ? embedded->mWidth * embedded->mHeight * sizeof(aiTexel) : embedded->mWidth;
+            texture.dataOffset = appendStream(m_model.ownedStreams, embedded->pcData, size);
+            texture.dataSize = size;
+            texture.width = embedded->mHeight > 0 ? embedded->mWidth : 0;
+            texture.height = embedded->mHeight;
+        } else {
+            texture.path = texturePath.C_Str();
+        }
+        m_model.textures.push_back(std::move(texture));
+        return it->second;
+    }
+
+private:
+    const aiScene* m_scene;
+    ModelData& m_model;
+    std::unordered_map<std::string, int32_t> m_indices;
+};
+
+ModelData importModel(const std::string& path, const MeshImportOptions& options, JobSystem* jobSystem) {
+    Assimp::Importer importer;
+
+    const aiScene* aiscene = importer.ReadFile(path,
+        aiProcess_Triangulate |
+        aiProcess_OptimizeMeshes |
+        aiProcess_FlipUVs |
+        aiProcess_GenNormals |
+        aiProcess_CalcTangentSpace |
+        aiProcess_LimitBoneWeights);
+
+    if (!aiscene || aiscene->mFlags & AI_SCENE_FLAGS_INCOMPLETE || !aiscene->mRootNode)
+        throw std::runtime_error("Failed to load mesh: " + std::string(importer.GetErrorString()));
+
+    ModelData model;
+
+    // -------------------------------------------------------------------------
+    // Skinning: collect bone names and build skeleton
+    // -------------------------------------------------------------------------
+
+    // Step 1: collect all bone names
+    std::unordered_set<std::string> boneNameSet;
+    for (unsigned int i = 0; i < aiscene->mNumMeshes; i++) {
+        aiMesh* m = aiscene->mMeshes[i];
+        for (unsigned int j = 0; j < m->mNumBones; j++)
+            boneNameSet.insert(m->mBones[j]->mName.C_Str());
+    }
+
+    const bool hasAnySkinning = !boneNameSet.empty();
+
+    // Step 2: mark nodes to include — bones AND their non-bone ancestors.
+    // We need ALL ancestors so that intermediate node transforms (e.g. "Armature")
+    // are accumulated into bone world transforms. Without this, inverseBindPose
+    // (which was computed from the full hierarchy) won't cancel correctly at bind pose.
+    std::unordered_set<std::string> includedNodeNames;
+    if (hasAnySkinning) {
+        std::function<bool(const aiNode*)> markAncestors = [&](const aiNode* node) -> bool {
+            bool anyChildIncluded = false;
+            for (unsigned int i = 0; i < node->mNumChildren; i++)
+                if (markAncestors(node->mChildren[i])) anyChildIncluded = true;
+            std::string name = node->mName.C_Str();
+            if (boneNameSet.count(name) || anyChildIncluded) {
+                includedNodeNames.insert(name);
+                return true;
+            }
+            return false;
+        };
+        markAncestors(aiscene->mRootNode);
+    }
+
+    // Step 3: build skeleton — all included nodes in parent-first DFS order.
+    //   globalBoneRegistry: bone name → boneOutputIndex (index in BonesUniform::bones[])
+    //   non-bone nodes get boneOutputIndex = -1 and don't write to BonesUniform.
+    std::unordered_map<std::string, uint32_t> globalBoneRegistry; // bone name → boneOutputIndex
+
+    if (hasAnySkinning) {
+        std::unordered_map<std::string, uint32_t> nodeNameToIndex;
+        uint32_t nextBoneOutputIndex = 0;
+        std::function<void(const aiNode*, int)> buildSkeleton = [&](const aiNode* node, int parentNodeIdx) {
+            std::string name = node->mName.C_Str();
+            if (!includedNodeNames.count(name)) return;
+
+            uint32_t nodeIdx = static_cast<uint32_t>(model.skeleton.size());
+            nodeNameToIndex[name] = nodeIdx;
+
+            ModelBone bone;
+            bone.name = name;
+            bone.parent = parentNodeIdx;
+            bone.localTransform = aiMatrixToGlm(node->mTransformation);
+            bone.inverseBindPose = glm::mat4(1.0f);
+            if (boneNameSet.count(name)) {
+                bone.boneOutputIndex = static_cast<int>(nextBoneOutputIndex);
+                globalBoneRegistry[name] = nextBoneOutputIndex++;
+            } else {
+                bone.boneOutputIndex = -1;
+            }
+            model.skeleton.push_back(std::move(bone));
+
+            for (unsigned int i = 0; i < node->mNumChildren; i++)
+                buildSkeleton(node->mChildren[i], static_cast<int>(nodeIdx));
+        };
+        buildSkeleton(aiscene->mRootNode, -1);
+
+        // Step 4: fill inverseBindPose from mesh bone data
+        for (unsigned int i = 0; i < aiscene->mNumMeshes; i++) {
+            aiMesh* m = aiscene->mMeshes[i];
+            for (unsigned int j = 0; j < m->mNumBones; j++) {
+                aiBone* bone = m->mBones[j];
+                auto it = nodeNameToIndex.find(bone->mName.C_Str());
+                if (it != nodeNameToIndex.end())
+                    model.skeleton[it->second].inverseBindPose = aiMatrixToGlm(bone->mOffsetMatrix);
+            }
+        }
+    }
+
+    // The packed layout has no color and 8 bit bone indices
+    bool quantize = options.quantizeVertices && globalBoneRegistry.size() <= kMaxQuantizedBones;
+    for (unsigned int i = 0; i < aiscene->mNumMeshes && quantize; i++) {
+        quantize = aiscene->mMeshes[i]->mColors[0] == nullptr;
+    }
+    model.quantized = quantize;
+
+    // -------------------------------------------------------------------------
+    // Materials
+    // -------------------------------------------------------------------------
+    TextureTable textures(aiscene, model);
+    model.materials.resize(aiscene->mNumMaterials);
+    for (unsigned int i = 0; i < aiscene->mNumMaterials; i++) {
+        aiMaterial* mat = aiscene->mMaterials[i];
+        ModelMaterial& material = model.materials[i];
+
+        material.baseColor = textures.add(mat, aiTextureType_BASE_COLOR, false);
+        if (material.baseColor == ModelMaterial::kNoTexture) material.baseColor = textures.add(mat, aiTextureType_DIFFUSE, false);
+        material.normal = textures.add(mat, aiTextureType_NORMALS, true);
+        material.metallicRoughness = textures.add(mat, aiTextureType_GLTF_METALLIC_ROUGHNESS, false);
+    }
+    for (unsigned int i = 0; i < aiscene->mNumMeshes; i++) {
+        if (aiscene->mMeshes[i]->mNumBones > 0)
+            model.materials[aiscene->mMeshes[i]->mMaterialIndex].skinned = true;
+    }
+
+    // -------------------------------------------------------------------------
+    // Build per-aiMesh vertex/index streams, one job per mesh
+    // -------------------------------------------------------------------------
+    const uint32_t meshCount = aiscene->mNumMeshes;
+    std::vector<MeshStaging> staging(meshCount);
+    auto convertRange = [&](uint32_t first, uint32_t last) {
+        for (uint32_t i = first; i < last; i++) {
+            convertMesh(aiscene->mMeshes[i], globalBoneRegistry, quantize, staging[i]);
+        }
+    };
+    if (jobSystem) {
+        // mesh sizes vary by orders of magnitude, a grain of one lets idle workers steal the rest
+        jobSystem->parallelFor(0, meshCount, 1, convertRange);
+    } else {
+        convertRange(0, meshCount);
+    }
+
+    model.meshes.resize(meshCount);
+    size_t sourceVertexBytes = 0;
+    size_t vertexBytes = 0;
+    MeshOptimizeStats total;
+    double transformedBefore = 0.0, transformedAfter = 0.0;
+    for (uint32_t i = 0; i < meshCount; i++) {
+        MeshStaging& converted = staging[i];
+        const MeshOptimizeStats& stats = converted.stats;
+        if (options.logMeshStats) {
+            std::cout << "Mesh '" << aiscene->mMeshes[i]->mName.C_Str() << "': vertices " << stats.sourceVertexCount << " -> " << stats.vertexCount
+                      << ", ACMR " << stats.before.acmr << " -> " << stats.after.acmr
+                      << ", ATVR " << stats.before.atvr << " -> " << stats.after.atvr << "\n";
+        }
+        total.sourceVertexCount += stats.sourceVertexCount;
+        total.vertexCount += stats.vertexCount;
+        total.triangleCount += stats.triangleCount;
+        transformedBefore += double(stats.before.acmr) * stats.triangleCount;
+        transformedAfter += double(stats.after.acmr) * stats.triangleCount;
+
+        ModelMesh& mesh = model.meshes[i];
+        mesh = std::move(converted.mesh);
+        mesh.vertexOffset = appendStream(model.ownedStreams, converted.vertices.data(), converted.vertices.size());
+        mesh.indexOffset = appendStream(model.ownedStreams, converted.indices.data(), converted.indices.size() * sizeof(uint16_t));
+        sourceVertexBytes += converted.sourceVertexBytes;
+        vertexBytes += converted.vertices.size();
+
+        // release the staging copy right away, the streams of a large model add up
+        converted = {};
+    }
+
+    // one line per model, the per mesh stats are behind MeshImportOptions::logMeshStats
+    std::cout << "Optimized " << meshCount << " meshes of '" << path << "': vertices " << total.sourceVertexCount
+              << " -> " << total.vertexCount << ", ACMR " << transformedBefore / std::max<size_t>(total.triangleCount, 1)
+              << " -> " << transformedAfter / std::max<size_t>(total.triangleCount, 1);
+    if (quantize) {
+        std::cout << ", quantized vertex data " << sourceVertexBytes << " -> " << vertexBytes << " bytes";
+    }
+    std::cout << std::endl;
+
+    // -------------------------------------------------------------------------
+    // Parse animation clips
+    // -------------------------------------------------------------------------
+    if (hasAnySkinning) {
+        model.clips.reserve(aiscene->mNumAnimations);
+        for (unsigned int i = 0; i < aiscene->mNumAnimations; i++) {
+            aiAnimation* aiAnim = aiscene->mAnimations[i];
+            AnimationClip clip;
+            clip.name = aiAnim->mName.C_Str();
+            clip.ticksPerSecond = aiAnim->mTicksPerSecond > 0.0 ? static_cast<float>(aiAnim->mTicksPerSecond) : 25.0f;
+            clip.duration = static_cast<float>(aiAnim->mDuration) / clip.ticksPerSecond;
+
+            for (unsigned int j = 0; j < aiAnim->mNumChannels; j++) {
+                aiNodeAnim* ch = aiAnim->mChannels[j];
+                BoneChannel bc;
+                bc.boneName = ch->mNodeName.C_Str();
+                for (unsigned int k = 0; k < ch->mNumPositionKeys; k++)
+                    bc.positionKeys.push_back({ static_cast<float>(ch->mPositionKeys[k].mTime) / clip.ticksPerSecond,
+                        {ch->mPositionKeys[k].mValue.x, ch->mPositionKeys[k].mValue.y, ch->mPositionKeys[k].mValue.z} });
+                for (unsigned int k = 0; k < ch->mNumRotationKeys; k++)
+                    bc.rotationKeys.push_back({ static_cast<float>(ch->mRotationKeys[k].mTime) / clip.ticksPerSecond,
+                        glm::quat(ch->mRotationKeys[k].mValue.w, ch->mRotationKeys[k].mValue.x,
+                                  ch->mRotationKeys[k].mValue.y, ch->mRotationKeys[k].mValue.z) });
+                for (unsigned int k = 0; k < ch->mNumScalingKeys; k++)
+                    bc.scaleKeys.push_back({ static_cast<float>(ch->mScalingKeys[k].mTime) / clip.ticksPerSecond,
+                        {ch->mScalingKeys[k].mValue.x, ch->mScalingKeys[k].mValue.y, ch->mScalingKeys[k].mValue.z} });
+                clip.channels.push_back(std::move(bc));
+            }
+            model.clips.push_back(std::move(clip));
+        }
+    }
+
+    // -------------------------------------------------------------------------
+    // Node hierarchy
+    // -------------------------------------------------------------------------
+    std::function<void(const aiNode*, int32_t)> addNode = [&](const aiNode* node, int32_t parent) {
+        const auto index = static_cast<int32_t>(model.nodes.size());
+        model.nodes.push_back({ aiMatrixToGlm(node->mTransformation), parent, {} });
+        model.nodes.back().meshes.assign(node->mMeshes, node->mMeshes + node->mNumMeshes);
+        for (unsigned int i = 0; i < node->mNumChildren; i++) {
+            addNode(node->mChildren[i], index);
+        }
+    };
+    addNode(aiscene->mRootNode, -1);
+
+    return model;
+}
+
+}
@@ -0,0 +1,17 @@
+#pragma once
+
+#include "ModelData.h"
+
+#include <string>
+
+namespace ailo {
+
+class JobSystem;
+
+// CPU stage of the import, shared by the engine and resgen: reads the file with Assimp and
+// produces GPU-ready streams with optimized, quantized, LOD and meshlet data. Throws
+// std::runtime_error when the file can't be read. With a jobSystem the meshes are converted
+// on its workers, the result is the same either way.
+ModelData importModel(const std::string& path, const MeshImportOptions& options = {}, JobSystem* jobSystem = nullptr);
+
+}
@@ -10,7 +10,9 @@ ailo::Pipeline::Pipeline(
     const resource_ptr<gpu::Program>& programPtr,
     vk::RenderPass renderPass,
     const gpu::VertexBufferLayout& vertexInput,
-    const gpu::FrameBufferFormat& format
+    const gpu::FrameBufferFormat& format,
+    uint32_t subpass,
+    DepthMode depthMode
     )
         : m_device(device),
         m_programPtr(programPtr) {
@@ -64,14 +66,20 @@ ailo::Pipeline::Pipeline(
     depthStencil.depthTestEnable = VK_TRUE;
     depthStencil.depthWriteEnable = raster.depthWriteEnable;
     depthStencil.depthCompareOp = raster.depthCompareOp;
+    if (depthMode == DepthMode::EQUAL_READ_ONLY) {
+        depthStencil.depthWriteEnable = VK_FALSE;
+        depthStencil.depthCompareOp = vk::CompareOp::eEqual;
+    }
     depthStencil.depthBoundsTestEnable = VK_FALSE;
     depthStencil.stencilTestEnable = VK_FALSE;
 
     // Color blending
     PerColorAttachment<vk::PipelineColorBlendAttachmentState> colorBlendAttachments{};
     for (auto& colorBlendAttachment : colorBlendAttachments) {
-        colorBlendAttachment.colorWriteMask = vk::ColorComponentFlagBits::eR | vk::ColorComponentFlagBits::eG |
-                                              vk::ColorComponentFlagBits::eB | vk::ColorComponentFlagBits::eA;
+        if (raster.colorWriteEnable) {
+            colorBlendAttachment.colorWriteMask = vk::ColorComponentFlagBits::eR | vk::ColorComponentFlagBits::eG |
+                                                  vk::ColorComponentFlagBits::eB | vk::ColorComponentFlagBits::eA;
+        }
         colorBlendAttachment.blendEnable = raster.blendEnable;
         colorBlendAttachment.colorBlendOp = raster.blendOp.rgb;
         colorBlendAttachment.alphaBlendOp = raster.blendOp.a;
@@ -108,7 +116,7 @@ ailo::Pipeline::Pipeline(
     pipelineInfo.pDynamicState = &dynamicState;
     pipelineInfo.layout = programPtr->pipelineLayout();
     pipelineInfo.renderPass = renderPass;
-    pipelineInfo.subpass = 0;
+    pipelineInfo.subpass = subpass;
 
     auto result = m_device.createGraphicsPipeline(nullptr, pipelineInfo);
     if (result.result != vk::Result::eSuccess) {
@@ -127,9 +135,14 @@ ailo::PipelineCache::PipelineCache(vk::Device device, ResourceContainer<Pipeline
 
 void ailo::PipelineCache::bindProgram(const resource_ptr<gpu::Program>& program) {
     m_pipelineState.program = program;
+    m_currentPipeline = {};
 }
 
 ailo::resource_ptr<ailo::Pipeline> ailo::PipelineCache::getOrCreate() {
+    if (m_currentPipeline) {
+        return m_currentPipeline;
+    }
+
     auto& state = m_pipelineState;
 
     PipelineCacheQuery query;
@@ -142,15 +155,21 @@ ailo::resource_ptr<ailo::Pipeline> ailo::PipelineCache::getOrCreate() {
         query.renderPassKey.colors[i] = state.frameBufferFormat.color[i];
     }
     query.renderPassKey.depth = state.frameBufferFormat.depth;
+    query.renderPassKey.subpasses = state.subpasses;
+    query.renderPassKey.subpassCount = state.subpassCount;
+    query.renderPassKey.subpass = state.subpass;
+    query.depthMode = state.depthMode;
 
     auto ptr = m_cache.get(query);
     if (ptr) {
-        return *ptr;
+        m_currentPipeline = *ptr;
+        return m_currentPipeline;
     }
 
-    resource_ptr<Pipeline> pipeline = resource_ptr<Pipeline>::make(*m_pipelines, m_device, m_pipelineState.program, m_pipelineState.renderPass, m_pipelineState.vertexLayout, m_pipelineState.frameBufferFormat);
+    resource_ptr<Pipeline> pipeline = resource_ptr<Pipeline>::make(*m_pipelines, m_device, m_pipelineState.program, m_pipelineState.renderPass, m_pipelineState.vertexLayout, m_pipelineState.frameBufferFormat, m_pipelineState.subpass, m_pipelineState.depthMode);
     auto [it, result] = m_cache.tryEmplace(query, pipeline);
     assert(result);
     assert(it->second);
-    return it->second;
+    m_currentPipeline = it->second;
+    return m_currentPipeline;
 }
@@ -12,7 +12,7 @@ namespace ailo {
 
 class Pipeline : public enable_resource_ptr<Pipeline> {
 public:
-    Pipeline(vk::Device device, const resource_ptr<gpu::Program>& program, vk::RenderPass renderPass, const gpu::VertexBufferLayout& vertexInput, const gpu::FrameBufferFormat& format);
+    Pipeline(vk::Device device, const resource_ptr<gpu::Program>& program, vk::RenderPass renderPass, const gpu::VertexBufferLayout& vertexInput, const gpu::FrameBufferFormat& format, uint32_t subpass, DepthMode depthMode);
     ~Pipeline();
 
     vk::Pipeline operator*() const noexcept { return m_pipeline; }
@@ -33,6 +33,9 @@ class PipelineCache {
     struct RenderPassCompatibilityKey {
         PerColorAttachment<vk::Format> colors;
         vk::Format depth;
+        std::array<SubpassDescription, kMaxSubpasses> subpasses;
+        uint8_t subpassCount;
+        uint8_t subpass;
 
         bool operator==(const RenderPassCompatibilityKey& other) const = default;
     };
@@ -46,6 +49,7 @@ class PipelineCache {
         uint32_t vertexAttributesCount {};
         uint32_t vertexBindingsCount {};
         RenderPassCompatibilityKey renderPassKey {};
+        DepthMode depthMode {};
 
         bool operator==(const PipelineCacheQuery& other) const = default;
     };
@@ -69,6 +73,14 @@ class PipelineCache {
             for (auto& color : key.renderPassKey.colors) {
                 utils::hash_combine(seed, color);
             }
+            for (uint32_t i = 0; i < key.renderPassKey.subpassCount; i++) {
+                utils::hash_combine(seed, key.renderPassKey.subpasses[i].colors.to_ulong());
+                utils::hash_combine(seed, key.renderPassKey.subpasses[i].inputs.to_ulong());
+                utils::hash_combine(seed, key.renderPassKey.subpasses[i].depthInput);
+            }
+            utils::hash_combine(seed, key.renderPassKey.subpassCount);
+            utils::hash_combine(seed, key.renderPassKey.subpass);
+            utils::hash_combine(seed, key.depthMode);
             return seed;
         }
     };
@@ -78,6 +90,10 @@ class PipelineCache {
         gpu::VertexBufferLayout vertexLayout {};
         vk::RenderPass renderPass {};
         gpu::FrameBufferFormat frameBufferFormat {};
+        std::array<SubpassDescription, kMaxSubpasses> subpasses {};
+        uint8_t subpassCount = 0;
+        uint8_t subpass = 0;
+        DepthMode depthMode = DepthMode::PROGRAM;
     };
 
 public:
@@ -86,10 +102,25 @@ public:
     explicit PipelineCache(vk::Device device, ResourceContainer<Pipeline>& pipelines);
 
     void bindProgram(const resource_ptr<gpu::Program>& program);
-    void bindVertexLayout(const gpu::VertexBufferLayout& vertexLayout) { m_pipelineState.vertexLayout = vertexLayout; }
-    void bindRenderPass(vk::RenderPass renderPass, const gpu::FrameBufferFormat& format) {
+    void bindVertexLayout(const gpu::VertexBufferLayout& vertexLayout) {
+        m_pipelineState.vertexLayout = vertexLayout;
+        m_currentPipeline = {};
+    }
+    void bindRenderPass(vk::RenderPass renderPass, const gpu::FrameBufferFormat& format, const RenderPassDescription& description) {
         m_pipelineState.renderPass = renderPass;
         m_pipelineState.frameBufferFormat = format;
+        m_pipelineState.subpasses = description.subpasses;
+        m_pipelineState.subpassCount = description.subpassCount;
+        m_pipelineState.subpass = 0;
+        m_currentPipeline = {};
+    }
+    void bindDepthMode(DepthMode depthMode) {
+        m_pipelineState.depthMode = depthMode;
+        m_currentPipeline = {};
+    }
+    void bindSubpass(uint32_t subpass) {
+        m_pipelineState.subpass = subpass;
+        m_currentPipeline = {};
     }
 
     vk::PipelineLayout pipelineLayout() const { return m_pipelineState.program->pipelineLayout(); }
@@ -98,6 +129,7 @@ public:
 
     void clear() {
         m_cache.clear();
+        m_currentPipeline = {};
     }
 
 
@@ -106,6 +138,8 @@ private:
     LRUCache<PipelineCacheQuery, resource_ptr<Pipeline>, PipelineCacheQueryHash> m_cache;
     vk::Device m_device;
     PipelineState m_pipelineState;
+    // pipeline matching m_pipelineState, reset whenever the state changes
+    resource_ptr<Pipeline> m_currentPipeline;
 };
 
 }
@@ -5,11 +5,28 @@
 namespace ailo::gpu {
 
 Program::Program(vk::Device device, const ShaderDescription& description) : m_device(device) {
+    m_pipelineLayout = createPipelineLayout(description.layout);
+
+    if (!description.computeShader.empty()) {
+        m_computeShader = createShaderModule(description.computeShader);
+
+        vk::ComputePipelineCreateInfo pipelineInfo {};
+        pipelineInfo.stage.stage = vk::ShaderStageFlagBits::eCompute;
+        pipelineInfo.stage.module = m_computeShader;
+        pipelineInfo.stage.pName = "main";
+        pipelineInfo.layout = m_pipelineLayout;
+
+        auto result = m_device.createComputePipeline(nullptr, pipelineInfo);
+        if (result.result != vk::Result::eSuccess) {
+            throw std::runtime_error("failed to create compute pipeline!");
+        }
+        m_computePipeline = result.value;
+        return;
+    }
+
     m_vertexShader = createShaderModule(description.vertexShader);
     m_fragmentShader = createShaderModule(description.fragmentShader);
 
-    m_pipelineLayout = createPipelineLayout(description.layout);
-
     auto& raster = description.raster;
     m_rasterParams.cullMode = vkutils::getCullMode(raster.cullingMode);
     m_rasterParams.frontFace = raster.inverseFrontFace ? vk::FrontFace::eClockwise : vk::FrontFace::eCounterClockwise;
@@ -17,13 +34,16 @@ Program::Program(vk::Device device, const ShaderDescription& description) : m_de
     m_rasterParams.blendOp = { vkutils::getBlendOp(raster.rgbBlendOp), vkutils::getBlendOp(raster.alphaBlendOp) };
     m_rasterParams.depthCompareOp = vkutils::getCompareOperation(raster.depthCompareOp);
     m_rasterParams.depthWriteEnable = raster.depthWriteEnable;
+    m_rasterParams.colorWriteEnable = raster.colorWriteEnable;
     m_rasterParams.srcBlendFactor = { vkutils::getBlendFunction(raster.srcRgbBlendFunc), vkutils::getBlendFunction(raster.srcAlphaBlendFunc) };
     m_rasterParams.dstBlendFactor = { vkutils::getBlendFunction(raster.dstRgbBlendFunc), vkutils::getBlendFunction(raster.dstAlphaBlendFunc) };
 }
 
 Program::~Program() {
+    m_device.destroyPipeline(m_computePipeline);
     m_device.destroyShaderModule(m_vertexShader);
     m_device.destroyShaderModule(m_fragmentShader);
+    m_device.destroyShaderModule(m_computeShader);
     m_device.destroyPipelineLayout(m_pipelineLayout);
 }
 
@@ -29,6 +29,7 @@ struct RasterParams {
     BlendFactor srcBlendFactor;
     BlendFactor dstBlendFactor;
     bool depthWriteEnable;
+    bool colorWriteEnable;
     bool blendEnable;
 };
 
@@ -41,6 +42,8 @@ public:
     vk::PipelineLayout pipelineLayout() { return m_pipelineLayout; }
     vk::ShaderModule vertexShader() { return m_vertexShader; }
     vk::ShaderModule fragmentShader() { return m_fragmentShader; }
+    // Null for graphics programs, those get their pipelines from the PipelineCache
+    vk::Pipeline computePipeline() { return m_computePipeline; }
 
 private:
     vk::PipelineLayout createPipelineLayout(const std::vector<ShaderDescription::SetLayout>& layoutDescription);
@@ -50,6 +53,8 @@ private:
     vk::Device m_device;
     vk::ShaderModule m_vertexShader;
     vk::ShaderModule m_fragmentShader;
+    vk::ShaderModule m_computeShader;
+    vk::Pipeline m_computePipeline;
     vk::PipelineLayout m_pipelineLayout;
     RasterParams m_rasterParams;
 };
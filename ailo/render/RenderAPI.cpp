@@ -22,6 +22,7 @@ RenderAPI::RenderAPI(Platform::WindowHandle window)
     m_pipelineCache(*m_device, m_graphicsPipelines) {
 
     m_swapChain = std::make_unique<SwapChain>(m_device, m_textures, m_renderTargets);
+    createStatisticsQueries();
 }
 
 RenderAPI::~RenderAPI() = default;
@@ -31,6 +32,7 @@ void RenderAPI::shutdown() {
 
     m_swapChain->destroy(*m_device);
 
+    m_computeProgram = {};
     m_framebufferCache.clear();
     m_renderPassCache.clear();
     m_pipelineCache.clear();
@@ -47,6 +49,11 @@ void RenderAPI::shutdown() {
     m_commands.destroy();
 
     destroyStageBuffers();
+    for (auto& readback : m_readbacks) {
+        vmaUnmapMemory(m_Allocator, readback.buffer.vmaAllocation);
+        vmaDestroyBuffer(m_Allocator, readback.buffer.buffer, readback.buffer.vmaAllocation);
+    }
+    m_readbacks.clear();
 
     cleanupDescriptorSets();
 
@@ -54,6 +61,9 @@ void RenderAPI::shutdown() {
 
     m_device->destroyDescriptorPool(m_descriptorPool);
     m_device->destroyCommandPool(m_commandPool);
+    if (m_statisticsQueryPool) {
+        m_device->destroyQueryPool(m_statisticsQueryPool);
+    }
 }
 
 // Frame lifecycle
@@ -72,6 +82,9 @@ bool RenderAPI::beginFrame() {
         throw std::runtime_error("failed to acquire swap chain image!");
     }
 
+    prepareStatisticsQuery();
+    collectReadbacks();
+
     return true;
 }
 
@@ -90,10 +103,79 @@ void RenderAPI::endFrame() {
     // free resources acquired by command buffer
     destroyStageBuffers();
     cleanupDescriptorSets();
+    m_computeProgram = {};
 
     m_commands.next();
 }
 
+void RenderAPI::createStatisticsQueries() {
+    if (!m_device.isPipelineStatisticsSupported()) {
+        return;
+    }
+
+    vk::QueryPoolCreateInfo poolInfo {};
+    poolInfo.queryType = vk::QueryType::ePipelineStatistics;
+    poolInfo.queryCount = kStatisticsQueryCount;
+    poolInfo.pipelineStatistics = vk::QueryPipelineStatisticFlagBits::eFragmentShaderInvocations;
+    m_statisticsQueryPool = m_device->createQueryPool(poolInfo);
+}
+
+void RenderAPI::prepareStatisticsQuery() {
+    m_frameStatisticsQuery.reset();
+    if (!m_statisticsQueryPool) {
+        return;
+    }
+
+    // queries finish in submission order, stop at the first one still in flight
+    for (uint32_t i = 0; i < kStatisticsQueryCount; i++) {
+        uint32_t index = (m_nextStatisticsQuery + i) % kStatisticsQueryCount;
+        if (!m_statisticsQueryPending[index]) {
+            continue;
+        }
+
+        std::array<uint64_t, 2> result {}; // value, availability
+        auto status = m_device->getQueryPoolResults(m_statisticsQueryPool, index, 1, sizeof(result), result.data(), sizeof(result),
+            vk::QueryResultFlagBits::e64 | vk::QueryResultFlagBits::eWithAvailability);
+        if (status != vk::Result::eSuccess || result[1] == 0) {
+            break;
+        }
+        m_pipelineStatistics = PipelineStatistics { .fragmentShaderInvocations = result[0] };
+        m_statisticsQueryPending[index] = false;
+    }
+
+    // the GPU is too far behind, skip statistics this frame
+    if (m_statisticsQueryPending[m_nextStatisticsQuery]) {
+        return;
+    }
+
+    auto& commands = m_commands.get();
+    commands->resetQueryPool(m_statisticsQueryPool, m_nextStatisticsQuery, 1);
+    m_frameStatisticsQuery = m_nextStatisticsQuery;
+    m_nextStatisticsQuery = (m_nextStatisticsQuery + 1) % kStatisticsQueryCount;
+}
+
+void RenderAPI::beginPipelineStatistics() {
+    if (!m_frameStatisticsQuery || m_statisticsQueryActive) {
+        return;
+    }
+
+    auto& commands = m_commands.get();
+    commands->beginQuery(m_statisticsQueryPool, *m_frameStatisticsQuery, {});
+    m_statisticsQueryActive = true;
+}
+
+void RenderAPI::endPipelineStatistics() {
+    if (!m_statisticsQueryActive) {
+        return;
+    }
+
+    auto& commands = m_commands.get();
+    commands->endQuery(m_statisticsQueryPool, *m_frameStatisticsQuery);
+    m_statisticsQueryPending[*m_frameStatisticsQuery] = true;
+    m_statisticsQueryActive = false;
+    m_frameStatisticsQuery.reset();
+}
+
 void RenderAPI::cleanupDescriptorSets() {
     const auto [first, last] =
         std::ranges::remove_if(m_descriptorSetsToDestroy, [this](const DescriptorSet& descriptorSet) {
@@ -263,6 +345,11 @@ TextureHandle RenderAPI::createTexture(TextureType type, vk::Format format, Text
         (usage & TextureUsage::DepthStencilAttachment) != TextureUsage::None ?
             vk::ImageAspectFlagBits::eDepth : vk::ImageAspectFlagBits::eColor);
     ptr->acquire(ptr);
+
+    // storage textures are read and written by compute, they never leave the general layout
+    if ((usage & TextureUsage::Storage) != TextureUsage::None) {
+        ptr->transitionLayout(*m_commands.get(), vk::ImageLayout::eGeneral);
+    }
     return ptr.getHandle();
 }
 
@@ -365,6 +452,15 @@ DescriptorSetLayoutHandle RenderAPI::createDescriptorSetLayout(const std::vector
       if(binding.descriptorType == vk::DescriptorType::eUniformBufferDynamic) {
         descriptorSetLayout.dynamicBindings.set(binding.binding, true);
       }
+      if(binding.descriptorType == vk::DescriptorType::eStorageBuffer) {
+        descriptorSetLayout.storageBindings.set(binding.binding, true);
+      }
+      if(binding.descriptorType == vk::DescriptorType::eInputAttachment) {
+        descriptorSetLayout.inputAttachmentBindings.set(binding.binding, true);
+      }
+      if(binding.descriptorType == vk::DescriptorType::eStorageImage) {
+        descriptorSetLayout.storageImageBindings.set(binding.binding, true);
+      }
     }
 
     return handle;
@@ -399,6 +495,9 @@ void RenderAPI::createDescriptorSet(DescriptorSet& descriptorSet, DescriptorSetL
     descriptorSet.descriptorSet = result[0];
     descriptorSet.boundBindings.reset();
     descriptorSet.dynamicBindings = descriptorSetLayout.dynamicBindings;
+    descriptorSet.storageBindings = descriptorSetLayout.storageBindings;
+    descriptorSet.inputAttachmentBindings = descriptorSetLayout.inputAttachmentBindings;
+    descriptorSet.storageImageBindings = descriptorSetLayout.storageImageBindings;
     descriptorSet.layoutHandle = layoutHandle;
     descriptorSet.boundFence = nullptr;
 }
@@ -411,6 +510,40 @@ void RenderAPI::destroyDescriptorSet(const DescriptorSetHandle& handle) {
     m_descriptorSets.erase(handle);
 }
 
+void RenderAPI::detachBoundDescriptorSet(DescriptorSet& descriptorSet) {
+    if (!descriptorSet.isBound()) {
+        return;
+    }
+
+    // the set is still used by a frame in flight, write into a copy of it instead
+    m_descriptorSetsToDestroy.push_back(descriptorSet);
+
+    DescriptorSet newDescriptorSet;
+    createDescriptorSet(newDescriptorSet, descriptorSet.layoutHandle);
+    newDescriptorSet.boundBindings = descriptorSet.boundBindings;
+
+    std::vector<vk::CopyDescriptorSet> copyDescriptors;
+    for(size_t i = 0; i < descriptorSet.boundBindings.size(); i++) {
+        if (!descriptorSet.boundBindings[i]) {
+            continue;
+        }
+        vk::CopyDescriptorSet copyDescriptorSet {};
+        copyDescriptorSet.srcSet = descriptorSet.descriptorSet;
+        copyDescriptorSet.srcBinding = i;
+        copyDescriptorSet.srcArrayElement = 0;
+        copyDescriptorSet.dstSet = newDescriptorSet.descriptorSet;
+        copyDescriptorSet.dstBinding = i;
+        copyDescriptorSet.dstArrayElement = 0;
+        copyDescriptorSet.descriptorCount = 1;
+
+        copyDescriptors.push_back(copyDescriptorSet);
+    }
+
+    m_device->updateDescriptorSets(0, nullptr, copyDescriptors.size(), copyDescriptors.data());
+
+    std::swap(descriptorSet, newDescriptorSet);
+}
+
 void RenderAPI::updateDescriptorSetBuffer(const DescriptorSetHandle& descriptorSetHandle, const BufferHandle& bufferHandle, uint32_t binding, uint64_t offset, uint64_t size) {
     if (!descriptorSetHandle) {
         return;
@@ -418,19 +551,25 @@ void RenderAPI::updateDescriptorSetBuffer(const DescriptorSetHandle& descriptorS
 
     auto& descriptorSet = m_descriptorSets.get(descriptorSetHandle);
     auto& buffer = m_buffers.get(bufferHandle);
+    detachBoundDescriptorSet(descriptorSet);
 
     vk::DescriptorBufferInfo bufferInfo{};
     bufferInfo.buffer = buffer.buffer;
     bufferInfo.offset = offset;
     bufferInfo.range = size == std::numeric_limits<decltype(size)>::max() ? buffer.size : size;
 
-    bool isDynamic = descriptorSet.dynamicBindings[binding];
+    vk::DescriptorType descriptorType = vk::DescriptorType::eUniformBuffer;
+    if (descriptorSet.storageBindings[binding]) {
+        descriptorType = vk::DescriptorType::eStorageBuffer;
+    } else if (descriptorSet.dynamicBindings[binding]) {
+        descriptorType = vk::DescriptorType::eUniformBufferDynamic;
+    }
 
     vk::WriteDescriptorSet descriptorWrite{};
     descriptorWrite.dstSet = descriptorSet.descriptorSet;
     descriptorWrite.dstBinding = binding;
     descriptorWrite.dstArrayElement = 0;
-    descriptorWrite.descriptorType = isDynamic ? vk::DescriptorType::eUniformBufferDynamic : vk::DescriptorType::eUniformBuffer;
+    descriptorWrite.descriptorType = descriptorType;
     descriptorWrite.descriptorCount = 1;
     descriptorWrite.pBufferInfo = &bufferInfo;
 
@@ -438,7 +577,7 @@ void RenderAPI::updateDescriptorSetBuffer(const DescriptorSetHandle& descriptorS
     descriptorSet.boundBindings[binding] = true;
 }
 
-void RenderAPI::updateDescriptorSetTexture(const DescriptorSetHandle& descriptorSetHandle, const TextureHandle& textureHandle, uint32_t binding) {
+void RenderAPI::updateDescriptorSetTexture(const DescriptorSetHandle& descriptorSetHandle, const TextureHandle& textureHandle, uint32_t binding, uint8_t level) {
     if(!descriptorSetHandle) {
         return;
     }
@@ -446,47 +585,33 @@ void RenderAPI::updateDescriptorSetTexture(const DescriptorSetHandle& descriptor
     auto& descriptorSet = m_descriptorSets.get(descriptorSetHandle);
     auto& texture = m_textures.get(textureHandle);
 
-    // if (false) {
-    if (descriptorSet.isBound()) {
-        // re-create descriptor set
-        m_descriptorSetsToDestroy.push_back(descriptorSet);
-
-        DescriptorSet newDescriptorSet;
-        createDescriptorSet(newDescriptorSet, descriptorSet.layoutHandle);
-        newDescriptorSet.boundBindings = descriptorSet.boundBindings;
-
-        std::vector<vk::CopyDescriptorSet> copyDescriptors;
-        for(size_t i = 0; i < descriptorSet.boundBindings.size(); i++) {
-            if (!descriptorSet.boundBindings[i]) {
-                continue;
-            }
-            vk::CopyDescriptorSet copyDescriptorSet {};
-            copyDescriptorSet.srcSet = descriptorSet.descriptorSet;
-            copyDescriptorSet.srcBinding = i;
-            copyDescriptorSet.srcArrayElement = 0;
-            copyDescriptorSet.dstSet = newDescriptorSet.descriptorSet;
-            copyDescriptorSet.dstBinding = i;
-            copyDescriptorSet.dstArrayElement = 0;
-            copyDescriptorSet.descriptorCount = 1;
-
-            copyDescriptors.push_back(copyDescriptorSet);
-        }
-
-        m_device->updateDescriptorSets(0, nullptr, copyDescriptors.size(), copyDescriptors.data());
-
-        std::swap(descriptorSet, newDescriptorSet);
-    }
+    detachBoundDescriptorSet(descriptorSet);
 
     vk::DescriptorImageInfo imageInfo{};
-    imageInfo.imageLayout = vk::ImageLayout::eShaderReadOnlyOptimal;
+    imageInfo.imageLayout = (texture.getUsage() & vk::ImageUsageFlagBits::eStorage) ?
+        vk::ImageLayout::eGeneral : vk::ImageLayout::eShaderReadOnlyOptimal;
     imageInfo.imageView = texture.imageView;
     imageInfo.sampler = texture.sampler;
 
+    vk::DescriptorType descriptorType = vk::DescriptorType::eCombinedImageSampler;
+    if (descriptorSet.storageImageBindings[binding]) {
+        descriptorType = vk::DescriptorType::eStorageImage;
+        imageInfo.imageView = texture.getLevelView(level);
+        imageInfo.sampler = nullptr;
+    } else if (descriptorSet.inputAttachmentBindings[binding]) {
+        // read within the render pass, in the layout its subpass references it with
+        descriptorType = vk::DescriptorType::eInputAttachment;
+        imageInfo.sampler = nullptr;
+        if (texture.aspect & vk::ImageAspectFlagBits::eDepth) {
+            imageInfo.imageLayout = vk::ImageLayout::eDepthStencilReadOnlyOptimal;
+        }
+    }
+
     vk::WriteDescriptorSet descriptorWrite{};
     descriptorWrite.dstSet = descriptorSet.descriptorSet;
     descriptorWrite.dstBinding = binding;
     descriptorWrite.dstArrayElement = 0;
-    descriptorWrite.descriptorType = vk::DescriptorType::eCombinedImageSampler;
+    descriptorWrite.descriptorType = descriptorType;
     descriptorWrite.descriptorCount = 1;
     descriptorWrite.pImageInfo = &imageInfo;
 
@@ -557,8 +682,32 @@ void RenderAPI::beginRenderPass(const RenderPassDescription& description, vk::Cl
 
 void RenderAPI::beginRenderPass(const RenderTargetHandle& rth, const RenderPassDescription& description,
     vk::ClearColorValue clearColor) {
-    auto& rt = m_renderTargets.get(rth);
+    beginRenderPass(m_renderTargets.get(rth), description, clearColor);
+}
 
+void RenderAPI::beginRenderPass(const PerColorAttachment<TextureHandle>& colors, TextureHandle depth,
+    const RenderPassDescription& description, vk::ClearColorValue clearColor) {
+    auto swapChainTarget = m_swapChain->getCurrentRenderTarget();
+
+    // not acquired, released with the render pass state
+    auto renderTarget = resource_ptr<gpu::RenderTarget>::make(m_renderTargets);
+    renderTarget->colors[0] = swapChainTarget->colors[0];
+    renderTarget->resolve[0] = swapChainTarget->resolve[0];
+    for (uint32_t i = 1; i < colors.size(); i++) {
+        if (colors[i]) {
+            renderTarget->colors[i] = m_textures.get(colors[i]).getSharedPtr();
+        }
+    }
+    renderTarget->depth = depth ? m_textures.get(depth).getSharedPtr() : swapChainTarget->depth;
+    renderTarget->width = swapChainTarget->width;
+    renderTarget->height = swapChainTarget->height;
+    renderTarget->samples = swapChainTarget->samples;
+
+    beginRenderPass(*renderTarget, description, clearColor);
+}
+
+void RenderAPI::beginRenderPass(gpu::RenderTarget& rt, const RenderPassDescription& description,
+    vk::ClearColorValue clearColor) {
     m_currentRenderPassState = {};
     m_currentRenderPassState.renderTarget = rt.getSharedPtr();
 
@@ -593,7 +742,7 @@ void RenderAPI::beginRenderPass(const RenderTargetHandle& rth, const RenderPassD
     auto& renderPass = m_renderPassCache.getOrCreate(description, fbFormat);
     auto& frameBuffer = m_framebufferCache.getOrCreate(renderPass, fbFormat, fbImageView, rt.width, rt.height);
 
-    m_pipelineCache.bindRenderPass(renderPass, fbFormat);
+    m_pipelineCache.bindRenderPass(renderPass, fbFormat, description);
 
     vk::Extent2D extent { rt.width, rt.height };
     vk::Rect2D rect { { 0, 0 }, extent};
@@ -635,6 +784,15 @@ void RenderAPI::beginRenderPass(const RenderTargetHandle& rth, const RenderPassD
     commandBuffer->setScissor(0, 1, &scissor);
 }
 
+void RenderAPI::nextSubpass() {
+    auto& commands = m_commands.get();
+    commands->nextSubpass(vk::SubpassContents::eInline);
+
+    m_currentRenderPassState.subpass++;
+    m_currentRenderPassState.boundPipeline = {};
+    m_pipelineCache.bindSubpass(m_currentRenderPassState.subpass);
+}
+
 void RenderAPI::endRenderPass() {
     auto& commands = m_commands.get();
     commands->endRenderPass();
@@ -661,10 +819,14 @@ void RenderAPI::endRenderPass() {
 void RenderAPI::bindPipeline(const PipelineState& state) {
     auto& program = m_programs.get(state.program);
     m_pipelineCache.bindProgram(program.getSharedPtr());
+    m_pipelineCache.bindDepthMode(state.depthMode);
 
     if (state.vertexBufferLayout) {
         auto& vertexLayout = m_vertexBufferLayouts.get(state.vertexBufferLayout);
         m_pipelineCache.bindVertexLayout(vertexLayout);
+    } else {
+        // e.g. fullscreen triangles generated from gl_VertexIndex
+        m_pipelineCache.bindVertexLayout({});
     }
 }
 
@@ -682,21 +844,35 @@ void RenderAPI::bindIndexBuffer(const BufferHandle& handle, vk::IndexType indexT
     commands->bindIndexBuffer(buffer.buffer, 0, indexType);
 }
 
-void RenderAPI::drawIndexed(uint32_t indexCount, uint32_t instanceCount, uint32_t firstIndex, int32_t vertexOffset) {
-    auto& commands = m_commands.get();
+void RenderAPI::bindGraphicsPipeline(CommandBuffer& commands) {
     auto pipeline = m_pipelineCache.getOrCreate();
     assert(pipeline);
 
-    commands->bindPipeline(vk::PipelineBindPoint::eGraphics, *pipeline);
-    commands->drawIndexed(indexCount, instanceCount, firstIndex, vertexOffset, 0);
+    if (m_currentRenderPassState.boundPipeline != *pipeline) {
+        commands->bindPipeline(vk::PipelineBindPoint::eGraphics, *pipeline);
+        m_currentRenderPassState.boundPipeline = *pipeline;
+    }
 }
 
-void RenderAPI::draw(uint32_t vertexCount, uint32_t firstVertex) {
+void RenderAPI::drawIndexed(uint32_t indexCount, uint32_t instanceCount, uint32_t firstIndex, int32_t vertexOffset, uint32_t firstInstance) {
     auto& commands = m_commands.get();
-    auto pipeline = m_pipelineCache.getOrCreate();
-    assert(pipeline);
+    bindGraphicsPipeline(commands);
+    commands->drawIndexed(indexCount, instanceCount, firstIndex, vertexOffset, firstInstance);
+}
 
-    commands->bindPipeline(vk::PipelineBindPoint::eGraphics, *pipeline);
+void RenderAPI::drawIndexedIndirect(const BufferHandle& handle, uint64_t byteOffset, uint32_t drawCount) {
+    auto& buffer = m_buffers.get(handle);
+    assert(buffer.binding == BufferBinding::INDIRECT);
+    assert(drawCount <= 1 || isMultiDrawIndirectSupported());
+
+    auto& commands = m_commands.get();
+    bindGraphicsPipeline(commands);
+    commands->drawIndexedIndirect(buffer.buffer, byteOffset, drawCount, sizeof(vk::DrawIndexedIndirectCommand));
+}
+
+void RenderAPI::draw(uint32_t vertexCount, uint32_t firstVertex) {
+    auto& commands = m_commands.get();
+    bindGraphicsPipeline(commands);
     commands->draw(vertexCount, 1, firstVertex, 0);
 }
 
@@ -712,17 +888,149 @@ void RenderAPI::setScissor(int32_t x, int32_t y, uint32_t width, uint32_t height
     commands->setScissor(0, 1, &scissor);
 }
 
+void RenderAPI::clearDepth(int32_t x, int32_t y, uint32_t width, uint32_t height, float depth) {
+    vk::ClearAttachment attachment {};
+    attachment.aspectMask = vk::ImageAspectFlagBits::eDepth;
+    attachment.clearValue.depthStencil = vk::ClearDepthStencilValue { depth, 0 };
+
+    vk::ClearRect rect {};
+    rect.rect = vk::Rect2D {{x, y}, {width, height}};
+    rect.baseArrayLayer = 0;
+    rect.layerCount = 1;
+
+    auto& commands = m_commands.get();
+    commands->clearAttachments(1, &attachment, 1, &rect);
+}
+
+// Compute
+
+void RenderAPI::bindComputeProgram(const ProgramHandle& handle) {
+    auto& program = m_programs.get(handle);
+    assert(program.computePipeline());
+
+    m_computeProgram = program.getSharedPtr();
+    auto& commands = m_commands.get();
+    commands->bindPipeline(vk::PipelineBindPoint::eCompute, program.computePipeline());
+}
+
+void RenderAPI::bindComputeDescriptorSet(const DescriptorSetHandle& descriptorSetHandle, uint32_t setIndex) {
+    assert(m_computeProgram && descriptorSetHandle);
+    auto& descriptorSet = m_descriptorSets.get(descriptorSetHandle);
+
+    auto& commands = m_commands.get();
+    commands->bindDescriptorSets(vk::PipelineBindPoint::eCompute, m_computeProgram->pipelineLayout(),
+        setIndex, 1, &descriptorSet.descriptorSet, 0, nullptr);
+
+    descriptorSet.boundFence = commands.getFenceStatusShared();
+}
+
+void RenderAPI::dispatch(uint32_t groupCountX, uint32_t groupCountY, uint32_t groupCountZ) {
+    auto& commands = m_commands.get();
+    commands->dispatch(groupCountX, groupCountY, groupCountZ);
+}
+
+void RenderAPI::fillBuffer(const BufferHandle& handle, uint32_t value) {
+    auto& buffer = m_buffers.get(handle);
+    auto& commands = m_commands.get();
+    commands->fillBuffer(buffer.buffer, 0, VK_WHOLE_SIZE, value);
+}
+
+void RenderAPI::memoryBarrier() {
+    constexpr vk::PipelineStageFlags stages = vk::PipelineStageFlagBits::eTransfer
+        | vk::PipelineStageFlagBits::eComputeShader
+        | vk::PipelineStageFlagBits::eDrawIndirect
+        | vk::PipelineStageFlagBits::eVertexShader
+        | vk::PipelineStageFlagBits::eFragmentShader;
+
+    vk::MemoryBarrier barrier {};
+    barrier.srcAccessMask = vk::AccessFlagBits::eTransferWrite | vk::AccessFlagBits::eShaderWrite;
+    barrier.dstAccessMask = vk::AccessFlagBits::eTransferRead | vk::AccessFlagBits::eTransferWrite
+        | vk::AccessFlagBits::eShaderRead | vk::AccessFlagBits::eShaderWrite
+        | vk::AccessFlagBits::eIndirectCommandRead;
+
+    auto& commands = m_commands.get();
+    commands->pipelineBarrier(stages, stages, {}, 1, &barrier, 0, nullptr, 0, nullptr);
+}
+
+void RenderAPI::readBuffer(const BufferHandle& handle, uint64_t size, uint64_t byteOffset, std::function<void(const void*)> callback) {
+    auto& buffer = m_buffers.get(handle);
+
+    VkBufferCreateInfo bufferInfo {
+        .sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO,
+        .size = size,
+        .usage = VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+    };
+    VmaAllocationCreateInfo allocInfo { .usage = VMA_MEMORY_USAGE_GPU_TO_CPU };
+    VkBuffer vkBuffer;
+    VmaAllocation memory;
+    if (vmaCreateBuffer(m_Allocator, &bufferInfo, &allocInfo, &vkBuffer, &memory, nullptr) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create readback buffer!");
+    }
+
+    void* mapping = nullptr;
+    vmaMapMemory(m_Allocator, memory, &mapping);
+
+    auto& commands = m_commands.get();
+
+    vk::MemoryBarrier barrier {};
+    barrier.srcAccessMask = vk::AccessFlagBits::eTransferWrite | vk::AccessFlagBits::eShaderWrite;
+    barrier.dstAccessMask = vk::AccessFlagBits::eTransferRead;
+    commands->pipelineBarrier(vk::PipelineStageFlagBits::eTransfer | vk::PipelineStageFlagBits::eComputeShader,
+        vk::PipelineStageFlagBits::eTransfer, {}, 1, &barrier, 0, nullptr, 0, nullptr);
+
+    vk::BufferCopy region { byteOffset, 0, size };
+    commands->copyBuffer(buffer.buffer, vkBuffer, 1, &region);
+
+    barrier.srcAccessMask = vk::AccessFlagBits::eTransferWrite;
+    barrier.dstAccessMask = vk::AccessFlagBits::eHostRead;
+    commands->pipelineBarrier(vk::PipelineStageFlagBits::eTransfer, vk::PipelineStageFlagBits::eHost,
+        {}, 1, &barrier, 0, nullptr, 0, nullptr);
+
+    Readback readback {
+        .buffer = { .buffer = vkBuffer, .size = size, .vmaAllocation = memory, .mapping = mapping },
+        .callback = std::move(callback)
+    };
+    readback.buffer.setFence(commands.getFenceStatusShared());
+    m_readbacks.push_back(std::move(readback));
+}
+
+void RenderAPI::collectReadbacks() {
+    const auto [first, last] =
+        std::ranges::remove_if(m_readbacks, [this](const Readback& readback) {
+            if (readback.buffer.isAcquired()) {
+                return false;
+            }
+
+            vmaInvalidateAllocation(m_Allocator, readback.buffer.vmaAllocation, 0, readback.buffer.size);
+            readback.callback(readback.buffer.mapping);
+
+            vmaUnmapMemory(m_Allocator, readback.buffer.vmaAllocation);
+            vmaDestroyBuffer(m_Allocator, readback.buffer.buffer, readback.buffer.vmaAllocation);
+            return true;
+        });
+
+    m_readbacks.erase(first, last);
+}
+
 // Swapchain management
 
 void RenderAPI::handleWindowResize() {
     m_framebufferResized = true;
 }
 
+vk::Extent2D RenderAPI::getSwapChainExtent() {
+    auto renderTarget = m_swapChain->getCurrentRenderTarget();
+    return { renderTarget->width, renderTarget->height };
+}
+
 vk::DescriptorPool RenderAPI::createDescriptorPoolS(vk::Device device) {
     std::array poolSizes {
         vk::DescriptorPoolSize {vk::DescriptorType::eUniformBuffer, 500 },
         vk::DescriptorPoolSize {vk::DescriptorType::eUniformBufferDynamic, 500 },
-        vk::DescriptorPoolSize {vk::DescriptorType::eCombinedImageSampler, 500 }
+        vk::DescriptorPoolSize {vk::DescriptorType::eStorageBuffer, 500 },
+        vk::DescriptorPoolSize {vk::DescriptorType::eCombinedImageSampler, 500 },
+        vk::DescriptorPoolSize {vk::DescriptorType::eInputAttachment, 64 },
+        vk::DescriptorPoolSize {vk::DescriptorType::eStorageImage, 64 }
     };
     vk::DescriptorPoolCreateInfo poolInfo{};
     poolInfo.poolSizeCount = static_cast<uint32_t>(poolSizes.size());
@@ -800,9 +1108,12 @@ void RenderAPI::destroyStageBuffers() {
 }
 
 void getReadBarrierAccessAndStage(BufferBinding bufferBinding, VkAccessFlags& access, VkPipelineStageFlags& stage) {
-  if (bufferBinding == BufferBinding::UNIFORM) {
+  if (bufferBinding == BufferBinding::UNIFORM || bufferBinding == BufferBinding::STORAGE) {
     access = VK_ACCESS_SHADER_READ_BIT;
-    stage = VK_PIPELINE_STAGE_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+    stage = VK_PIPELINE_STAGE_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT;
+  } else if (bufferBinding == BufferBinding::INDIRECT) {
+    access = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_INDIRECT_COMMAND_READ_BIT;
+    stage = VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT;
   } else if (bufferBinding == BufferBinding::VERTEX) {
     access = VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT;
     stage = VK_PIPELINE_STAGE_VERTEX_INPUT_BIT;
@@ -5,6 +5,7 @@
 #include <vk_mem_alloc.h>
 #include <glm/glm.hpp>
 
+#include <functional>
 #include <vector>
 #include <optional>
 
@@ -63,7 +64,8 @@ public:
     DescriptorSetHandle createDescriptorSet(DescriptorSetLayoutHandle dslh);
     void destroyDescriptorSet(const DescriptorSetHandle& handle);
     void updateDescriptorSetBuffer(const DescriptorSetHandle& descriptorSet, const BufferHandle& buffer, uint32_t binding, uint64_t offset = 0, uint64_t size = std::numeric_limits<decltype(size)>::max());
-    void updateDescriptorSetTexture(const DescriptorSetHandle& descriptorSet, const TextureHandle& texture, uint32_t binding = 0);
+    // level is the mip level written through storage image bindings, other bindings see the whole texture
+    void updateDescriptorSetTexture(const DescriptorSetHandle& descriptorSet, const TextureHandle& texture, uint32_t binding = 0, uint8_t level = 0);
 
     RenderTargetHandle createRenderTarget(const PerColorAttachment<TextureHandle>& colors, TextureHandle depth, uint32_t width, uint32_t height, vk::SampleCountFlagBits samples);
     void destroyRenderTarget(const RenderTargetHandle&);
@@ -76,18 +78,47 @@ public:
     // Command recording (call between beginFrame and endFrame)
     void beginRenderPass(const RenderPassDescription& description, vk::ClearColorValue clearColor = vk::ClearColorValue(std::array<float, 4>{0.0f, 0.0f, 0.0f, 1.0f}));
     void beginRenderPass(const RenderTargetHandle&, const RenderPassDescription& description, vk::ClearColorValue clearColor = vk::ClearColorValue(std::array<float, 4>{0.0f, 0.0f, 0.0f, 1.0f}));
+    // Renders into the current swap chain image as color 0, the other colors and the depth come from the given textures
+    void beginRenderPass(const PerColorAttachment<TextureHandle>& colors, TextureHandle depth, const RenderPassDescription& description, vk::ClearColorValue clearColor = vk::ClearColorValue(std::array<float, 4>{0.0f, 0.0f, 0.0f, 1.0f}));
+    void nextSubpass();
     void endRenderPass();
+    // GPU statistics of the commands recorded between the calls, at most one scope per frame.
+    // Inside a render pass both calls have to be in the same subpass.
+    void beginPipelineStatistics();
+    void endPipelineStatistics();
+    // Latest statistics the GPU has finished, empty when unsupported by the device
+    const std::optional<PipelineStatistics>& getPipelineStatistics() const { return m_pipelineStatistics; }
     void bindPipeline(const PipelineState& state);
     void bindVertexBuffer(const BufferHandle& handle);
     // FIXME: remove indexType from here, save it on creation instead
     void bindIndexBuffer(const BufferHandle& handle, vk::IndexType indexType = vk::IndexType::eUint16);
     void bindDescriptorSet(const DescriptorSetHandle& descriptorSet, uint32_t setIndex, std::initializer_list<uint32_t> dynamicOffsets = { });
-    void drawIndexed(uint32_t indexCount, uint32_t instanceCount = 1, uint32_t firstIndex = 0, int32_t vertexOffset = 0);
+    void drawIndexed(uint32_t indexCount, uint32_t instanceCount = 1, uint32_t firstIndex = 0, int32_t vertexOffset = 0, uint32_t firstInstance = 0);
+    // Draws with the VkDrawIndexedIndirectCommand at byteOffset of an INDIRECT buffer and the drawCount - 1
+    // that follow it. A non zero firstInstance needs isDrawIndirectFirstInstanceSupported(), a drawCount
+    // above one isMultiDrawIndirectSupported()
+    void drawIndexedIndirect(const BufferHandle& handle, uint64_t byteOffset, uint32_t drawCount = 1);
+    bool isDrawIndirectFirstInstanceSupported() const { return m_device.isDrawIndirectFirstInstanceSupported(); }
+    bool isMultiDrawIndirectSupported() const { return m_device.isMultiDrawIndirectSupported(); }
+    bool isTextureCompressionBCSupported() const { return m_device.isTextureCompressionBCSupported(); }
     void draw(uint32_t vertexCount, uint32_t firstVertex = 0);
     void setViewport(float x, float y, float width, float height);
     void setScissor(int32_t x, int32_t y, uint32_t width, uint32_t height);
+    // Clears a region of the current depth attachment, call inside a render pass
+    void clearDepth(int32_t x, int32_t y, uint32_t width, uint32_t height, float depth = 1.0f);
+
+    // Compute, recorded outside of render passes
+    void bindComputeProgram(const ProgramHandle& handle);
+    void bindComputeDescriptorSet(const DescriptorSetHandle& descriptorSet, uint32_t setIndex);
+    void dispatch(uint32_t groupCountX, uint32_t groupCountY = 1, uint32_t groupCountZ = 1);
+    void fillBuffer(const BufferHandle& handle, uint32_t value);
+    // Makes transfer and shader writes recorded so far visible to the transfers, dispatches and draws after it
+    void memoryBarrier();
+    // Copies a buffer range to the host, the callback gets the data once the GPU has finished the frame
+    void readBuffer(const BufferHandle& handle, uint64_t size, uint64_t byteOffset, std::function<void(const void*)> callback);
 
     void handleWindowResize();
+    vk::Extent2D getSwapChainExtent();
 
 private:
     using Buffer = gpu::Buffer;
@@ -106,6 +137,15 @@ private:
     void cleanupDescriptorSets();
 
     void createDescriptorSet(DescriptorSet&, DescriptorSetLayoutHandle);
+    // Swaps a set used by a frame in flight for a copy of it, so it can be updated right away
+    void detachBoundDescriptorSet(DescriptorSet&);
+    void beginRenderPass(gpu::RenderTarget&, const RenderPassDescription& description, vk::ClearColorValue clearColor);
+    void createStatisticsQueries();
+    // Collects finished queries and resets a query for the new frame
+    void prepareStatisticsQuery();
+    // Calls back the readbacks the GPU has finished
+    void collectReadbacks();
+    void bindGraphicsPipeline(CommandBuffer& commands);
     void allocateBuffer(Buffer& buffer, vk::BufferUsageFlags usageFlags, uint32_t numBytes);
     StageBuffer allocateStageBuffer(uint32_t capacity);
     void destroyStageBuffers();
@@ -132,6 +172,12 @@ private:
     std::vector<StageBuffer> m_stageBuffers;
     std::vector<DescriptorSet> m_descriptorSetsToDestroy;
 
+    struct Readback {
+        StageBuffer buffer;
+        std::function<void(const void*)> callback;
+    };
+    std::vector<Readback> m_readbacks;
+
     // resources
     ResourceContainer<Buffer> m_buffers;
     ResourceContainer<DescriptorSetLayout> m_descriptorSetLayouts;
@@ -147,6 +193,16 @@ private:
     RenderPassCache m_renderPassCache;
     PipelineCache m_pipelineCache;
     RenderPassState m_currentRenderPassState;
+    resource_ptr<gpu::Program> m_computeProgram;
+
+    // Pipeline statistics queries, results are polled without waiting for the GPU
+    static constexpr uint32_t kStatisticsQueryCount = 16;
+    vk::QueryPool m_statisticsQueryPool;
+    std::array<bool, kStatisticsQueryCount> m_statisticsQueryPending {};
+    uint32_t m_nextStatisticsQuery = 0;
+    std::optional<uint32_t> m_frameStatisticsQuery; // reset and ready to begin this frame
+    bool m_statisticsQueryActive = false;
+    std::optional<PipelineStatistics> m_pipelineStatistics;
 };
 
 } // namespace ailo
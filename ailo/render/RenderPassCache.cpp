@@ -6,23 +6,18 @@
 namespace ailo {
 RenderPass::RenderPass(vk::Device device, const RenderPassCacheQuery& query) : m_device(device) {
     std::array<vk::AttachmentDescription, 2 * kMaxColorAttachments + 1> attachments; // color / resolve / depth
-    std::array<vk::AttachmentReference, kMaxColorAttachments> colorAttachmentRefs;
-    std::array<vk::AttachmentReference, kMaxColorAttachments> resolveAttachmentRefs;
-    vk::AttachmentReference depthAttachmentRef {};
+    PerColorAttachment<uint32_t> colorAttachmentIndices;
+    PerColorAttachment<uint32_t> resolveAttachmentIndices;
 
     uint32_t attachmentCount = 0;
-    for (size_t i = 0; i < colorAttachmentRefs.size(); i++) {
-        auto& attachmentRef = colorAttachmentRefs[i];
-
+    for (size_t i = 0; i < colorAttachmentIndices.size(); i++) {
         if (query.attachments[i].format == vk::Format::eUndefined) {
-            attachmentRef.attachment = VK_ATTACHMENT_UNUSED;
-            attachmentRef.layout = vk::ImageLayout::eColorAttachmentOptimal;
+            colorAttachmentIndices[i] = VK_ATTACHMENT_UNUSED;
             continue;
         }
 
         auto& attachmentDesc = query.attachments[i];
-        attachmentRef.attachment = attachmentCount;
-        attachmentRef.layout = vk::ImageLayout::eColorAttachmentOptimal;
+        colorAttachmentIndices[i] = attachmentCount;
 
         auto& attachment = attachments[attachmentCount++];
         attachment.format = attachmentDesc.format;
@@ -35,18 +30,14 @@ RenderPass::RenderPass(vk::Device device, const RenderPassCacheQuery& query) : m
         attachment.finalLayout = vk::ImageLayout::eColorAttachmentOptimal;
     }
 
-    for (size_t i = 0; i < resolveAttachmentRefs.size(); i++) {
-        auto& attachmentRef = resolveAttachmentRefs[i];
-
+    for (size_t i = 0; i < resolveAttachmentIndices.size(); i++) {
         if (!query.hasResolve[i]) {
-            attachmentRef.attachment = VK_ATTACHMENT_UNUSED;
-            attachmentRef.layout = vk::ImageLayout::eColorAttachmentOptimal;
+            resolveAttachmentIndices[i] = VK_ATTACHMENT_UNUSED;
             continue;
         }
 
         auto& attachmentDesc = query.attachments[i];
-        attachmentRef.attachment = attachmentCount;
-        attachmentRef.layout = vk::ImageLayout::eColorAttachmentOptimal;
+        resolveAttachmentIndices[i] = attachmentCount;
 
         auto& attachment = attachments[attachmentCount++];
         attachment.format = attachmentDesc.format;
@@ -60,8 +51,7 @@ RenderPass::RenderPass(vk::Device device, const RenderPassCacheQuery& query) : m
     }
 
     auto& depthQuery = query.attachments[kMaxColorAttachments];
-    depthAttachmentRef.attachment = depthQuery.format != vk::Format::eUndefined ? attachmentCount : VK_ATTACHMENT_UNUSED;
-    depthAttachmentRef.layout = vk::ImageLayout::eDepthStencilAttachmentOptimal;
+    uint32_t depthAttachmentIndex = depthQuery.format != vk::Format::eUndefined ? attachmentCount : VK_ATTACHMENT_UNUSED;
 
     if (depthQuery.format != vk::Format::eUndefined) {
         auto& depthAttachment = attachments[attachmentCount++];
@@ -75,14 +65,61 @@ RenderPass::RenderPass(vk::Device device, const RenderPassCacheQuery& query) : m
         depthAttachment.finalLayout = vk::ImageLayout::eDepthStencilAttachmentOptimal;
     }
 
-    vk::SubpassDescription subpass{};
-    subpass.pipelineBindPoint = vk::PipelineBindPoint::eGraphics;
-    subpass.colorAttachmentCount = colorAttachmentRefs.size();
-    subpass.pColorAttachments = colorAttachmentRefs.data();
-    subpass.pResolveAttachments = resolveAttachmentRefs.data();
-    subpass.pDepthStencilAttachment = &depthAttachmentRef;
+    // A query without subpasses is a single subpass writing every color attachment
+    std::array<SubpassDescription, kMaxSubpasses> subpassDescs = query.subpasses;
+    uint32_t subpassCount = query.subpassCount;
+    if (subpassCount == 0) {
+        subpassCount = 1;
+        subpassDescs[0] = {};
+        for (size_t i = 0; i < colorAttachmentIndices.size(); i++) {
+            subpassDescs[0].colors[i] = colorAttachmentIndices[i] != VK_ATTACHMENT_UNUSED;
+        }
+    }
+
+    struct SubpassReferences {
+        PerColorAttachment<vk::AttachmentReference> colors;
+        PerColorAttachment<vk::AttachmentReference> resolves;
+        std::array<vk::AttachmentReference, kMaxColorAttachments + 1> inputs; // colors / depth
+        vk::AttachmentReference depth;
+    };
+    std::array<SubpassReferences, kMaxSubpasses> references {};
+    std::array<vk::SubpassDescription, kMaxSubpasses> subpasses {};
+
+    for (uint32_t s = 0; s < subpassCount; s++) {
+        const auto& subpassDesc = subpassDescs[s];
+        auto& refs = references[s];
+        // multisampled colors are resolved once they are final
+        const bool lastSubpass = s + 1 == subpassCount;
+
+        for (size_t i = 0; i < kMaxColorAttachments; i++) {
+            refs.colors[i].attachment = subpassDesc.colors[i] ? colorAttachmentIndices[i] : VK_ATTACHMENT_UNUSED;
+            refs.colors[i].layout = vk::ImageLayout::eColorAttachmentOptimal;
+            refs.resolves[i].attachment = subpassDesc.colors[i] && lastSubpass ? resolveAttachmentIndices[i] : VK_ATTACHMENT_UNUSED;
+            refs.resolves[i].layout = vk::ImageLayout::eColorAttachmentOptimal;
+            refs.inputs[i].attachment = subpassDesc.inputs[i] ? colorAttachmentIndices[i] : VK_ATTACHMENT_UNUSED;
+            refs.inputs[i].layout = vk::ImageLayout::eShaderReadOnlyOptimal;
+        }
+        refs.inputs[kMaxColorAttachments].attachment = subpassDesc.depthInput ? depthAttachmentIndex : VK_ATTACHMENT_UNUSED;
+        refs.inputs[kMaxColorAttachments].layout = vk::ImageLayout::eDepthStencilReadOnlyOptimal;
+
+        // depth read as an input stays bound for testing, but can't be written
+        refs.depth.attachment = depthAttachmentIndex;
+        refs.depth.layout = subpassDesc.depthInput ?
+            vk::ImageLayout::eDepthStencilReadOnlyOptimal : vk::ImageLayout::eDepthStencilAttachmentOptimal;
+
+        auto& subpass = subpasses[s];
+        subpass.pipelineBindPoint = vk::PipelineBindPoint::eGraphics;
+        subpass.colorAttachmentCount = refs.colors.size();
+        subpass.pColorAttachments = refs.colors.data();
+        subpass.pResolveAttachments = refs.resolves.data();
+        subpass.inputAttachmentCount = refs.inputs.size();
+        subpass.pInputAttachments = refs.inputs.data();
+        subpass.pDepthStencilAttachment = &refs.depth;
+    }
+
+    std::array<vk::SubpassDependency, kMaxSubpasses> dependencies {};
 
-    vk::SubpassDependency dependency{};
+    auto& dependency = dependencies[0];
     dependency.srcSubpass = VK_SUBPASS_EXTERNAL;
     dependency.dstSubpass = 0;
     dependency.srcStageMask = vk::PipelineStageFlagBits::eColorAttachmentOutput | vk::PipelineStageFlagBits::eEarlyFragmentTests;
@@ -90,13 +127,30 @@ RenderPass::RenderPass(vk::Device device, const RenderPassCacheQuery& query) : m
     dependency.dstStageMask = vk::PipelineStageFlagBits::eFragmentShader | vk::PipelineStageFlagBits::eColorAttachmentOutput | vk::PipelineStageFlagBits::eEarlyFragmentTests;
     dependency.dstAccessMask = vk::AccessFlagBits::eShaderRead | vk::AccessFlagBits::eColorAttachmentWrite | vk::AccessFlagBits::eDepthStencilAttachmentWrite;
 
+    // Every subpass may read what the previous one wrote at the same pixel
+    constexpr vk::PipelineStageFlags kSubpassStages = vk::PipelineStageFlagBits::eFragmentShader |
+        vk::PipelineStageFlagBits::eEarlyFragmentTests | vk::PipelineStageFlagBits::eLateFragmentTests |
+        vk::PipelineStageFlagBits::eColorAttachmentOutput;
+    for (uint32_t s = 1; s < subpassCount; s++) {
+        auto& subpassDependency = dependencies[s];
+        subpassDependency.srcSubpass = s - 1;
+        subpassDependency.dstSubpass = s;
+        subpassDependency.srcStageMask = kSubpassStages;
+        subpassDependency.srcAccessMask = vk::AccessFlagBits::eColorAttachmentWrite | vk::AccessFlagBits::eDepthStencilAttachmentWrite;
+        subpassDependency.dstStageMask = kSubpassStages;
+        subpassDependency.dstAccessMask = vk::AccessFlagBits::eInputAttachmentRead |
+            vk::AccessFlagBits::eColorAttachmentRead | vk::AccessFlagBits::eColorAttachmentWrite |
+            vk::AccessFlagBits::eDepthStencilAttachmentRead | vk::AccessFlagBits::eDepthStencilAttachmentWrite;
+        subpassDependency.dependencyFlags = vk::DependencyFlagBits::eByRegion;
+    }
+
     vk::RenderPassCreateInfo renderPassInfo{};
     renderPassInfo.attachmentCount = attachmentCount;
     renderPassInfo.pAttachments = attachments.data();
-    renderPassInfo.subpassCount = 1;
-    renderPassInfo.pSubpasses = &subpass;
-    renderPassInfo.dependencyCount = 1;
-    renderPassInfo.pDependencies = &dependency;
+    renderPassInfo.subpassCount = subpassCount;
+    renderPassInfo.pSubpasses = subpasses.data();
+    renderPassInfo.dependencyCount = subpassCount;
+    renderPassInfo.pDependencies = dependencies.data();
 
     m_renderPass = m_device.createRenderPass(renderPassInfo);
 }
@@ -123,6 +177,8 @@ RenderPass& RenderPassCache::getOrCreate(const RenderPassDescription& descriptio
 
     query.hasResolve = format.hasResolve;
     query.samples = format.samples;
+    query.subpasses = description.subpasses;
+    query.subpassCount = description.subpassCount;
 
     auto [it, result] = m_cache.tryEmplace(query, m_device, query);
     return it->second;
@@ -22,6 +22,8 @@ struct RenderPassCacheQuery {
     std::array<AttachmentDescription, kMaxColorAttachments + 1> attachments {};
     std::bitset<kMaxColorAttachments> hasResolve {};
     vk::SampleCountFlagBits samples = vk::SampleCountFlagBits::e1;
+    std::array<SubpassDescription, kMaxSubpasses> subpasses {};
+    uint8_t subpassCount = 0;
 
     bool operator==(const RenderPassCacheQuery& other) const = default;
 };
@@ -52,6 +54,12 @@ class RenderPassCache {
             }
             utils::hash_combine(seed, query.hasResolve);
             utils::hash_combine(seed, query.samples);
+            for (uint32_t i = 0; i < query.subpassCount; i++) {
+                utils::hash_combine(seed, query.subpasses[i].colors.to_ulong());
+                utils::hash_combine(seed, query.subpasses[i].inputs.to_ulong());
+                utils::hash_combine(seed, query.subpasses[i].depthInput);
+            }
+            utils::hash_combine(seed, query.subpassCount);
             return seed;
         }
     };
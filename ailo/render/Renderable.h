@@ -8,6 +8,8 @@ struct Renderable {
     std::vector<asset_ptr<Material>> materials;
 
     DescriptorSetHandle descriptorSet;
+    uint32_t objectSlot = 0; // in the renderer's object buffer, assigned on creation
+    uint8_t lod = 0; // level drawn last frame, the renderer only leaves it outside a hysteresis band
 };
 
 }
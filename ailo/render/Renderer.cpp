@@ -1,12 +1,17 @@
 #include "Renderer.h"
 
+#include <algorithm>
+#include <bit>
+#include <chrono>
 #include <iostream>
+#include <unordered_map>
 #include <ecs/Scene.h>
 
 #include "Engine.h"
 #include "Mesh.h"
 #include "Shader.h"
 #include "Material.h"
+#include "ecs/Light.h"
 #include "ecs/SceneLighting.h"
 #include "ecs/Transform.h"
 #include "glm/gtc/constants.hpp"
@@ -14,6 +19,9 @@
 
 #include "Renderable.h"
 #include "Skin.h"
+#include "common/JobSystem.h"
+#include "common/RadixSort.h"
+#include "utils/Utils.h"
 
 namespace ailo {
 
@@ -30,7 +38,28 @@ static glm::vec2 getSpotLightScaleOffset(float inner, float outer) {
   return { scale, offset };
 }
 
-Renderer::Renderer(RenderAPI* renderApi, AssetManager* assetManager) : m_renderAPI(renderApi) {
+static uint64_t makeSortKey(RenderQueuePass pass, uint32_t pipelineId, uint32_t materialId = 0, uint32_t depth = 0) {
+  return (uint64_t(std::to_underlying(pass)) & 0xf) << 60
+       | (uint64_t(pipelineId) & 0xfff) << 48
+       | (uint64_t(materialId) & 0xffff) << 32
+       | (uint64_t(depth) & 0xffff) << 16;
+}
+
+// Near and far distances of a [0, 1] depth range perspective projection
+static std::pair<float, float> getPerspectiveNearFar(const glm::mat4& projection) {
+  float nearDistance = projection[3][2] / projection[2][2];
+  float farDistance = projection[3][2] / (projection[2][2] + 1.0f);
+  return { nearDistance, farDistance };
+}
+
+// Upper 16 bits of a non-negative float preserve its ordering, which gives a
+// logarithmic depth bucket: fine close to the camera, coarse far away.
+static uint32_t getDepthBucket(float viewDepth) {
+  return std::bit_cast<uint32_t>(std::max(viewDepth, 0.0f)) >> 16;
+}
+
+Renderer::Renderer(RenderAPI* renderApi, AssetManager* assetManager, JobSystem* jobSystem)
+  : m_renderAPI(renderApi), m_jobSystem(jobSystem) {
   m_persistentAssets.push_back(asset_ptr_cast<Asset>(createWhiteTexture(assetManager)));
   m_persistentAssets.push_back(asset_ptr_cast<Asset>(createBlackTexture(assetManager)));
   m_persistentAssets.push_back(asset_ptr_cast<Asset>(createDefaultMetallicRoughnessTexture(assetManager)));
@@ -41,19 +70,63 @@ Renderer::Renderer(RenderAPI* renderApi, AssetManager* assetManager) : m_renderA
 
   auto backend = m_renderAPI;
   m_viewUniformBufferHandle = backend->createBuffer(BufferBinding::UNIFORM, sizeof(m_perViewUniformBufferData));
-  m_lightsUniformBufferHandle = backend->createBuffer(BufferBinding::UNIFORM, sizeof(m_lightUniformsBufferData));
   m_viewDescriptorSetLayout = backend->createDescriptorSetLayout(DescriptorSetLayoutBindings::perView());
   m_objectDescriptorSetLayout = backend->createDescriptorSetLayout(DescriptorSetLayoutBindings::perObject());
   m_viewDescriptorSet = backend->createDescriptorSet(m_viewDescriptorSetLayout);
   m_objectDescriptorSet = backend->createDescriptorSet(m_objectDescriptorSetLayout);
 
   backend->updateDescriptorSetBuffer(m_viewDescriptorSet, m_viewUniformBufferHandle, std::to_underlying(PerViewDescriptorBindings::FRAME_UNIFORMS));
-  backend->updateDescriptorSetBuffer(m_viewDescriptorSet, m_lightsUniformBufferHandle, std::to_underlying(PerViewDescriptorBindings::LIGHTS));
 
   backend->updateDescriptorSetTexture(m_viewDescriptorSet, m_iblDfgLut->getHandle(), std::to_underlying(PerViewDescriptorBindings::IBL_DFG_LUT));
 
-  m_shadowShader = Shader::load(assetManager, m_renderAPI, Shader::getShadowShaderDescription());
-  m_skinnedShadowShader = Shader::load(assetManager, m_renderAPI, Shader::getSkinnedShadowShaderDescription());
+  m_shadowShaders = {
+      Shader::load(assetManager, m_renderAPI, Shader::getShadowShaderDescription()),
+      Shader::load(assetManager, m_renderAPI, Shader::getSkinnedShadowShaderDescription()),
+      Shader::load(assetManager, m_renderAPI, Shader::getQuantizedShadowShaderDescription()),
+      Shader::load(assetManager, m_renderAPI, Shader::getSkinnedQuantizedShadowShaderDescription()),
+  };
+
+  m_gbufferShaders = {
+      Shader::load(assetManager, m_renderAPI, Shader::getGBufferShaderDescription()),
+      Shader::load(assetManager, m_renderAPI, Shader::getSkinnedGBufferShaderDescription()),
+      Shader::load(assetManager, m_renderAPI, Shader::getQuantizedGBufferShaderDescription()),
+      Shader::load(assetManager, m_renderAPI, Shader::getSkinnedQuantizedGBufferShaderDescription()),
+  };
+  m_deferredLightingShader = Shader::load(assetManager, m_renderAPI, Shader::getDeferredLightingShaderDescription());
+  m_gbufferDescriptorSet = backend->createDescriptorSet(
+      m_deferredLightingShader->getDescriptorSetLayout(std::to_underlying(DescriptorSetBindingPoints::PER_MATERIAL)));
+
+  m_hizFromDepthShader = Shader::load(assetManager, m_renderAPI, Shader::getHiZFromDepthShaderDescription());
+  m_hizDownsampleShader = Shader::load(assetManager, m_renderAPI, Shader::getHiZDownsampleShaderDescription());
+  m_earlyOcclusionCullShader = Shader::load(assetManager, m_renderAPI, Shader::getEarlyOcclusionCullShaderDescription());
+  m_lateOcclusionCullShader = Shader::load(assetManager, m_renderAPI, Shader::getLateOcclusionCullShaderDescription());
+  m_occlusionCullDescriptorSet = backend->createDescriptorSet(m_earlyOcclusionCullShader->getDescriptorSetLayout(0));
+  m_occlusionUniformBuffer = backend->createBuffer(BufferBinding::UNIFORM, sizeof(OcclusionCullUniforms));
+  m_occlusionStatsBuffer = backend->createBuffer(BufferBinding::STORAGE, sizeof(uint32_t));
+  backend->updateDescriptorSetBuffer(m_occlusionCullDescriptorSet, m_occlusionUniformBuffer, std::to_underlying(OcclusionCullDescriptorBindings::UNIFORMS));
+  backend->updateDescriptorSetBuffer(m_occlusionCullDescriptorSet, m_occlusionStatsBuffer, std::to_underlying(OcclusionCullDescriptorBindings::STATS));
+
+  m_meshletCullShader = Shader::load(assetManager, m_renderAPI, Shader::getMeshletCullShaderDescription());
+  m_meshletCullDescriptorSet = backend->createDescriptorSet(m_meshletCullShader->getDescriptorSetLayout(0));
+  m_meshletUniformBuffer = backend->createBuffer(BufferBinding::UNIFORM, sizeof(MeshletCullUniforms));
+  m_meshletStatsBuffer = backend->createBuffer(BufferBinding::STORAGE, sizeof(uint32_t));
+  backend->updateDescriptorSetBuffer(m_meshletCullDescriptorSet, m_meshletUniformBuffer, std::to_underlying(MeshletCullDescriptorBindings::UNIFORMS));
+  backend->updateDescriptorSetBuffer(m_meshletCullDescriptorSet, m_meshletStatsBuffer, std::to_underlying(MeshletCullDescriptorBindings::STATS));
+
+  for (auto& cascade : m_shadowCascades) {
+    cascade.viewUniformBuffer = backend->createBuffer(BufferBinding::UNIFORM, sizeof(PerViewUniforms));
+    cascade.viewDescriptorSet = backend->createDescriptorSet(m_viewDescriptorSetLayout);
+    backend->updateDescriptorSetBuffer(cascade.viewDescriptorSet, cascade.viewUniformBuffer, std::to_underlying(PerViewDescriptorBindings::FRAME_UNIFORMS));
+  }
+
+  // Light buffers are bound to every view, the shadow views just don't read them
+  m_clustersBufferHandle = backend->createBuffer(BufferBinding::STORAGE, kClusterCount * sizeof(LightCluster));
+  backend->updateDescriptorSetBuffer(m_viewDescriptorSet, m_clustersBufferHandle, std::to_underlying(PerViewDescriptorBindings::CLUSTERS));
+  for (auto& cascade : m_shadowCascades) {
+    backend->updateDescriptorSetBuffer(cascade.viewDescriptorSet, m_clustersBufferHandle, std::to_underlying(PerViewDescriptorBindings::CLUSTERS));
+  }
+  reserveViewStorageBuffer(m_lightsBufferHandle, m_lightsBufferCapacity, 0, PerViewDescriptorBindings::LIGHTS);
+  reserveViewStorageBuffer(m_clusterLightIndicesBufferHandle, m_clusterLightIndicesBufferCapacity, 0, PerViewDescriptorBindings::CLUSTER_LIGHT_INDICES);
 
   // Provide a valid (all-identity) bone buffer for non-skinned entities so
   // the descriptor set binding is always satisfied.
@@ -66,10 +139,135 @@ Renderer::Renderer(RenderAPI* renderApi, AssetManager* assetManager) : m_renderA
 Renderer::~Renderer() = default;
 
 bool Renderer::beginFrame() {
+  m_stats = {};
   return m_renderAPI->beginFrame();
 }
 
-void Renderer::shadowPass(Scene& scene) {
+void Renderer::extract(Scene& scene, const Camera& camera) {
+  auto sceneLighting = scene.tryGet<SceneLighting>(scene.single());
+
+  // prepare per view buffer
+  m_camera = camera;
+  m_perViewUniformBufferData.projection = camera.projection;
+  m_perViewUniformBufferData.view = camera.view;
+  m_perViewUniformBufferData.viewInverse = inverse(camera.view);
+  m_perViewUniformBufferData.projectionInverse = inverse(camera.projection);
+  m_perViewUniformBufferData.lightColorIntensity = glm::vec4(1.0f, 1.0f, 1.0f, 1.2f);
+  m_perViewUniformBufferData.lightDirection = sceneLighting ? sceneLighting->lightDirection : glm::vec3(0.0f, 1.0f, 0.0f);
+  m_perViewUniformBufferData.ambientLightColorIntensity = glm::vec4(1.0f, 1.0f, 1.0f, 0.01f);
+  m_perViewUniformBufferData.iblSpecularMaxLod = sceneLighting ? sceneLighting->prefilteredEnvMap->getLevels() - 1 : 1;
+
+  prepareLights(scene, camera);
+
+  // World bounds are gathered once and tested against every view
+  auto gatherStart = std::chrono::steady_clock::now();
+  gatherBounds(scene);
+  m_stats.prepareMs = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - gatherStart).count();
+
+  cull(Frustum::fromViewProjection(camera.projection * camera.view));
+  std::swap(m_cameraVisibility, m_visibility);
+  m_stats.culledObjects = std::count(m_cameraVisibility.begin(), m_cameraVisibility.end(), 0);
+
+  if (camera.softwareOcclusion) {
+    softwareOcclusionCull(camera.projection * camera.view);
+  }
+
+  // fills m_visibility with the casters of the cascades to render
+  prepareShadowCascades(scene, camera);
+
+  // objects and materials are prepared once for every view that needs them
+  for (size_t i = 0; i < m_visibility.size(); i++) {
+    m_visibility[i] |= m_cameraVisibility[i];
+  }
+  auto prepareStart = std::chrono::steady_clock::now();
+  prepare(scene, &m_visibility);
+  m_stats.prepareMs += std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - prepareStart).count();
+
+  m_stats.visibleObjects = 0;
+  for (const RenderData& renderData : m_renderData) {
+    if (isVisibleFromCamera(renderData)) {
+      m_stats.visibleObjects++;
+      m_stats.visibleTriangles += renderData.indexCount / 3;
+      m_stats.reducedLodDraws += renderData.lod > 0 ? 1 : 0;
+    }
+  }
+}
+
+void Renderer::prepareLights(Scene& scene, const Camera& camera) {
+  auto& backend = *m_renderAPI;
+
+  m_lightsBufferData.clear();
+  m_lightBounds.clear();
+  for (auto [entity, light, transform] : scene.view<Light, WorldTransform>().each()) {
+    glm::vec3 position = glm::vec3(transform.matrix[3]);
+    glm::vec3 direction = glm::normalize(glm::vec3(transform.matrix * glm::vec4(0.0f, 0.0f, -1.0f, 0.0f)));
+
+    auto& lightData = m_lightsBufferData.emplace_back();
+    lightData.type = std::to_underlying(light.type);
+    lightData.lightPositionFalloff = glm::vec4(position, 1.0f / (light.radius * light.radius));
+    lightData.lightColorIntensity = glm::vec4(light.color, light.intensity);
+    lightData.direction = direction;
+
+    // a spot cone fits a smaller sphere than its range, which touches fewer clusters
+    BoundingSphere bounds { position, light.radius };
+    if (light.type == LightType::Spot) {
+      lightData.scaleOffset = getSpotLightScaleOffset(light.innerAngle, light.outerAngle);
+      if (light.outerAngle <= glm::quarter_pi<float>()) {
+        float radius = light.radius / (2.0f * std::cos(light.outerAngle));
+        bounds = { position + direction * radius, radius };
+      } else if (light.outerAngle < glm::half_pi<float>()) {
+        bounds = { position + direction * (light.radius * std::cos(light.outerAngle)), light.radius * std::sin(light.outerAngle) };
+      }
+    }
+    bounds.center = glm::vec3(camera.view * glm::vec4(bounds.center, 1.0f));
+    m_lightBounds.push_back(bounds);
+  }
+
+  auto [cameraNear, cameraFar] = getPerspectiveNearFar(camera.projection);
+  m_lightClusters.setProjection(camera.projection, cameraNear, cameraFar);
+  m_lightClusters.assign(m_lightBounds, *m_jobSystem);
+
+  const auto& clusters = m_lightClusters.getClusters();
+  const auto& lightIndices = m_lightClusters.getLightIndices();
+  reserveViewStorageBuffer(m_lightsBufferHandle, m_lightsBufferCapacity,
+    m_lightsBufferData.size() * sizeof(LightUniform), PerViewDescriptorBindings::LIGHTS);
+  reserveViewStorageBuffer(m_clusterLightIndicesBufferHandle, m_clusterLightIndicesBufferCapacity,
+    lightIndices.size() * sizeof(uint32_t), PerViewDescriptorBindings::CLUSTER_LIGHT_INDICES);
+
+  if (!m_lightsBufferData.empty()) {
+    backend.updateBuffer(m_lightsBufferHandle, m_lightsBufferData.data(), m_lightsBufferData.size() * sizeof(LightUniform));
+  }
+  if (!lightIndices.empty()) {
+    backend.updateBuffer(m_clusterLightIndicesBufferHandle, lightIndices.data(), lightIndices.size() * sizeof(uint32_t));
+  }
+  backend.updateBuffer(m_clustersBufferHandle, clusters.data(), clusters.size() * sizeof(LightCluster));
+
+  m_perViewUniformBufferData.clusterGrid = glm::uvec4(kClusterGridX, kClusterGridY, kClusterGridZ, static_cast<uint32_t>(m_lightsBufferData.size()));
+  m_perViewUniformBufferData.clusterDepthScaleBias = glm::vec4(m_lightClusters.getDepthSliceScaleBias(), 0.0f, 0.0f);
+
+  m_stats.lights = static_cast<uint32_t>(m_lightsBufferData.size());
+  m_stats.clusterLightIndices = static_cast<uint32_t>(lightIndices.size());
+}
+
+void Renderer::reserveViewStorageBuffer(BufferHandle& buffer, size_t& capacity, size_t size, PerViewDescriptorBindings binding) {
+  if (size <= capacity && buffer) {
+    return;
+  }
+
+  auto& backend = *m_renderAPI;
+  capacity = std::max({ kMinViewStorageBufferSize, size, capacity * 2 });
+  if (buffer) {
+    backend.destroyBuffer(buffer);
+  }
+  buffer = backend.createBuffer(BufferBinding::STORAGE, capacity);
+
+  backend.updateDescriptorSetBuffer(m_viewDescriptorSet, buffer, std::to_underlying(binding));
+  for (auto& cascade : m_shadowCascades) {
+    backend.updateDescriptorSetBuffer(cascade.viewDescriptorSet, buffer, std::to_underlying(binding));
+  }
+}
+
+void Renderer::prepareShadowCascades(Scene& scene, const Camera& camera) {
   RenderAPI* backend = m_renderAPI;
 
   // Create shadow map resources lazily
@@ -77,229 +275,1143 @@ void Renderer::shadowPass(Scene& scene) {
     m_shadowMapTexture = backend->createTexture(
         TextureType::TEXTURE_2D, vk::Format::eD32Sfloat,
         TextureUsage::Sampled | TextureUsage::DepthStencilAttachment,
-        kShadowMapSize, kShadowMapSize);
+        kShadowAtlasSize, kShadowAtlasSize);
 
     backend->updateDescriptorSetTexture(m_viewDescriptorSet, m_shadowMapTexture, std::to_underlying(PerViewDescriptorBindings::SHADOW_MAP));
+
+    for (auto& cascade : m_shadowCascades) {
+      cascade.cached = false;
+    }
   }
 
   if (!m_shadowMapRenderTarget) {
     m_shadowMapRenderTarget = backend->createRenderTarget(
-        {}, m_shadowMapTexture, kShadowMapSize, kShadowMapSize, vk::SampleCountFlagBits::e1);
+        {}, m_shadowMapTexture, kShadowAtlasSize, kShadowAtlasSize, vk::SampleCountFlagBits::e1);
   }
 
   auto sceneLighting = scene.tryGet<SceneLighting>(scene.single());
-
-  // Compute light view-projection matrix
   glm::vec3 lightDir = sceneLighting ? sceneLighting->lightDirection : glm::vec3(0.0f, 1.0f, 0.0f);
-  float extent = 22;
-  float nearPlane = 0.1f;
-  float farPlane = 32.0f;
-  glm::vec3 center = glm::vec3(0.0f);
-  glm::vec3 lightPos = center + lightDir * 18.0f;
-
-  // glm::vec3 up = glm::abs(glm::dot(lightDir, glm::vec3(0, 1, 0))) > 0.99f
-      // ? glm::vec3(0, 0, 1) : glm::vec3(0, 1, 0);
-  glm::vec3 up = glm::vec3(0, 1, 0);
-  glm::mat4 lightView = glm::lookAt(lightPos, center, up);
-  glm::mat4 lightProjection = glm::ortho(-extent, extent, -extent, extent, nearPlane, farPlane);
-  // Flip Y for Vulkan
-  lightProjection[1][1] *= -1.0f;
-
-  glm::mat4 lightVP = lightProjection * lightView;
-  m_perViewUniformBufferData.lightViewProjection = lightVP;
-  m_perViewUniformBufferData.projection = lightProjection;
-  m_perViewUniformBufferData.view = lightView;
-  m_perViewUniformBufferData.viewInverse = inverse(lightView);
-
-  // prepare descriptor sets and uniform buffers
-  prepare(scene);
-
-  // Begin depth-only render pass
+
+  // Light space is a rotation only, looking along the light rays
+  glm::vec3 up = glm::abs(glm::dot(lightDir, glm::vec3(0, 1, 0))) > 0.99f
+      ? glm::vec3(0, 0, 1) : glm::vec3(0, 1, 0);
+  glm::mat4 lightView = glm::lookAt(glm::vec3(0.0f), -lightDir, up);
+
+  // Shadows don't need to reach further than the farthest visible receiver. The distance
+  // is rounded up so that splits, and so cached cascades, don't change with every camera move.
+  glm::mat4 cameraViewProjection = camera.projection * camera.view;
+
+  float receiversDepth = 0.0f;
+  for (size_t i = 0; i < m_cullingBounds.size(); i++) {
+    if (m_cameraVisibility[i]) {
+      receiversDepth = std::max(receiversDepth, -m_cullingBounds.get(i).transform(camera.view).min.z);
+    }
+  }
+
+  auto [cameraNear, cameraFar] = getPerspectiveNearFar(camera.projection);
+  float shadowDistance = std::ceil(receiversDepth / kShadowDistanceStep) * kShadowDistanceStep;
+  shadowDistance = std::clamp(shadowDistance, cameraNear + kShadowDistanceStep, cameraFar);
+
+  // Practical split scheme, a blend between logarithmic and uniform splits
+  std::array<float, kShadowCascadeCount + 1> splits {};
+  splits[0] = cameraNear;
+  for (uint32_t i = 1; i <= kShadowCascadeCount; i++) {
+    float p = float(i) / kShadowCascadeCount;
+    float logSplit = cameraNear * std::pow(shadowDistance / cameraNear, p);
+    float uniformSplit = cameraNear + (shadowDistance - cameraNear) * p;
+    splits[i] = glm::mix(uniformSplit, logSplit, kShadowSplitLambda);
+  }
+
+  auto frustumCorners = Frustum::corners(cameraViewProjection);
+
+  m_visibility.assign(m_cullingBounds.size(), 0);
+
+  for (uint32_t c = 0; c < kShadowCascadeCount; c++) {
+    auto& cascade = m_shadowCascades[c];
+
+    // Fit a sphere around the split slice of the camera frustum, it doesn't
+    // depend on the camera orientation so the cascade size stays constant
+    std::array<glm::vec3, 8> slice;
+    float t0 = (splits[c] - cameraNear) / (cameraFar - cameraNear);
+    float t1 = (splits[c + 1] - cameraNear) / (cameraFar - cameraNear);
+    glm::vec3 center(0.0f);
+    for (uint32_t k = 0; k < 4; k++) {
+      slice[k] = glm::mix(frustumCorners[k], frustumCorners[k + 4], t0);
+      slice[k + 4] = glm::mix(frustumCorners[k], frustumCorners[k + 4], t1);
+      center += slice[k] + slice[k + 4];
+    }
+    center /= 8.0f;
+
+    float radius = 0.0f;
+    for (const glm::vec3& corner : slice) {
+      radius = std::max(radius, glm::length(corner - center));
+    }
+    radius = std::ceil(radius * 16.0f) / 16.0f;
+
+    // Snap the cascade to a whole number of texels so it doesn't shimmer. Outer cascades
+    // snap to a coarse grid so their matrix, and their cached depth, survive small camera moves.
+    // The cascade is enlarged by one step so the sphere stays covered: step = texels * 2 * (r + step) / size
+    float texels = c == 0 ? 1.0f : float(kShadowMapSize / 8);
+    float step = 2.0f * texels * radius / (float(kShadowMapSize) - 2.0f * texels);
+    float halfExtent = radius + step;
+
+    glm::vec3 lightCenter = glm::vec3(lightView * glm::vec4(center, 1.0f));
+    glm::vec2 snappedCenter = glm::floor(glm::vec2(lightCenter) / step) * step;
+    glm::vec2 min = snappedCenter - halfExtent;
+    glm::vec2 max = snappedCenter + halfExtent;
+    float farZ = std::floor((lightCenter.z - radius) / step) * step;
+
+    // Casters are bounded by the cascade sides and behind the receivers, the volume is
+    // unbounded toward the light so that casters outside the view still cast.
+    // In light space the light looks down -z, so the far plane is at -farZ
+    Frustum casterVolume = Frustum::fromViewProjection(glm::ortho(min.x, max.x, min.y, max.y, 0.0f, -farZ) * lightView);
+    casterVolume.planes[Frustum::Near] = glm::vec4(0.0f, 0.0f, 0.0f, 1.0f);
+    m_cullingBounds.cull(casterVolume, cascade.visibility);
+
+    // Move the near plane to the closest caster to the light and track the cascade contents
+    float nearZ = std::ceil((lightCenter.z + radius) / step) * step;
+    size_t contentKey = 0;
+    bool hasDynamicCasters = false;
+    for (size_t i = 0; i < m_cullingBounds.size(); i++) {
+      if (cascade.visibility[i]) {
+        Aabb bounds = m_cullingBounds.get(i);
+        nearZ = std::max(nearZ, bounds.transform(lightView).max.z);
+        hasDynamicCasters |= !m_cullable[i];
+
+        // every component on its own, a sum keeps the key of a caster moving along (d, -d, 0)
+        utils::hash_combine(contentKey, i);
+        for (int axis = 0; axis < 3; axis++) {
+          utils::hash_combine(contentKey, bounds.min[axis]);
+          utils::hash_combine(contentKey, bounds.max[axis]);
+        }
+      }
+    }
+
+    glm::mat4 lightProjection = glm::ortho(min.x, max.x, min.y, max.y, -nearZ, -farZ);
+    // Flip Y for Vulkan
+    lightProjection[1][1] *= -1.0f;
+    glm::mat4 viewProjection = lightProjection * lightView;
+
+    // Cascades with only static casters keep their depth while the light and the contents don't change
+    cascade.render = !cascade.cached || cascade.contentKey != contentKey || cascade.viewProjection != viewProjection;
+    cascade.cached = !hasDynamicCasters;
+    cascade.contentKey = contentKey;
+    cascade.viewProjection = viewProjection;
+
+    m_perViewUniformBufferData.shadowCascadeViewProjection[c] = viewProjection;
+    m_perViewUniformBufferData.shadowCascadeSplits[c] = splits[c + 1];
+
+    if (cascade.render) {
+      for (size_t i = 0; i < m_cullingBounds.size(); i++) {
+        m_visibility[i] |= cascade.visibility[i];
+      }
+
+      PerViewUniforms cascadeView = m_perViewUniformBufferData;
+      cascadeView.projection = lightProjection;
+      cascadeView.view = lightView;
+      cascadeView.viewInverse = inverse(lightView);
+      backend->updateBuffer(cascade.viewUniformBuffer, &cascadeView, sizeof(cascadeView));
+    }
+  }
+}
+
+void Renderer::shadowPass() {
+  RenderAPI* backend = m_renderAPI;
+
+  bool anyCascadeToRender = std::any_of(m_shadowCascades.begin(), m_shadowCascades.end(),
+    [](const ShadowCascade& cascade) { return cascade.render; });
+  if (!anyCascadeToRender) {
+    return;
+  }
+
+  // Begin depth-only render pass, cached cascades are loaded and the rest are cleared one by one
   RenderPassDescription shadowPassDesc {};
-  shadowPassDesc.depth = { vk::AttachmentLoadOp::eClear, vk::AttachmentStoreOp::eStore };
+  shadowPassDesc.depth = { vk::AttachmentLoadOp::eLoad, vk::AttachmentStoreOp::eStore };
 
   backend->beginRenderPass(m_shadowMapRenderTarget, shadowPassDesc);
 
   PipelineState pipelineState {};
+  BufferHandle indexBuffer;
+  BufferHandle vertexBuffer;
 
-  for(const RenderData& renderData : m_renderData) {
-    // Skip entities without Transform (e.g. skybox) — they shouldn't cast shadows
-    if (!renderData.hasTransform) {
+  for (uint32_t c = 0; c < kShadowCascadeCount; c++) {
+    auto& cascade = m_shadowCascades[c];
+    if (!cascade.render) {
       continue;
     }
 
-    pipelineState.program = renderData.isSkinned
-        ? m_skinnedShadowShader->program()
-        : m_shadowShader->program();
-    pipelineState.vertexBufferLayout = renderData.vertexBufferLayout;
-    backend->bindPipeline(pipelineState);
+    int32_t x = int32_t(c % kShadowAtlasGrid * kShadowMapSize);
+    int32_t y = int32_t(c / kShadowAtlasGrid * kShadowMapSize);
+    backend->setViewport(float(x), float(y), float(kShadowMapSize), float(kShadowMapSize));
+    backend->setScissor(x, y, kShadowMapSize, kShadowMapSize);
+    backend->clearDepth(x, y, kShadowMapSize, kShadowMapSize);
+    m_stats.shadowCascadesRendered++;
+
+    // Shadow casters only differ by pipeline, so sort by it to minimize state changes
+    m_renderQueue.clear();
+    for (uint32_t i = 0; i < m_renderData.size(); i++) {
+      const RenderData& renderData = m_renderData[i];
+      // Skip entities without Transform (e.g. skybox) — they shouldn't cast shadows
+      if (!renderData.hasTransform || !cascade.visibility[renderData.boundsIndex]) {
+        continue;
+      }
+      // the shadow program is picked by skinning and quantization, the latter comes with its own vertex layout
+      uint32_t pipelineId = uint32_t(renderData.vertexBufferLayout.getId() << 1) | (renderData.isSkinned ? 1 : 0);
+      m_renderQueue.push_back({ makeSortKey(RenderQueuePass::Shadow, pipelineId), i });
+    }
+    sortRenderQueue();
+
+    bool viewBound = false;
+    DescriptorSetHandle objectDescriptorSet;
+    for (const RenderQueueItem& item : m_renderQueue) {
+      const RenderData& renderData = m_renderData[item.index];
+
+      ProgramHandle program = m_shadowShaders[vertexVariant(renderData)]->program();
+      if (program != pipelineState.program || renderData.vertexBufferLayout != pipelineState.vertexBufferLayout) {
+        pipelineState.program = program;
+        pipelineState.vertexBufferLayout = renderData.vertexBufferLayout;
+        backend->bindPipeline(pipelineState);
+        viewBound = false;
+        m_stats.pipelineBinds++;
+      }
 
-    backend->bindDescriptorSet(m_viewDescriptorSet, std::to_underlying(DescriptorSetBindingPoints::PER_VIEW));
-    backend->bindDescriptorSet(
-      renderData.objectDescriptorSet,
-      std::to_underlying(DescriptorSetBindingPoints::PER_RENDERABLE),
-      { renderData.objectBufferOffset, 0 });
+      if (!viewBound) {
+        backend->bindDescriptorSet(cascade.viewDescriptorSet, std::to_underlying(DescriptorSetBindingPoints::PER_VIEW));
+        objectDescriptorSet = {};
+        viewBound = true;
+      }
+      // objects are indexed with the first instance, the set only changes for skinned renderables
+      if (renderData.objectDescriptorSet != objectDescriptorSet) {
+        objectDescriptorSet = renderData.objectDescriptorSet;
+        backend->bindDescriptorSet(objectDescriptorSet, std::to_underlying(DescriptorSetBindingPoints::PER_RENDERABLE));
+      }
 
-    backend->bindIndexBuffer(renderData.indexBuffer);
-    backend->bindVertexBuffer(renderData.vertexBuffer);
+      if (renderData.indexBuffer != indexBuffer) {
+        indexBuffer = renderData.indexBuffer;
+        backend->bindIndexBuffer(indexBuffer);
+        m_stats.bufferBinds++;
+      }
+      if (renderData.vertexBuffer != vertexBuffer) {
+        vertexBuffer = renderData.vertexBuffer;
+        backend->bindVertexBuffer(vertexBuffer);
+        m_stats.bufferBinds++;
+      }
 
-    backend->drawIndexed(renderData.indexCount, 1, renderData.indexOffset);
+      backend->drawIndexed(renderData.indexCount, 1, renderData.indexOffset, renderData.vertexOffset, renderData.objectIndex);
+      m_stats.drawCalls++;
+      m_stats.shadowCasters++;
+    }
   }
 
   backend->endRenderPass();
 }
 
-void Renderer::colorPass(Scene& scene, const Camera& camera) {
+void Renderer::colorPass() {
+  buildColorRenderQueue();
 
-  auto sceneLighting = scene.tryGet<SceneLighting>(scene.single());
+  if (m_shadingMode == ShadingMode::Deferred) {
+    deferredPass();
+  } else {
+    forwardPass();
+  }
 
-  // prepare per view buffer
-  m_perViewUniformBufferData.projection = camera.projection;
-  m_perViewUniformBufferData.view = camera.view;
-  m_perViewUniformBufferData.viewInverse = inverse(camera.view);
-  m_perViewUniformBufferData.lightColorIntensity = glm::vec4(1.0f, 1.0f, 1.0f, 1.2f);
-  m_perViewUniformBufferData.lightDirection = sceneLighting ? sceneLighting->lightDirection : glm::vec3(0.0f, 1.0f, 0.0f);
-  m_perViewUniformBufferData.ambientLightColorIntensity = glm::vec4(1.0f, 1.0f, 1.0f, 0.01f);
-  m_perViewUniformBufferData.iblSpecularMaxLod = sceneLighting ? sceneLighting->prefilteredEnvMap->getLevels() - 1 : 1;
+  updateOverdrawStats();
+}
+
+void Renderer::buildColorRenderQueue() {
+  // Sort by state first, then front-to-back within the same state to reduce overdraw
+  m_renderQueue.clear();
+  for (uint32_t i = 0; i < m_renderData.size(); i++) {
+    const RenderData& renderData = m_renderData[i];
+    if (!isVisibleFromCamera(renderData)) {
+      continue;
+    }
+    auto pass = renderData.hasTransform ? RenderQueuePass::Opaque : RenderQueuePass::Background;
+    float viewDepth = -(m_camera.view * glm::vec4(renderData.worldPosition, 1.0f)).z;
+    m_renderQueue.push_back({
+      makeSortKey(pass, renderData.pipelineId, renderData.materialId, getDepthBucket(viewDepth)), i });
+  }
+  sortRenderQueue();
+}
+
+std::vector<RenderQueueItem>::const_iterator Renderer::getBackgroundBegin() const {
+  return std::partition_point(m_renderQueue.begin(), m_renderQueue.end(),
+    [](const RenderQueueItem& item) { return item.sortKey < makeSortKey(RenderQueuePass::Background, 0); });
+}
+
+void Renderer::drawDepthPrepass(std::span<const RenderQueueItem> items, OcclusionDraws draws) {
+  RenderAPI* backend = m_renderAPI;
+
+  PipelineState pipelineState {};
+  DescriptorSetHandle objectDescriptorSet;
+  BufferHandle indexBuffer;
+  BufferHandle vertexBuffer;
+
+  for (uint32_t i = 0; i < items.size(); i++) {
+    const RenderData& renderData = m_renderData[items[i].index];
+
+    ProgramHandle program = m_shadowShaders[vertexVariant(renderData)]->program();
+    if (program != pipelineState.program || renderData.vertexBufferLayout != pipelineState.vertexBufferLayout) {
+      bool programChanged = program != pipelineState.program;
+      pipelineState.program = program;
+      pipelineState.vertexBufferLayout = renderData.vertexBufferLayout;
+      backend->bindPipeline(pipelineState);
+      m_stats.pipelineBinds++;
+
+      if (programChanged) {
+        backend->bindDescriptorSet(m_viewDescriptorSet, std::to_underlying(DescriptorSetBindingPoints::PER_VIEW));
+        objectDescriptorSet = {};
+      }
+    }
+
+    if (renderData.objectDescriptorSet != objectDescriptorSet) {
+      objectDescriptorSet = renderData.objectDescriptorSet;
+      backend->bindDescriptorSet(objectDescriptorSet, std::to_underlying(DescriptorSetBindingPoints::PER_RENDERABLE));
+    }
+
+    if (renderData.indexBuffer != indexBuffer) {
+      indexBuffer = renderData.indexBuffer;
+      backend->bindIndexBuffer(indexBuffer);
+      m_stats.bufferBinds++;
+    }
+    if (renderData.vertexBuffer != vertexBuffer) {
+      vertexBuffer = renderData.vertexBuffer;
+      backend->bindVertexBuffer(vertexBuffer);
+      m_stats.bufferBinds++;
+    }
+
+    drawItem(renderData, i, draws);
+    m_stats.depthPrepassDraws++;
+  }
+}
 
-  float radius = 3.0f;
-  auto& light0 = m_lightUniformsBufferData[0];
-  light0.type = 0; // 0 - point, 1 - spot
-  light0.lightPositionFalloff = glm::vec4(3.0, 1.5, 0.5f, 1.0f / (radius * radius));
-  light0.lightColorIntensity = glm::vec4(1.0f, 1.0f, 0.0f, 1.0f);
+void Renderer::drawColorItems(std::span<const RenderQueueItem> items, bool gbuffer, DepthMode depthMode, OcclusionDraws draws) {
+  RenderAPI* backend = m_renderAPI;
 
-  auto& light1 = m_lightUniformsBufferData[1];
-  light1 = light0;
-  light1.type = 1;
-  light1.lightPositionFalloff = glm::vec4(.0, 1.5, 2.5f, 1.0f / (radius * radius));
-  light1.lightColorIntensity = glm::vec4(1.0f, 0.0f, 0.0f, 1.0f);
-  light1.direction = glm::vec3(0.0f, 1.0f, 0.5f);
-  light1.scaleOffset = getSpotLightScaleOffset(glm::radians(42.0), glm::radians(66.0));
+  PipelineState pipelineState {};
+  const Material* material = nullptr;
+  DescriptorSetHandle objectDescriptorSet;
+  BufferHandle indexBuffer;
+  BufferHandle vertexBuffer;
+
+  for (uint32_t i = 0; i < items.size(); i++) {
+    const RenderData& renderData = m_renderData[items[i].index];
+
+    // the G-buffer programs share the material layout, so any material can be bound to them
+    ProgramHandle program = renderData.program;
+    if (gbuffer) {
+      program = m_gbufferShaders[vertexVariant(renderData)]->program();
+    }
+
+    if (program != pipelineState.program || renderData.vertexBufferLayout != pipelineState.vertexBufferLayout) {
+      bool programChanged = program != pipelineState.program;
+      pipelineState.program = program;
+      pipelineState.vertexBufferLayout = renderData.vertexBufferLayout;
+      pipelineState.depthMode = depthMode;
+      backend->bindPipeline(pipelineState);
+      m_stats.pipelineBinds++;
+
+      // a different program may come with an incompatible pipeline layout, rebind everything
+      if (programChanged) {
+        backend->bindDescriptorSet(m_viewDescriptorSet, std::to_underlying(DescriptorSetBindingPoints::PER_VIEW));
+        objectDescriptorSet = {};
+        material = nullptr;
+      }
+    }
+
+    if (renderData.objectDescriptorSet != objectDescriptorSet) {
+      objectDescriptorSet = renderData.objectDescriptorSet;
+      backend->bindDescriptorSet(objectDescriptorSet, std::to_underlying(DescriptorSetBindingPoints::PER_RENDERABLE));
+    }
+
+    if (renderData.material != material) {
+      material = renderData.material;
+      material->bindDescriptorSet(*backend);
+      m_stats.materialBinds++;
+    }
+
+    if (renderData.indexBuffer != indexBuffer) {
+      indexBuffer = renderData.indexBuffer;
+      backend->bindIndexBuffer(indexBuffer);
+      m_stats.bufferBinds++;
+    }
+    if (renderData.vertexBuffer != vertexBuffer) {
+      vertexBuffer = renderData.vertexBuffer;
+      backend->bindVertexBuffer(vertexBuffer);
+      m_stats.bufferBinds++;
+    }
 
-  // prepare descriptor sets and uniform buffers
-  prepare(scene);
+    drawItem(renderData, i, draws);
+  }
+}
 
+void Renderer::forwardPass() {
   RenderAPI* backend = m_renderAPI;
 
+  auto backgroundBegin = getBackgroundBegin();
+  std::span<const RenderQueueItem> opaqueItems { m_renderQueue.cbegin(), backgroundBegin };
+  std::span<const RenderQueueItem> backgroundItems { backgroundBegin, m_renderQueue.cend() };
+
+  if (m_camera.occlusionCulling && !opaqueItems.empty() && backend->isDrawIndirectFirstInstanceSupported()) {
+    occlusionCulledForwardPass(opaqueItems, backgroundItems);
+    return;
+  }
+
+  // meshlet commands carry the object index in firstInstance as well
+  OcclusionDraws draws = OcclusionDraws::None;
+  if (m_camera.meshletCulling && !opaqueItems.empty() && backend->isDrawIndirectFirstInstanceSupported()) {
+    cullMeshlets(opaqueItems);
+    draws = OcclusionDraws::Meshlets;
+  }
+
   RenderPassDescription renderPass {};
   renderPass.color[0] = { vk::AttachmentLoadOp::eClear, vk::AttachmentStoreOp::eStore };
   renderPass.depth = { vk::AttachmentLoadOp::eClear, vk::AttachmentStoreOp::eDontCare };
 
   backend->beginRenderPass(renderPass, vk::ClearColorValue(0.1f, 0.1f, 0.3f, 1.0f));
 
-  PipelineState pipelineState {};
+  if (m_camera.depthPrepass) {
+    drawDepthPrepass(opaqueItems, draws);
+  }
 
-  for(const RenderData& renderData : m_renderData) {
-      pipelineState.program = renderData.program;
-      pipelineState.vertexBufferLayout = renderData.vertexBufferLayout;
+  backend->beginPipelineStatistics();
+  drawColorItems(opaqueItems, false, m_camera.depthPrepass ? DepthMode::EQUAL_READ_ONLY : DepthMode::PROGRAM, draws);
+  backend->endPipelineStatistics();
+  drawColorItems(backgroundItems, false);
 
-      backend->bindPipeline(pipelineState);
+  backend->endRenderPass();
+}
+
+void Renderer::occlusionCulledForwardPass(std::span<const RenderQueueItem> opaqueItems, std::span<const RenderQueueItem> backgroundItems) {
+  RenderAPI* backend = m_renderAPI;
+
+  prepareHiZ();
+  prepareOcclusionCullItems(opaqueItems);
+
+  const bool depthPrepass = m_camera.depthPrepass;
+  const auto groupCount = static_cast<uint32_t>((opaqueItems.size() + kOcclusionCullGroupSize - 1) / kOcclusionCullGroupSize);
+  const vk::ClearColorValue clearColor(0.1f, 0.1f, 0.3f, 1.0f);
+
+  // Early phase: what was visible last frame is drawn first and becomes the occluders of this frame
+  backend->bindComputeProgram(m_earlyOcclusionCullShader->program());
+  backend->bindComputeDescriptorSet(m_occlusionCullDescriptorSet, 0);
+  backend->dispatch(groupCount);
+  backend->memoryBarrier();
+
+  RenderPassDescription renderPass {};
+  renderPass.color[0] = { vk::AttachmentLoadOp::eClear, vk::AttachmentStoreOp::eStore };
+  renderPass.depth = { vk::AttachmentLoadOp::eClear, vk::AttachmentStoreOp::eStore };
 
-      backend->bindDescriptorSet(m_viewDescriptorSet, std::to_underlying(DescriptorSetBindingPoints::PER_VIEW));
-      backend->bindDescriptorSet(
-        renderData.objectDescriptorSet,
-        std::to_underlying(DescriptorSetBindingPoints::PER_RENDERABLE),
-        { renderData.objectBufferOffset, 0 });
+  // a statistics scope can't span render passes from inside, without a pre-pass it
+  // wraps both phases and counts the background too
+  if (!depthPrepass) {
+    backend->beginPipelineStatistics();
+  }
+
+  backend->beginRenderPass({}, m_occlusionDepth, renderPass, clearColor);
+  if (depthPrepass) {
+    drawDepthPrepass(opaqueItems, OcclusionDraws::Early);
+  } else {
+    drawColorItems(opaqueItems, false, DepthMode::PROGRAM, OcclusionDraws::Early);
+  }
+  backend->endRenderPass();
+
+  // Late phase: everything is tested against the pyramid of the early depth, so objects
+  // that come into view are drawn this frame instead of popping in a frame later
+  buildHiZ();
+  backend->fillBuffer(m_objectVisibilityBuffer, 0);
+  backend->fillBuffer(m_occlusionStatsBuffer, 0);
+  backend->memoryBarrier();
+
+  backend->bindComputeProgram(m_lateOcclusionCullShader->program());
+  backend->bindComputeDescriptorSet(m_occlusionCullDescriptorSet, 0);
+  backend->dispatch(groupCount);
+  backend->memoryBarrier();
+
+  backend->readBuffer(m_occlusionStatsBuffer, sizeof(uint32_t), 0, [this](const void* data) {
+    m_occlusionVisibleDraws = *static_cast<const uint32_t*>(data);
+  });
+
+  renderPass.color[0].load = vk::AttachmentLoadOp::eLoad;
+  renderPass.depth = { vk::AttachmentLoadOp::eLoad, vk::AttachmentStoreOp::eDontCare };
+  backend->beginRenderPass({}, m_occlusionDepth, renderPass, clearColor);
+  if (depthPrepass) {
+    drawDepthPrepass(opaqueItems, OcclusionDraws::Late);
+    backend->beginPipelineStatistics();
+    drawColorItems(opaqueItems, false, DepthMode::EQUAL_READ_ONLY, OcclusionDraws::Visible);
+    backend->endPipelineStatistics();
+  } else {
+    drawColorItems(opaqueItems, false, DepthMode::PROGRAM, OcclusionDraws::Late);
+  }
+  drawColorItems(backgroundItems, false);
+  backend->endRenderPass();
+
+  if (!depthPrepass) {
+    backend->endPipelineStatistics();
+  }
+
+  m_stats.occlusionTestedDraws = static_cast<uint32_t>(opaqueItems.size());
+  m_stats.occlusionVisibleDraws = m_occlusionVisibleDraws;
+}
 
-      renderData.material->bindDescriptorSet(*backend);
+void Renderer::prepareHiZ() {
+  RenderAPI* backend = m_renderAPI;
+
+  vk::Extent2D extent = backend->getSwapChainExtent();
+  if (m_hizTexture && extent == m_hizExtent) {
+    return;
+  }
 
-      backend->bindIndexBuffer(renderData.indexBuffer);
-      backend->bindVertexBuffer(renderData.vertexBuffer);
-      backend->drawIndexed(renderData.indexCount, 1, renderData.indexOffset);
+  if (m_hizTexture) {
+    backend->waitIdle();
+    backend->destroyTexture(m_occlusionDepth);
+    backend->destroyTexture(m_hizTexture);
+    for (auto& descriptorSet : m_hizDescriptorSets) {
+      backend->destroyDescriptorSet(descriptorSet);
+    }
+    m_hizDescriptorSets.clear();
   }
 
+  m_hizExtent = extent;
+  m_occlusionDepth = backend->createTexture(
+      TextureType::TEXTURE_2D, vk::Format::eD32Sfloat,
+      TextureUsage::DepthStencilAttachment | TextureUsage::Sampled, extent.width, extent.height);
+
+  // every level halves the previous one down to 1x1
+  uint32_t width = std::max(extent.width / 2, 1u);
+  uint32_t height = std::max(extent.height / 2, 1u);
+  auto levels = static_cast<uint8_t>(std::bit_width(std::max(width, height)));
+  m_hizTexture = backend->createTexture(
+      TextureType::TEXTURE_2D, vk::Format::eR32Sfloat,
+      TextureUsage::Storage | TextureUsage::Sampled, width, height, levels);
+
+  constexpr auto source = std::to_underlying(HiZBuildDescriptorBindings::SOURCE);
+  constexpr auto destination = std::to_underlying(HiZBuildDescriptorBindings::DESTINATION);
+  for (uint8_t level = 0; level < levels; level++) {
+    auto& shader = level == 0 ? m_hizFromDepthShader : m_hizDownsampleShader;
+    auto descriptorSet = backend->createDescriptorSet(shader->getDescriptorSetLayout(0));
+    if (level == 0) {
+      backend->updateDescriptorSetTexture(descriptorSet, m_occlusionDepth, source);
+    } else {
+      backend->updateDescriptorSetTexture(descriptorSet, m_hizTexture, source, level - 1);
+    }
+    backend->updateDescriptorSetTexture(descriptorSet, m_hizTexture, destination, level);
+    m_hizDescriptorSets.push_back(descriptorSet);
+  }
+
+  backend->updateDescriptorSetTexture(m_occlusionCullDescriptorSet, m_hizTexture, std::to_underlying(OcclusionCullDescriptorBindings::HIZ));
+}
+
+void Renderer::prepareOcclusionCullItems(std::span<const RenderQueueItem> opaqueItems) {
+  RenderAPI* backend = m_renderAPI;
+
+  const auto itemCount = static_cast<uint32_t>(opaqueItems.size());
+  if (itemCount > m_occlusionItemsCapacity) {
+    m_occlusionItemsCapacity = std::max({ kMinOcclusionItems, itemCount, m_occlusionItemsCapacity * 2 });
+    backend->destroyBuffer(m_occlusionItemsBuffer);
+    backend->destroyBuffer(m_occlusionCommandsBuffer);
+    m_occlusionItemsBuffer = backend->createBuffer(BufferBinding::STORAGE, m_occlusionItemsCapacity * sizeof(OcclusionCullItem));
+    m_occlusionCommandsBuffer = backend->createBuffer(BufferBinding::INDIRECT,
+        kOcclusionCommandSections * m_occlusionItemsCapacity * sizeof(vk::DrawIndexedIndirectCommand));
+    backend->updateDescriptorSetBuffer(m_occlusionCullDescriptorSet, m_occlusionItemsBuffer, std::to_underlying(OcclusionCullDescriptorBindings::ITEMS));
+    backend->updateDescriptorSetBuffer(m_occlusionCullDescriptorSet, m_occlusionCommandsBuffer, std::to_underlying(OcclusionCullDescriptorBindings::COMMANDS));
+  }
+
+  // a new visibility buffer starts with nothing visible, so everything is drawn by the late phase once
+  if (m_perObjectBufferData.size() > m_objectVisibilityCapacity) {
+    m_objectVisibilityCapacity = m_perObjectBufferData.size();
+    backend->destroyBuffer(m_objectVisibilityBuffer);
+    m_objectVisibilityBuffer = backend->createBuffer(BufferBinding::STORAGE, m_objectVisibilityCapacity * sizeof(uint32_t));
+    backend->fillBuffer(m_objectVisibilityBuffer, 0);
+    backend->updateDescriptorSetBuffer(m_occlusionCullDescriptorSet, m_objectVisibilityBuffer, std::to_underlying(OcclusionCullDescriptorBindings::OBJECT_VISIBILITY));
+  }
+
+  m_occlusionItems.resize(itemCount);
+  for (uint32_t i = 0; i < itemCount; i++) {
+    const RenderData& renderData = m_renderData[opaqueItems[i].index];
+    Aabb bounds = renderData.boundsIndex != kInvalidBoundsIndex ? m_cullingBounds.get(renderData.boundsIndex) : Aabb {};
+    m_occlusionItems[i] = {
+      .aabbMin = bounds.min,
+      .objectIndex = renderData.objectIndex,
+      .aabbMax = bounds.max,
+      .indexCount = renderData.indexCount,
+      .firstIndex = renderData.indexOffset,
+      .vertexOffset = renderData.vertexOffset
+    };
+  }
+  backend->updateBuffer(m_occlusionItemsBuffer, m_occlusionItems.data(), itemCount * sizeof(OcclusionCullItem));
+
+  OcclusionCullUniforms uniforms {
+    .viewProjection = m_camera.projection * m_camera.view,
+    .depthSize = { m_hizExtent.width, m_hizExtent.height },
+    .itemCount = itemCount,
+    .sectionSize = m_occlusionItemsCapacity
+  };
+  backend->updateBuffer(m_occlusionUniformBuffer, &uniforms, sizeof(uniforms));
+  backend->memoryBarrier();
+}
+
+void Renderer::buildHiZ() {
+  RenderAPI* backend = m_renderAPI;
+
+  for (uint32_t level = 0; level < m_hizDescriptorSets.size(); level++) {
+    if (level <= 1) {
+      auto& shader = level == 0 ? m_hizFromDepthShader : m_hizDownsampleShader;
+      backend->bindComputeProgram(shader->program());
+    }
+    backend->bindComputeDescriptorSet(m_hizDescriptorSets[level], 0);
+
+    uint32_t width = std::max(m_hizExtent.width >> (level + 1), 1u);
+    uint32_t height = std::max(m_hizExtent.height >> (level + 1), 1u);
+    backend->dispatch((width + kHiZGroupSize - 1) / kHiZGroupSize, (height + kHiZGroupSize - 1) / kHiZGroupSize);
+    backend->memoryBarrier();
+  }
+}
+
+uint64_t Renderer::getOcclusionCommandOffset(OcclusionDraws draws, uint32_t itemIndex) const {
+  uint64_t section = std::to_underlying(draws) - 1;
+  return (section * m_occlusionItemsCapacity + itemIndex) * sizeof(vk::DrawIndexedIndirectCommand);
+}
+
+void Renderer::cullMeshlets(std::span<const RenderQueueItem> opaqueItems) {
+  RenderAPI* backend = m_renderAPI;
+
+  m_meshletItems.clear();
+  m_meshletDraws.clear();
+  m_meshletDrawRanges.assign(opaqueItems.size(), {});
+  for (uint32_t i = 0; i < opaqueItems.size(); i++) {
+    const RenderData& renderData = m_renderData[opaqueItems[i].index];
+    if (!renderData.meshlets || !renderData.model) {
+      continue;
+    }
+
+    const glm::mat4& model = *renderData.model;
+    const glm::vec3 scale(glm::length(glm::vec3(model[0])), glm::length(glm::vec3(model[1])), glm::length(glm::vec3(model[2])));
+    const float maxScale = std::max({ scale.x, scale.y, scale.z });
+    const float minScale = std::min({ scale.x, scale.y, scale.z });
+    const auto drawIndex = static_cast<uint32_t>(m_meshletDraws.size());
+    const auto firstCommand = static_cast<uint32_t>(m_meshletItems.size());
+
+    m_meshletDraws.push_back({
+      .model = model,
+      .firstCommand = firstCommand,
+      .objectIndex = renderData.objectIndex,
+      .maxScale = maxScale,
+      .coneCulling = minScale > 0.99f * maxScale ? 1u : 0u
+    });
+    // meshlet offsets are relative to the mesh indices, the first meshlet starts the level
+    const uint32_t firstIndex = renderData.indexOffset - renderData.meshlets->front().indexOffset;
+    for (const Meshlet& meshlet : *renderData.meshlets) {
+      m_meshletItems.push_back({
+        .sphere = glm::vec4(meshlet.sphere.center, meshlet.sphere.radius),
+        .coneAxis = meshlet.coneAxis,
+        .coneCutoff = meshlet.coneCutoff,
+        .firstIndex = firstIndex + meshlet.indexOffset,
+        .indexCount = meshlet.indexCount,
+        .drawIndex = drawIndex,
+        .vertexOffset = renderData.vertexOffset
+      });
+    }
+    m_meshletDrawRanges[i] = { firstCommand, static_cast<uint32_t>(renderData.meshlets->size()) };
+  }
+
+  const auto itemCount = static_cast<uint32_t>(m_meshletItems.size());
+  const auto drawCount = static_cast<uint32_t>(m_meshletDraws.size());
+  m_stats.meshletsTested = itemCount;
+  m_stats.meshletsVisible = m_meshletVisibleCount;
+  if (itemCount == 0) {
+    return;
+  }
+
+  if (itemCount > m_meshletItemsCapacity) {
+    m_meshletItemsCapacity = std::max({ kMinMeshletItems, itemCount, m_meshletItemsCapacity * 2 });
+    backend->destroyBuffer(m_meshletItemsBuffer);
+    backend->destroyBuffer(m_meshletCommandsBuffer);
+    m_meshletItemsBuffer = backend->createBuffer(BufferBinding::STORAGE, m_meshletItemsCapacity * sizeof(MeshletCullItem));
+    m_meshletCommandsBuffer = backend->createBuffer(BufferBinding::INDIRECT, m_meshletItemsCapacity * sizeof(vk::DrawIndexedIndirectCommand));
+    backend->updateDescriptorSetBuffer(m_meshletCullDescriptorSet, m_meshletItemsBuffer, std::to_underlying(MeshletCullDescriptorBindings::ITEMS));
+    backend->updateDescriptorSetBuffer(m_meshletCullDescriptorSet, m_meshletCommandsBuffer, std::to_underlying(MeshletCullDescriptorBindings::COMMANDS));
+  }
+  if (drawCount > m_meshletDrawsCapacity) {
+    m_meshletDrawsCapacity = std::max({ kMinMeshletDraws, drawCount, m_meshletDrawsCapacity * 2 });
+    backend->destroyBuffer(m_meshletDrawsBuffer);
+    backend->destroyBuffer(m_meshletDrawCountsBuffer);
+    m_meshletDrawsBuffer = backend->createBuffer(BufferBinding::STORAGE, m_meshletDrawsCapacity * sizeof(MeshletCullDraw));
+    m_meshletDrawCountsBuffer = backend->createBuffer(BufferBinding::STORAGE, m_meshletDrawsCapacity * sizeof(uint32_t));
+    backend->updateDescriptorSetBuffer(m_meshletCullDescriptorSet, m_meshletDrawsBuffer, std::to_underlying(MeshletCullDescriptorBindings::DRAWS));
+    backend->updateDescriptorSetBuffer(m_meshletCullDescriptorSet, m_meshletDrawCountsBuffer, std::to_underlying(MeshletCullDescriptorBindings::DRAW_COUNTS));
+  }
+
+  backend->updateBuffer(m_meshletItemsBuffer, m_meshletItems.data(), itemCount * sizeof(MeshletCullItem));
+  backend->updateBuffer(m_meshletDrawsBuffer, m_meshletDraws.data(), drawCount * sizeof(MeshletCullDraw));
+
+  MeshletCullUniforms uniforms {};
+  const Frustum frustum = Frustum::fromViewProjection(m_camera.projection * m_camera.view);
+  std::copy(frustum.planes.begin(), frustum.planes.end(), uniforms.frustumPlanes);
+  uniforms.cameraPosition = glm::vec3(glm::inverse(m_camera.view)[3]);
+  uniforms.itemCount = itemCount;
+  backend->updateBuffer(m_meshletUniformBuffer, &uniforms, sizeof(uniforms));
+
+  // the commands that aren't written stay zero and draw nothing
+  backend->fillBuffer(m_meshletCommandsBuffer, 0);
+  backend->fillBuffer(m_meshletDrawCountsBuffer, 0);
+  backend->fillBuffer(m_meshletStatsBuffer, 0);
+  backend->memoryBarrier();
+
+  backend->bindComputeProgram(m_meshletCullShader->program());
+  backend->bindComputeDescriptorSet(m_meshletCullDescriptorSet, 0);
+  backend->dispatch((itemCount + kMeshletCullGroupSize - 1) / kMeshletCullGroupSize);
+  backend->memoryBarrier();
+
+  backend->readBuffer(m_meshletStatsBuffer, sizeof(uint32_t), 0, [this](const void* data) {
+    m_meshletVisibleCount = *static_cast<const uint32_t*>(data);
+  });
+}
+
+void Renderer::drawItem(const RenderData& renderData, uint32_t itemIndex, OcclusionDraws draws) {
+  RenderAPI* backend = m_renderAPI;
+
+  m_stats.drawCalls++;
+  if (draws == OcclusionDraws::Meshlets && m_meshletDrawRanges[itemIndex].commandCount > 0) {
+    const MeshletDrawRange& range = m_meshletDrawRanges[itemIndex];
+    const uint64_t offset = uint64_t(range.firstCommand) * sizeof(vk::DrawIndexedIndirectCommand);
+    if (backend->isMultiDrawIndirectSupported()) {
+      backend->drawIndexedIndirect(m_meshletCommandsBuffer, offset, range.commandCount);
+      return;
+    }
+    for (uint32_t c = 0; c < range.commandCount; c++) {
+      backend->drawIndexedIndirect(m_meshletCommandsBuffer, offset + c * sizeof(vk::DrawIndexedIndirectCommand));
+    }
+    return;
+  }
+
+  if (draws == OcclusionDraws::None || draws == OcclusionDraws::Meshlets) {
+    backend->drawIndexed(renderData.indexCount, 1, renderData.indexOffset, renderData.vertexOffset, renderData.objectIndex);
+  } else {
+    backend->drawIndexedIndirect(m_occlusionCommandsBuffer, getOcclusionCommandOffset(draws, itemIndex));
+  }
+}
+
+void Renderer::deferredPass() {
+  RenderAPI* backend = m_renderAPI;
+
+  prepareGBuffer();
+
+  constexpr auto litColor = std::to_underlying(GBufferAttachment::LIT_COLOR);
+  constexpr auto baseColorMetallic = std::to_underlying(GBufferAttachment::BASE_COLOR_METALLIC);
+  constexpr auto normalRoughness = std::to_underlying(GBufferAttachment::NORMAL_ROUGHNESS);
+
+  // The G-buffer is only read within the render pass, so it's never loaded or stored
+  // and may stay in tile memory on GPUs that support it
+  RenderPassDescription renderPass {};
+  renderPass.color[litColor] = { vk::AttachmentLoadOp::eClear, vk::AttachmentStoreOp::eStore };
+  renderPass.color[baseColorMetallic] = { vk::AttachmentLoadOp::eDontCare, vk::AttachmentStoreOp::eDontCare };
+  renderPass.color[normalRoughness] = { vk::AttachmentLoadOp::eDontCare, vk::AttachmentStoreOp::eDontCare };
+  renderPass.depth = { vk::AttachmentLoadOp::eClear, vk::AttachmentStoreOp::eDontCare };
+
+  renderPass.subpassCount = 3;
+  auto& gbufferSubpass = renderPass.subpasses[0];
+  gbufferSubpass.colors[baseColorMetallic] = true;
+  gbufferSubpass.colors[normalRoughness] = true;
+
+  auto& lightingSubpass = renderPass.subpasses[1];
+  lightingSubpass.colors[litColor] = true;
+  lightingSubpass.inputs[baseColorMetallic] = true;
+  lightingSubpass.inputs[normalRoughness] = true;
+  lightingSubpass.depthInput = true;
+
+  // background, e.g. skybox, depth tested against the G-buffer depth
+  auto& forwardSubpass = renderPass.subpasses[2];
+  forwardSubpass.colors[litColor] = true;
+
+  PerColorAttachment<TextureHandle> attachments {};
+  attachments[baseColorMetallic] = m_gbufferBaseColorMetallic;
+  attachments[normalRoughness] = m_gbufferNormalRoughness;
+
+  backend->beginRenderPass(attachments, m_gbufferDepth, renderPass, vk::ClearColorValue(0.1f, 0.1f, 0.3f, 1.0f));
+
+  auto backgroundBegin = getBackgroundBegin();
+  std::span<const RenderQueueItem> opaqueItems { m_renderQueue.cbegin(), backgroundBegin };
+  if (m_camera.depthPrepass) {
+    drawDepthPrepass(opaqueItems);
+  }
+
+  backend->beginPipelineStatistics();
+  drawColorItems(opaqueItems, true, m_camera.depthPrepass ? DepthMode::EQUAL_READ_ONLY : DepthMode::PROGRAM);
+  backend->endPipelineStatistics();
+
+  backend->nextSubpass();
+  backend->bindPipeline({ .program = m_deferredLightingShader->program() });
+  backend->bindDescriptorSet(m_viewDescriptorSet, std::to_underlying(DescriptorSetBindingPoints::PER_VIEW));
+  backend->bindDescriptorSet(m_gbufferDescriptorSet, std::to_underlying(DescriptorSetBindingPoints::PER_MATERIAL));
+  backend->draw(3);
+  m_stats.pipelineBinds++;
+  m_stats.drawCalls++;
+
+  backend->nextSubpass();
+  drawColorItems({ backgroundBegin, m_renderQueue.cend() }, false);
+
   backend->endRenderPass();
 }
 
+void Renderer::updateOverdrawStats() {
+  const auto& statistics = m_renderAPI->getPipelineStatistics();
+  if (!statistics) {
+    return;
+  }
+
+  vk::Extent2D extent = m_renderAPI->getSwapChainExtent();
+  m_stats.shadedFragments = statistics->fragmentShaderInvocations;
+  m_stats.overdraw = float(statistics->fragmentShaderInvocations) / float(std::max(extent.width * extent.height, 1u));
+}
+
+void Renderer::prepareGBuffer() {
+  RenderAPI* backend = m_renderAPI;
+
+  vk::Extent2D extent = backend->getSwapChainExtent();
+  if (m_gbufferDepth && extent == m_gbufferExtent) {
+    return;
+  }
+
+  if (m_gbufferDepth) {
+    // resizes are rare, let the frames in flight finish with the old attachments
+    backend->waitIdle();
+    backend->destroyTexture(m_gbufferBaseColorMetallic);
+    backend->destroyTexture(m_gbufferNormalRoughness);
+    backend->destroyTexture(m_gbufferDepth);
+  }
+
+  m_gbufferExtent = extent;
+  m_gbufferBaseColorMetallic = backend->createTexture(
+      TextureType::TEXTURE_2D, vk::Format::eR8G8B8A8Srgb,
+      TextureUsage::ColorAttachment | TextureUsage::InputAttachment, extent.width, extent.height);
+  m_gbufferNormalRoughness = backend->createTexture(
+      TextureType::TEXTURE_2D, vk::Format::eA2B10G10R10UnormPack32,
+      TextureUsage::ColorAttachment | TextureUsage::InputAttachment, extent.width, extent.height);
+  m_gbufferDepth = backend->createTexture(
+      TextureType::TEXTURE_2D, vk::Format::eD32Sfloat,
+      TextureUsage::DepthStencilAttachment | TextureUsage::InputAttachment, extent.width, extent.height);
+
+  backend->updateDescriptorSetTexture(m_gbufferDescriptorSet, m_gbufferBaseColorMetallic, std::to_underlying(GBufferDescriptorBindings::BASE_COLOR_METALLIC));
+  backend->updateDescriptorSetTexture(m_gbufferDescriptorSet, m_gbufferNormalRoughness, std::to_underlying(GBufferDescriptorBindings::NORMAL_ROUGHNESS));
+  backend->updateDescriptorSetTexture(m_gbufferDescriptorSet, m_gbufferDepth, std::to_underlying(GBufferDescriptorBindings::DEPTH));
+}
+
 void Renderer::endFrame() {
   m_renderAPI->endFrame();
 }
 
 void Renderer::onSceneCreated(Scene& scene) {
+  scene.onConstruct<Renderable>().connect<&Renderer::onCreateRenderable>(*this);
   scene.onDestroy<Renderable>().connect<&Renderer::onDestroyRenderable>(*this);
 }
 
-void Renderer::prepare(Scene& scene) {
-  auto& backend = *m_renderAPI;
+template<typename Fn>
+void Renderer::forEachExtractChunk(Fn&& fn) {
+  const uint32_t count = static_cast<uint32_t>(m_extracted.size());
+  m_jobSystem->parallelFor(0, static_cast<uint32_t>(m_extractChunks.size()), 1, [&](uint32_t firstChunk, uint32_t lastChunk) {
+    for (uint32_t c = firstChunk; c < lastChunk; c++) {
+      uint32_t first = c * kExtractChunkSize;
+      fn(m_extractChunks[c], first, std::min(count, first + kExtractChunkSize));
+    }
+  });
+}
+
+void Renderer::gatherBounds(Scene& scene) {
+  m_extracted.clear();
+  for(const auto& [entity, renderable] : scene.view<Renderable>().each()) {
+    m_extracted.push_back({ entity, &renderable });
+  }
+  m_extractChunks.resize((m_extracted.size() + kExtractChunkSize - 1) / kExtractChunkSize);
+
+  // Component lookups only read the registry and run in parallel
+  forEachExtractChunk([&scene, this](ExtractChunk& chunk, uint32_t first, uint32_t last) {
+    chunk.boundsCount = 0;
+    for (uint32_t i = first; i < last; i++) {
+      auto& item = m_extracted[i];
+      item.transform = scene.tryGet<WorldTransform>(item.entity);
+      item.skin = scene.tryGet<Skin>(item.entity);
+      if (item.transform) {
+        chunk.boundsCount += item.renderable->mesh->faces.size();
+      }
+    }
+  });
+
+  uint32_t boundsCount = 0;
+  for (auto& chunk : m_extractChunks) {
+    chunk.boundsOffset = boundsCount;
+    boundsCount += chunk.boundsCount;
+  }
+  m_cullingBounds.resize(boundsCount);
+  m_cullable.resize(boundsCount);
+
+  // Skinned meshes move away from their bind pose bounds, so their bounds are
+  // kept for light fitting but they are never culled. Entities without a
+  // Transform (skybox) follow the camera and aren't gathered at all.
+  forEachExtractChunk([this](ExtractChunk& chunk, uint32_t first, uint32_t last) {
+    uint32_t boundsIndex = chunk.boundsOffset;
+    for (uint32_t i = first; i < last; i++) {
+      auto& item = m_extracted[i];
+      if (!item.transform) {
+        item.firstBoundsIndex = kInvalidBoundsIndex;
+        continue;
+      }
+
+      item.firstBoundsIndex = boundsIndex;
+      for (const auto& face : item.renderable->mesh->faces) {
+        m_cullingBounds.set(boundsIndex, face.bounds.transform(item.transform->matrix));
+        m_cullable[boundsIndex] = item.skin ? 0 : 1;
+        boundsIndex++;
+      }
+    }
+  });
+}
+
+void Renderer::cull(const Frustum& frustum) {
+  m_cullingBounds.cull(frustum, m_visibility);
+  for (size_t i = 0; i < m_visibility.size(); i++) {
+    m_visibility[i] |= !m_cullable[i];
+  }
+}
 
-  auto renderableView = scene.view<Renderable>();
-  size_t meshCount = renderableView.size();
+uint8_t Renderer::selectLod(const Mesh& mesh, float screenScale, uint8_t currentLod) const {
+  const float maxError = kLodScreenError * std::exp2(m_lodBias);
+  const auto levelCount = static_cast<uint8_t>(mesh.lodErrors.size());
+  currentLod = std::min<uint8_t>(currentLod, levelCount - 1);
 
-  // prepare per object buffer
-  if(meshCount > m_perObjectUniformBufferData.size() || !m_objectsUniformBufferHandle) {
-    m_perObjectUniformBufferData.resize(std::max(meshCount, m_perObjectUniformBufferData.size()));
+  auto coarsest = [&](float limit) {
+    uint8_t lod = 0;
+    while (lod + 1 < levelCount && mesh.lodErrors[lod + 1] * screenScale <= limit) {
+      lod++;
+    }
+    return lod;
+  };
+
+  // Coarser once well under the limit, finer once well over it, so objects
+  // near a threshold don't switch back and forth every frame
+  uint8_t coarser = coarsest(maxError * (1.0f - kLodHysteresis));
+  if (coarser > currentLod) {
+    return coarser;
+  }
+  if (mesh.lodErrors[currentLod] * screenScale > maxError * (1.0f + kLodHysteresis)) {
+    return coarsest(maxError);
+  }
+  return currentLod;
+}
 
-    if(m_objectsUniformBufferHandle) {
-      backend.destroyBuffer(m_objectsUniformBufferHandle);
+void Renderer::softwareOcclusionCull(const glm::mat4& viewProjection) {
+  glm::vec3 cameraPosition = glm::vec3(m_perViewUniformBufferData.viewInverse[3]);
+
+  // Skinned meshes leave their bind pose, so only static ones with a visible face occlude
+  m_occluderCandidates.clear();
+  for (uint32_t i = 0; i < m_extracted.size(); i++) {
+    const auto& item = m_extracted[i];
+    const Mesh& mesh = *item.renderable->mesh;
+    if (!item.transform || item.skin || mesh.occluder.isEmpty()) {
+      continue;
+    }
+    const uint8_t* faceVisibility = m_cameraVisibility.data() + item.firstBoundsIndex;
+    if (std::all_of(faceVisibility, faceVisibility + mesh.faces.size(), [](uint8_t visible) { return visible == 0; })) {
+      continue;
     }
-    m_objectsUniformBufferHandle = backend.createBuffer(BufferBinding::UNIFORM, m_perObjectUniformBufferData.size() * sizeof(PerObjectUniforms));
 
-    backend.updateDescriptorSetBuffer(m_objectDescriptorSet, m_objectsUniformBufferHandle, std::to_underlying(PerObjectDescriptorBindings::OBJECT_UNIFORMS), 0, sizeof(PerObjectUniforms));
+    const glm::mat4& m = item.transform->matrix;
+    float scale = std::max({ glm::length(glm::vec3(m[0])), glm::length(glm::vec3(m[1])), glm::length(glm::vec3(m[2])) });
+    float radius = mesh.sphere.radius * scale;
+    float distance = glm::length(glm::vec3(m * glm::vec4(mesh.sphere.center, 1.0f)) - cameraPosition);
+    float size = radius / std::max(distance, radius);
+    if (size >= kMinSoftwareOccluderSize) {
+      m_occluderCandidates.emplace_back(size, i);
+    }
   }
 
-  m_renderData.clear();
-  m_renderData.reserve(meshCount * 2);
+  auto occluderCount = std::min<size_t>(m_occluderCandidates.size(), kMaxSoftwareOccluders);
+  std::partial_sort(m_occluderCandidates.begin(), m_occluderCandidates.begin() + occluderCount, m_occluderCandidates.end(),
+    [](const auto& a, const auto& b) { return a.first > b.first; });
 
-  uint32_t index = 0;
-  for(const auto& [entity, renderable] : renderableView.each()) {
-    const auto tr = scene.tryGet<Transform>(entity);
-    auto skin = scene.tryGet<Skin>(entity);
+  m_softwareOcclusion.begin(viewProjection);
+  for (size_t i = 0; i < occluderCount; i++) {
+    const auto& item = m_extracted[m_occluderCandidates[i].second];
+    m_softwareOcclusion.addOccluder(item.renderable->mesh->occluder, item.transform->matrix);
+  }
+  m_softwareOcclusion.rasterize(*m_jobSystem);
 
-    auto& uniformBufferData = m_perObjectUniformBufferData[index];
-    uniformBufferData.model = tr ? tr->transform : glm::mat4(1.0f);
-    uniformBufferData.modelInverse = inverse(uniformBufferData.model);
-    uniformBufferData.modelInverseTranspose = transpose(uniformBufferData.modelInverse);
-    uniformBufferData.flags = skin ? std::to_underlying(ObjectFlags::SkinningEnabled) : 0u;
+  auto visibleCount = std::count(m_cameraVisibility.begin(), m_cameraVisibility.end(), 1);
+  m_softwareOcclusion.cull(m_cullingBounds, m_cameraVisibility, *m_jobSystem);
+  for (size_t i = 0; i < m_cameraVisibility.size(); i++) {
+    m_cameraVisibility[i] |= !m_cullable[i];
+  }
 
-    auto mesh = renderable.mesh;
-    for(size_t i = 0; i < mesh->faces.size(); i++) {
-      auto& [indexOffset, indexCount] = mesh->faces[i];
-      auto& material = renderable.materials[i];
-      material->updateTextures(backend);
-      material->updateBuffers(backend);
+  m_stats.softwareOccluders = m_softwareOcclusion.getOccluderCount();
+  m_stats.softwareOccludedObjects = visibleCount - std::count(m_cameraVisibility.begin(), m_cameraVisibility.end(), 1);
+}
 
-      auto& entry = m_renderData.emplace_back();
+void Renderer::prepare(Scene& scene, const std::vector<uint8_t>* visibility) {
+  auto& backend = *m_renderAPI;
 
-      if (skin) {
-        auto& objectDescriptor = renderable.descriptorSet;
-        if (!objectDescriptor) {
-          objectDescriptor = backend.createDescriptorSet(m_objectDescriptorSetLayout);
+  // Count visible faces of every chunk
+  forEachExtractChunk([visibility, this](ExtractChunk& chunk, uint32_t first, uint32_t last) {
+    chunk.renderDataCount = 0;
+    chunk.pendingDescriptorSets.clear();
+    for (uint32_t i = first; i < last; i++) {
+      auto& item = m_extracted[i];
+      const size_t faceCount = item.renderable->mesh->faces.size();
+
+      item.visibleFaceCount = faceCount;
+      if (visibility && item.transform) {
+        const uint8_t* faceVisibility = visibility->data() + item.firstBoundsIndex;
+        item.visibleFaceCount -= std::count(faceVisibility, faceVisibility + faceCount, 0);
+      }
+      if (item.visibleFaceCount == 0) {
+        continue;
+      }
 
-          backend.updateDescriptorSetBuffer(
-          objectDescriptor, m_objectsUniformBufferHandle,
-          std::to_underlying(PerObjectDescriptorBindings::OBJECT_UNIFORMS),
-          0, sizeof(PerObjectUniforms));
+      chunk.renderDataCount += item.visibleFaceCount;
+      if (item.skin && !item.renderable->descriptorSet) {
+        chunk.pendingDescriptorSets.push_back(i);
+      }
+    }
+  });
 
-          backend.updateDescriptorSetBuffer(
-            objectDescriptor, skin->getBuffer().getHandle(),
-            std::to_underlying(PerObjectDescriptorBindings::BONE_UNIFORMS),
-            0, sizeof(BonesUniform));
-        }
+  uint32_t renderDataCount = 0;
+  for (auto& chunk : m_extractChunks) {
+    chunk.renderDataOffset = renderDataCount;
+    renderDataCount += chunk.renderDataCount;
+  }
 
-        entry.objectDescriptorSet = objectDescriptor;
+  reserveObjectSlots();
+
+  // Descriptor sets are created by the backend, keep it on this thread
+  for (const auto& chunk : m_extractChunks) {
+    for (uint32_t i : chunk.pendingDescriptorSets) {
+      auto& item = m_extracted[i];
+      auto& objectDescriptor = item.renderable->descriptorSet;
+      objectDescriptor = backend.createDescriptorSet(m_objectDescriptorSetLayout);
+
+      backend.updateDescriptorSetBuffer(
+        objectDescriptor, m_objectBufferHandle,
+        std::to_underlying(PerObjectDescriptorBindings::OBJECT_DATA));
+
+      backend.updateDescriptorSetBuffer(
+        objectDescriptor, item.skin->getBuffer().getHandle(),
+        std::to_underlying(PerObjectDescriptorBindings::BONE_UNIFORMS),
+        0, sizeof(BonesUniform));
+    }
+  }
+
+  m_renderData.resize(renderDataCount);
+
+  const glm::vec3 cameraPosition = glm::vec3(m_perViewUniformBufferData.viewInverse[3]);
+  const float projectionScale = std::abs(m_camera.projection[1][1]);
+
+  // Every chunk refreshes the object slots that changed and fills its own slice of the render data
+  forEachExtractChunk([visibility, cameraPosition, projectionScale, this](ExtractChunk& chunk, uint32_t first, uint32_t last) {
+    chunk.dirtyObjectSlots.clear();
+    RenderData* entry = m_renderData.data() + chunk.renderDataOffset;
+    for (uint32_t i = first; i < last; i++) {
+      const auto& item = m_extracted[i];
+      const auto* tr = item.transform;
+      const auto& renderable = *item.renderable;
+      const uint32_t slot = renderable.objectSlot;
+
+      // culled objects are kept up to date as well, their slot must be valid once they show up
+      if (m_objectSlotDirty[slot] || (tr && tr->changed)) {
+        // inverses are cached by TransformSystem and only recomputed when the transform changes
+        const glm::mat4 model = tr ? tr->matrix : glm::mat4(1.0f);
+        const glm::mat4 inverse = tr ? tr->inverse : glm::mat4(1.0f);
+        auto& objectData = m_perObjectBufferData[slot];
+        // glm is column major, row r of the model is column r of its transpose.
+        // Quantized positions are dequantized by the same matrix, normals aren't affected.
+        const glm::mat4 modelRows = transpose(model * renderable.mesh->positionDecode);
+        objectData.modelRows[0] = modelRows[0];
+        objectData.modelRows[1] = modelRows[1];
+        objectData.modelRows[2] = modelRows[2];
+        // rows of the inverse transpose are the columns of the inverse
+        objectData.normalRow0 = glm::vec3(inverse[0]);
+        objectData.normalRow1 = glm::vec3(inverse[1]);
+        objectData.normalRow2 = glm::vec3(inverse[2]);
+        objectData.flags = item.skin ? std::to_underlying(ObjectFlags::SkinningEnabled) : 0u;
+        m_objectSlotDirty[slot] = 0;
+        chunk.dirtyObjectSlots.push_back(slot);
       }
-      else {
-        entry.objectDescriptorSet = m_objectDescriptorSet;
+
+      if (item.visibleFaceCount == 0) {
+        continue;
       }
 
-      entry.objectBufferOffset = index * sizeof(PerObjectUniforms);
-      entry.program = material->getShader()->program();
-      entry.vertexBufferLayout = mesh->vertexBuffer->getLayout();
-      entry.material = material.get();
-      entry.indexBuffer = mesh->indexBuffer->getHandle();
-      entry.vertexBuffer = mesh->vertexBuffer->getBuffer();
-      entry.indexCount = indexCount;
-      entry.indexOffset = indexOffset;
-      entry.hasTransform = tr != nullptr;
-      entry.isSkinned = (skin != nullptr);
+      const auto& mesh = renderable.mesh;
+      const uint8_t* faceVisibility = visibility && tr ? visibility->data() + item.firstBoundsIndex : nullptr;
+
+      // One level for the whole renderable, picked from the projected size of its bounding sphere
+      uint8_t lod = 0;
+      if (tr && mesh->lodErrors.size() > 1) {
+        const glm::mat4& m = tr->matrix;
+        float scale = std::max({ glm::length(glm::vec3(m[0])), glm::length(glm::vec3(m[1])), glm::length(glm::vec3(m[2])) });
+        float radius = mesh->sphere.radius * scale;
+        float distance = std::max(glm::length(glm::vec3(m * glm::vec4(mesh->sphere.center, 1.0f)) - cameraPosition), radius);
+        lod = selectLod(*mesh, 0.5f * projectionScale * radius / distance, renderable.lod);
+        item.renderable->lod = lod;
+      }
 
-      index++;
+      for(size_t f = 0; f < mesh->faces.size(); f++) {
+        if (faceVisibility && !faceVisibility[f]) {
+          continue;
+        }
+
+        const auto& face = mesh->faces[f];
+        const auto& material = renderable.materials[f];
+
+        // faces share the object data of their renderable
+        entry->objectDescriptorSet = item.skin ? renderable.descriptorSet : m_objectDescriptorSet;
+        entry->objectIndex = slot;
+        entry->program = material->getShader()->program();
+        entry->vertexBufferLayout = mesh->geometry.getLayout();
+        entry->material = material.get();
+        entry->indexBuffer = mesh->geometry.getIndexBuffer();
+        entry->vertexBuffer = mesh->geometry.getVertexBuffer();
+        const uint32_t faceLod = std::min<uint32_t>(lod, face.lods.size());
+        entry->indexCount = faceLod ? face.lods[faceLod - 1].indexCount : face.indexCount;
+        entry->indexOffset = mesh->geometry.getFirstIndex() + (faceLod ? face.lods[faceLod - 1].indexOffset : face.indexOffset);
+        entry->vertexOffset = mesh->geometry.getBaseVertex();
+        entry->lod = static_cast<uint8_t>(faceLod);
+        entry->worldPosition = tr ? glm::vec3(tr->matrix * glm::vec4(face.sphere.center, 1.0f)) : face.sphere.center;
+        entry->boundsIndex = tr ? item.firstBoundsIndex + f : kInvalidBoundsIndex;
+        entry->hasTransform = tr != nullptr;
+        entry->isSkinned = item.skin != nullptr;
+        entry->isQuantized = mesh->quantized;
+        entry->meshlets = faceLod == 0 && tr && !item.skin && !face.meshlets.empty() ? &face.meshlets : nullptr;
+        entry->model = tr ? &tr->matrix : nullptr;
+        entry++;
+      }
     }
+  });
+
+  // Dense ids keep the sort key fields small regardless of handle values.
+  // They depend on the order of first appearance and materials are updated
+  // through the backend, so this runs over the stitched list on this thread.
+  std::unordered_map<uint64_t, uint16_t> pipelineIds;
+  std::unordered_map<const Material*, uint16_t> materialIds;
+  const Material* lastMaterial = nullptr;
+  uint16_t lastMaterialId = 0;
+  for (auto& entry : m_renderData) {
+    // faces of a renderable often share a material, skip the lookup for runs of it
+    if (entry.material != lastMaterial) {
+      auto [materialId, inserted] = materialIds.try_emplace(entry.material, materialIds.size());
+      if (inserted) {
+        entry.material->updateTextures(backend);
+        entry.material->updateBuffers(backend);
+      }
+      lastMaterial = entry.material;
+      lastMaterialId = materialId->second;
+    }
+    entry.materialId = lastMaterialId;
+
+    uint64_t pipelineKey = (entry.program.getId() << 32) | (entry.vertexBufferLayout.getId() & 0xffffffff);
+    entry.pipelineId = pipelineIds.try_emplace(pipelineKey, pipelineIds.size()).first->second;
   }
 
   backend.updateBuffer(m_viewUniformBufferHandle, &m_perViewUniformBufferData, sizeof(m_perViewUniformBufferData));
-  backend.updateBuffer(m_lightsUniformBufferHandle, m_lightUniformsBufferData.data(), sizeof(m_lightUniformsBufferData));
-  backend.updateBuffer(m_objectsUniformBufferHandle, m_perObjectUniformBufferData.data(), m_perObjectUniformBufferData.size() * sizeof(PerObjectUniforms));
+  uploadDirtyObjectSlots();
 
   auto ibl = scene.tryGet<SceneLighting>(scene.single());
   auto iblTexHandle = ibl ? ibl->prefilteredEnvMap->getHandle() : TextureHandle{};
@@ -309,11 +1421,86 @@ void Renderer::prepare(Scene& scene) {
   }
 }
 
+void Renderer::reserveObjectSlots() {
+  auto& backend = *m_renderAPI;
+
+  const size_t slotCount = m_objectSlotDirty.size();
+  if (slotCount <= m_perObjectBufferData.size() && m_objectBufferHandle) {
+    return;
+  }
+
+  // grow geometrically, the whole buffer is uploaded again after that
+  size_t capacity = std::max<size_t>({ kMinObjectSlots, slotCount, m_perObjectBufferData.size() * 2 });
+  m_perObjectBufferData.resize(capacity);
+  std::fill(m_objectSlotDirty.begin(), m_objectSlotDirty.end(), 1);
+
+  if(m_objectBufferHandle) {
+    backend.destroyBuffer(m_objectBufferHandle);
+  }
+  m_objectBufferHandle = backend.createBuffer(BufferBinding::STORAGE, capacity * sizeof(PerObjectData));
+
+  backend.updateDescriptorSetBuffer(m_objectDescriptorSet, m_objectBufferHandle, std::to_underlying(PerObjectDescriptorBindings::OBJECT_DATA));
+
+  // skinned renderables have their own descriptor sets pointing at the old buffer
+  for (const auto& item : m_extracted) {
+    if (item.renderable->descriptorSet) {
+      backend.updateDescriptorSetBuffer(
+        item.renderable->descriptorSet, m_objectBufferHandle,
+        std::to_underlying(PerObjectDescriptorBindings::OBJECT_DATA));
+    }
+  }
+}
+
+void Renderer::uploadDirtyObjectSlots() {
+  m_dirtyObjectSlots.clear();
+  for (const auto& chunk : m_extractChunks) {
+    m_dirtyObjectSlots.insert(m_dirtyObjectSlots.end(), chunk.dirtyObjectSlots.begin(), chunk.dirtyObjectSlots.end());
+  }
+  std::sort(m_dirtyObjectSlots.begin(), m_dirtyObjectSlots.end());
+
+  // Coalesce into ranges, small gaps are uploaded along to save copy commands
+  size_t i = 0;
+  while (i < m_dirtyObjectSlots.size()) {
+    uint32_t first = m_dirtyObjectSlots[i];
+    uint32_t last = first;
+    for (i++; i < m_dirtyObjectSlots.size() && m_dirtyObjectSlots[i] - last <= kMaxObjectUploadGap; i++) {
+      last = m_dirtyObjectSlots[i];
+    }
+
+    uint32_t count = last - first + 1;
+    m_renderAPI->updateBuffer(m_objectBufferHandle, &m_perObjectBufferData[first],
+      count * sizeof(PerObjectData), first * sizeof(PerObjectData));
+    m_stats.objectUploadRanges++;
+    m_stats.objectUploadBytes += count * sizeof(PerObjectData);
+  }
+}
+
+bool Renderer::isVisibleFromCamera(const RenderData& renderData) const {
+  return renderData.boundsIndex == kInvalidBoundsIndex || m_cameraVisibility[renderData.boundsIndex];
+}
+
+void Renderer::sortRenderQueue() {
+  radixSort(m_renderQueue, m_renderQueueScratch, [](const RenderQueueItem& item) { return item.sortKey; });
+}
+
+void Renderer::onCreateRenderable(entt::registry& registry, entt::entity entity) {
+    Renderable& renderable = registry.get<Renderable>(entity);
+    if (!m_freeObjectSlots.empty()) {
+        renderable.objectSlot = m_freeObjectSlots.back();
+        m_freeObjectSlots.pop_back();
+    } else {
+        renderable.objectSlot = static_cast<uint32_t>(m_objectSlotDirty.size());
+        m_objectSlotDirty.push_back(0);
+    }
+    m_objectSlotDirty[renderable.objectSlot] = 1;
+}
+
 void Renderer::onDestroyRenderable(entt::registry& registry, entt::entity entity) {
     Renderable& renderable = registry.get<Renderable>(entity);
     if (renderable.descriptorSet) {
         m_renderAPI->destroyDescriptorSet(renderable.descriptorSet);
     }
+    m_freeObjectSlots.push_back(renderable.objectSlot);
 }
 
 asset_ptr<Texture> Renderer::createWhiteTexture(AssetManager* assetManager) {
@@ -354,16 +1541,45 @@ void Renderer::terminate() {
 
   backend.destroyDescriptorSet(m_viewDescriptorSet);
   backend.destroyDescriptorSet(m_objectDescriptorSet);
+  backend.destroyDescriptorSet(m_gbufferDescriptorSet);
+  backend.destroyDescriptorSet(m_occlusionCullDescriptorSet);
+  backend.destroyDescriptorSet(m_meshletCullDescriptorSet);
+  for (auto& descriptorSet : m_hizDescriptorSets) {
+    backend.destroyDescriptorSet(descriptorSet);
+  }
 
   backend.destroyDescriptorSetLayout(m_viewDescriptorSetLayout);
   backend.destroyDescriptorSetLayout(m_objectDescriptorSetLayout);
 
   backend.destroyBuffer(m_viewUniformBufferHandle);
-  backend.destroyBuffer(m_lightsUniformBufferHandle);
-  backend.destroyBuffer(m_objectsUniformBufferHandle);
+  backend.destroyBuffer(m_lightsBufferHandle);
+  backend.destroyBuffer(m_clustersBufferHandle);
+  backend.destroyBuffer(m_clusterLightIndicesBufferHandle);
+  backend.destroyBuffer(m_objectBufferHandle);
+
+  for (auto& cascade : m_shadowCascades) {
+    backend.destroyDescriptorSet(cascade.viewDescriptorSet);
+    backend.destroyBuffer(cascade.viewUniformBuffer);
+  }
 
   backend.destroyTexture(m_shadowMapTexture);
   backend.destroyRenderTarget(m_shadowMapRenderTarget);
+  backend.destroyTexture(m_gbufferBaseColorMetallic);
+  backend.destroyTexture(m_gbufferNormalRoughness);
+  backend.destroyTexture(m_gbufferDepth);
+  backend.destroyTexture(m_occlusionDepth);
+  backend.destroyTexture(m_hizTexture);
+  backend.destroyBuffer(m_occlusionUniformBuffer);
+  backend.destroyBuffer(m_occlusionItemsBuffer);
+  backend.destroyBuffer(m_occlusionCommandsBuffer);
+  backend.destroyBuffer(m_objectVisibilityBuffer);
+  backend.destroyBuffer(m_occlusionStatsBuffer);
+  backend.destroyBuffer(m_meshletUniformBuffer);
+  backend.destroyBuffer(m_meshletItemsBuffer);
+  backend.destroyBuffer(m_meshletDrawsBuffer);
+  backend.destroyBuffer(m_meshletCommandsBuffer);
+  backend.destroyBuffer(m_meshletDrawCountsBuffer);
+  backend.destroyBuffer(m_meshletStatsBuffer);
   backend.destroyBuffer(m_dummyBonesBuffer);
 }
 
@@ -1,9 +1,14 @@
 #pragma once
 
 #include "RenderPrimitive.h"
+#include <span>
 #include <vector>
 
 #include "Renderable.h"
+#include "Culling.h"
+#include "LightClusters.h"
+#include "Meshlets.h"
+#include "SoftwareOcclusion.h"
 
 namespace ailo {
 
@@ -19,7 +24,12 @@ struct PerViewUniforms {
 
   float iblSpecularMaxLod;
   float __padding1[3];
-  alignas(16) glm::mat4 lightViewProjection;
+  alignas(16) glm::mat4 shadowCascadeViewProjection[kShadowCascadeCount];
+  glm::vec4 shadowCascadeSplits; // view space far distance of each cascade
+
+  glm::uvec4 clusterGrid; // xyz - cluster counts, w - light count
+  glm::vec4 clusterDepthScaleBias; // xy, slice = log(viewDepth) * x + y
+  alignas(16) glm::mat4 projectionInverse;
 };
 
 struct LightUniform {
@@ -32,11 +42,64 @@ struct LightUniform {
   float __padding1;
 };
 
-struct alignas(64) PerObjectUniforms {
-  alignas(16) glm::mat4 model = glm::mat4(1);
-  alignas(16) glm::mat4 modelInverse = glm::mat4(1);
-  alignas(16) glm::mat4 modelInverseTranspose = glm::mat4(1);
+// Entry of the object storage buffer, indexed with gl_InstanceIndex.
+// Matrices are stored as rows, the last row of an affine transform is always (0, 0, 0, 1).
+struct PerObjectData {
+  glm::vec4 modelRows[3];
+  glm::vec3 normalRow0; // inverse transpose of the model 3x3
   uint32_t flags;
+  glm::vec3 normalRow1;
+  float __padding0;
+  glm::vec3 normalRow2;
+  float __padding1;
+};
+static_assert(sizeof(PerObjectData) == 96);
+
+// Opaque draw tested by the occlusion culling programs
+struct OcclusionCullItem {
+  glm::vec3 aabbMin; // world space, empty when the draw has no bounds
+  uint32_t objectIndex;
+  glm::vec3 aabbMax;
+  uint32_t indexCount;
+  uint32_t firstIndex;
+  int32_t vertexOffset;
+  uint32_t __padding0[2];
+};
+static_assert(sizeof(OcclusionCullItem) == 48);
+
+struct OcclusionCullUniforms {
+  alignas(16) glm::mat4 viewProjection;
+  glm::uvec2 depthSize;
+  uint32_t itemCount;
+  uint32_t sectionSize; // commands per section of the draw command buffer
+};
+
+// Meshlet tested by the meshlet culling program
+struct MeshletCullItem {
+  glm::vec4 sphere; // local space center and radius
+  glm::vec3 coneAxis;
+  float coneCutoff;
+  uint32_t firstIndex;
+  uint32_t indexCount;
+  uint32_t drawIndex; // into the meshlet draws
+  int32_t vertexOffset;
+};
+static_assert(sizeof(MeshletCullItem) == 48);
+
+// Opaque draw split into meshlets, its visible ones are compacted to the front of its commands
+struct MeshletCullDraw {
+  glm::mat4 model; // without the position decode of quantized meshes, meshlets are in local space
+  uint32_t firstCommand;
+  uint32_t objectIndex;
+  float maxScale; // largest axis scale of the model, for the spheres
+  uint32_t coneCulling; // zero under non uniform scale, which doesn't preserve the cones
+};
+static_assert(sizeof(MeshletCullDraw) == 80);
+
+struct MeshletCullUniforms {
+  glm::vec4 frustumPlanes[Frustum::Count];
+  glm::vec3 cameraPosition;
+  uint32_t itemCount;
 };
 
 enum class ObjectFlags : uint32_t {
@@ -56,6 +119,10 @@ struct BonesUniform {
 struct Camera {
   glm::mat4 projection;
   glm::mat4 view;
+  bool depthPrepass = false; // lay down depth first, so opaque geometry is shaded once per pixel
+  bool occlusionCulling = false; // two-phase Hi-Z culling of opaque draws, forward shading only
+  bool softwareOcclusion = false; // CPU culling against the occluder meshes, before render data is built
+  bool meshletCulling = false; // GPU frustum and cone culling of meshlets, forward shading without occlusionCulling
 };
 
 enum class DescriptorSetBindingPoints : uint8_t {
@@ -69,14 +136,57 @@ enum class PerViewDescriptorBindings {
   LIGHTS = 1,
   IBL_SPECULAR_MAP = 2,
   IBL_DFG_LUT = 3,
-  SHADOW_MAP = 4
+  SHADOW_MAP = 4,
+  CLUSTERS = 5,
+  CLUSTER_LIGHT_INDICES = 6
 };
 
 enum class PerObjectDescriptorBindings {
-  OBJECT_UNIFORMS = 0,
+  OBJECT_DATA = 0,
   BONE_UNIFORMS = 1
 };
 
+// Input attachments of the deferred lighting subpass, bound at PER_MATERIAL
+enum class GBufferDescriptorBindings {
+  BASE_COLOR_METALLIC = 0,
+  NORMAL_ROUGHNESS = 1,
+  DEPTH = 2
+};
+
+// Set 0 of the Hi-Z build programs. The source of level 0 is the depth buffer,
+// the previous level of the pyramid after that.
+enum class HiZBuildDescriptorBindings {
+  SOURCE = 0,
+  DESTINATION = 1
+};
+
+// Set 0 of the occlusion culling programs
+enum class OcclusionCullDescriptorBindings {
+  UNIFORMS = 0,
+  ITEMS = 1,
+  COMMANDS = 2,
+  OBJECT_VISIBILITY = 3,
+  STATS = 4,
+  HIZ = 5
+};
+
+// Set 0 of the meshlet culling program
+enum class MeshletCullDescriptorBindings {
+  UNIFORMS = 0,
+  ITEMS = 1,
+  DRAWS = 2,
+  COMMANDS = 3,
+  DRAW_COUNTS = 4,
+  STATS = 5
+};
+
+// Color slots of the deferred render pass, slot 0 is the lit swap chain image
+enum class GBufferAttachment : uint8_t {
+  LIT_COLOR = 0,
+  BASE_COLOR_METALLIC = 1, // rgb - base color, a - metallic
+  NORMAL_ROUGHNESS = 2 // rg - octahedral normal, b - perceptual roughness
+};
+
 class DescriptorSetLayoutBindings {
 public:
   static const std::vector<DescriptorSetLayoutBinding>& perView() {
@@ -88,7 +198,7 @@ public:
       },
     {
         .binding = std::to_underlying(PerViewDescriptorBindings::LIGHTS),
-        .descriptorType = vk::DescriptorType::eUniformBuffer,
+        .descriptorType = vk::DescriptorType::eStorageBuffer,
         .stageFlags = vk::ShaderStageFlagBits::eVertex | vk::ShaderStageFlagBits::eFragment
       },
       {
@@ -105,6 +215,16 @@ public:
         .binding = std::to_underlying(PerViewDescriptorBindings::SHADOW_MAP),
         .descriptorType = vk::DescriptorType::eCombinedImageSampler,
         .stageFlags = vk::ShaderStageFlagBits::eFragment
+      },
+      {
+        .binding = std::to_underlying(PerViewDescriptorBindings::CLUSTERS),
+        .descriptorType = vk::DescriptorType::eStorageBuffer,
+        .stageFlags = vk::ShaderStageFlagBits::eFragment
+      },
+      {
+        .binding = std::to_underlying(PerViewDescriptorBindings::CLUSTER_LIGHT_INDICES),
+        .descriptorType = vk::DescriptorType::eStorageBuffer,
+        .stageFlags = vk::ShaderStageFlagBits::eFragment
       }
     };
     return bindings;
@@ -113,68 +233,371 @@ public:
     static const std::vector<DescriptorSetLayoutBinding>& perObject() {
         static std::vector<DescriptorSetLayoutBinding> bindings {
             {
-              .binding = std::to_underlying(PerObjectDescriptorBindings::OBJECT_UNIFORMS),
-              .descriptorType = vk::DescriptorType::eUniformBufferDynamic,
+              .binding = std::to_underlying(PerObjectDescriptorBindings::OBJECT_DATA),
+              .descriptorType = vk::DescriptorType::eStorageBuffer,
               .stageFlags = vk::ShaderStageFlagBits::eVertex
             },
             {
               .binding = std::to_underlying(PerObjectDescriptorBindings::BONE_UNIFORMS),
-              .descriptorType = vk::DescriptorType::eUniformBufferDynamic,
+              .descriptorType = vk::DescriptorType::eUniformBuffer,
               .stageFlags = vk::ShaderStageFlagBits::eVertex
             }
         };
         return bindings;
     }
+
+    static const std::vector<DescriptorSetLayoutBinding>& gbufferInputs() {
+        static std::vector<DescriptorSetLayoutBinding> bindings {
+            {
+              .binding = std::to_underlying(GBufferDescriptorBindings::BASE_COLOR_METALLIC),
+              .descriptorType = vk::DescriptorType::eInputAttachment,
+              .stageFlags = vk::ShaderStageFlagBits::eFragment
+            },
+            {
+              .binding = std::to_underlying(GBufferDescriptorBindings::NORMAL_ROUGHNESS),
+              .descriptorType = vk::DescriptorType::eInputAttachment,
+              .stageFlags = vk::ShaderStageFlagBits::eFragment
+            },
+            {
+              .binding = std::to_underlying(GBufferDescriptorBindings::DEPTH),
+              .descriptorType = vk::DescriptorType::eInputAttachment,
+              .stageFlags = vk::ShaderStageFlagBits::eFragment
+            }
+        };
+        return bindings;
+    }
+
+    static const std::vector<DescriptorSetLayoutBinding>& hizBuild(bool fromDepth) {
+        static std::vector<DescriptorSetLayoutBinding> depthBindings {
+            {
+              .binding = std::to_underlying(HiZBuildDescriptorBindings::SOURCE),
+              .descriptorType = vk::DescriptorType::eCombinedImageSampler,
+              .stageFlags = vk::ShaderStageFlagBits::eCompute
+            },
+            {
+              .binding = std::to_underlying(HiZBuildDescriptorBindings::DESTINATION),
+              .descriptorType = vk::DescriptorType::eStorageImage,
+              .stageFlags = vk::ShaderStageFlagBits::eCompute
+            }
+        };
+        static std::vector<DescriptorSetLayoutBinding> levelBindings {
+            {
+              .binding = std::to_underlying(HiZBuildDescriptorBindings::SOURCE),
+              .descriptorType = vk::DescriptorType::eStorageImage,
+              .stageFlags = vk::ShaderStageFlagBits::eCompute
+            },
+            {
+              .binding = std::to_underlying(HiZBuildDescriptorBindings::DESTINATION),
+              .descriptorType = vk::DescriptorType::eStorageImage,
+              .stageFlags = vk::ShaderStageFlagBits::eCompute
+            }
+        };
+        return fromDepth ? depthBindings : levelBindings;
+    }
+
+    static const std::vector<DescriptorSetLayoutBinding>& occlusionCull() {
+        static std::vector<DescriptorSetLayoutBinding> bindings {
+            {
+              .binding = std::to_underlying(OcclusionCullDescriptorBindings::UNIFORMS),
+              .descriptorType = vk::DescriptorType::eUniformBuffer,
+              .stageFlags = vk::ShaderStageFlagBits::eCompute
+            },
+            {
+              .binding = std::to_underlying(OcclusionCullDescriptorBindings::ITEMS),
+              .descriptorType = vk::DescriptorType::eStorageBuffer,
+              .stageFlags = vk::ShaderStageFlagBits::eCompute
+            },
+            {
+              .binding = std::to_underlying(OcclusionCullDescriptorBindings::COMMANDS),
+              .descriptorType = vk::DescriptorType::eStorageBuffer,
+              .stageFlags = vk::ShaderStageFlagBits::eCompute
+            },
+            {
+              .binding = std::to_underlying(OcclusionCullDescriptorBindings::OBJECT_VISIBILITY),
+              .descriptorType = vk::DescriptorType::eStorageBuffer,
+              .stageFlags = vk::ShaderStageFlagBits::eCompute
+            },
+            {
+              .binding = std::to_underlying(OcclusionCullDescriptorBindings::STATS),
+              .descriptorType = vk::DescriptorType::eStorageBuffer,
+              .stageFlags = vk::ShaderStageFlagBits::eCompute
+            },
+            {
+              .binding = std::to_underlying(OcclusionCullDescriptorBindings::HIZ),
+              .descriptorType = vk::DescriptorType::eCombinedImageSampler,
+              .stageFlags = vk::ShaderStageFlagBits::eCompute
+            }
+        };
+        return bindings;
+    }
+
+    static const std::vector<DescriptorSetLayoutBinding>& meshletCull() {
+        static std::vector<DescriptorSetLayoutBinding> bindings {
+            {
+              .binding = std::to_underlying(MeshletCullDescriptorBindings::UNIFORMS),
+              .descriptorType = vk::DescriptorType::eUniformBuffer,
+              .stageFlags = vk::ShaderStageFlagBits::eCompute
+            },
+            {
+              .binding = std::to_underlying(MeshletCullDescriptorBindings::ITEMS),
+              .descriptorType = vk::DescriptorType::eStorageBuffer,
+              .stageFlags = vk::ShaderStageFlagBits::eCompute
+            },
+            {
+              .binding = std::to_underlying(MeshletCullDescriptorBindings::DRAWS),
+              .descriptorType = vk::DescriptorType::eStorageBuffer,
+              .stageFlags = vk::ShaderStageFlagBits::eCompute
+            },
+            {
+              .binding = std::to_underlying(MeshletCullDescriptorBindings::COMMANDS),
+              .descriptorType = vk::DescriptorType::eStorageBuffer,
+              .stageFlags = vk::ShaderStageFlagBits::eCompute
+            },
+            {
+              .binding = std::to_underlying(MeshletCullDescriptorBindings::DRAW_COUNTS),
+              .descriptorType = vk::DescriptorType::eStorageBuffer,
+              .stageFlags = vk::ShaderStageFlagBits::eCompute
+            },
+            {
+              .binding = std::to_underlying(MeshletCullDescriptorBindings::STATS),
+              .descriptorType = vk::DescriptorType::eStorageBuffer,
+              .stageFlags = vk::ShaderStageFlagBits::eCompute
+            }
+        };
+        return bindings;
+    }
 };
 
 class Scene;
+class JobSystem;
+struct WorldTransform;
+struct Skin;
+
+enum class RenderQueuePass : uint8_t {
+  Shadow = 0,
+  Opaque = 1,
+  Background = 2 // drawn after opaque geometry, e.g. skybox
+};
+
+enum class ShadingMode : uint8_t {
+  Forward = 0,
+  // G-buffer, lighting and background subpasses of one render pass
+  Deferred = 1
+};
+
+// Draw commands the opaque items are drawn with, the GPU culled ones have no instances
+enum class OcclusionDraws : uint8_t {
+  None = 0, // direct draws, no occlusion culling
+  Early = 1, // visible last frame
+  Late = 2, // visible against the early depth, missed by the early draws
+  Visible = 3, // everything that may be visible, color after a depth pre-pass
+  Meshlets = 4 // visible meshlets of the meshlet culling pass, direct draws for the rest
+};
+
+static constexpr uint32_t kInvalidBoundsIndex = std::numeric_limits<uint32_t>::max();
 
 struct RenderData {
   ProgramHandle program;
   VertexBufferLayoutHandle vertexBufferLayout;
   DescriptorSetHandle objectDescriptorSet;
-  uint32_t objectBufferOffset;
+  uint32_t objectIndex; // into the object table, passed as the first instance
   Material* material;
   BufferHandle indexBuffer;
   BufferHandle vertexBuffer;
   uint32_t indexCount;
   uint32_t indexOffset;
+  int32_t vertexOffset; // base vertex of the mesh in its geometry arena block
+  glm::vec3 worldPosition;
+  uint32_t boundsIndex; // into Renderer::m_cullingBounds, kInvalidBoundsIndex without Transform
+  uint16_t pipelineId; // dense per-frame id of (program, vertex layout)
+  uint16_t materialId; // dense per-frame id of material
+  uint8_t lod;
   bool hasTransform;
   bool isSkinned;
+  bool isQuantized; // packed vertex attributes, see MeshImportOptions
+  const std::vector<Meshlet>* meshlets; // of level 0 draws of static meshes, null otherwise
+  const glm::mat4* model; // null without Transform
+};
+
+// Commands of an opaque item in the meshlet command buffer, none when it's drawn directly
+struct MeshletDrawRange {
+  uint32_t firstCommand = 0;
+  uint32_t commandCount = 0;
+};
+
+// Sort key layout (msb -> lsb):
+// | pass : 4 | pipeline : 12 | material : 16 | depth : 16 | unused : 16 |
+struct RenderQueueItem {
+  uint64_t sortKey;
+  uint32_t index; // into Renderer::m_renderData
+};
+
+struct RenderStats {
+  uint32_t drawCalls = 0;
+  uint32_t pipelineBinds = 0;
+  uint32_t materialBinds = 0;
+  uint32_t bufferBinds = 0;
+  uint32_t visibleObjects = 0; // camera frustum culling, counted per draw
+  uint32_t culledObjects = 0;
+  uint32_t visibleTriangles = 0; // of the camera visible draws, after LOD selection
+  uint32_t reducedLodDraws = 0; // camera visible draws with a coarser level than 0
+  uint32_t shadowCasters = 0; // summed over rendered cascades
+  uint32_t shadowCascadesRendered = 0;
+  uint32_t objectUploadRanges = 0;
+  uint32_t objectUploadBytes = 0;
+  uint32_t lights = 0;
+  uint32_t clusterLightIndices = 0; // light references summed over all clusters
+  uint32_t depthPrepassDraws = 0;
+  // Fragment shader invocations of the opaque color draws and their ratio to the screen pixels.
+  // Read back from the GPU, so they lag a few frames behind, zero when the device can't count them.
+  uint64_t shadedFragments = 0;
+  float overdraw = 0.0f;
+  uint32_t occlusionTestedDraws = 0;
+  uint32_t occlusionVisibleDraws = 0; // read back from the GPU, a few frames behind
+  uint32_t softwareOccluders = 0;
+  uint32_t softwareOccludedObjects = 0; // frustum visible bounds hidden by the software occluders
+  uint32_t meshletsTested = 0;
+  uint32_t meshletsVisible = 0; // read back from the GPU, a few frames behind
+  float prepareMs = 0.0f; // CPU time of gatherBounds() and prepare(), the chunked passes over the renderables
 };
 
 class Renderer {
 public:
-  Renderer(RenderAPI*, AssetManager*);
+  Renderer(RenderAPI*, AssetManager*, JobSystem*);
   ~Renderer();
 
   bool beginFrame();
-  void shadowPass(Scene& scene);
-  void colorPass(Scene& scene, const Camera& camera);
+  // Builds the frame snapshot used by all passes, call once per frame after beginFrame
+  void extract(Scene& scene, const Camera& camera);
+  void shadowPass();
+  // Draws the camera view with the current shading mode
+  void colorPass();
   void endFrame();
   void onSceneCreated(Scene&);
 
   void terminate();
   TextureHandle getShadowMapTexture() const { return m_shadowMapTexture; }
+  const RenderStats& getStats() const { return m_stats; }
+  void setShadingMode(ShadingMode mode) { m_shadingMode = mode; }
+  ShadingMode getShadingMode() const { return m_shadingMode; }
+  // Each step up doubles the screen space error allowed for mesh LODs, negative values refine
+  void setLodBias(float bias) { m_lodBias = bias; }
+  float getLodBias() const { return m_lodBias; }
 
 private:
-  void prepare(Scene&);
+  // Renderables of the scene in view order, shared by gatherBounds() and prepare()
+  struct ExtractedRenderable {
+    entt::entity entity;
+    Renderable* renderable;
+    const WorldTransform* transform;
+    Skin* skin;
+    uint32_t firstBoundsIndex; // kInvalidBoundsIndex without Transform
+    uint32_t visibleFaceCount;
+  };
+
+  // kExtractChunkSize renderables processed by one job. Counts are filled in
+  // parallel, offsets are their prefix sums, so every chunk writes its own
+  // slice of the output without locks.
+  struct ExtractChunk {
+    uint32_t boundsOffset = 0;
+    uint32_t boundsCount = 0;
+    uint32_t renderDataOffset = 0;
+    uint32_t renderDataCount = 0;
+    std::vector<uint32_t> pendingDescriptorSets; // skinned renderables without a descriptor set yet
+    std::vector<uint32_t> dirtyObjectSlots;
+  };
+  static constexpr uint32_t kExtractChunkSize = 256;
+
+  // Calls fn(chunk, first, last) for every chunk of m_extracted in parallel
+  template<typename Fn>
+  void forEachExtractChunk(Fn&& fn);
+
+  // World bounds of every face of entities with a Transform, in view order
+  void gatherBounds(Scene&);
+  // Fills m_visibility for the gathered bounds
+  void cull(const Frustum&);
+  // Rasterizes the largest occluders on screen and clears the hidden bounds from m_cameraVisibility
+  void softwareOcclusionCull(const glm::mat4& viewProjection);
+  // visibility is indexed as gatherBounds() output, everything is prepared when it's not set
+  void prepare(Scene&, const std::vector<uint8_t>* visibility = nullptr);
+  // Coarsest level of the mesh whose error stays under the allowed screen error. screenScale is the
+  // fraction of the screen height covered by one unit of relative error.
+  uint8_t selectLod(const Mesh&, float screenScale, uint8_t currentLod) const;
+
+  // Renderer owned programs come in a variant per vertex format: bit 0 skinned, bit 1 quantized
+  static constexpr uint32_t kVertexVariantCount = 4;
+  static uint32_t vertexVariant(const RenderData& renderData) {
+    return (renderData.isSkinned ? 1u : 0u) | (renderData.isQuantized ? 2u : 0u);
+  }
+  // Gathers the lights of the scene and assigns them to the clusters of the camera
+  void prepareLights(Scene&, const Camera&);
+  // Grows a per view storage buffer to fit size bytes, rebinding it in every view descriptor set
+  void reserveViewStorageBuffer(BufferHandle& buffer, size_t& capacity, size_t size, PerViewDescriptorBindings binding);
+  // Fits cascades and decides which of them need to be rendered this frame
+  void prepareShadowCascades(Scene&, const Camera&);
+  bool isVisibleFromCamera(const RenderData&) const;
+  // Fills m_renderQueue with the camera visible renderables
+  void buildColorRenderQueue();
+  // Opaque items come first in the sorted queue, returns where the background starts
+  std::vector<RenderQueueItem>::const_iterator getBackgroundBegin() const;
+  // gbuffer draws with the G-buffer programs instead of the material ones
+  void drawColorItems(std::span<const RenderQueueItem> items, bool gbuffer, DepthMode depthMode = DepthMode::PROGRAM,
+    OcclusionDraws draws = OcclusionDraws::None);
+  // Depth only draws with the shadow programs, the color draws that follow test EQUAL against them
+  void drawDepthPrepass(std::span<const RenderQueueItem> items, OcclusionDraws draws = OcclusionDraws::None);
+  void updateOverdrawStats();
+  void forwardPass();
+  // Early draws, Hi-Z pyramid of their depth, late draws of what the pyramid doesn't occlude
+  void occlusionCulledForwardPass(std::span<const RenderQueueItem> opaqueItems, std::span<const RenderQueueItem> backgroundItems);
+  // (Re)creates the depth buffer and the Hi-Z pyramid when the swap chain extent changes
+  void prepareHiZ();
+  // Uploads the bounds of the opaque items, growing the culling buffers to fit them
+  void prepareOcclusionCullItems(std::span<const RenderQueueItem> opaqueItems);
+  void buildHiZ();
+  uint64_t getOcclusionCommandOffset(OcclusionDraws draws, uint32_t itemIndex) const;
+  // Culls the meshlets of the opaque items on the GPU, outside of a render pass
+  void cullMeshlets(std::span<const RenderQueueItem> opaqueItems);
+  // Direct or indirect draw of item itemIndex of the drawn span, depending on draws
+  void drawItem(const RenderData& renderData, uint32_t itemIndex, OcclusionDraws draws);
+  void deferredPass();
+  // (Re)creates the G-buffer attachments when the swap chain extent changes
+  void prepareGBuffer();
+  void sortRenderQueue();
+  // Grows the object buffer to fit every allocated slot
+  void reserveObjectSlots();
+  void uploadDirtyObjectSlots();
+  void onCreateRenderable(entt::registry& registry, entt::entity entity);
   void onDestroyRenderable(entt::registry& registry, entt::entity entity);
 
-  using PerObjectUniformBufferData = std::vector<PerObjectUniforms>;
+  using PerObjectBufferData = std::vector<PerObjectData>;
 
   asset_ptr<Texture> createWhiteTexture(AssetManager*);
   asset_ptr<Texture> createBlackTexture(AssetManager*);
   asset_ptr<Texture> createDefaultNormalTexture(AssetManager*);
   asset_ptr<Texture> createDefaultMetallicRoughnessTexture(AssetManager*);
 
-  PerObjectUniformBufferData m_perObjectUniformBufferData {32};
+  // CPU copy of the object buffer, indexed by Renderable::objectSlot
+  PerObjectBufferData m_perObjectBufferData;
+  std::vector<uint8_t> m_objectSlotDirty; // one per allocated slot, uploaded on the next prepare
+  std::vector<uint32_t> m_freeObjectSlots;
+  std::vector<uint32_t> m_dirtyObjectSlots;
+  static constexpr size_t kMinObjectSlots = 32;
+  static constexpr uint32_t kMaxObjectUploadGap = 4; // clean slots uploaded to merge two ranges
   PerViewUniforms m_perViewUniformBufferData {};
-  std::array<LightUniform, kLightUniformArraySize> m_lightUniformsBufferData {};
 
-  BufferHandle m_objectsUniformBufferHandle;
+  // Clustered lighting
+  std::vector<LightUniform> m_lightsBufferData;
+  std::vector<BoundingSphere> m_lightBounds; // view space, indexed as m_lightsBufferData
+  LightClusters m_lightClusters;
+  BufferHandle m_lightsBufferHandle;
+  BufferHandle m_clustersBufferHandle;
+  BufferHandle m_clusterLightIndicesBufferHandle;
+  size_t m_lightsBufferCapacity = 0;
+  size_t m_clusterLightIndicesBufferCapacity = 0;
+  static constexpr size_t kMinViewStorageBufferSize = 4096; // bytes
+
+  BufferHandle m_objectBufferHandle;
   BufferHandle m_viewUniformBufferHandle;
-  BufferHandle m_lightsUniformBufferHandle;
   DescriptorSetHandle m_viewDescriptorSet;
   DescriptorSetHandle m_objectDescriptorSet;
   DescriptorSetLayoutHandle m_viewDescriptorSetLayout;
@@ -185,16 +608,103 @@ private:
   std::vector<asset_ptr<Asset>> m_persistentAssets;
 
   // Shadow mapping
+  struct ShadowCascade {
+    glm::mat4 viewProjection {};
+    size_t contentKey = 0;
+    bool cached = false; // atlas depth stays valid while viewProjection and contentKey match
+    bool render = false;
+    BufferHandle viewUniformBuffer;
+    DescriptorSetHandle viewDescriptorSet;
+    std::vector<uint8_t> visibility; // casters, indexed as m_cullingBounds
+  };
+
   TextureHandle m_shadowMapTexture;
   RenderTargetHandle m_shadowMapRenderTarget;
-  asset_ptr<Shader> m_shadowShader;
-  asset_ptr<Shader> m_skinnedShadowShader;
-  static constexpr uint32_t kShadowMapSize = 1024;
+  std::array<asset_ptr<Shader>, kVertexVariantCount> m_shadowShaders; // indexed by vertexVariant()
+  std::array<ShadowCascade, kShadowCascadeCount> m_shadowCascades;
+  static constexpr uint32_t kShadowMapSize = 1024; // per cascade
+  static constexpr uint32_t kShadowAtlasSize = kShadowMapSize * kShadowAtlasGrid;
+  static constexpr float kShadowDistanceStep = 16.0f;
+  static constexpr float kShadowSplitLambda = 0.75f;
 
   BufferHandle m_dummyBonesBuffer;
 
+  // Deferred shading
+  ShadingMode m_shadingMode = ShadingMode::Forward;
+  std::array<asset_ptr<Shader>, kVertexVariantCount> m_gbufferShaders; // indexed by vertexVariant()
+  asset_ptr<Shader> m_deferredLightingShader;
+  TextureHandle m_gbufferBaseColorMetallic;
+  TextureHandle m_gbufferNormalRoughness;
+  TextureHandle m_gbufferDepth;
+  DescriptorSetHandle m_gbufferDescriptorSet;
+  vk::Extent2D m_gbufferExtent {};
+
+  // Hi-Z occlusion culling
+  asset_ptr<Shader> m_hizFromDepthShader;
+  asset_ptr<Shader> m_hizDownsampleShader;
+  asset_ptr<Shader> m_earlyOcclusionCullShader;
+  asset_ptr<Shader> m_lateOcclusionCullShader;
+  TextureHandle m_occlusionDepth; // depth of both forward phases, sampled to build the pyramid
+  TextureHandle m_hizTexture; // level 0 is half the depth resolution
+  std::vector<DescriptorSetHandle> m_hizDescriptorSets; // one per level
+  vk::Extent2D m_hizExtent {};
+  DescriptorSetHandle m_occlusionCullDescriptorSet;
+  BufferHandle m_occlusionUniformBuffer;
+  BufferHandle m_occlusionItemsBuffer;
+  BufferHandle m_occlusionCommandsBuffer; // Early, Late and Visible sections of m_occlusionItemsCapacity commands
+  BufferHandle m_objectVisibilityBuffer; // per object slot, carries the late phase result to the next frame
+  BufferHandle m_occlusionStatsBuffer;
+  uint32_t m_occlusionItemsCapacity = 0;
+  size_t m_objectVisibilityCapacity = 0;
+  uint32_t m_occlusionVisibleDraws = 0;
+  std::vector<OcclusionCullItem> m_occlusionItems;
+  static constexpr uint32_t kMinOcclusionItems = 256;
+  static constexpr uint32_t kOcclusionCommandSections = 3;
+  static constexpr uint32_t kOcclusionCullGroupSize = 64;
+  static constexpr uint32_t kHiZGroupSize = 8;
+
+  // Meshlet culling
+  asset_ptr<Shader> m_meshletCullShader;
+  DescriptorSetHandle m_meshletCullDescriptorSet;
+  BufferHandle m_meshletUniformBuffer;
+  BufferHandle m_meshletItemsBuffer;
+  BufferHandle m_meshletDrawsBuffer;
+  BufferHandle m_meshletCommandsBuffer; // a command per meshlet item
+  BufferHandle m_meshletDrawCountsBuffer; // per meshlet draw
+  BufferHandle m_meshletStatsBuffer;
+  uint32_t m_meshletItemsCapacity = 0;
+  uint32_t m_meshletDrawsCapacity = 0;
+  uint32_t m_meshletVisibleCount = 0;
+  std::vector<MeshletCullItem> m_meshletItems;
+  std::vector<MeshletCullDraw> m_meshletDraws;
+  std::vector<MeshletDrawRange> m_meshletDrawRanges; // per opaque item
+  static constexpr uint32_t kMinMeshletItems = 1024;
+  static constexpr uint32_t kMinMeshletDraws = 64;
+  static constexpr uint32_t kMeshletCullGroupSize = 64;
+
+  std::vector<ExtractedRenderable> m_extracted;
+  std::vector<ExtractChunk> m_extractChunks;
   std::vector<RenderData> m_renderData;
+  std::vector<RenderQueueItem> m_renderQueue;
+  std::vector<RenderQueueItem> m_renderQueueScratch;
+  CullingBounds m_cullingBounds;
+  std::vector<uint8_t> m_cullable;
+  std::vector<uint8_t> m_visibility;
+  std::vector<uint8_t> m_cameraVisibility;
+  SoftwareOcclusion m_softwareOcclusion;
+  std::vector<std::pair<float, uint32_t>> m_occluderCandidates; // (screen size, index into m_extracted)
+  static constexpr uint32_t kMaxSoftwareOccluders = 32;
+  static constexpr float kMinSoftwareOccluderSize = 0.1f; // bounding sphere radius over distance
+
+  // LOD selection
+  float m_lodBias = 0.0f;
+  static constexpr float kLodScreenError = 0.001f; // fraction of the screen height
+  static constexpr float kLodHysteresis = 0.25f;
+
+  Camera m_camera {};
+  RenderStats m_stats;
   RenderAPI* m_renderAPI;
+  JobSystem* m_jobSystem;
 };
 
 }
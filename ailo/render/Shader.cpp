@@ -117,6 +117,7 @@ ShaderDescription& Shader::getShadowShaderDescription() {
             .cullingMode = CullingMode::FRONT,
             .inverseFrontFace = true,
             .depthWriteEnable = true,
+            .colorWriteEnable = false,
             .depthCompareOp = CompareOp::LESS,
         },
         .layout = {
@@ -170,6 +171,7 @@ ShaderDescription& Shader::getSkinnedShadowShaderDescription() {
             .cullingMode = CullingMode::FRONT,
             .inverseFrontFace = true,
             .depthWriteEnable = true,
+            .colorWriteEnable = false,
             .depthCompareOp = CompareOp::LESS,
         },
         .layout = {
@@ -180,6 +182,173 @@ ShaderDescription& Shader::getSkinnedShadowShaderDescription() {
     return description;
 }
 
+ShaderDescription& Shader::getGBufferShaderDescription() {
+    static ShaderDescription shaderDescription {
+        .vertexShader = os::readFile("shaders/pbr.vert.spv"),
+        .fragmentShader = os::readFile("shaders/gbuffer.frag.spv"),
+        .raster = RasterDescription {
+            .cullingMode = CullingMode::FRONT,
+            .inverseFrontFace = true,
+            .depthWriteEnable = true,
+            .depthCompareOp = CompareOp::LESS,
+        },
+        .layout = {
+            DescriptorSetLayoutBindings::perView(),
+            DescriptorSetLayoutBindings::perObject(),
+            {
+                {
+                    .binding = 0,
+                    .descriptorType = vk::DescriptorType::eCombinedImageSampler,
+                    .stageFlags = vk::ShaderStageFlagBits::eFragment,
+                },
+                {
+                    .binding = 1,
+                    .descriptorType = vk::DescriptorType::eCombinedImageSampler,
+                    .stageFlags = vk::ShaderStageFlagBits::eFragment,
+                },
+                {
+                    .binding = 2,
+                    .descriptorType = vk::DescriptorType::eCombinedImageSampler,
+                    .stageFlags = vk::ShaderStageFlagBits::eFragment,
+                }
+            },
+        }
+    };
+    return shaderDescription;
+}
+
+ShaderDescription& Shader::getSkinnedGBufferShaderDescription() {
+    static ShaderDescription shaderDescription {
+        .vertexShader = os::readFile("shaders/pbr_skinned.vert.spv"),
+        .fragmentShader = os::readFile("shaders/gbuffer.frag.spv"),
+        .raster = RasterDescription {
+            .cullingMode = CullingMode::FRONT,
+            .inverseFrontFace = true,
+            .depthWriteEnable = true,
+            .depthCompareOp = CompareOp::LESS,
+        },
+        .layout = {
+            DescriptorSetLayoutBindings::perView(),
+            DescriptorSetLayoutBindings::perObject(),
+            {
+                {
+                    .binding = 0,
+                    .descriptorType = vk::DescriptorType::eCombinedImageSampler,
+                    .stageFlags = vk::ShaderStageFlagBits::eFragment,
+                },
+                {
+                    .binding = 1,
+                    .descriptorType = vk::DescriptorType::eCombinedImageSampler,
+                    .stageFlags = vk::ShaderStageFlagBits::eFragment,
+                },
+                {
+                    .binding = 2,
+                    .descriptorType = vk::DescriptorType::eCombinedImageSampler,
+                    .stageFlags = vk::ShaderStageFlagBits::eFragment,
+                }
+            },
+        }
+    };
+    return shaderDescription;
+}
+
+// The quantized variants only swap the vertex shader for one that decodes the packed attributes
+static ShaderDescription withVertexShader(const ShaderDescription& base, const char* path) {
+    ShaderDescription description = base;
+    description.vertexShader = os::readFile(path);
+    return description;
+}
+
+ShaderDescription& Shader::getQuantizedShaderDescription() {
+    static ShaderDescription description = withVertexShader(getDefaultShaderDescription(), "shaders/pbr_quantized.vert.spv");
+    return description;
+}
+
+ShaderDescription& Shader::getSkinnedQuantizedShaderDescription() {
+    static ShaderDescription description = withVertexShader(getSkinnedShaderDescription(), "shaders/pbr_skinned_quantized.vert.spv");
+    return description;
+}
+
+ShaderDescription& Shader::getQuantizedShadowShaderDescription() {
+    static ShaderDescription description = withVertexShader(getShadowShaderDescription(), "shaders/shadow_quantized.vert.spv");
+    return description;
+}
+
+ShaderDescription& Shader::getSkinnedQuantizedShadowShaderDescription() {
+    static ShaderDescription description = withVertexShader(getSkinnedShadowShaderDescription(), "shaders/shadow_skinned_quantized.vert.spv");
+    return description;
+}
+
+ShaderDescription& Shader::getQuantizedGBufferShaderDescription() {
+    static ShaderDescription description = withVertexShader(getGBufferShaderDescription(), "shaders/pbr_quantized.vert.spv");
+    return description;
+}
+
+ShaderDescription& Shader::getSkinnedQuantizedGBufferShaderDescription() {
+    static ShaderDescription description = withVertexShader(getSkinnedGBufferShaderDescription(), "shaders/pbr_skinned_quantized.vert.spv");
+    return description;
+}
+
+ShaderDescription& Shader::getDeferredLightingShaderDescription() {
+    static ShaderDescription description {
+        .vertexShader = os::readFile("shaders/deferred_lighting.vert.spv"),
+        .fragmentShader = os::readFile("shaders/deferred_lighting.frag.spv"),
+        .raster = RasterDescription {
+            .cullingMode = CullingMode::NONE,
+            .inverseFrontFace = false,
+            .depthWriteEnable = false,
+            .depthCompareOp = CompareOp::GREATER
+        },
+        .layout = {
+            DescriptorSetLayoutBindings::perView(),
+            DescriptorSetLayoutBindings::perObject(),
+            DescriptorSetLayoutBindings::gbufferInputs(),
+        }
+    };
+    return description;
+}
+
+ShaderDescription& Shader::getHiZFromDepthShaderDescription() {
+    static ShaderDescription description {
+        .computeShader = os::readFile("shaders/hiz_build_depth.comp.spv"),
+        .layout = { DescriptorSetLayoutBindings::hizBuild(true) }
+    };
+    return description;
+}
+
+ShaderDescription& Shader::getHiZDownsampleShaderDescription() {
+    static ShaderDescription description {
+        .computeShader = os::readFile("shaders/hiz_build.comp.spv"),
+        .layout = { DescriptorSetLayoutBindings::hizBuild(false) }
+    };
+    return description;
+}
+
+// Both phases share the layout, so one descriptor set serves them
+ShaderDescription& Shader::getEarlyOcclusionCullShaderDescription() {
+    static ShaderDescription description {
+        .computeShader = os::readFile("shaders/occlusion_cull.comp.spv"),
+        .layout = { DescriptorSetLayoutBindings::occlusionCull() }
+    };
+    return description;
+}
+
+ShaderDescription& Shader::getLateOcclusionCullShaderDescription() {
+    static ShaderDescription description {
+        .computeShader = os::readFile("shaders/occlusion_cull_late.comp.spv"),
+        .layout = { DescriptorSetLayoutBindings::occlusionCull() }
+    };
+    return description;
+}
+
+ShaderDescription& Shader::getMeshletCullShaderDescription() {
+    static ShaderDescription description {
+        .computeShader = os::readFile("shaders/meshlet_cull.comp.spv"),
+        .layout = { DescriptorSetLayoutBindings::meshletCull() }
+    };
+    return description;
+}
+
 asset_ptr<Shader> Shader::load(AssetManager* assetManager, RenderAPI* renderApi, const ShaderDescription& description) {
     return assetManager->emplace<Shader>(renderApi, description);
 }
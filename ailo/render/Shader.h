@@ -24,6 +24,20 @@ class Shader : public Asset {
     static ShaderDescription& getShadowShaderDescription();
     static ShaderDescription& getSkinnedShaderDescription();
     static ShaderDescription& getSkinnedShadowShaderDescription();
+    static ShaderDescription& getGBufferShaderDescription();
+    static ShaderDescription& getSkinnedGBufferShaderDescription();
+    static ShaderDescription& getQuantizedShaderDescription();
+    static ShaderDescription& getSkinnedQuantizedShaderDescription();
+    static ShaderDescription& getQuantizedShadowShaderDescription();
+    static ShaderDescription& getSkinnedQuantizedShadowShaderDescription();
+    static ShaderDescription& getQuantizedGBufferShaderDescription();
+    static ShaderDescription& getSkinnedQuantizedGBufferShaderDescription();
+    static ShaderDescription& getDeferredLightingShaderDescription();
+    static ShaderDescription& getHiZFromDepthShaderDescription();
+    static ShaderDescription& getHiZDownsampleShaderDescription();
+    static ShaderDescription& getEarlyOcclusionCullShaderDescription();
+    static ShaderDescription& getLateOcclusionCullShaderDescription();
+    static ShaderDescription& getMeshletCullShaderDescription();
 
     static asset_ptr<Shader> load(AssetManager* assetManager, RenderAPI*, const ShaderDescription&);
 
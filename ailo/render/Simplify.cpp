@@ -0,0 +1,236 @@
+#include "Simplify.h"
+
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <unordered_map>
+
+namespace ailo {
+
+namespace {
+
+// Symmetric 4x4 matrix of the plane equations, upper triangle
+struct Quadric {
+    std::array<double, 10> m {};
+
+    void addPlane(const glm::vec3& normal, float distance) {
+        const double a = normal.x, b = normal.y, c = normal.z, d = distance;
+        const double plane[10] = { a * a, a * b, a * c, a * d, b * b, b * c, b * d, c * c, c * d, d * d };
+        for (size_t i = 0; i < 10; i++) {
+            m[i] += plane[i];
+        }
+    }
+
+    void add(const Quadric& other) {
+        for (size_t i = 0; i < 10; i++) {
+            m[i] += other.m[i];
+        }
+    }
+
+    // Sum of the squared distances to the planes
+    [[nodiscard]] double error(const glm::vec3& p) const {
+        const double x = p.x, y = p.y, z = p.z;
+        return m[0] * x * x + 2.0 * m[1] * x * y + 2.0 * m[2] * x * z + 2.0 * m[3] * x
+             + m[4] * y * y + 2.0 * m[5] * y * z + 2.0 * m[6] * y
+             + m[7] * z * z + 2.0 * m[8] * z
+             + m[9];
+    }
+};
+
+struct Collapse {
+    uint32_t from;
+    uint32_t to;
+    double cost;
+};
+
+uint64_t edgeKey(uint32_t a, uint32_t b) {
+    return a < b ? (uint64_t(a) << 32 | b) : (uint64_t(b) << 32 | a);
+}
+
+}
+
+std::vector<uint16_t> simplifyMesh(
+    const float* positions, size_t stride, size_t vertexCount,
+    const std::vector<uint16_t>& indices, size_t targetIndexCount,
+    float maxError, float* error) {
+
+    auto position = [&](uint32_t v) {
+        const float* p = positions + v * stride;
+        return glm::vec3(p[0], p[1], p[2]);
+    };
+
+    // Vertices that only differ in attributes share a position id
+    std::vector<uint32_t> positionIds(vertexCount);
+    std::vector<uint32_t> positionVertexCounts;
+    {
+        struct Hash {
+            size_t operator()(const glm::vec3& p) const {
+                return std::hash<float>()(p.x) ^ std::hash<float>()(p.y) * 31 ^ std::hash<float>()(p.z) * 131;
+            }
+        };
+        struct Equal {
+            bool operator()(const glm::vec3& a, const glm::vec3& b) const { return a.x == b.x && a.y == b.y && a.z == b.z; }
+        };
+        std::unordered_map<glm::vec3, uint32_t, Hash, Equal> ids;
+        for (uint32_t v = 0; v < vertexCount; v++) {
+            auto [it, inserted] = ids.try_emplace(position(v), static_cast<uint32_t>(positionVertexCounts.size()));
+            if (inserted) {
+                positionVertexCounts.push_back(0);
+            }
+            positionIds[v] = it->second;
+            positionVertexCounts[it->second]++;
+        }
+    }
+
+    // Open borders and seams are locked, every edge of a closed surface is shared by two triangles
+    std::vector<uint8_t> locked(positionVertexCounts.size(), 0);
+    for (size_t p = 0; p < positionVertexCounts.size(); p++) {
+        locked[p] = positionVertexCounts[p] > 1 ? 1 : 0;
+    }
+    {
+        std::unordered_map<uint64_t, uint32_t> edgeTriangles;
+        for (size_t i = 0; i + 2 < indices.size(); i += 3) {
+            for (uint32_t e = 0; e < 3; e++) {
+                edgeTriangles[edgeKey(positionIds[indices[i + e]], positionIds[indices[i + (e + 1) % 3]])]++;
+            }
+        }
+        for (const auto& [key, count] : edgeTriangles) {
+            if (count != 2) {
+                locked[key >> 32] = 1;
+                locked[key & 0xffffffff] = 1;
+            }
+        }
+    }
+
+    std::vector<Quadric> quadrics(positionVertexCounts.size());
+    for (size_t i = 0; i + 2 < indices.size(); i += 3) {
+        glm::vec3 p0 = position(indices[i]);
+        glm::vec3 p1 = position(indices[i + 1]);
+        glm::vec3 p2 = position(indices[i + 2]);
+        glm::vec3 normal = glm::cross(p1 - p0, p2 - p0);
+        float length = glm::length(normal);
+        if (length == 0.0f) {
+            continue;
+        }
+        normal = normal / length;
+        for (uint32_t k = 0; k < 3; k++) {
+            quadrics[positionIds[indices[i + k]]].addPlane(normal, -glm::dot(normal, p0));
+        }
+    }
+
+    std::vector<uint16_t> result = indices;
+    std::vector<std::vector<uint32_t>> vertexTriangles(vertexCount);
+    std::vector<Collapse> collapses;
+    std::vector<uint8_t> touched(vertexCount);
+    std::vector<uint32_t> remap(vertexCount);
+    const double maxCost = double(maxError) * double(maxError);
+    double largestCost = 0.0;
+
+    // Every pass collapses independent edges in order of cost, then rebuilds the index list
+    while (result.size() > targetIndexCount) {
+        for (auto& triangles : vertexTriangles) {
+            triangles.clear();
+        }
+        collapses.clear();
+        for (uint32_t t = 0; t + 2 < result.size(); t += 3) {
+            for (uint32_t e = 0; e < 3; e++) {
+                uint32_t a = result[t + e];
+                uint32_t b = result[t + (e + 1) % 3];
+                vertexTriangles[a].push_back(t);
+
+                // both directions of an edge show up in its two triangles
+                uint32_t pa = positionIds[a];
+                uint32_t pb = positionIds[b];
+                if (!locked[pa] && pa != pb) {
+                    Quadric q = quadrics[pa];
+                    q.add(quadrics[pb]);
+                    collapses.push_back({ a, b, std::max(q.error(position(b)), 0.0) });
+                }
+            }
+        }
+        std::sort(collapses.begin(), collapses.end(), [](const Collapse& x, const Collapse& y) { return x.cost < y.cost; });
+
+        std::fill(touched.begin(), touched.end(), 0);
+        for (uint32_t v = 0; v < vertexCount; v++) {
+            remap[v] = v;
+        }
+
+        size_t indexCount = result.size();
+        bool collapsed = false;
+        for (const Collapse& collapse : collapses) {
+            if (collapse.cost > maxCost || indexCount <= targetIndexCount) {
+                break;
+            }
+            if (touched[collapse.from] || touched[collapse.to]) {
+                continue;
+            }
+
+            // Triangles around the removed vertex must not flip or degenerate
+            const glm::vec3 target = position(collapse.to);
+            uint32_t removedTriangles = 0;
+            bool flips = false;
+            for (uint32_t t : vertexTriangles[collapse.from]) {
+                uint32_t k = result[t] == collapse.from ? 0 : (result[t + 1] == collapse.from ? 1 : 2);
+                uint32_t v1 = result[t + (k + 1) % 3];
+                uint32_t v2 = result[t + (k + 2) % 3];
+                if (positionIds[v1] == positionIds[collapse.to] || positionIds[v2] == positionIds[collapse.to]) {
+                    removedTriangles++;
+                    continue;
+                }
+                glm::vec3 p1 = position(v1);
+                glm::vec3 p2 = position(v2);
+                glm::vec3 before = glm::cross(p1 - position(collapse.from), p2 - position(collapse.from));
+                glm::vec3 after = glm::cross(p1 - target, p2 - target);
+                if (glm::dot(before, after) <= 0.25f * glm::length(before) * glm::length(after)) {
+                    flips = true;
+                    break;
+                }
+            }
+            if (flips) {
+                continue;
+            }
+
+            // the one ring of the removed vertex changes, keep it out of this pass
+            for (uint32_t t : vertexTriangles[collapse.from]) {
+                touched[result[t]] = 1;
+                touched[result[t + 1]] = 1;
+                touched[result[t + 2]] = 1;
+            }
+            touched[collapse.to] = 1;
+
+            remap[collapse.from] = collapse.to;
+            quadrics[positionIds[collapse.to]].add(quadrics[positionIds[collapse.from]]);
+            largestCost = std::max(largestCost, collapse.cost);
+            indexCount -= removedTriangles * 3;
+            collapsed = true;
+        }
+
+        if (!collapsed) {
+            break;
+        }
+
+        size_t count = 0;
+        for (size_t i = 0; i + 2 < result.size(); i += 3) {
+            uint32_t v0 = remap[result[i]];
+            uint32_t v1 = remap[result[i + 1]];
+            uint32_t v2 = remap[result[i + 2]];
+            uint32_t p0 = positionIds[v0], p1 = positionIds[v1], p2 = positionIds[v2];
+            if (p0 == p1 || p1 == p2 || p2 == p0) {
+                continue;
+            }
+            result[count++] = static_cast<uint16_t>(v0);
+            result[count++] = static_cast<uint16_t>(v1);
+            result[count++] = static_cast<uint16_t>(v2);
+        }
+        result.resize(count);
+    }
+
+    if (error) {
+        *error = static_cast<float>(std::sqrt(largestCost));
+    }
+    return result;
+}
+
+}
@@ -0,0 +1,19 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace ailo {
+
+// Quadric error metric edge collapse. A vertex is collapsed onto a neighbour and never
+// moved, so the result indexes the same vertex buffer. Vertices on open borders and
+// attribute seams (several vertices at one position) stay in place to keep the mesh closed.
+// Stops once the index count drops to targetIndexCount or the next collapse would move the
+// surface further than maxError. error receives the largest error introduced, in position units.
+std::vector<uint16_t> simplifyMesh(
+    const float* positions, size_t stride, size_t vertexCount,
+    const std::vector<uint16_t>& indices, size_t targetIndexCount,
+    float maxError, float* error = nullptr);
+
+}
@@ -0,0 +1,358 @@
+#include "SoftwareOcclusion.h"
+
+#include "common/JobSystem.h"
+
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <limits>
+#include <unordered_map>
+#include <utility>
+
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#define AILO_OCCLUSION_SSE 1
+#include <xmmintrin.h>
+#endif
+
+namespace ailo {
+
+namespace {
+
+constexpr uint32_t kOccludersPerJob = 4;
+constexpr uint32_t kBoundsPerJob = 256;
+
+// A box counts as hidden only when the occluders are nearer by more than this fraction of its distance
+constexpr float kDepthBias = 1e-3f;
+
+// Twice the screen area, in pixels, below which a triangle is dropped as degenerate
+constexpr float kMinTriangleArea = 1e-6f;
+
+// Clips a triangle against the near plane (z >= 0), returns the vertex count of the polygon
+uint32_t clipNear(const glm::vec4 (&in)[3], glm::vec4 (&out)[4]) {
+    uint32_t count = 0;
+    for (uint32_t i = 0; i < 3; i++) {
+        const glm::vec4& a = in[i];
+        const glm::vec4& b = in[(i + 1) % 3];
+        if (a.z >= 0.0f) {
+            out[count++] = a;
+        }
+        if ((a.z >= 0.0f) != (b.z >= 0.0f)) {
+            float t = a.z / (a.z - b.z);
+            out[count++] = a + (b - a) * t;
+        }
+    }
+    return count;
+}
+
+// xy in pixels, z is 1 / w
+glm::vec3 toScreen(const glm::vec4& clip) {
+    float invW = 1.0f / clip.w;
+    return {
+        (clip.x * invW * 0.5f + 0.5f) * float(SoftwareOcclusion::kWidth),
+        (clip.y * invW * 0.5f + 0.5f) * float(SoftwareOcclusion::kHeight),
+        invW
+    };
+}
+
+}
+
+OccluderMesh simplifyOccluder(const float* positions, size_t stride, const uint16_t* indices, size_t indexCount, uint32_t maxTriangles) {
+    auto position = [&](uint16_t vertex) {
+        const float* p = positions + vertex * stride;
+        return glm::vec3(p[0], p[1], p[2]);
+    };
+
+    // twice the area of every triangle, degenerate ones can't hide anything
+    std::vector<std::pair<float, size_t>> triangles;
+    triangles.reserve(indexCount / 3);
+    for (size_t i = 0; i + 2 < indexCount; i += 3) {
+        glm::vec3 a = position(indices[i]);
+        float area = glm::length(glm::cross(position(indices[i + 1]) - a, position(indices[i + 2]) - a));
+        if (area > 0.0f) {
+            triangles.emplace_back(area, i);
+        }
+    }
+    if (triangles.size() > maxTriangles) {
+        std::nth_element(triangles.begin(), triangles.begin() + maxTriangles, triangles.end(), std::greater<>());
+        triangles.resize(maxTriangles);
+    }
+    // back in source order, which keeps the shared vertices close
+    std::sort(triangles.begin(), triangles.end(), [](const auto& a, const auto& b) { return a.second < b.second; });
+
+    OccluderMesh occluder;
+    std::unordered_map<uint16_t, uint16_t> vertices;
+    occluder.indices.reserve(triangles.size() * 3);
+    for (const auto& [area, first] : triangles) {
+        for (size_t k = 0; k < 3; k++) {
+            auto [it, inserted] = vertices.try_emplace(indices[first + k], static_cast<uint16_t>(occluder.positions.size()));
+            if (inserted) {
+                occluder.positions.push_back(position(indices[first + k]));
+            }
+            occluder.indices.push_back(it->second);
+        }
+    }
+    return occluder;
+}
+
+void SoftwareOcclusion::begin(const glm::mat4& viewProjection) {
+    m_viewProjection = viewProjection;
+    m_occluders.clear();
+}
+
+void SoftwareOcclusion::addOccluder(const OccluderMesh& mesh, const glm::mat4& model) {
+    if (!mesh.isEmpty()) {
+        m_occluders.push_back({ &mesh, m_viewProjection * model });
+    }
+}
+
+void SoftwareOcclusion::setupTriangles(const Occluder& occluder, std::vector<Triangle>& triangles) {
+    triangles.clear();
+
+    const OccluderMesh& mesh = *occluder.mesh;
+    for (size_t i = 0; i + 2 < mesh.indices.size(); i += 3) {
+        glm::vec4 clip[3];
+        for (uint32_t k = 0; k < 3; k++) {
+            clip[k] = occluder.modelViewProjection * glm::vec4(mesh.positions[mesh.indices[i + k]], 1.0f);
+        }
+
+        glm::vec4 polygon[4];
+        uint32_t polygonSize = clipNear(clip, polygon);
+        if (polygonSize < 3) {
+            continue;
+        }
+
+        glm::vec3 screen[4];
+        for (uint32_t k = 0; k < polygonSize; k++) {
+            screen[k] = toScreen(polygon[k]);
+        }
+
+        // a clipped quad is drawn as a fan
+        for (uint32_t k = 1; k + 1 < polygonSize; k++) {
+            const glm::vec3& v0 = screen[0];
+            const glm::vec3& v1 = screen[k];
+            const glm::vec3& v2 = screen[k + 1];
+
+            float area = (v1.x - v0.x) * (v2.y - v0.y) - (v2.x - v0.x) * (v1.y - v0.y);
+            if (std::abs(area) < kMinTriangleArea) {
+                continue;
+            }
+
+            float minX = std::min({ v0.x, v1.x, v2.x });
+            float minY = std::min({ v0.y, v1.y, v2.y });
+            float maxX = std::max({ v0.x, v1.x, v2.x });
+            float maxY = std::max({ v0.y, v1.y, v2.y });
+
+            Triangle triangle {};
+            triangle.minX = std::max(static_cast<int32_t>(std::ceil(minX - 0.5f)), 0);
+            triangle.minY = std::max(static_cast<int32_t>(std::ceil(minY - 0.5f)), 0);
+            triangle.maxX = std::min(static_cast<int32_t>(std::floor(maxX - 0.5f)), int32_t(kWidth) - 1);
+            triangle.maxY = std::min(static_cast<int32_t>(std::floor(maxY - 0.5f)), int32_t(kHeight) - 1);
+            if (triangle.minX > triangle.maxX || triangle.minY > triangle.maxY) {
+                continue;
+            }
+
+            // edge i is opposite to vertex i, both windings are drawn
+            const glm::vec3* v[3] = { &v0, &v1, &v2 };
+            float sign = area > 0.0f ? 1.0f : -1.0f;
+            for (uint32_t e = 0; e < 3; e++) {
+                const glm::vec3& a = *v[(e + 1) % 3];
+                const glm::vec3& b = *v[(e + 2) % 3];
+                triangle.edgeA[e] = sign * (a.y - b.y);
+                triangle.edgeB[e] = sign * (b.x - a.x);
+                triangle.edgeC[e] = sign * (a.x * b.y - b.x * a.y);
+            }
+
+            // barycentrics are the edge functions over the area
+            float invArea = 1.0f / std::abs(area);
+            triangle.depthA = (triangle.edgeA[0] * v0.z + triangle.edgeA[1] * v1.z + triangle.edgeA[2] * v2.z) * invArea;
+            triangle.depthB = (triangle.edgeB[0] * v0.z + triangle.edgeB[1] * v1.z + triangle.edgeB[2] * v2.z) * invArea;
+            triangle.depthC = (triangle.edgeC[0] * v0.z + triangle.edgeC[1] * v1.z + triangle.edgeC[2] * v2.z) * invArea;
+            triangles.push_back(triangle);
+        }
+    }
+}
+
+void SoftwareOcclusion::rasterize(JobSystem& jobSystem) {
+    m_occluderTriangles.resize(std::max(m_occluderTriangles.size(), m_occluders.size()));
+    jobSystem.parallelFor(0, static_cast<uint32_t>(m_occluders.size()), kOccludersPerJob, [this](uint32_t first, uint32_t last) {
+        for (uint32_t i = first; i < last; i++) {
+            setupTriangles(m_occluders[i], m_occluderTriangles[i]);
+        }
+    });
+
+    m_triangles.clear();
+    m_tileTriangles.resize(kTilesX * kTilesY);
+    for (auto& tile : m_tileTriangles) {
+        tile.clear();
+    }
+    for (size_t i = 0; i < m_occluders.size(); i++) {
+        for (const Triangle& triangle : m_occluderTriangles[i]) {
+            auto index = static_cast<uint32_t>(m_triangles.size());
+            m_triangles.push_back(triangle);
+            for (int32_t y = triangle.minY / int32_t(kTileHeight); y <= triangle.maxY / int32_t(kTileHeight); y++) {
+                for (int32_t x = triangle.minX / int32_t(kTileWidth); x <= triangle.maxX / int32_t(kTileWidth); x++) {
+                    m_tileTriangles[x + y * kTilesX].push_back(index);
+                }
+            }
+        }
+    }
+
+    m_depth.assign(kWidth * kHeight, 0.0f);
+    m_blockDepth.resize(kBlocksX * kBlocksY);
+    jobSystem.parallelFor(0, kTilesX * kTilesY, 1, [this](uint32_t first, uint32_t last) {
+        for (uint32_t tile = first; tile < last; tile++) {
+            rasterizeTile(tile);
+        }
+    });
+}
+
+void SoftwareOcclusion::rasterizeTile(uint32_t tile) {
+    const int32_t tileMinX = int32_t(tile % kTilesX * kTileWidth);
+    const int32_t tileMinY = int32_t(tile / kTilesX * kTileHeight);
+    const int32_t tileMaxX = tileMinX + int32_t(kTileWidth) - 1;
+    const int32_t tileMaxY = tileMinY + int32_t(kTileHeight) - 1;
+
+    for (uint32_t index : m_tileTriangles[tile]) {
+        const Triangle& t = m_triangles[index];
+        // the tile width is a multiple of 4, so aligned groups never leave the tile
+        const int32_t minX = std::max(t.minX, tileMinX) & ~3;
+        const int32_t maxX = std::min(t.maxX, tileMaxX);
+        const int32_t minY = std::max(t.minY, tileMinY);
+        const int32_t maxY = std::min(t.maxY, tileMaxY);
+
+        for (int32_t y = minY; y <= maxY; y++) {
+            float py = float(y) + 0.5f;
+            float* row = m_depth.data() + y * kWidth;
+            int32_t x = minX;
+#if AILO_OCCLUSION_SSE
+            float rowE0 = t.edgeB[0] * py + t.edgeC[0];
+            float rowE1 = t.edgeB[1] * py + t.edgeC[1];
+            float rowE2 = t.edgeB[2] * py + t.edgeC[2];
+            float rowZ = t.depthB * py + t.depthC;
+            const __m128 laneOffsets = _mm_setr_ps(0.5f, 1.5f, 2.5f, 3.5f);
+            const __m128 zero = _mm_setzero_ps();
+            for (; x <= maxX; x += 4) {
+                __m128 px = _mm_add_ps(_mm_set1_ps(float(x)), laneOffsets);
+                __m128 e0 = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(t.edgeA[0]), px), _mm_set1_ps(rowE0));
+                __m128 e1 = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(t.edgeA[1]), px), _mm_set1_ps(rowE1));
+                __m128 e2 = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(t.edgeA[2]), px), _mm_set1_ps(rowE2));
+                __m128 inside = _mm_and_ps(_mm_and_ps(_mm_cmpge_ps(e0, zero), _mm_cmpge_ps(e1, zero)), _mm_cmpge_ps(e2, zero));
+                if (_mm_movemask_ps(inside) == 0) {
+                    continue;
+                }
+
+                __m128 z = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(t.depthA), px), _mm_set1_ps(rowZ));
+                __m128 depth = _mm_loadu_ps(row + x);
+                __m128 nearest = _mm_max_ps(depth, z);
+                _mm_storeu_ps(row + x, _mm_or_ps(_mm_and_ps(inside, nearest), _mm_andnot_ps(inside, depth)));
+            }
+#endif
+            for (; x <= maxX; x++) {
+                float px = float(x) + 0.5f;
+                bool inside = true;
+                for (uint32_t e = 0; e < 3; e++) {
+                    inside &= t.edgeA[e] * px + t.edgeB[e] * py + t.edgeC[e] >= 0.0f;
+                }
+                if (inside) {
+                    row[x] = std::max(row[x], t.depthA * px + t.depthB * py + t.depthC);
+                }
+            }
+        }
+    }
+
+    for (int32_t blockY = tileMinY / int32_t(kBlockSize); blockY <= tileMaxY / int32_t(kBlockSize); blockY++) {
+        for (int32_t blockX = tileMinX / int32_t(kBlockSize); blockX <= tileMaxX / int32_t(kBlockSize); blockX++) {
+            float farthest = std::numeric_limits<float>::max();
+            for (int32_t y = blockY * int32_t(kBlockSize); y < (blockY + 1) * int32_t(kBlockSize); y++) {
+                const float* row = m_depth.data() + y * kWidth + blockX * kBlockSize;
+                farthest = std::min(farthest, *std::min_element(row, row + kBlockSize));
+            }
+            m_blockDepth[blockX + blockY * kBlocksX] = farthest;
+        }
+    }
+}
+
+bool SoftwareOcclusion::isOccluded(const Aabb& worldBounds) const {
+    if (m_triangles.empty()) {
+        return false;
+    }
+
+    glm::vec3 screenMin { std::numeric_limits<float>::max() };
+    glm::vec3 screenMax { std::numeric_limits<float>::lowest() };
+    for (uint32_t i = 0; i < 8; i++) {
+        glm::vec3 corner {
+            (i & 1) ? worldBounds.max.x : worldBounds.min.x,
+            (i & 2) ? worldBounds.max.y : worldBounds.min.y,
+            (i & 4) ? worldBounds.max.z : worldBounds.min.z
+        };
+        glm::vec4 clip = m_viewProjection * glm::vec4(corner, 1.0f);
+        // crosses the near plane, the camera may be inside
+        if (clip.z < 0.0f) {
+            return false;
+        }
+        glm::vec3 screen = toScreen(clip);
+        screenMin = glm::min(screenMin, screen);
+        screenMax = glm::max(screenMax, screen);
+    }
+
+    // every pixel the box touches, not only the covered centers
+    const int32_t minX = std::max(static_cast<int32_t>(std::floor(screenMin.x)), 0);
+    const int32_t minY = std::max(static_cast<int32_t>(std::floor(screenMin.y)), 0);
+    const int32_t maxX = std::min(static_cast<int32_t>(std::floor(screenMax.x)), int32_t(kWidth) - 1);
+    const int32_t maxY = std::min(static_cast<int32_t>(std::floor(screenMax.y)), int32_t(kHeight) - 1);
+    if (minX > maxX || minY > maxY) {
+        return false;
+    }
+
+    // hidden when the occluders are nearer than the nearest point of the box at every pixel
+    const float boxDepth = screenMax.z * (1.0f + kDepthBias);
+
+    // the farthest depth of the blocks settles most of the hidden boxes
+    bool blocksHide = true;
+    for (int32_t y = minY / int32_t(kBlockSize); blocksHide && y <= maxY / int32_t(kBlockSize); y++) {
+        for (int32_t x = minX / int32_t(kBlockSize); x <= maxX / int32_t(kBlockSize); x++) {
+            if (m_blockDepth[x + y * kBlocksX] <= boxDepth) {
+                blocksHide = false;
+                break;
+            }
+        }
+    }
+    if (blocksHide) {
+        return true;
+    }
+
+    for (int32_t y = minY; y <= maxY; y++) {
+        const float* row = m_depth.data() + y * kWidth;
+        int32_t x = minX;
+#if AILO_OCCLUSION_SSE
+        const __m128 depth = _mm_set1_ps(boxDepth);
+        for (; x + 3 <= maxX; x += 4) {
+            if (_mm_movemask_ps(_mm_cmple_ps(_mm_loadu_ps(row + x), depth)) != 0) {
+                return false;
+            }
+        }
+#endif
+        for (; x <= maxX; x++) {
+            if (row[x] <= boxDepth) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+void SoftwareOcclusion::cull(const CullingBounds& bounds, std::vector<uint8_t>& visibility, JobSystem& jobSystem) const {
+    if (m_triangles.empty()) {
+        return;
+    }
+
+    jobSystem.parallelFor(0, static_cast<uint32_t>(bounds.size()), kBoundsPerJob, [&](uint32_t first, uint32_t last) {
+        for (uint32_t i = first; i < last; i++) {
+            if (visibility[i] && isOccluded(bounds.get(i))) {
+                visibility[i] = 0;
+            }
+        }
+    });
+}
+
+}
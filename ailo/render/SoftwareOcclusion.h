@@ -0,0 +1,92 @@
+#pragma once
+
+#include "Culling.h"
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <vector>
+
+namespace ailo {
+
+class JobSystem;
+
+// Reduced copy of a mesh that is rasterized by SoftwareOcclusion
+struct OccluderMesh {
+    std::vector<glm::vec3> positions;
+    std::vector<uint16_t> indices;
+
+    [[nodiscard]] bool isEmpty() const { return indices.empty(); }
+};
+
+// The largest maxTriangles triangles of the mesh, unchanged. Occluders must not cover
+// anything the mesh doesn't, so the mesh is only thinned out: moving vertices, as
+// clustering or edge collapses do, can fill a concave part or a hole in front of what
+// is seen through it.
+OccluderMesh simplifyOccluder(const float* positions, size_t stride, const uint16_t* indices, size_t indexCount, uint32_t maxTriangles = 512);
+
+// CPU occlusion culling against a low resolution depth buffer of the occluders.
+// Occluder triangles are binned into screen tiles, tiles are rasterized in parallel
+// 4 pixels at a time. Depth is stored as 1 / w, which is linear in screen space and
+// doesn't lose precision far from the near plane, so the nearest is the largest.
+class SoftwareOcclusion {
+public:
+    static constexpr uint32_t kWidth = 320;
+    static constexpr uint32_t kHeight = 192;
+    static constexpr uint32_t kTileWidth = 64;
+    static constexpr uint32_t kTileHeight = 32;
+    static constexpr uint32_t kTilesX = kWidth / kTileWidth;
+    static constexpr uint32_t kTilesY = kHeight / kTileHeight;
+    static constexpr uint32_t kBlockSize = 8;
+    static constexpr uint32_t kBlocksX = kWidth / kBlockSize;
+    static constexpr uint32_t kBlocksY = kHeight / kBlockSize;
+
+    // Clears the occluders of the previous frame
+    void begin(const glm::mat4& viewProjection);
+    // mesh is referenced until rasterize() returns
+    void addOccluder(const OccluderMesh& mesh, const glm::mat4& model);
+    void rasterize(JobSystem& jobSystem);
+
+    // Writes 0 to visibility[i] when box i is hidden behind the occluders, boxes with 0 aren't tested
+    void cull(const CullingBounds& bounds, std::vector<uint8_t>& visibility, JobSystem& jobSystem) const;
+    [[nodiscard]] bool isOccluded(const Aabb& worldBounds) const;
+
+    [[nodiscard]] uint32_t getOccluderCount() const { return static_cast<uint32_t>(m_occluders.size()); }
+    // Rasterized triangles, after near plane clipping
+    [[nodiscard]] uint32_t getTriangleCount() const { return static_cast<uint32_t>(m_triangles.size()); }
+    // kWidth * kHeight, row major, 0 where nothing was drawn
+    [[nodiscard]] const std::vector<float>& getDepth() const { return m_depth; }
+
+private:
+    struct Occluder {
+        const OccluderMesh* mesh;
+        glm::mat4 modelViewProjection;
+    };
+
+    // Screen space setup, the pixel at (x, y) is sampled at its center (x + 0.5, y + 0.5)
+    struct Triangle {
+        float edgeA[3]; // edge i: a * x + b * y + c >= 0 inside
+        float edgeB[3];
+        float edgeC[3];
+        float depthA; // 1 / w = a * x + b * y + c
+        float depthB;
+        float depthC;
+        int32_t minX; // inclusive pixel bounds, inside the buffer
+        int32_t minY;
+        int32_t maxX;
+        int32_t maxY;
+    };
+
+    static void setupTriangles(const Occluder& occluder, std::vector<Triangle>& triangles);
+    void rasterizeTile(uint32_t tile);
+
+    glm::mat4 m_viewProjection { 1.0f };
+    std::vector<Occluder> m_occluders;
+    std::vector<std::vector<Triangle>> m_occluderTriangles; // per occluder, filled in parallel
+    std::vector<Triangle> m_triangles;
+    std::vector<std::vector<uint32_t>> m_tileTriangles; // indices into m_triangles
+    std::vector<float> m_depth;
+    std::vector<float> m_blockDepth; // farthest depth of every kBlockSize square
+};
+
+}
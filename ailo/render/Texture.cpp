@@ -1,8 +1,14 @@
 #include "Texture.h"
 
+#include <array>
+#include <exception>
 #include <filesystem>
+#include <utility>
 
 #include "Engine.h"
+#include "Ktx2.h"
+#include "OS.h"
+#include "common/JobSystem.h"
 
 #include <iostream>
 #include <ostream>
@@ -15,6 +21,27 @@ Texture::Texture(RenderAPI* renderApi, TextureType type, vk::Format format, Text
     : m_handle(renderApi->createTexture(type, format, usage, width, height, levels)), m_levels(levels), m_renderApi(renderApi) {
 }
 
+Texture::Texture(asset_ptr<Texture> placeholder)
+    : m_levels(placeholder->m_levels), m_renderApi(placeholder->m_renderApi), m_placeholder(std::move(placeholder)) {
+}
+
+Texture::Texture(Texture&& other) noexcept
+    : Asset(std::move(other)), m_handle(std::exchange(other.m_handle, {})), m_levels(other.m_levels),
+      m_renderApi(other.m_renderApi), m_placeholder(std::move(other.m_placeholder)) {
+}
+
+Texture& Texture::operator=(Texture&& other) noexcept {
+    if (this != &other) {
+        release();
+        Asset::operator=(std::move(other));
+        m_handle = std::exchange(other.m_handle, {});
+        m_levels = other.m_levels;
+        m_renderApi = other.m_renderApi;
+        m_placeholder = std::move(other.m_placeholder);
+    }
+    return *this;
+}
+
 Texture::~Texture() {
     release();
 }
@@ -36,7 +63,55 @@ void Texture::release() {
     m_renderApi->destroyTexture(m_handle);
 }
 
+static uint32_t mipLevelCount(uint32_t width, uint32_t height) {
+    return static_cast<uint32_t>(std::floor(std::log2(std::max(width, height)))) + 1;
+}
+
 void Texture::load(LoadContext<Texture>& ctx, RenderAPI* renderApi, const std::string& key, bool mipmaps) {
+    create(ctx, renderApi, decode(key, renderApi->isTextureCompressionBCSupported()), mipmaps);
+}
+
+static Texture::Image decodeFile(const std::string& path, bool isHdr, vk::Format format) {
+    Texture::Image image;
+    image.format = format;
+
+    int texWidth, texHeight, texChannels;
+    int desiredChannels = STBI_rgb_alpha;
+    if (!isHdr) {
+        image.pixels.reset(stbi_load(path.c_str(), &texWidth, &texHeight, &texChannels, desiredChannels), stbi_image_free);
+    } else {
+        image.pixels.reset(stbi_loadf(path.c_str(), &texWidth, &texHeight, &texChannels, desiredChannels), stbi_image_free);
+    }
+    if (!image.pixels) {
+        std::cerr << "Failed to load texture image at '" << path << "'! Reason " << stbi_failure_reason() << std::endl;
+        throw std::runtime_error("failed to load texture image!");
+    }
+
+    image.width = texWidth;
+    image.height = texHeight;
+    image.size = size_t(texWidth) * texHeight * desiredChannels * (isHdr ? sizeof(float) : sizeof(uint8_t));
+    return image;
+}
+
+// The levels point into the mapping, which the image keeps alive
+static Texture::Image decodeKtx2(const std::string& path) {
+    auto file = std::make_shared<os::MappedFile>(path);
+    const Ktx2Image ktx = parseKtx2(file->getData());
+
+    Texture::Image image;
+    image.width = ktx.width;
+    image.height = ktx.height;
+    image.format = static_cast<vk::Format>(ktx.format);
+    for (uint32_t level = 0; level < ktx.levels.size(); level++) {
+        const auto offset = static_cast<size_t>(ktx.levels[level].data() - file->getData().data());
+        image.levels.push_back({ offset, ktx.levels[level].size(), std::max(ktx.width >> level, 1u), std::max(ktx.height >> level, 1u) });
+        image.size += ktx.levels[level].size();
+    }
+    image.pixels = std::shared_ptr<const void>(file, file->getData().data());
+    return image;
+}
+
+Texture::Image Texture::decode(const std::string& key, bool allowCompressed) {
     std::set<std::string> tags;
     auto first = key.find_first_of('@');
     if (first != std::string::npos) {
@@ -49,48 +124,64 @@ void Texture::load(LoadContext<Texture>& ctx, RenderAPI* renderApi, const std::s
     }
 
     auto path = key.substr(0, first);
+    if (isKtx2File(path)) {
+        return decodeKtx2(path);
+    }
+    if (allowCompressed) {
+        auto compressedPath = std::filesystem::path(path).replace_extension(kKtx2Extension);
+        if (std::filesystem::exists(compressedPath)) {
+            return decodeKtx2(compressedPath.string());
+        }
+    }
+
     bool isHdr = stbi_is_hdr(path.c_str());
 
     vk::Format format = isHdr ? vk::Format::eR32G32B32A32Sfloat : vk::Format::eR8G8B8A8Srgb;
     if (tags.contains("norm")) {
         format = vk::Format::eR8G8B8A8Unorm;
     }
+    return decodeFile(path, isHdr, format);
+}
 
-    Texture* tex;
-    if (!isHdr) {
-        // Load texture
-        int texWidth, texHeight, texChannels;
-        int desiredChannels = STBI_rgb_alpha;
-
-        stbi_uc* pixels = stbi_load(path.c_str(), &texWidth, &texHeight, &texChannels, desiredChannels);
-        if (!pixels) {
-            std::cerr << "Failed to load texture image at '" << path << "'! Reason " << stbi_failure_reason() << std::endl;
-            throw std::runtime_error("failed to load texture image!");
-        }
+Texture::Image Texture::decode(const void* data, size_t dataSize, vk::Format format) {
+    int texChannels;
+    int texWidth, texHeight;
+    int desiredChannels = STBI_rgb_alpha;
 
-        uint32_t mipLevels = static_cast<uint32_t>(std::floor(std::log2(std::max(texWidth, texHeight)))) + 1;
-        tex = &ctx.construct(renderApi, TextureType::TEXTURE_2D, format, TextureUsage::Sampled, texWidth, texHeight, mipmaps ? mipLevels : 1);
-        tex->updateImage(renderApi, pixels, texWidth * texHeight * desiredChannels);
-        stbi_image_free(pixels);
+    Image image;
+    image.pixels.reset(stbi_load_from_memory(static_cast<stbi_uc const*>(data), static_cast<int>(dataSize), &texWidth, &texHeight, &texChannels, desiredChannels), stbi_image_free);
+    if (!image.pixels) {
+        std::cerr << "Failed to decode embedded texture! Reason " << stbi_failure_reason() << std::endl;
+        throw std::runtime_error("failed to decode embedded texture!");
+    }
 
-    } else {
-        int texWidth, texHeight, texChannels;
-        int desiredChannels = STBI_rgb_alpha;
+    image.width = texWidth;
+    image.height = texHeight;
+    image.size = size_t(texWidth) * texHeight * desiredChannels * sizeof(uint8_t);
+    image.format = format;
+    return image;
+}
 
-        float* pixels = stbi_loadf(path.c_str(), &texWidth, &texHeight, &texChannels, desiredChannels);
-        if (!pixels) {
-            std::cerr << "Failed to load texture image at '" << path << "'! Reason " << stbi_failure_reason() << std::endl;
-            throw std::runtime_error("failed to load texture image!");
+void Texture::create(LoadContext<Texture>& ctx, RenderAPI* renderApi, const Image& image, bool mipmaps) {
+    if (!image.levels.empty()) {
+        if (!renderApi->isTextureCompressionBCSupported()) {
+            throw std::runtime_error("the device doesn't support BC compressed textures");
         }
-
-        uint32_t mipLevels = static_cast<uint32_t>(std::floor(std::log2(std::max(texWidth, texHeight)))) + 1;
-        tex = &ctx.construct(renderApi, TextureType::TEXTURE_2D, format, TextureUsage::Sampled, texWidth, texHeight, mipmaps ? mipLevels : 1);
-        tex->updateImage(renderApi, pixels, texWidth * texHeight * desiredChannels * sizeof(float));
-        stbi_image_free(pixels);
+        const auto* bytes = static_cast<const std::byte*>(image.pixels.get());
+        Texture& tex = ctx.construct(renderApi, TextureType::TEXTURE_2D, image.format, TextureUsage::Sampled, image.width, image.height, static_cast<uint8_t>(image.levels.size()));
+        for (uint32_t level = 0; level < image.levels.size(); level++) {
+            const Image::Level& l = image.levels[level];
+            tex.updateImage(renderApi, bytes + l.offset, l.size, l.width, l.height, 0, 0, 0, 1, level);
+        }
+        return;
     }
 
+    uint32_t levels = mipmaps ? mipLevelCount(image.width, image.height) : 1;
+    Texture& tex = ctx.construct(renderApi, TextureType::TEXTURE_2D, image.format, TextureUsage::Sampled, image.width, image.height, levels);
+    tex.updateImage(renderApi, image.pixels.get(), image.size);
+
     if (mipmaps) {
-        tex->generateMipmaps(renderApi);
+        tex.generateMipmaps(renderApi);
     }
 }
 
@@ -101,28 +192,30 @@ asset_ptr<Texture> Texture::loadCubemap(AssetManager* assetManager, RenderAPI* r
     p.replace_extension("");
 
     bool isHdr = format == vk::Format::eR32G32B32A32Sfloat;
+    JobSystem* jobSystem = assetManager->getJobSystem();
     asset_ptr<Texture> tex;
 
-    auto loadFace = [&](const std::string& face_path, size_t face, uint32_t mip) {
-        int texChannels, texWidth, texHeight;
-        int desiredChannels = STBI_rgb_alpha;
-        void* pixels;
-        uint32_t byteSize;
-
-        if (isHdr) {
-            pixels = stbi_loadf(face_path.c_str(), &texWidth, &texHeight, &texChannels, desiredChannels);
-            byteSize = texWidth * texHeight * desiredChannels * sizeof(float);
+    // the six faces of a level decode at once, a level is uploaded before the next one is read
+    std::array<Image, 6> faces;
+    auto loadFaces = [&](const std::string& levelPrefix) {
+        std::array<std::exception_ptr, 6> errors;
+        auto decodeRange = [&](uint32_t first, uint32_t last) {
+            for (uint32_t face = first; face < last; face++) {
+                try {
+                    faces[face] = decodeFile(levelPrefix + suffixes[face] + extension, isHdr, format);
+                } catch (...) {
+                    errors[face] = std::current_exception();
+                }
+            }
+        };
+        if (jobSystem) {
+            jobSystem->parallelFor(0, 6, 1, decodeRange);
         } else {
-            pixels = stbi_load(face_path.c_str(), &texWidth, &texHeight, &texChannels, desiredChannels);
-            byteSize = texWidth * texHeight * desiredChannels * sizeof(uint8_t);
+            decodeRange(0, 6);
         }
-
-        if (!pixels) {
-            std::cerr << "Failed to load texture image at '" << face_path << "'! Reason " << stbi_failure_reason() << std::endl;
-            throw std::runtime_error("failed to load texture image!");
+        for (auto& error : errors) {
+            if (error) std::rethrow_exception(error);
         }
-
-        return std::tuple{ pixels, byteSize, texWidth, texHeight };
     };
 
     if (loadMipmaps) {
@@ -136,29 +229,27 @@ asset_ptr<Texture> Texture::loadCubemap(AssetManager* assetManager, RenderAPI* r
         }
 
         for (uint32_t mip = 0; mip < mipLevels; mip++) {
+            loadFaces(p.string() + "_m" + std::to_string(mip));
             for (size_t face = 0; face < 6; face++) {
-                auto face_path = p.string() + "_m" + std::to_string(mip) + suffixes[face] + extension;
-                auto [pixels, byteSize, texWidth, texHeight] = loadFace(face_path, face, mip);
-
+                const Image& image = faces[face];
                 if (!tex)
-                    tex = assetManager->emplaceWithPath<Texture>(path, renderApi, TextureType::TEXTURE_CUBEMAP, format, TextureUsage::Sampled, texWidth, texHeight, mipLevels);
+                    tex = assetManager->emplaceWithPath<Texture>(path, renderApi, TextureType::TEXTURE_CUBEMAP, format, TextureUsage::Sampled, image.width, image.height, mipLevels);
 
-                tex->updateImage(renderApi, pixels, byteSize, texWidth, texHeight, 0, 0, face, 1, mip);
-                stbi_image_free(pixels);
+                tex->updateImage(renderApi, image.pixels.get(), image.size, image.width, image.height, 0, 0, face, 1, mip);
+                faces[face] = {};
             }
         }
     } else {
+        loadFaces(p.string());
         for (size_t face = 0; face < 6; face++) {
-            auto face_path = p.string() + suffixes[face] + extension;
-            auto [pixels, byteSize, texWidth, texHeight] = loadFace(face_path, face, 0);
-
+            const Image& image = faces[face];
             if (!tex) {
                 constexpr int MAX_MIP_LEVELS = 4;
-                tex = assetManager->emplaceWithPath<Texture>(face_path, renderApi, TextureType::TEXTURE_CUBEMAP, format, TextureUsage::Sampled, texWidth, texHeight, MAX_MIP_LEVELS);
+                tex = assetManager->emplaceWithPath<Texture>(p.string() + suffixes[face] + extension, renderApi, TextureType::TEXTURE_CUBEMAP, format, TextureUsage::Sampled, image.width, image.height, MAX_MIP_LEVELS);
             }
 
-            tex->updateImage(renderApi, pixels, byteSize, texWidth, texHeight, 0, 0, face, 1);
-            stbi_image_free(pixels);
+            tex->updateImage(renderApi, image.pixels.get(), image.size, image.width, image.height, 0, 0, face, 1);
+            faces[face] = {};
         }
 
         tex->generateMipmaps(renderApi);
@@ -179,17 +270,12 @@ asset_ptr<Texture> Texture::fromEmbedded(AssetManager* assetManager, RenderAPI*
 }
 
 asset_ptr<Texture> Texture::fromEmbeddedCompressed(AssetManager* assetManager, RenderAPI* renderApi, const void* data, size_t dataSize, vk::Format format) {
-    int texChannels;
-    int texWidth, texHeight;
-    int desiredChannels = STBI_rgb_alpha;
-
-    unsigned char* pixels = stbi_load_from_memory(static_cast<stbi_uc const*>(data), dataSize, &texWidth, &texHeight, &texChannels, desiredChannels);
-    auto byteSize = texWidth * texHeight * desiredChannels * sizeof(uint8_t);
-
-    asset_ptr<Texture> texture = assetManager->emplace<Texture>(renderApi, TextureType::TEXTURE_2D, format, TextureUsage::Sampled, texWidth, texHeight);
-    texture->updateImage(renderApi, pixels, byteSize, texWidth, texHeight, 0, 0, 0, 1);
+    return fromImage(assetManager, renderApi, decode(data, dataSize, format));
+}
 
-    stbi_image_free(pixels);
+asset_ptr<Texture> Texture::fromImage(AssetManager* assetManager, RenderAPI* renderApi, const Image& image) {
+    asset_ptr<Texture> texture = assetManager->emplace<Texture>(renderApi, TextureType::TEXTURE_2D, image.format, TextureUsage::Sampled, image.width, image.height);
+    texture->updateImage(renderApi, image.pixels.get(), image.size, image.width, image.height, 0, 0, 0, 1);
     return texture;
 }
 
@@ -197,4 +283,25 @@ void TextureLoader::load(LoadContext<Texture>& ctx, const std::string& path) {
     Texture::load(ctx, m_renderApi, path, true);
 }
 
+TextureLoader::Decoded TextureLoader::decode(const std::string& path) {
+    auto image = std::make_shared<Texture::Image>(Texture::decode(path, m_renderApi->isTextureCompressionBCSupported()));
+    const size_t size = image->size;
+    return {
+        [renderApi = m_renderApi, image](LoadContext<Texture>& ctx) {
+            Texture::create(ctx, renderApi, *image, true);
+        },
+        size
+    };
+}
+
+bool TextureLoader::placeholder(LoadContext<Texture>& ctx, const std::string& path) {
+    auto placeholder = ctx.get<Texture>(path.find("@norm") != std::string::npos
+        ? "builtin://textures/normal@norm" : "builtin://textures/white");
+    if (!placeholder) {
+        return false;
+    }
+    ctx.construct(std::move(placeholder));
+    return true;
+}
+
 }
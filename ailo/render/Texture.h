@@ -2,12 +2,38 @@
 #include "RenderAPI.h"
 #include "../assets/Assets.h"
 
+#include <memory>
+#include <vector>
+
 namespace ailo {
 class Engine;
 
 class Texture : public Asset {
 public:
+    // Pixels decoded by stb_image or a mapped KTX2 file, independent of the RenderAPI so decoding
+    // can run on any thread
+    struct Image {
+        struct Level {
+            size_t offset = 0;
+            size_t size = 0;
+            uint32_t width = 0;
+            uint32_t height = 0;
+        };
+
+        std::shared_ptr<const void> pixels;
+        size_t size = 0;
+        uint32_t width = 0;
+        uint32_t height = 0;
+        vk::Format format = vk::Format::eUndefined;
+        // precomputed mip chain in pixels, largest first. Empty when create() generates the mips
+        std::vector<Level> levels;
+    };
+
     Texture(RenderAPI*, TextureType, vk::Format, TextureUsage, uint32_t width, uint32_t height, uint8_t levels = 1);
+    // Shows the image of placeholder until contents are moved in by an asynchronous load
+    explicit Texture(asset_ptr<Texture> placeholder);
+    Texture(Texture&& other) noexcept;
+    Texture& operator=(Texture&& other) noexcept;
     ~Texture();
 
     void updateImage(RenderAPI*, const void* data, size_t dataSize, uint32_t width, uint32_t height, uint32_t xOffset, uint32_t yOffset, uint32_t baseLayer = 0, uint32_t layerCount = 1, uint32_t level = 0);
@@ -15,10 +41,21 @@ public:
     void generateMipmaps(RenderAPI*);
     void release();
 
-    TextureHandle getHandle() const { return m_handle; }
+    TextureHandle getHandle() const { return m_placeholder ? m_placeholder->getHandle() : m_handle; }
     uint32_t getLevels() const { return m_levels; }
 
     static void load(LoadContext<Texture>&, RenderAPI*, const std::string& key, bool mipmaps = false);
+
+    // Decodes the file of a key as load() does, throws std::runtime_error when it can't be read.
+    // A .ktx2 file is mapped as is, and with allowCompressed a .ktx2 next to the image, written by
+    // `resgen texture-compress`, is read instead of the image
+    static Image decode(const std::string& key, bool allowCompressed = false);
+    // Decodes an encoded image in memory to RGBA8
+    static Image decode(const void* data, size_t dataSize, vk::Format format);
+    // Creates the texture of a decoded image, on the thread that owns the RenderAPI
+    static void create(LoadContext<Texture>&, RenderAPI*, const Image&, bool mipmaps = false);
+    static asset_ptr<Texture> fromImage(AssetManager*, RenderAPI*, const Image&);
+    // Faces of a level are decoded in parallel on the job system of the AssetManager
     static asset_ptr<Texture> loadCubemap(AssetManager*, RenderAPI*, const std::string& paths, vk::Format format, bool loadMipmaps = false);
     static asset_ptr<Texture> fromEmbedded(AssetManager*, RenderAPI*, const void* data, size_t dataSize, vk::Format format, uint32_t width, uint32_t height, uint8_t levels = 1);
     static asset_ptr<Texture> fromEmbeddedCompressed(AssetManager*, RenderAPI*, const void* data, size_t dataSize, vk::Format format);
@@ -27,6 +64,7 @@ private:
     TextureHandle m_handle;
     uint8_t m_levels;
     RenderAPI* m_renderApi;
+    asset_ptr<Texture> m_placeholder;
 };
 
 class TextureLoader : public AssetLoader<Texture> {
@@ -35,6 +73,9 @@ public:
 
 protected:
     void load(LoadContext<Texture>& ctx, const std::string& path) override;
+    Decoded decode(const std::string& path) override;
+    // builtin://textures/white, or the flat normal for @norm keys
+    bool placeholder(LoadContext<Texture>& ctx, const std::string& path) override;
 
 private:
     RenderAPI* m_renderApi;
@@ -104,8 +104,18 @@ VulkanDevice::VulkanDevice(Platform::WindowHandle window)
         queueCreateInfoCount = 2;
     }
 
+    vk::PhysicalDeviceFeatures supportedFeatures = m_physicalDevice.getFeatures();
+    m_pipelineStatisticsSupported = supportedFeatures.pipelineStatisticsQuery;
+    m_drawIndirectFirstInstanceSupported = supportedFeatures.drawIndirectFirstInstance;
+    m_multiDrawIndirectSupported = supportedFeatures.multiDrawIndirect;
+    m_textureCompressionBCSupported = supportedFeatures.textureCompressionBC;
+
     vk::PhysicalDeviceFeatures deviceFeatures{};
     deviceFeatures.samplerAnisotropy = true;
+    deviceFeatures.pipelineStatisticsQuery = m_pipelineStatisticsSupported;
+    deviceFeatures.drawIndirectFirstInstance = m_drawIndirectFirstInstanceSupported;
+    deviceFeatures.multiDrawIndirect = m_multiDrawIndirectSupported;
+    deviceFeatures.textureCompressionBC = m_textureCompressionBCSupported;
 
     std::vector<const char*> enabledExtensions;
     std::ranges::transform(requiredDeviceExtensions, std::back_inserter(enabledExtensions), [](const auto& extension) { return extension.data(); });
@@ -33,6 +33,13 @@ public:
     vk::Device* operator->() { return &m_device; }
 
     auto getMSAASamples() const { return m_msaaSamples; }
+    bool isPipelineStatisticsSupported() const { return m_pipelineStatisticsSupported; }
+    // GPU written indirect draws carry the object index in firstInstance
+    bool isDrawIndirectFirstInstanceSupported() const { return m_drawIndirectFirstInstanceSupported; }
+    // more than one command per indirect draw call
+    bool isMultiDrawIndirectSupported() const { return m_multiDrawIndirectSupported; }
+    // sampling BC1-BC7 images, the formats resgen texture-compress writes
+    bool isTextureCompressionBCSupported() const { return m_textureCompressionBCSupported; }
 
 private:
     void createInstance();
@@ -50,6 +57,10 @@ private:
     vk::SurfaceKHR m_surface;
     vk::PhysicalDevice m_physicalDevice;
     vk::SampleCountFlagBits m_msaaSamples = vk::SampleCountFlagBits::e1;
+    bool m_pipelineStatisticsSupported = false;
+    bool m_drawIndirectFirstInstanceSupported = false;
+    bool m_multiDrawIndirectSupported = false;
+    bool m_textureCompressionBCSupported = false;
     vk::Device m_device;
     vk::Queue m_graphicsQueue;
     vk::Queue m_presentQueue;
@@ -0,0 +1,118 @@
+#include "ModelImport.h"
+#include "common/JobSystem.h"
+
+#include <stb_image/stb_image.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <exception>
+#include <filesystem>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Import time of a model with 1..N threads converting its meshes, Sponza by default, and
+// decode time of the images next to it, one image per job as MeshReader decodes them.
+// Run from the repository root or pass the model path.
+
+using namespace ailo;
+
+namespace {
+
+double measure(const std::string& path, const MeshImportOptions& options, JobSystem* jobs, uint32_t iterations, size_t& meshCount) {
+    double total = 0.0;
+    for (uint32_t i = 0; i <= iterations; i++) {
+        auto start = std::chrono::steady_clock::now();
+        ModelData model = importModel(path, options, jobs);
+        auto end = std::chrono::steady_clock::now();
+        meshCount = model.meshes.size();
+
+        // the first run warms up the file cache
+        if (i > 0) {
+            total += std::chrono::duration<double, std::milli>(end - start).count();
+        }
+    }
+    return total / iterations;
+}
+
+double measureDecode(const std::vector<std::string>& images, JobSystem* jobs, uint32_t iterations, size_t& bytes) {
+    std::vector<size_t> sizes(images.size());
+    auto decodeRange = [&](uint32_t first, uint32_t last) {
+        for (uint32_t i = first; i < last; i++) {
+            int width, height, channels;
+            stbi_uc* pixels = stbi_load(images[i].c_str(), &width, &height, &channels, STBI_rgb_alpha);
+            sizes[i] = pixels ? size_t(width) * height * 4 : 0;
+            stbi_image_free(pixels);
+        }
+    };
+
+    double total = 0.0;
+    for (uint32_t i = 0; i <= iterations; i++) {
+        auto start = std::chrono::steady_clock::now();
+        if (jobs) {
+            jobs->parallelFor(0, static_cast<uint32_t>(images.size()), 1, decodeRange);
+        } else {
+            decodeRange(0, static_cast<uint32_t>(images.size()));
+        }
+        auto end = std::chrono::steady_clock::now();
+
+        if (i > 0) {
+            total += std::chrono::duration<double, std::milli>(end - start).count();
+        }
+    }
+    bytes = 0;
+    for (size_t size : sizes) {
+        bytes += size;
+    }
+    return total / iterations;
+}
+
+}
+
+int main(int argc, char** argv) {
+    const std::string path = argc > 1 ? argv[1] : "assets/models/sponza/Sponza.gltf";
+    const uint32_t maxWorkers = std::max(std::thread::hardware_concurrency(), 2u) - 1;
+    const uint32_t iterations = 3;
+
+    std::vector<std::string> images;
+    for (const auto& entry : std::filesystem::directory_iterator(std::filesystem::path(path).parent_path())) {
+        const auto extension = entry.path().extension();
+        if (extension == ".png" || extension == ".jpg" || extension == ".jpeg" || extension == ".tga") {
+            images.push_back(entry.path().string());
+        }
+    }
+    std::sort(images.begin(), images.end());
+    if (!images.empty()) {
+        std::printf("%s, %zu images\n", path.c_str(), images.size());
+        size_t bytes = 0;
+        const double serial = measureDecode(images, nullptr, iterations, bytes);
+        std::printf("  serial      %9.1f ms (%zu MiB RGBA8)\n", serial, bytes >> 20);
+        for (uint32_t workers = 1; workers <= maxWorkers; workers *= 2) {
+            JobSystem jobs(workers);
+            const double parallel = measureDecode(images, &jobs, iterations, bytes);
+            std::printf("  %2u threads  %9.1f ms  x%.2f\n", workers + 1, parallel, serial / parallel);
+        }
+        std::printf("\n");
+    }
+
+    for (bool quantize : { false, true }) {
+        std::printf("%s, %s vertices\n", path.c_str(), quantize ? "quantized" : "full");
+        const MeshImportOptions options { .quantizeVertices = quantize };
+        try {
+            size_t meshCount = 0;
+            const double serial = measure(path, options, nullptr, iterations, meshCount);
+            std::printf("  serial      %9.1f ms (%zu meshes)\n", serial, meshCount);
+            for (uint32_t workers = 1; workers <= maxWorkers; workers *= 2) {
+                JobSystem jobs(workers);
+                const double parallel = measure(path, options, &jobs, iterations, meshCount);
+                std::printf("  %2u threads  %9.1f ms  x%.2f\n", workers + 1, parallel, serial / parallel);
+            }
+        } catch (const std::exception& e) {
+            std::fprintf(stderr, "%s\n", e.what());
+            return 1;
+        }
+        std::printf("\n");
+    }
+    return 0;
+}
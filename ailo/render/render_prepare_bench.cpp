@@ -0,0 +1,374 @@
+#include "Culling.h"
+#include "common/JobSystem.h"
+#include "ecs/Transform.h"
+
+#include <entt/entt.hpp>
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <thread>
+#include <vector>
+
+// Scaling benchmark of the CPU side of a frame: the extract and prepare passes of
+// Renderer run over a registry of synthetic renderables with 1..N workers. Renderer
+// needs a device, so the passes are mirrored here over plain structs: the same
+// chunks, component lookups, count / prefix sum / fill steps, object data and
+// render data writes, without the descriptor sets and pipeline ids that stay on
+// the calling thread anyway. Keep them in sync with Renderer::gatherBounds and
+// Renderer::prepare.
+
+using namespace ailo;
+
+namespace {
+
+constexpr uint32_t kChunkSize = 256; // Renderer::kExtractChunkSize
+constexpr uint32_t kInvalidBoundsIndex = ~0u;
+
+struct Skin {
+    uint32_t boneCount = 0;
+};
+
+struct FaceLod {
+    uint32_t indexOffset = 0;
+    uint32_t indexCount = 0;
+};
+
+struct Face {
+    Aabb bounds;
+    BoundingSphere sphere;
+    uint32_t indexOffset = 0;
+    uint32_t indexCount = 0;
+    std::vector<FaceLod> lods;
+};
+
+struct Mesh {
+    std::vector<Face> faces;
+    BoundingSphere sphere;
+    std::vector<float> lodErrors;
+    glm::mat4 positionDecode {1.0f};
+};
+
+struct Renderable {
+    const Mesh* mesh = nullptr;
+    uint32_t objectSlot = 0;
+    uint8_t lod = 0;
+};
+
+struct ObjectData {
+    glm::vec4 modelRows[3];
+    glm::vec3 normalRow0;
+    uint32_t flags;
+    glm::vec3 normalRow1;
+    uint32_t padding0;
+    glm::vec3 normalRow2;
+    uint32_t padding1;
+};
+
+struct RenderEntry {
+    glm::vec3 worldPosition;
+    const glm::mat4* model;
+    uint32_t objectIndex;
+    uint32_t indexCount;
+    uint32_t indexOffset;
+    uint32_t boundsIndex;
+    uint8_t lod;
+    bool hasTransform;
+    bool isSkinned;
+};
+
+struct Extracted {
+    entt::entity entity;
+    Renderable* renderable;
+    const WorldTransform* transform = nullptr;
+    const Skin* skin = nullptr;
+    uint32_t firstBoundsIndex = 0;
+    uint32_t visibleFaceCount = 0;
+};
+
+struct Chunk {
+    uint32_t boundsOffset = 0;
+    uint32_t boundsCount = 0;
+    uint32_t renderDataOffset = 0;
+    uint32_t renderDataCount = 0;
+    std::vector<uint32_t> dirtySlots;
+};
+
+// Meshes with 1 to 8 faces and 3 levels, like the imported scenes
+std::vector<Mesh> makeMeshes(std::mt19937& rng) {
+    std::uniform_real_distribution<float> size(0.2f, 1.0f);
+    std::vector<Mesh> meshes(16);
+    for (size_t m = 0; m < meshes.size(); m++) {
+        auto& mesh = meshes[m];
+        mesh.lodErrors = { 0.0f, 0.01f, 0.05f };
+        Aabb meshBounds;
+        for (size_t f = 0; f <= m % 8; f++) {
+            Face face;
+            glm::vec3 extent(size(rng), size(rng), size(rng));
+            face.bounds = { -extent, extent };
+            face.sphere = { glm::vec3(0.0f), glm::length(extent) };
+            face.indexOffset = uint32_t(f) * 3000;
+            face.indexCount = 3000;
+            face.lods = { { face.indexOffset, 1500 }, { face.indexOffset, 600 } };
+            meshBounds.extend(face.bounds);
+            mesh.faces.push_back(std::move(face));
+        }
+        mesh.sphere = { meshBounds.center(), glm::length(meshBounds.extent()) };
+    }
+    return meshes;
+}
+
+class Frame {
+public:
+    Frame(entt::registry& registry, JobSystem* jobs) : m_registry(registry), m_jobs(jobs) {}
+
+    void extract() {
+        m_extracted.clear();
+        for (auto [entity, renderable] : m_registry.view<Renderable>().each()) {
+            m_extracted.push_back({ entity, &renderable });
+        }
+        m_chunks.resize((m_extracted.size() + kChunkSize - 1) / kChunkSize);
+
+        forEachChunk([this](Chunk& chunk, uint32_t first, uint32_t last) {
+            chunk.boundsCount = 0;
+            for (uint32_t i = first; i < last; i++) {
+                auto& item = m_extracted[i];
+                item.transform = m_registry.try_get<WorldTransform>(item.entity);
+                item.skin = m_registry.try_get<Skin>(item.entity);
+                if (item.transform) {
+                    chunk.boundsCount += item.renderable->mesh->faces.size();
+                }
+            }
+        });
+
+        uint32_t boundsCount = 0;
+        for (auto& chunk : m_chunks) {
+            chunk.boundsOffset = boundsCount;
+            boundsCount += chunk.boundsCount;
+        }
+        m_bounds.resize(boundsCount);
+        m_cullable.resize(boundsCount);
+
+        forEachChunk([this](Chunk& chunk, uint32_t first, uint32_t last) {
+            uint32_t boundsIndex = chunk.boundsOffset;
+            for (uint32_t i = first; i < last; i++) {
+                auto& item = m_extracted[i];
+                if (!item.transform) {
+                    item.firstBoundsIndex = kInvalidBoundsIndex;
+                    continue;
+                }
+                item.firstBoundsIndex = boundsIndex;
+                for (const auto& face : item.renderable->mesh->faces) {
+                    m_bounds.set(boundsIndex, face.bounds.transform(item.transform->matrix));
+                    m_cullable[boundsIndex] = item.skin ? 0 : 1;
+                    boundsIndex++;
+                }
+            }
+        });
+    }
+
+    void cull(const Frustum& frustum) {
+        m_bounds.cull(frustum, m_visibility);
+        for (size_t i = 0; i < m_visibility.size(); i++) {
+            m_visibility[i] |= !m_cullable[i];
+        }
+    }
+
+    void prepare(const glm::vec3& cameraPosition, float projectionScale) {
+        forEachChunk([this](Chunk& chunk, uint32_t first, uint32_t last) {
+            chunk.renderDataCount = 0;
+            for (uint32_t i = first; i < last; i++) {
+                auto& item = m_extracted[i];
+                const size_t faceCount = item.renderable->mesh->faces.size();
+                item.visibleFaceCount = faceCount;
+                if (item.transform) {
+                    const uint8_t* faceVisibility = m_visibility.data() + item.firstBoundsIndex;
+                    item.visibleFaceCount -= std::count(faceVisibility, faceVisibility + faceCount, 0);
+                }
+                chunk.renderDataCount += item.visibleFaceCount;
+            }
+        });
+
+        uint32_t renderDataCount = 0;
+        for (auto& chunk : m_chunks) {
+            chunk.renderDataOffset = renderDataCount;
+            renderDataCount += chunk.renderDataCount;
+        }
+        m_objectData.resize(m_extracted.size());
+        m_renderData.resize(renderDataCount);
+
+        forEachChunk([this, cameraPosition, projectionScale](Chunk& chunk, uint32_t first, uint32_t last) {
+            chunk.dirtySlots.clear();
+            RenderEntry* entry = m_renderData.data() + chunk.renderDataOffset;
+            for (uint32_t i = first; i < last; i++) {
+                const auto& item = m_extracted[i];
+                const auto* tr = item.transform;
+                auto& renderable = *item.renderable;
+                const uint32_t slot = renderable.objectSlot;
+
+                if (tr && tr->changed) {
+                    const glm::mat4 modelRows = glm::transpose(tr->matrix * renderable.mesh->positionDecode);
+                    auto& objectData = m_objectData[slot];
+                    objectData.modelRows[0] = modelRows[0];
+                    objectData.modelRows[1] = modelRows[1];
+                    objectData.modelRows[2] = modelRows[2];
+                    objectData.normalRow0 = glm::vec3(tr->inverse[0]);
+                    objectData.normalRow1 = glm::vec3(tr->inverse[1]);
+                    objectData.normalRow2 = glm::vec3(tr->inverse[2]);
+                    objectData.flags = item.skin ? 1u : 0u;
+                    chunk.dirtySlots.push_back(slot);
+                }
+
+                if (item.visibleFaceCount == 0) {
+                    continue;
+                }
+
+                const Mesh& mesh = *renderable.mesh;
+                const uint8_t* faceVisibility = tr ? m_visibility.data() + item.firstBoundsIndex : nullptr;
+
+                // Renderer::selectLod without the hysteresis
+                uint8_t lod = 0;
+                if (tr) {
+                    const glm::mat4& m = tr->matrix;
+                    float scale = std::max({ glm::length(glm::vec3(m[0])), glm::length(glm::vec3(m[1])), glm::length(glm::vec3(m[2])) });
+                    float radius = mesh.sphere.radius * scale;
+                    float distance = std::max(glm::length(glm::vec3(m * glm::vec4(mesh.sphere.center, 1.0f)) - cameraPosition), radius);
+                    float screenScale = 0.5f * projectionScale * radius / distance;
+                    while (lod + 1u < mesh.lodErrors.size() && mesh.lodErrors[lod + 1] * screenScale <= 0.001f) {
+                        lod++;
+                    }
+                    renderable.lod = lod;
+                }
+
+                for (size_t f = 0; f < mesh.faces.size(); f++) {
+                    if (faceVisibility && !faceVisibility[f]) {
+                        continue;
+                    }
+                    const auto& face = mesh.faces[f];
+                    const uint32_t faceLod = std::min<uint32_t>(lod, face.lods.size());
+                    entry->objectIndex = slot;
+                    entry->indexCount = faceLod ? face.lods[faceLod - 1].indexCount : face.indexCount;
+                    entry->indexOffset = faceLod ? face.lods[faceLod - 1].indexOffset : face.indexOffset;
+                    entry->lod = static_cast<uint8_t>(faceLod);
+                    entry->worldPosition = tr ? glm::vec3(tr->matrix * glm::vec4(face.sphere.center, 1.0f)) : face.sphere.center;
+                    entry->boundsIndex = tr ? item.firstBoundsIndex + f : kInvalidBoundsIndex;
+                    entry->hasTransform = tr != nullptr;
+                    entry->isSkinned = item.skin != nullptr;
+                    entry->model = tr ? &tr->matrix : nullptr;
+                    entry++;
+                }
+            }
+        });
+    }
+
+    [[nodiscard]] size_t getRenderDataCount() const { return m_renderData.size(); }
+
+private:
+    // Without a job system the chunks run inline, which is the serial baseline
+    template<typename Fn>
+    void forEachChunk(Fn&& fn) {
+        const uint32_t count = static_cast<uint32_t>(m_extracted.size());
+        auto run = [&](uint32_t firstChunk, uint32_t lastChunk) {
+            for (uint32_t c = firstChunk; c < lastChunk; c++) {
+                uint32_t first = c * kChunkSize;
+                fn(m_chunks[c], first, std::min(count, first + kChunkSize));
+            }
+        };
+        if (m_jobs) {
+            m_jobs->parallelFor(0, static_cast<uint32_t>(m_chunks.size()), 1, run);
+        } else {
+            run(0, static_cast<uint32_t>(m_chunks.size()));
+        }
+    }
+
+    entt::registry& m_registry;
+    JobSystem* m_jobs;
+    std::vector<Extracted> m_extracted;
+    std::vector<Chunk> m_chunks;
+    CullingBounds m_bounds;
+    std::vector<uint8_t> m_cullable;
+    std::vector<uint8_t> m_visibility;
+    std::vector<ObjectData> m_objectData;
+    std::vector<RenderEntry> m_renderData;
+};
+
+// A 200x200 field of objects around the origin, every transform moved this frame and one in 16 skinned
+void makeScene(entt::registry& registry, const std::vector<Mesh>& meshes, uint32_t objectCount, std::mt19937& rng) {
+    std::uniform_real_distribution<float> position(-100.0f, 100.0f);
+    std::uniform_real_distribution<float> scale(0.5f, 2.0f);
+    for (uint32_t i = 0; i < objectCount; i++) {
+        auto entity = registry.create();
+        registry.emplace<Renderable>(entity, &meshes[i % meshes.size()], i);
+        glm::mat4 matrix = glm::scale(glm::translate(glm::mat4(1.0f), glm::vec3(position(rng), 0.0f, position(rng))), glm::vec3(scale(rng)));
+        registry.emplace<WorldTransform>(entity, matrix, glm::inverse(matrix), true);
+        if (i % 16 == 0) {
+            registry.emplace<Skin>(entity, 64u);
+        }
+    }
+}
+
+struct Timings {
+    double extract = 0.0;
+    double prepare = 0.0;
+    size_t renderDataCount = 0;
+};
+
+Timings measure(entt::registry& registry, JobSystem* jobs, uint32_t iterations) {
+    const glm::vec3 cameraPosition(0.0f, 2.0f, 0.0f);
+    const glm::mat4 projection = glm::perspective(glm::radians(60.0f), 16.0f / 9.0f, 0.1f, 500.0f);
+    const Frustum frustum = Frustum::fromViewProjection(projection * glm::lookAt(cameraPosition, glm::vec3(0.0f, 2.0f, -1.0f), glm::vec3(0.0f, 1.0f, 0.0f)));
+
+    Frame frame(registry, jobs);
+
+    // warm up threads and sizes the arrays
+    frame.extract();
+    frame.cull(frustum);
+    frame.prepare(cameraPosition, projection[1][1]);
+
+    Timings timings;
+    for (uint32_t i = 0; i < iterations; i++) {
+        auto start = std::chrono::steady_clock::now();
+        frame.extract();
+        auto extracted = std::chrono::steady_clock::now();
+        frame.cull(frustum);
+        auto culled = std::chrono::steady_clock::now();
+        frame.prepare(cameraPosition, projection[1][1]);
+        auto prepared = std::chrono::steady_clock::now();
+        timings.extract += std::chrono::duration<double, std::milli>(extracted - start).count();
+        timings.prepare += std::chrono::duration<double, std::milli>(prepared - culled).count();
+    }
+    timings.extract /= iterations;
+    timings.prepare /= iterations;
+    timings.renderDataCount = frame.getRenderDataCount();
+    return timings;
+}
+
+}
+
+int main(int argc, char** argv) {
+    const uint32_t maxWorkers = std::max(std::thread::hardware_concurrency(), 2u) - 1;
+    const uint32_t objectCount = argc > 1 ? static_cast<uint32_t>(std::atoi(argv[1])) : 50000;
+    const uint32_t iterations = 20;
+
+    std::mt19937 rng(7);
+    auto meshes = makeMeshes(rng);
+    entt::registry registry;
+    makeScene(registry, meshes, objectCount, rng);
+
+    Timings serial = measure(registry, nullptr, iterations);
+    std::printf("renderables: %u, draws: %zu\n", objectCount, serial.renderDataCount);
+    std::printf("             extract            prepare\n");
+    std::printf("  serial     %8.3f ms         %8.3f ms\n", serial.extract, serial.prepare);
+
+    for (uint32_t workers = 1; workers <= maxWorkers; workers *= 2) {
+        JobSystem jobs(workers);
+        Timings timings = measure(registry, &jobs, iterations);
+        std::printf("  %2u threads %8.3f ms  x%.2f  %8.3f ms  x%.2f\n", workers + 1,
+            timings.extract, serial.extract / timings.extract, timings.prepare, serial.prepare / timings.prepare);
+    }
+    return 0;
+}
@@ -0,0 +1,183 @@
+#include "SoftwareOcclusion.h"
+#include "common/JobSystem.h"
+
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <thread>
+#include <vector>
+
+// Cull rate benchmark: a street of building occluders in front of a field of
+// small boxes, rasterized and tested with 1..N workers. The occluded share is of
+// the boxes left by frustum culling. A wall with a window checks first that the
+// simplified occluders don't hide what can be seen through a concave mesh.
+
+using namespace ailo;
+
+namespace {
+
+constexpr float sBoxPositions[] = {
+    -1.0f, -1.0f, -1.0f,   1.0f, -1.0f, -1.0f,   1.0f,  1.0f, -1.0f,  -1.0f,  1.0f, -1.0f,
+    -1.0f, -1.0f,  1.0f,   1.0f, -1.0f,  1.0f,   1.0f,  1.0f,  1.0f,  -1.0f,  1.0f,  1.0f,
+};
+constexpr uint16_t sBoxIndices[] = {
+    0, 2, 1, 0, 3, 2,   4, 5, 6, 4, 6, 7,   0, 1, 5, 0, 5, 4,
+    3, 6, 2, 3, 7, 6,   0, 4, 7, 0, 7, 3,   1, 2, 6, 1, 6, 5,
+};
+
+// A 2x2 wall in the xy plane with a window of 2x2 of its 24x24 quads in the middle
+void makeWindowWall(std::vector<float>& positions, std::vector<uint16_t>& indices) {
+    constexpr uint32_t kQuads = 24;
+    for (uint32_t y = 0; y <= kQuads; y++) {
+        for (uint32_t x = 0; x <= kQuads; x++) {
+            positions.insert(positions.end(), { float(x) / kQuads * 2.0f - 1.0f, float(y) / kQuads * 2.0f - 1.0f, 0.0f });
+        }
+    }
+    for (uint32_t y = 0; y < kQuads; y++) {
+        for (uint32_t x = 0; x < kQuads; x++) {
+            if (x >= kQuads / 2 - 1 && x < kQuads / 2 + 1 && y >= kQuads / 2 - 1 && y < kQuads / 2 + 1) {
+                continue;
+            }
+            auto v = static_cast<uint16_t>(y * (kQuads + 1) + x);
+            auto above = static_cast<uint16_t>(v + kQuads + 1);
+            indices.insert(indices.end(), { v, uint16_t(v + 1), uint16_t(above + 1), v, uint16_t(above + 1), above });
+        }
+    }
+}
+
+// A box seen through the window must stay visible, one behind the wall must be hidden
+bool checkWindowWall(const glm::mat4& projection) {
+    std::vector<float> positions;
+    std::vector<uint16_t> indices;
+    makeWindowWall(positions, indices);
+    // every triangle is kept, the wall has to hide the box behind it
+    auto triangleCount = static_cast<uint32_t>(indices.size() / 3);
+    OccluderMesh wall = simplifyOccluder(positions.data(), 3, indices.data(), indices.size(), triangleCount);
+
+    glm::mat4 view = glm::lookAt(glm::vec3(0.0f, 0.0f, 3.0f), glm::vec3(0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+    SoftwareOcclusion occlusion;
+    occlusion.begin(projection * view);
+    occlusion.addOccluder(wall, glm::scale(glm::mat4(1.0f), glm::vec3(4.0f)));
+    JobSystem jobs(1);
+    occlusion.rasterize(jobs);
+
+    // the window spans 1 / 9 of the distance to it on each side, the box 0.4 / 3.95 near its right edge
+    const Aabb throughWindow { glm::vec3(0.3f, -0.05f, -1.05f), glm::vec3(0.4f, 0.05f, -0.95f) };
+    const Aabb behindWall { glm::vec3(2.0f, -0.5f, -2.5f), glm::vec3(3.0f, 0.5f, -1.5f) };
+    bool passed = true;
+    if (occlusion.isOccluded(throughWindow)) {
+        std::printf("FAILED: a box seen through the window of a wall is culled\n");
+        passed = false;
+    }
+    if (!occlusion.isOccluded(behindWall)) {
+        std::printf("FAILED: a box behind a wall is not culled\n");
+        passed = false;
+    }
+    return passed;
+}
+
+struct Scene {
+    std::vector<glm::mat4> occluders;
+    CullingBounds bounds;
+};
+
+Scene makeScene(uint32_t occluderCount, uint32_t objectCount) {
+    std::mt19937 random(7);
+    std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+
+    Scene scene;
+    // buildings on both sides of the street and across its end
+    for (uint32_t i = 0; i < occluderCount; i++) {
+        float side = (i % 3 == 0) ? -1.0f : (i % 3 == 1 ? 1.0f : 0.0f);
+        float depth = 15.0f + float(i / 3) * 12.0f;
+        glm::vec3 position = side == 0.0f ? glm::vec3(0.0f, 8.0f, -depth - 40.0f) : glm::vec3(side * 14.0f, 8.0f, -depth);
+        glm::vec3 scale { 8.0f + unit(random) * 4.0f, 8.0f + unit(random) * 8.0f, 5.0f };
+        scene.occluders.push_back(glm::scale(glm::translate(glm::mat4(1.0f), position), scale));
+    }
+
+    Aabb box { glm::vec3(-1.0f), glm::vec3(1.0f) };
+    scene.bounds.reserve(objectCount);
+    for (uint32_t i = 0; i < objectCount; i++) {
+        glm::vec3 position { (unit(random) * 2.0f - 1.0f) * 60.0f, unit(random) * 4.0f, -10.0f - unit(random) * 190.0f };
+        glm::mat4 model = glm::scale(glm::translate(glm::mat4(1.0f), position), glm::vec3(0.5f + unit(random)));
+        scene.bounds.add(box.transform(model));
+    }
+    return scene;
+}
+
+struct Result {
+    double rasterizeMs;
+    double cullMs;
+    uint32_t triangles;
+    uint32_t visible;
+    uint32_t occluded;
+};
+
+Result measure(uint32_t workerCount, const Scene& scene, const OccluderMesh& occluderMesh, const glm::mat4& viewProjection, uint32_t iterations) {
+    JobSystem jobs(workerCount);
+    SoftwareOcclusion occlusion;
+    std::vector<uint8_t> frustumVisibility;
+    scene.bounds.cull(Frustum::fromViewProjection(viewProjection), frustumVisibility);
+    std::vector<uint8_t> visibility;
+
+    Result result {};
+    for (uint32_t i = 0; i <= iterations; i++) {
+        auto start = std::chrono::steady_clock::now();
+        occlusion.begin(viewProjection);
+        for (const glm::mat4& model : scene.occluders) {
+            occlusion.addOccluder(occluderMesh, model);
+        }
+        occlusion.rasterize(jobs);
+        auto rasterized = std::chrono::steady_clock::now();
+        visibility = frustumVisibility;
+        occlusion.cull(scene.bounds, visibility, jobs);
+        auto end = std::chrono::steady_clock::now();
+
+        // the first run warms up threads and caches
+        if (i > 0) {
+            result.rasterizeMs += std::chrono::duration<double, std::milli>(rasterized - start).count() / iterations;
+            result.cullMs += std::chrono::duration<double, std::milli>(end - rasterized).count() / iterations;
+        }
+    }
+
+    result.triangles = occlusion.getTriangleCount();
+    result.visible = static_cast<uint32_t>(std::count(frustumVisibility.begin(), frustumVisibility.end(), 1));
+    result.occluded = result.visible - static_cast<uint32_t>(std::count(visibility.begin(), visibility.end(), 1));
+    return result;
+}
+
+}
+
+int main() {
+    const uint32_t maxWorkers = std::max(std::thread::hardware_concurrency(), 2u) - 1;
+    const uint32_t iterations = 50;
+
+    OccluderMesh occluderMesh = simplifyOccluder(sBoxPositions, 3, sBoxIndices, std::size(sBoxIndices));
+    glm::mat4 projection = glm::perspective(glm::radians(60.0f), 16.0f / 9.0f, 0.1f, 1000.0f);
+    glm::mat4 view = glm::lookAt(glm::vec3(0.0f, 2.0f, 0.0f), glm::vec3(0.0f, 2.0f, -1.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+    glm::mat4 viewProjection = projection * view;
+
+    if (!checkWindowWall(projection)) {
+        return 1;
+    }
+
+    for (uint32_t occluderCount : { 16u, 64u }) {
+        for (uint32_t objectCount : { 10000u, 100000u }) {
+            Scene scene = makeScene(occluderCount, objectCount);
+            std::printf("occluders: %u, objects: %u\n", occluderCount, objectCount);
+
+            for (uint32_t workers = 1; workers <= maxWorkers; workers *= 2) {
+                Result r = measure(workers, scene, occluderMesh, viewProjection, iterations);
+                std::printf("  %2u threads  raster %7.3f ms (%u tris)  cull %7.3f ms  occluded %u / %u (%.1f%%)\n",
+                    workers + 1, r.rasterizeMs, r.triangles, r.cullMs, r.occluded, r.visible,
+                    r.visible ? 100.0 * r.occluded / r.visible : 0.0);
+            }
+            std::printf("\n");
+        }
+    }
+    return 0;
+}
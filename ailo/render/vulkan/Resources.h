@@ -35,6 +35,8 @@ enum class BufferBinding : uint8_t {
   VERTEX,
   INDEX,
   UNIFORM,
+  STORAGE,
+  INDIRECT, // storage buffer of draw commands written on the GPU
 };
 
 enum class CullingMode : uint8_t {
@@ -77,6 +79,12 @@ enum class CompareOp : uint8_t {
   ALWAYS
 };
 
+// How a pipeline uses the depth buffer
+enum class DepthMode : uint8_t {
+  PROGRAM, // raster state of the program
+  EQUAL_READ_ONLY // shades only the fragments laid down by a depth pre-pass
+};
+
 enum class TextureType : uint8_t {
     TEXTURE_2D,
     TEXTURE_CUBEMAP
@@ -88,6 +96,7 @@ enum class TextureUsage : uint16_t {
     Storage = 1 << 1,
     ColorAttachment = 1 << 2,
     DepthStencilAttachment = 1 << 3,
+    InputAttachment = 1 << 4,
 };
 
 inline TextureUsage operator&(TextureUsage lhs, TextureUsage rhs) {
@@ -144,12 +153,18 @@ struct DescriptorSetLayout {
 
     vk::DescriptorSetLayout layout;
     bitmask_t dynamicBindings;
+    bitmask_t storageBindings;
+    bitmask_t inputAttachmentBindings;
+    bitmask_t storageImageBindings;
 };
 
 struct DescriptorSet {
     vk::DescriptorSet descriptorSet;
     DescriptorSetLayout::bitmask_t boundBindings;
     DescriptorSetLayout::bitmask_t dynamicBindings;
+    DescriptorSetLayout::bitmask_t storageBindings;
+    DescriptorSetLayout::bitmask_t inputAttachmentBindings;
+    DescriptorSetLayout::bitmask_t storageImageBindings;
     DescriptorSetLayoutHandle layoutHandle;
     std::shared_ptr<FenceStatus> boundFence;
 
@@ -185,9 +200,22 @@ struct RenderPassAttachmentOperations {
     vk::AttachmentStoreOp store = vk::AttachmentStoreOp::eDontCare;
 };
 
+// Attachments of one subpass. Input attachments are read with subpassLoad,
+// their input_attachment_index is the color slot, or kMaxColorAttachments for the depth.
+struct SubpassDescription {
+    ColorAttachmentMask colors {};
+    ColorAttachmentMask inputs {};
+    bool depthInput = false; // depth is read only within the subpass
+
+    bool operator==(const SubpassDescription& other) const = default;
+};
+
 struct RenderPassDescription {
     PerColorAttachment<RenderPassAttachmentOperations> color;
     RenderPassAttachmentOperations depth;
+    // without subpasses the render pass has a single one writing every attachment
+    std::array<SubpassDescription, kMaxSubpasses> subpasses {};
+    uint8_t subpassCount = 0;
 };
 
 struct VertexInputDescription {
@@ -200,6 +228,7 @@ struct RasterDescription {
     bool inverseFrontFace = false;
     bool blendEnable = false;
     bool depthWriteEnable = true;
+    bool colorWriteEnable = true; // disabled for depth only programs
     BlendOperation rgbBlendOp;
     BlendOperation alphaBlendOp;
     BlendFunction srcRgbBlendFunc;
@@ -221,6 +250,7 @@ struct ShaderDescription {
 
     ShaderCode vertexShader;
     ShaderCode fragmentShader;
+    ShaderCode computeShader; // makes a compute program, the graphics stages and raster are unused
     RasterDescription raster;
     std::vector<SetLayout> layout;
 };
@@ -233,10 +263,17 @@ struct PipelineDescription {
 struct PipelineState {
     Handle<gpu::Program> program;
     Handle<gpu::VertexBufferLayout> vertexBufferLayout;
+    DepthMode depthMode = DepthMode::PROGRAM;
+};
+
+struct PipelineStatistics {
+    uint64_t fragmentShaderInvocations = 0;
 };
 
 struct RenderPassState {
     resource_ptr<gpu::RenderTarget> renderTarget {};
+    vk::Pipeline boundPipeline {};
+    uint32_t subpass = 0;
 };
 
 }
@@ -73,14 +73,26 @@ Texture::Texture(vk::Device device, vk::Image image, vk::Format format, uint32_t
     imageView = createImageView(device, image, format, m_levels, aspectFlags);
 }
 
+vk::ImageView Texture::getLevelView(uint8_t level) {
+    if (m_levels == 1) {
+        return imageView;
+    }
+
+    m_levelViews.resize(m_levels);
+    if (!m_levelViews[level]) {
+        m_levelViews[level] = createImageView(m_device, image, format, 1, aspect, level);
+    }
+    return m_levelViews[level];
+}
+
 vk::ImageView Texture::createImageView(vk::Device device, vk::Image image, vk::Format format, uint32_t levels,
-    vk::ImageAspectFlags aspectFlags) {
+    vk::ImageAspectFlags aspectFlags, uint32_t baseLevel) {
     vk::ImageViewCreateInfo viewInfo{};
     viewInfo.image = image;
     viewInfo.viewType = m_type == TextureType::TEXTURE_2D ? vk::ImageViewType::e2D : vk::ImageViewType::eCube;
     viewInfo.format = format;
     viewInfo.subresourceRange.aspectMask = aspectFlags;
-    viewInfo.subresourceRange.baseMipLevel = 0;
+    viewInfo.subresourceRange.baseMipLevel = baseLevel;
     viewInfo.subresourceRange.levelCount = levels;
     viewInfo.subresourceRange.baseArrayLayer = 0;
     viewInfo.subresourceRange.layerCount = m_layerCount;
@@ -103,6 +115,9 @@ uint32_t Texture::findMemoryType(vk::PhysicalDevice physicalDevice, uint32_t typ
 Texture::~Texture() {
     m_device.destroySampler(sampler);
     m_device.destroyImageView(imageView);
+    for (auto levelView : m_levelViews) {
+        m_device.destroyImageView(levelView);
+    }
 
     if (memory) {
         m_device.destroyImage(image);
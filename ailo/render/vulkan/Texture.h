@@ -58,6 +58,9 @@ public:
     uint8_t getLevels() const { return m_levels; }
     auto getUsage() const { return m_usage; }
 
+    // View of a single mip level, e.g. to write it as a storage image
+    vk::ImageView getLevelView(uint8_t level);
+
 private:
     vk::Device m_device {};
     std::vector<vk::ImageLayout> m_rangeLayouts;
@@ -66,8 +69,9 @@ private:
     TextureType m_type = TextureType::TEXTURE_2D;
     vk::SampleCountFlagBits m_samples = vk::SampleCountFlagBits::e1;
     vk::ImageUsageFlags m_usage;
+    std::vector<vk::ImageView> m_levelViews; // created on first use
 
-    vk::ImageView createImageView(vk::Device device, vk::Image image, vk::Format format, uint32_t levels, vk::ImageAspectFlags aspectFlags);
+    vk::ImageView createImageView(vk::Device device, vk::Image image, vk::Format format, uint32_t levels, vk::ImageAspectFlags aspectFlags, uint32_t baseLevel = 0);
     uint32_t findMemoryType(vk::PhysicalDevice physicalDevice, uint32_t typeFilter, vk::MemoryPropertyFlags properties);
 };
 
@@ -37,11 +37,13 @@ vk::CompareOp getCompareOperation(CompareOp compOp) {
   return static_cast<vk::CompareOp>(compOp);
 }
 
-vk::BufferUsageFlagBits getBufferUsage(BufferBinding binding) {
+vk::BufferUsageFlags getBufferUsage(BufferBinding binding) {
   switch(binding) {
     case BufferBinding::INDEX: return vk::BufferUsageFlagBits::eIndexBuffer;
     case BufferBinding::VERTEX: return vk::BufferUsageFlagBits::eVertexBuffer;
     case BufferBinding::UNIFORM: return vk::BufferUsageFlagBits::eUniformBuffer;
+    case BufferBinding::STORAGE: return vk::BufferUsageFlagBits::eStorageBuffer;
+    case BufferBinding::INDIRECT: return vk::BufferUsageFlagBits::eStorageBuffer | vk::BufferUsageFlagBits::eIndirectBuffer;
     case BufferBinding::UNKNOWN: return static_cast<vk::BufferUsageFlagBits>(0);
   }
   return static_cast<vk::BufferUsageFlagBits>(0);
@@ -53,6 +55,7 @@ vk::ImageUsageFlags getTextureUsage(TextureUsage usage) {
   if ((usage & TextureUsage::Storage) == TextureUsage::Storage) usageFlags |= vk::ImageUsageFlagBits::eStorage;
   if ((usage & TextureUsage::ColorAttachment) == TextureUsage::ColorAttachment) usageFlags |= vk::ImageUsageFlagBits::eColorAttachment;
   if ((usage & TextureUsage::DepthStencilAttachment) == TextureUsage::DepthStencilAttachment) usageFlags |= vk::ImageUsageFlagBits::eDepthStencilAttachment;
+  if ((usage & TextureUsage::InputAttachment) == TextureUsage::InputAttachment) usageFlags |= vk::ImageUsageFlagBits::eInputAttachment;
 
   return usageFlags;
 }
@@ -72,7 +75,9 @@ std::tuple<vk::AccessFlags, vk::PipelineStageFlags> getTransitionSrcAccess(vk::I
     case vk::ImageLayout::ePresentSrcKHR:
       return { vk::AccessFlagBits::eNone, vk::PipelineStageFlagBits::eTransfer };
     case vk::ImageLayout::eShaderReadOnlyOptimal:
-      return { vk::AccessFlagBits::eNone, vk::PipelineStageFlagBits::eFragmentShader };
+      return { vk::AccessFlagBits::eNone, vk::PipelineStageFlagBits::eFragmentShader | vk::PipelineStageFlagBits::eComputeShader };
+    case vk::ImageLayout::eGeneral:
+      return { vk::AccessFlagBits::eShaderWrite, vk::PipelineStageFlagBits::eComputeShader };
     default: return { vk::AccessFlagBits::eNone, vk::PipelineStageFlagBits::eNone };
   }
 }
@@ -88,7 +93,9 @@ std::tuple<vk::AccessFlags, vk::PipelineStageFlags> getTransitionDstAccess(vk::I
     case vk::ImageLayout::eTransferDstOptimal:
       return { vk::AccessFlagBits::eTransferWrite, vk::PipelineStageFlagBits::eTransfer };
     case vk::ImageLayout::eShaderReadOnlyOptimal:
-      return { vk::AccessFlagBits::eShaderRead, vk::PipelineStageFlagBits::eFragmentShader };
+      return { vk::AccessFlagBits::eShaderRead, vk::PipelineStageFlagBits::eFragmentShader | vk::PipelineStageFlagBits::eComputeShader };
+    case vk::ImageLayout::eGeneral:
+      return { vk::AccessFlagBits::eShaderRead | vk::AccessFlagBits::eShaderWrite, vk::PipelineStageFlagBits::eComputeShader };
     case vk::ImageLayout::ePresentSrcKHR:
     case vk::ImageLayout::eUndefined:
       return { vk::AccessFlagBits::eNone, vk::PipelineStageFlagBits::eTopOfPipe };
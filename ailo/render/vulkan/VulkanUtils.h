@@ -9,7 +9,7 @@ vk::CullModeFlags getCullMode(CullingMode mode);
 vk::BlendOp getBlendOp(BlendOperation);
 vk::BlendFactor getBlendFunction(BlendFunction);
 vk::CompareOp getCompareOperation(CompareOp);
-vk::BufferUsageFlagBits getBufferUsage(BufferBinding);
+vk::BufferUsageFlags getBufferUsage(BufferBinding);
 vk::ImageUsageFlags getTextureUsage(TextureUsage);
 
 std::tuple<vk::AccessFlags, vk::PipelineStageFlags> getTransitionSrcAccess(vk::ImageLayout);
@@ -0,0 +1,233 @@
+// Shading shared by the forward and the deferred paths, expects the common uniforms
+
+vec3 shading_position;
+vec3 shading_view;
+vec3 shading_normal;
+vec3 shading_reflected;
+float shading_NoV;
+
+struct Light {
+    vec4 colorIntensity;
+    vec3 l;
+    float NoL;
+    vec3 position;
+    float attenuation;
+    vec3 direction;
+};
+
+struct Pixel {
+    vec3 f0;
+    float reflectance;
+    vec3 diffuseColor;
+    float perceptualRoughness;
+    vec4 baseColor;
+    float metallic;
+    float roughness;
+//    vec3 energyCompensation;
+    vec3 dfg;
+};
+
+vec3 specularLobe(vec3 f0, float roughness, vec3 h, float NoV, float NoL, float NoH, float LoH) {
+    float D = distribution(roughness, NoH, h);
+    float V = visibility(roughness, NoV, NoL);
+    vec3 F = fresnel(f0, LoH);
+
+    return (D * V) * F;
+}
+
+vec3 surfaceShading(const Pixel pixel, const Light light, float occlusion) {
+    vec3 h = normalize(shading_view + light.l);
+    //float NoV = max(abs(shading_NoV), 1e-5);
+    float NoV = max(shading_NoV, 1e-5);
+    float NoL = light.NoL;
+    float NoH = clamp01(dot(shading_normal, h));
+    float LoH = clamp01(dot(light.l, h));
+
+    vec3 Fr = specularLobe(pixel.f0, pixel.roughness, h, NoV, NoL, NoH, LoH);
+    vec3 Fd = pixel.diffuseColor * diffuse(pixel.roughness, NoV, NoL, LoH);
+
+    vec3 color = Fd + Fr;// * pixel.energyCompensation;
+    return (color * light.colorIntensity.rgb) *
+                (light.colorIntensity.w * light.attenuation * NoL * occlusion);
+}
+
+float getSquareFalloffAttenuation(float distanceSquare, float falloff) {
+    float factor = distanceSquare * falloff;
+    float smoothFactor = clamp01(1.0 - factor * factor);
+    // We would normally divide by the square distance here
+    // but we do it at the call site
+    return smoothFactor * smoothFactor;
+}
+
+float getDistanceAttenuation(const vec3 posToLight, const vec3 posToCamera, float falloff) {
+    float distanceSquare = dot(posToLight, posToLight);
+    float attenuation = getSquareFalloffAttenuation(distanceSquare, falloff);
+
+    // light far attenuation
+    // attenuation *= clamp01(view.lightFarAttenuationParams.x - dot(posToCamera, posToCamera) * view.lightFarAttenuationParams.y);
+    return attenuation / max(distanceSquare, 1e-4);
+}
+
+float getAngleAttenuation(const vec3 lightDir, const vec3 l, const vec2 scaleOffset) {
+     float cd = dot(lightDir, l);
+     float attenuation = clamp01(cd * scaleOffset.x + scaleOffset.y);
+     return attenuation * attenuation;
+ }
+
+Light getLight(uint index) {
+    vec3 position = lights[index].positionFalloff.xyz;
+    float falloff = lights[index].positionFalloff.w;
+    vec3 direction = lights[index].direction;
+    vec2 scaleOffset = lights[index].scaleOffset;
+    vec4 colorIntensity = lights[index].colorIntensity;
+
+    vec3 posToLight = position - shading_position;
+    vec3 posToCamera = view.viewInverse[3].xyz - shading_position;
+
+    Light light;
+    light.colorIntensity = colorIntensity;
+    light.l = normalize(posToLight);
+    light.NoL = clamp01(dot(shading_normal, light.l));
+    light.attenuation = getDistanceAttenuation(posToLight, posToCamera, falloff);
+    light.position = position;
+    light.direction = direction;
+
+    if(lights[index].type == SPOT_LIGHT_TYPE) {
+        light.attenuation *= getAngleAttenuation(-direction, light.l, scaleOffset);
+    }
+
+    return light;
+}
+
+Light getDirectionalLight() {
+    Light light;
+    light.colorIntensity = view.lightColorIntensity;
+    light.l = normalize(view.lightDirection);
+    light.NoL = clamp01(dot(shading_normal, light.l));
+    light.attenuation = 1.0;
+    return light;
+}
+
+float sampleShadow(vec2 uv, float depth) {
+    const float bias = 0.005;
+    float closestDepth = texture(shadowMap, uv).r;
+    return (depth - bias > closestDepth) ? 0.0 : 1.0;
+}
+
+float calculateShadow(vec3 worldPos) {
+    float viewDepth = -(view.view * vec4(worldPos, 1.0)).z;
+
+    int cascade = 0;
+    while (cascade < SHADOW_CASCADE_COUNT && viewDepth > view.shadowCascadeSplits[cascade]) {
+        cascade++;
+    }
+    if (cascade == SHADOW_CASCADE_COUNT) {
+        return 1.0;
+    }
+
+    vec4 lightSpacePos = view.shadowCascadeViewProjection[cascade] * vec4(worldPos, 1.0);
+    vec3 projCoords = lightSpacePos.xyz * (1.0 / lightSpacePos.w);
+
+    vec2 uv = projCoords.xy * 0.5 + 0.5;
+    float depth = projCoords.z;
+
+    if (uv != clamp01(uv) || depth > 1.0) {
+        return 1.0;
+    }
+
+    // cascades are tiles of the shadow atlas, keep the filter inside the tile
+    vec2 texelSize = 1.0 / textureSize(shadowMap, 0);
+    vec2 tileOffset = vec2(cascade % SHADOW_ATLAS_GRID, cascade / SHADOW_ATLAS_GRID);
+    vec2 tileMin = tileOffset / SHADOW_ATLAS_GRID + texelSize * 1.5;
+    vec2 tileMax = (tileOffset + 1.0) / SHADOW_ATLAS_GRID - texelSize * 1.5;
+    uv = clamp((tileOffset + uv) / SHADOW_ATLAS_GRID, tileMin, tileMax);
+
+    float shadow = 0.0;
+//    shadow += sampleShadow(uv, depth);
+    shadow += sampleShadow(uv + vec2(-1, -1) * texelSize, depth);
+    shadow += sampleShadow(uv + vec2(-1,  0) * texelSize, depth);
+    shadow += sampleShadow(uv + vec2(-1,  1) * texelSize, depth);
+    shadow += sampleShadow(uv + vec2( 0, -1) * texelSize, depth);
+    shadow += sampleShadow(uv + vec2( 0,  0) * texelSize, depth);
+    shadow += sampleShadow(uv + vec2( 0,  1) * texelSize, depth);
+    shadow += sampleShadow(uv + vec2( 1, -1) * texelSize, depth);
+    shadow += sampleShadow(uv + vec2( 1,  0) * texelSize, depth);
+    shadow += sampleShadow(uv + vec2( 1,  1) * texelSize, depth);
+    shadow /= 9.0;
+
+    return shadow;
+}
+
+// Froxel of the fragment, must match the cluster layout of LightClusters on the CPU
+uint getClusterIndex(vec3 worldPos) {
+    vec4 viewPos = view.view * vec4(worldPos, 1.0);
+    vec4 clipPos = view.projection * viewPos;
+    vec2 ndc = clipPos.xy / clipPos.w;
+
+    vec2 gridSize = vec2(view.clusterGrid.xy);
+    uvec2 tile = uvec2(clamp(floor((ndc * 0.5 + 0.5) * gridSize), vec2(0.0), gridSize - 1.0));
+    float slice = floor(log(max(-viewPos.z, 1e-4)) * view.clusterDepthScaleBias.x + view.clusterDepthScaleBias.y);
+    uint z = uint(clamp(slice, 0.0, float(view.clusterGrid.z - 1)));
+
+    return tile.x + view.clusterGrid.x * (tile.y + view.clusterGrid.y * z);
+}
+
+// Fills the pixel from its material, call after prepareShading()
+void initPixel(out Pixel pixel, vec4 baseColor, float metallic, float perceptualRoughness) {
+    pixel.baseColor = baseColor;
+    pixel.perceptualRoughness = perceptualRoughness;
+    pixel.roughness = perceptualRoughness * perceptualRoughness;
+    pixel.metallic = metallic;
+
+    pixel.diffuseColor = baseColor.rgb * (1.0 - metallic);
+
+    const float reflectance = 0.5;
+    pixel.reflectance = 0.16 * reflectance * reflectance;
+
+    pixel.f0 = mix(vec3(pixel.reflectance), baseColor.rgb, metallic);
+    pixel.dfg = textureLod(iblDFG, vec2(shading_NoV, pixel.perceptualRoughness), 0.0).rgb;
+    //pixel.energyCompensation = 1.0 + pixel.f0 * (1.0 / pixel.dfg.y - 1.0);
+}
+
+void prepareShading(vec3 position, vec3 normal) {
+    vec3 sv = view.projection[2].w != 0.0 ? // is perspective projection?
+            (view.viewInverse[3].xyz - position) : view.viewInverse[2].xyz;
+
+    shading_position = position;
+    shading_view = normalize(sv);
+    shading_normal = normal;
+    shading_NoV = clampNoV(dot(shading_normal, shading_view));
+    shading_reflected = reflect(-shading_view, shading_normal);
+}
+
+// Direct lights, shadows and IBL, tone mapped
+vec3 evaluateLighting(const Pixel pixel) {
+    vec3 color = vec3(0.0);
+
+    Light directionalLight = getDirectionalLight();
+    float shadow = calculateShadow(shading_position);
+    color += surfaceShading(pixel, directionalLight, shadow);
+
+    LightCluster cluster = clusters[getClusterIndex(shading_position)];
+    for(uint i = 0; i < cluster.count; i++) {
+        Light light = getLight(clusterLightIndices[cluster.offset + i]);
+        color += surfaceShading(pixel, light, 1.0);
+    }
+
+    const float ambientLuminance = 0.2;
+
+    vec3 E = mix(pixel.dfg.xxx, pixel.dfg.yyy, pixel.f0);
+
+    vec3 reflected = mix(shading_reflected, shading_normal, pixel.roughness * pixel.roughness);
+    float radianceLod = view.iblSpecularMaxLod * pixel.perceptualRoughness * (2.0 - pixel.perceptualRoughness);
+    vec3 prefilteredRadiance = textureLod(iblSpecular, reflected, radianceLod).rgb;
+    vec3 Fr = E * prefilteredRadiance;
+
+    vec3 diffuseIrradiance = textureLod(iblSpecular, shading_normal, view.iblSpecularMaxLod).rgb;
+    vec3 Fd = pixel.diffuseColor * diffuseIrradiance * (1.0 - E);
+
+    color.rgb += ambientLuminance * (Fd + Fr);
+
+    // HDR tonemapping
+    return color / (color + vec3(1.0));
+}
@@ -17,6 +17,15 @@ void toTangentFrame(const vec4 q, out vec3 n, out vec3 t) {
         vec3(-2.0,  2.0,  2.0) * q.z * q.zwx;
 }
 
+// Unit vector from its octahedral encoding in [-1, 1]^2 (Cigolle et al. 2014), the snorm vertex
+// attributes of quantized meshes
+vec3 octDecodeSnorm(vec2 e) {
+    vec3 v = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+    float t = max(-v.z, 0.0);
+    v.xy += vec2(v.x >= 0.0 ? -t : t, v.y >= 0.0 ? -t : t);
+    return normalize(v);
+}
+
 #define MIN_N_DOT_V 1e-4
 
 float clampNoV(float NoV) {
@@ -27,4 +36,22 @@ float clampNoV(float NoV) {
 float pow5(float x) {
     float x2 = x * x;
     return x2 * x2 * x;
-}
\ No newline at end of file
+}
+// Octahedral unit vector encoding in [0, 1], Cigolle et al. 2014
+vec2 octWrap(vec2 v) {
+    return (1.0 - abs(v.yx)) * vec2(v.x >= 0.0 ? 1.0 : -1.0, v.y >= 0.0 ? 1.0 : -1.0);
+}
+
+vec2 octEncode(vec3 n) {
+    n /= abs(n.x) + abs(n.y) + abs(n.z);
+    vec2 e = n.z >= 0.0 ? n.xy : octWrap(n.xy);
+    return e * 0.5 + 0.5;
+}
+
+vec3 octDecode(vec2 e) {
+    e = e * 2.0 - 1.0;
+    vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+    float t = clamp01(-n.z);
+    n.xy += vec2(n.x >= 0.0 ? -t : t, n.y >= 0.0 ? -t : t);
+    return normalize(n);
+}
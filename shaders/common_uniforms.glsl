@@ -1,3 +1,6 @@
+#define SHADOW_CASCADE_COUNT 4
+#define SHADOW_ATLAS_GRID 2
+
 struct ViewUniform {
    mat4 projection;
    mat4 view;
@@ -7,7 +10,12 @@ struct ViewUniform {
    vec4 ambientLightColorIntensity;
 
    float iblSpecularMaxLod;
-   mat4 lightViewProjection;
+   mat4 shadowCascadeViewProjection[SHADOW_CASCADE_COUNT];
+   vec4 shadowCascadeSplits;
+
+   uvec4 clusterGrid; // xyz - cluster counts, w - light count
+   vec4 clusterDepthScaleBias; // xy, slice = log(viewDepth) * x + y
+   mat4 projectionInverse;
 };
 
 struct LightUniform {
@@ -18,18 +26,35 @@ struct LightUniform {
     vec2 scaleOffset;
 };
 
-struct ObjectUniform {
-    mat4 model;
-    mat4 modelInverse;
-    mat4 modelInverseTranspose;
+struct LightCluster {
+    uint offset;
+    uint count;
+};
+
+// rows of the affine model matrix and of its inverse transpose 3x3
+struct ObjectData {
+    vec4 modelRows[3];
+    vec3 normalRow0;
     uint flags;
+    vec3 normalRow1;
+    vec3 normalRow2;
 };
 
+vec4 objectToWorld(ObjectData object, vec4 position) {
+    return vec4(dot(object.modelRows[0], position),
+                dot(object.modelRows[1], position),
+                dot(object.modelRows[2], position),
+                position.w);
+}
+
+mat3 objectNormalToWorld(ObjectData object) {
+    return transpose(mat3(object.normalRow0, object.normalRow1, object.normalRow2));
+}
+
 struct BoneUniform {
     mat4 transform;
 };
 
-#define DYNAMIC_LIGHTS_COUNT 2
 #define MAX_BONES_COUNT 256
 
 const int POINT_LIGHT_TYPE = 0;
@@ -40,9 +65,9 @@ uniform perFrame_view {
     ViewUniform view;
 };
 
-layout (set = 0, binding = 1, std140)
-uniform perFrame_lights {
-    LightUniform lights[DYNAMIC_LIGHTS_COUNT];
+layout (set = 0, binding = 1, std430)
+readonly buffer perFrame_lights {
+    LightUniform lights[];
 };
 
 layout (set = 0, binding = 2)
@@ -54,9 +79,20 @@ uniform sampler2D iblDFG;
 layout (set = 0, binding = 4)
 uniform sampler2D shadowMap;
 
-layout (set = 1, binding = 0, std140)
-uniform perObject {
-    ObjectUniform object;
+layout (set = 0, binding = 5, std430)
+readonly buffer perFrame_clusters {
+    LightCluster clusters[];
+};
+
+layout (set = 0, binding = 6, std430)
+readonly buffer perFrame_clusterLights {
+    uint clusterLightIndices[];
+};
+
+// indexed with gl_InstanceIndex, the renderer passes the object index as the first instance
+layout (set = 1, binding = 0, std430)
+readonly buffer perObject_table {
+    ObjectData objects[];
 };
 
 layout (set = 1, binding = 1, std140)
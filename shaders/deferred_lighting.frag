@@ -0,0 +1,30 @@
+#version 450
+#include "common_math.glsl"
+#include "common_brdf.glsl"
+#include "common_uniforms.glsl"
+#include "common_lighting.glsl"
+
+layout(location = 1) in vec2 fragUV;
+
+// input_attachment_index is the color slot of the G-buffer, the depth is read at kMaxColorAttachments
+layout(input_attachment_index = 1, set = 2, binding = 0) uniform subpassInput gbufferBaseColorMetallic;
+layout(input_attachment_index = 2, set = 2, binding = 1) uniform subpassInput gbufferNormalRoughness;
+layout(input_attachment_index = 8, set = 2, binding = 2) uniform subpassInput gbufferDepth;
+
+layout(location = 0) out vec4 outColor;
+
+void main() {
+    vec4 baseColorMetallic = subpassLoad(gbufferBaseColorMetallic);
+    vec4 normalRoughness = subpassLoad(gbufferNormalRoughness);
+    float depth = subpassLoad(gbufferDepth).r;
+
+    vec4 viewPos = view.projectionInverse * vec4(fragUV * 2.0 - 1.0, depth, 1.0);
+    vec3 worldPos = (view.viewInverse * vec4(viewPos.xyz / viewPos.w, 1.0)).xyz;
+
+    prepareShading(worldPos, octDecode(normalRoughness.xy));
+
+    Pixel pixel;
+    initPixel(pixel, vec4(baseColorMetallic.rgb, 1.0), baseColorMetallic.a, normalRoughness.z);
+
+    outColor = vec4(evaluateLighting(pixel), 1.0);
+}
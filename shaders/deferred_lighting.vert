@@ -0,0 +1,15 @@
+#version 450
+
+layout(location = 1) out vec2 fragUV;
+
+void main() {
+    vec2 vertices[3] = vec2[3](
+        vec2(-1.0, -1.0),
+        vec2(3.0, -1.0),
+        vec2(-1.0, 3.0)
+    );
+
+    // on the far plane, so the GREATER depth test only passes where geometry was written
+    gl_Position = vec4(vertices[gl_VertexIndex], 1.0, 1.0);
+    fragUV = 0.5 * gl_Position.xy + vec2(0.5);
+}
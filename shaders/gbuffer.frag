@@ -0,0 +1,43 @@
+#version 450
+#include "common_math.glsl"
+#include "common_uniforms.glsl"
+
+#define VARYING in
+#include "common_varyings.glsl"
+
+#define MATERIAL_UNIFORM(x) layout(set = 2, binding = x)
+
+MATERIAL_UNIFORM(0) uniform sampler2D baseColorMap;
+
+#if defined(USE_NORMAL_MAP)
+MATERIAL_UNIFORM(1) uniform sampler2D normalMap;
+#endif
+
+MATERIAL_UNIFORM(2) uniform sampler2D metallicRoughnessMap;
+
+// Locations are the G-buffer color slots, slot 0 is the lit output written by the lighting subpass
+layout(location = 1) out vec4 outBaseColorMetallic;
+layout(location = 2) out vec4 outNormalRoughness;
+
+vec3 shadingNormal() {
+#if defined(USE_NORMAL_MAP)
+    vec3 n = fragNormalWorld;
+    vec3 t = fragTangentWorld.xyz;
+    vec3 b = cross(n, t) * sign(fragTangentWorld.w);
+
+    // z is rebuilt from xy so two channel BC5 normal maps sample the same as RGBA8 ones
+    vec2 xy = texture(normalMap, fragUV).rg * 2.0 - 1.0;
+    vec3 normal = vec3(xy, sqrt(max(1.0 - dot(xy, xy), 0.0)));
+    return normalize(mat3(t, b, n) * normal);
+#else
+    return normalize(fragNormalWorld);
+#endif
+}
+
+void main() {
+    vec4 baseColor = texture(baseColorMap, fragUV);
+    vec3 metallicRoughness = texture(metallicRoughnessMap, fragUV).rgb;
+
+    outBaseColorMetallic = vec4(baseColor.rgb, metallicRoughness.b);
+    outNormalRoughness = vec4(octEncode(shadingNormal()), metallicRoughness.g, 0.0);
+}
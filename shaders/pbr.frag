@@ -19,174 +19,20 @@ MATERIAL_UNIFORM(2) uniform sampler2D metallicRoughnessMap;
 layout(location = 0) out vec4 outColor;
 
 mat3 shading_tangentToWorld;
-vec3 shading_view;
-vec3 shading_normal;
-vec3 shading_reflected;
-float shading_NoV;
 
-struct Light {
-    vec4 colorIntensity;
-    vec3 l;
-    float NoL;
-    vec3 position;
-    float attenuation;
-    vec3 direction;
-};
-
-struct Pixel {
-    vec3 f0;
-    float reflectance;
-    vec3 diffuseColor;
-    float perceptualRoughness;
-    vec4 baseColor;
-    float metallic;
-    float roughness;
-//    vec3 energyCompensation;
-    vec3 dfg;
-};
+#include "common_lighting.glsl"
 
 void getPixel(out Pixel pixel) {
     vec4 baseColor = texture(baseColorMap, fragUV);
 
     vec3 metallicRoughness = texture(metallicRoughnessMap, fragUV).rgb;
-    float metallic = metallicRoughness.b;
-    float roughness = metallicRoughness.g;
-
-    pixel.baseColor = baseColor;
-    pixel.perceptualRoughness = roughness;
-    pixel.roughness = roughness * roughness;
-    pixel.metallic = metallic;
-
-    pixel.diffuseColor = baseColor.rgb * (1.0 - metallic);
-
-    const float reflectance = 0.5;
-    pixel.reflectance = 0.16 * reflectance * reflectance;
-
-    pixel.f0 = mix(vec3(pixel.reflectance), baseColor.rgb, metallic);
-    pixel.dfg = textureLod(iblDFG, vec2(shading_NoV, pixel.perceptualRoughness), 0.0).rgb;
-    //pixel.energyCompensation = 1.0 + pixel.f0 * (1.0 / pixel.dfg.y - 1.0);
-}
-
-vec3 specularLobe(vec3 f0, float roughness, vec3 h, float NoV, float NoL, float NoH, float LoH) {
-    float D = distribution(roughness, NoH, h);
-    float V = visibility(roughness, NoV, NoL);
-    vec3 F = fresnel(f0, LoH);
-
-    return (D * V) * F;
-}
-
-vec3 surfaceShading(const Pixel pixel, const Light light, float occlusion) {
-    vec3 h = normalize(shading_view + light.l);
-    //float NoV = max(abs(shading_NoV), 1e-5);
-    float NoV = max(shading_NoV, 1e-5);
-    float NoL = light.NoL;
-    float NoH = clamp01(dot(shading_normal, h));
-    float LoH = clamp01(dot(light.l, h));
-
-    vec3 Fr = specularLobe(pixel.f0, pixel.roughness, h, NoV, NoL, NoH, LoH);
-    vec3 Fd = pixel.diffuseColor * diffuse(pixel.roughness, NoV, NoL, LoH);
-
-    vec3 color = Fd + Fr;// * pixel.energyCompensation;
-    return (color * light.colorIntensity.rgb) *
-                (light.colorIntensity.w * light.attenuation * NoL * occlusion);
-}
-
-float getSquareFalloffAttenuation(float distanceSquare, float falloff) {
-    float factor = distanceSquare * falloff;
-    float smoothFactor = clamp01(1.0 - factor * factor);
-    // We would normally divide by the square distance here
-    // but we do it at the call site
-    return smoothFactor * smoothFactor;
-}
-
-float getDistanceAttenuation(const vec3 posToLight, const vec3 posToCamera, float falloff) {
-    float distanceSquare = dot(posToLight, posToLight);
-    float attenuation = getSquareFalloffAttenuation(distanceSquare, falloff);
-
-    // light far attenuation
-    // attenuation *= clamp01(view.lightFarAttenuationParams.x - dot(posToCamera, posToCamera) * view.lightFarAttenuationParams.y);
-    return attenuation / max(distanceSquare, 1e-4);
-}
-
-float getAngleAttenuation(const vec3 lightDir, const vec3 l, const vec2 scaleOffset) {
-     float cd = dot(lightDir, l);
-     float attenuation = clamp01(cd * scaleOffset.x + scaleOffset.y);
-     return attenuation * attenuation;
- }
-
-Light getLight(int index) {
-    vec3 position = lights[index].positionFalloff.xyz;
-    float falloff = lights[index].positionFalloff.w;
-    vec3 direction = lights[index].direction;
-    vec2 scaleOffset = lights[index].scaleOffset;
-    vec4 colorIntensity = lights[index].colorIntensity;
-
-    vec3 posToLight = position - fragPosWorld;
-    vec3 posToCamera = view.viewInverse[3].xyz - fragPosWorld;
-
-    Light light;
-    light.colorIntensity = colorIntensity;
-    light.l = normalize(posToLight);
-    light.NoL = clamp01(dot(shading_normal, light.l));
-    light.attenuation = getDistanceAttenuation(posToLight, posToCamera, falloff);
-    light.position = position;
-    light.direction = direction;
-
-    if(lights[index].type == SPOT_LIGHT_TYPE) {
-        light.attenuation *= getAngleAttenuation(-direction, light.l, scaleOffset);
-    }
-
-    return light;
-}
-
-Light getDirectionalLight() {
-    Light light;
-    light.colorIntensity = view.lightColorIntensity;
-    light.l = normalize(view.lightDirection);
-    light.NoL = clamp01(dot(shading_normal, light.l));
-    light.attenuation = 1.0;
-    return light;
-}
-
-float sampleShadow(vec2 uv, float depth) {
-    const float bias = 0.005;
-    float closestDepth = texture(shadowMap, uv).r;
-    return (depth - bias > closestDepth) ? 0.0 : 1.0;
-}
-
-float calculateShadow(vec3 worldPos) {
-    vec4 lightSpacePos = view.lightViewProjection * vec4(worldPos, 1.0);
-    vec3 projCoords = lightSpacePos.xyz * (1.0 / lightSpacePos.w);
-
-    vec2 uv = projCoords.xy * 0.5 + 0.5;
-    float depth = projCoords.z;
-
-    if (uv != clamp01(uv) || depth > 1.0) {
-        return 1.0;
-    }
-
-
-    float shadow = 0.0;
-//    shadow += sampleShadow(uv, depth);
-    vec2 texelSize = 1.0 / textureSize(shadowMap, 0);
-    shadow += sampleShadow(uv + vec2(-1, -1) * texelSize, depth);
-    shadow += sampleShadow(uv + vec2(-1,  0) * texelSize, depth);
-    shadow += sampleShadow(uv + vec2(-1,  1) * texelSize, depth);
-    shadow += sampleShadow(uv + vec2( 0, -1) * texelSize, depth);
-    shadow += sampleShadow(uv + vec2( 0,  0) * texelSize, depth);
-    shadow += sampleShadow(uv + vec2( 0,  1) * texelSize, depth);
-    shadow += sampleShadow(uv + vec2( 1, -1) * texelSize, depth);
-    shadow += sampleShadow(uv + vec2( 1,  0) * texelSize, depth);
-    shadow += sampleShadow(uv + vec2( 1,  1) * texelSize, depth);
-    shadow /= 9.0;
-
-    return shadow;
+    initPixel(pixel, baseColor, metallicRoughness.b, metallicRoughness.g);
 }
 
 vec3 shadingNormal() {
 #if defined(USE_NORMAL_MAP)
-    vec3 normal = texture(normalMap, fragUV).rgb;
-    normal = normal * 2.0 - 1.0;
+    vec2 xy = texture(normalMap, fragUV).rg * 2.0 - 1.0;
+    vec3 normal = vec3(xy, sqrt(max(1.0 - dot(xy, xy), 0.0)));
     return normalize(shading_tangentToWorld * normal);
 #else
     return normalize(fragNormalWorld);
@@ -199,45 +45,10 @@ void main() {
     vec3 b = cross(n, t) * sign(fragTangentWorld.w);
 
     shading_tangentToWorld = mat3(t, b, n);
-
-    vec3 sv = view.projection[2].w != 0.0 ? // is perspective projection?
-            (view.viewInverse[3].xyz - fragPosWorld) : view.viewInverse[2].xyz;
-
-    shading_view = normalize(sv);
-    shading_normal = shadingNormal();
-    shading_NoV = clampNoV(dot(shading_normal, shading_view));
-    shading_reflected = reflect(-shading_view, shading_normal);
+    prepareShading(fragPosWorld, shadingNormal());
 
     Pixel pixel;
     getPixel(pixel);
 
-    vec3 color = vec3(0.0);
-
-    Light directionalLight = getDirectionalLight();
-    float shadow = calculateShadow(fragPosWorld);
-    color += surfaceShading(pixel, directionalLight, shadow);
-
-    for(int i = 0; i < DYNAMIC_LIGHTS_COUNT; i++) {
-        Light light = getLight(i);
-        color += surfaceShading(pixel, light, 1.0);
-    }
-
-    const float ambientLuminance = 0.2;
-
-    vec3 E = mix(pixel.dfg.xxx, pixel.dfg.yyy, pixel.f0);
-
-    vec3 reflected = mix(shading_reflected, shading_normal, pixel.roughness * pixel.roughness);
-    float radianceLod = view.iblSpecularMaxLod * pixel.perceptualRoughness * (2.0 - pixel.perceptualRoughness);
-    vec3 prefilteredRadiance = textureLod(iblSpecular, reflected, radianceLod).rgb;
-    vec3 Fr = E * prefilteredRadiance;
-
-    vec3 diffuseIrradiance = textureLod(iblSpecular, shading_normal, view.iblSpecularMaxLod).rgb;
-    vec3 Fd = pixel.diffuseColor * diffuseIrradiance * (1.0 - E);
-
-    color.rgb += ambientLuminance * (Fd + Fr);
-
-    // HDR tonemapping
-    color = color / (color + vec3(1.0));
-
-    outColor = vec4(color, pixel.baseColor.a);
-}
\ No newline at end of file
+    outColor = vec4(evaluateLighting(pixel), pixel.baseColor.a);
+}
@@ -6,19 +6,36 @@
 #define VARYING out
 #include "common_varyings.glsl"
 
+#if defined(VARIANT_QUANTIZED)
+// xyz - position, the object matrix decodes normalized ones, w - tangent sign as 0 or 1
+layout(location = 0) in vec4 inPosition;
+layout(location = 2) in vec2 inUV;
+layout(location = 3) in vec2 inNormalOct;
+layout(location = 4) in vec2 inTangentOct;
+#else
 layout(location = 0) in vec3 inPosition;
 layout(location = 1) in vec3 inColor;
 layout(location = 2) in vec2 inUV;
 layout(location = 3) in vec3 inNormal;
 layout(location = 4) in vec4 inTangent;
+#endif
 
 #if defined(VARIANT_SKINNING)
+#if defined(VARIANT_QUANTIZED)
+layout(location = 5) in uvec4 inBoneIndices;
+#else
 layout(location = 5) in ivec4 inBoneIndices;
+#endif
 layout(location = 6) in vec4 inBoneWeights;
 #endif
 
 #define OBJECT_SKINNING_ENABLED_BIT 1
 
+ObjectData object;
+
+// depth has to match shadow.vert bit for bit, the color pass tests EQUAL after a depth pre-pass
+invariant gl_Position;
+
 vec3 getBonePosition(vec3 pos, uint boneIdx) {
     return (bones[boneIdx].transform * vec4(pos, 1.0)).xyz;
 }
@@ -28,7 +45,7 @@ vec3 getBoneVector(vec3 v, uint boneIdx) {
 }
 
 vec4 getPosition() {
-    vec4 position = vec4(inPosition, 1.0);
+    vec4 position = vec4(inPosition.xyz, 1.0);
 
 #if defined(VARIANT_SKINNING)
     if((object.flags & OBJECT_SKINNING_ENABLED_BIT) != 0) {
@@ -43,7 +60,7 @@ vec4 getPosition() {
     return position;
 }
 
-void getSkinNormalTangent(inout vec3 n, inout vec3 t, vec4 boneWeights, ivec4 boneIndices) {
+void getSkinNormalTangent(inout vec3 n, inout vec3 t, vec4 boneWeights, uvec4 boneIndices) {
     n   = boneWeights.x * getBoneVector(n, uint(boneIndices.x))
         + boneWeights.y * getBoneVector(n, uint(boneIndices.y))
         + boneWeights.z * getBoneVector(n, uint(boneIndices.z))
@@ -56,24 +73,36 @@ void getSkinNormalTangent(inout vec3 n, inout vec3 t, vec4 boneWeights, ivec4 bo
 }
 
 void main() {
-    vec4 position = object.model * getPosition();
-    mat3 normalToWorld = mat3(object.modelInverseTranspose);
-
+    object = objects[gl_InstanceIndex];
+    vec4 position = objectToWorld(object, getPosition());
+    mat3 normalToWorld = objectNormalToWorld(object);
+
+#if defined(VARIANT_QUANTIZED)
+    vec3 localNormal  = octDecodeSnorm(inNormalOct);
+    vec3 localTangent = octDecodeSnorm(inTangentOct);
+    float tangentSign = inPosition.w * 2.0 - 1.0;
+#else
     vec3 localNormal  = inNormal;
     vec3 localTangent = inTangent.xyz;
+    float tangentSign = inTangent.w;
+#endif
 
 #if defined(VARIANT_SKINNING)
     if((object.flags & OBJECT_SKINNING_ENABLED_BIT) != 0) {
-        getSkinNormalTangent(localNormal, localTangent, inBoneWeights, inBoneIndices);
+        getSkinNormalTangent(localNormal, localTangent, inBoneWeights, uvec4(inBoneIndices));
     }
 #endif
 
     fragPosWorld = position.xyz;
     fragNormalWorld = normalize(normalToWorld * localNormal);
     fragTangentWorld.xyz = normalize(normalToWorld * localTangent);
-    fragTangentWorld.w = inTangent.w;
+    fragTangentWorld.w = tangentSign;
 
+#if defined(VARIANT_QUANTIZED)
+    fragColor = vec3(1.0);
+#else
     fragColor = inColor;
+#endif
     fragUV = inUV;
 
     gl_Position = view.projection * view.view * position;
@@ -1,20 +1,34 @@
 #version 450
 #include "common_uniforms.glsl"
 
+#if defined(VARIANT_QUANTIZED)
+// see pbr.vert, only xyz is used here
+layout(location = 0) in vec4 inPosition;
+#else
 layout(location = 0) in vec3 inPosition;
+#endif
 #if defined(VARIANT_SKINNING)
+#if defined(VARIANT_QUANTIZED)
+layout(location = 5) in uvec4 inBoneIndices;
+#else
 layout(location = 5) in ivec4 inBoneIndices;
+#endif
 layout(location = 6) in vec4  inBoneWeights;
 #endif
 
 #define OBJECT_SKINNING_ENABLED_BIT 1
 
+ObjectData object;
+
+// also used as the camera depth pre-pass, see pbr.vert
+invariant gl_Position;
+
 vec3 getBonePosition(vec3 pos, uint boneIdx) {
     return (bones[boneIdx].transform * vec4(pos, 1.0)).xyz;
 }
 
 vec4 getPosition() {
-    vec4 position = vec4(inPosition, 1.0);
+    vec4 position = vec4(inPosition.xyz, 1.0);
 #if defined(VARIANT_SKINNING)
     if ((object.flags & OBJECT_SKINNING_ENABLED_BIT) != 0) {
         vec3 p = position.xyz;
@@ -28,5 +42,6 @@ vec4 getPosition() {
 }
 
 void main() {
-    gl_Position = view.projection * view.view * object.model * getPosition();
+    object = objects[gl_InstanceIndex];
+    gl_Position = view.projection * view.view * objectToWorld(object, getPosition());
 }
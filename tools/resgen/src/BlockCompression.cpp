@@ -0,0 +1,326 @@
+#include "BlockCompression.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <utility>
+
+namespace ailo {
+
+namespace {
+
+// Mean and principal axis of the points, a zero axis for a flat block
+template<int N>
+void principalAxis(const float (&points)[16][N], float (&mean)[N], float (&axis)[N]) {
+    for (int c = 0; c < N; c++) {
+        mean[c] = 0.0f;
+        for (int i = 0; i < 16; i++) {
+            mean[c] += points[i][c];
+        }
+        mean[c] /= 16.0f;
+    }
+
+    float covariance[N][N] = {};
+    for (int i = 0; i < 16; i++) {
+        for (int a = 0; a < N; a++) {
+            for (int b = 0; b < N; b++) {
+                covariance[a][b] += (points[i][a] - mean[a]) * (points[i][b] - mean[b]);
+            }
+        }
+    }
+
+    // power iteration from the row of the largest variance, which can't be orthogonal to the axis
+    int start = 0;
+    for (int c = 1; c < N; c++) {
+        if (covariance[c][c] > covariance[start][start]) start = c;
+    }
+    for (int c = 0; c < N; c++) {
+        axis[c] = covariance[start][c];
+    }
+    for (int iteration = 0; iteration < 8; iteration++) {
+        float next[N] = {};
+        float length = 0.0f;
+        for (int a = 0; a < N; a++) {
+            for (int b = 0; b < N; b++) {
+                next[a] += covariance[a][b] * axis[b];
+            }
+            length += next[a] * next[a];
+        }
+        length = std::sqrt(length);
+        for (int c = 0; c < N; c++) {
+            axis[c] = length > 1e-6f ? next[c] / length : 0.0f;
+        }
+    }
+}
+
+// Extremes of the points projected on their principal axis
+template<int N>
+void fitEndpoints(const float (&points)[16][N], float (&low)[N], float (&high)[N]) {
+    float mean[N], axis[N];
+    principalAxis(points, mean, axis);
+
+    float minT = 0.0f, maxT = 0.0f;
+    for (int i = 0; i < 16; i++) {
+        float t = 0.0f;
+        for (int c = 0; c < N; c++) {
+            t += (points[i][c] - mean[c]) * axis[c];
+        }
+        minT = std::min(minT, t);
+        maxT = std::max(maxT, t);
+    }
+    for (int c = 0; c < N; c++) {
+        low[c] = std::clamp(mean[c] + axis[c] * minT, 0.0f, 255.0f);
+        high[c] = std::clamp(mean[c] + axis[c] * maxT, 0.0f, 255.0f);
+    }
+}
+
+uint16_t packColor565(const float (&color)[3]) {
+    const auto r = static_cast<uint16_t>(std::lround(color[0] * 31.0f / 255.0f));
+    const auto g = static_cast<uint16_t>(std::lround(color[1] * 63.0f / 255.0f));
+    const auto b = static_cast<uint16_t>(std::lround(color[2] * 31.0f / 255.0f));
+    return static_cast<uint16_t>((r << 11) | (g << 5) | b);
+}
+
+void unpackColor565(uint16_t packed, int (&color)[3]) {
+    const int r = packed >> 11, g = (packed >> 5) & 63, b = packed & 31;
+    color[0] = (r << 3) | (r >> 2);
+    color[1] = (g << 2) | (g >> 4);
+    color[2] = (b << 3) | (b >> 2);
+}
+
+// BC7 mode 6 endpoint: 7 bit channels sharing a p-bit as their lowest bit
+struct Endpoint {
+    int value[4];
+    int pbit;
+
+    int expand(int c) const { return (value[c] << 1) | pbit; }
+};
+
+constexpr int kWeights4[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+Endpoint quantizeEndpoint(const float (&color)[4]) {
+    Endpoint best {};
+    float bestError = INFINITY;
+    for (int pbit = 0; pbit < 2; pbit++) {
+        Endpoint endpoint { {}, pbit };
+        float error = 0.0f;
+        for (int c = 0; c < 4; c++) {
+            endpoint.value[c] = std::clamp(static_cast<int>(std::lround((color[c] - pbit) / 2.0f)), 0, 127);
+            const float d = static_cast<float>(endpoint.expand(c)) - color[c];
+            error += d * d;
+        }
+        if (error < bestError) {
+            bestError = error;
+            best = endpoint;
+        }
+    }
+    return best;
+}
+
+// Nearest palette entry of every texel, returns the squared error of the block
+float fitIndices(const float (&points)[16][4], const Endpoint& e0, const Endpoint& e1, uint8_t (&indices)[16]) {
+    int palette[16][4];
+    for (int i = 0; i < 16; i++) {
+        for (int c = 0; c < 4; c++) {
+            palette[i][c] = ((64 - kWeights4[i]) * e0.expand(c) + kWeights4[i] * e1.expand(c) + 32) >> 6;
+        }
+    }
+
+    float total = 0.0f;
+    for (int i = 0; i < 16; i++) {
+        float bestError = INFINITY;
+        for (int p = 0; p < 16; p++) {
+            float error = 0.0f;
+            for (int c = 0; c < 4; c++) {
+                const float d = static_cast<float>(palette[p][c]) - points[i][c];
+                error += d * d;
+            }
+            if (error < bestError) {
+                bestError = error;
+                indices[i] = static_cast<uint8_t>(p);
+            }
+        }
+        total += bestError;
+    }
+    return total;
+}
+
+class BitWriter {
+public:
+    explicit BitWriter(uint8_t* data) : m_data(data) {}
+
+    void write(uint32_t value, uint32_t bits) {
+        for (uint32_t i = 0; i < bits; i++, m_offset++) {
+            m_data[m_offset / 8] |= static_cast<uint8_t>(((value >> i) & 1) << (m_offset % 8));
+        }
+    }
+
+private:
+    uint8_t* m_data;
+    uint32_t m_offset = 0;
+};
+
+}
+
+void encodeBC1(const uint8_t texels[64], uint8_t block[8]) {
+    float points[16][3];
+    for (int i = 0; i < 16; i++) {
+        for (int c = 0; c < 3; c++) {
+            points[i][c] = texels[i * 4 + c];
+        }
+    }
+    float low[3], high[3];
+    fitEndpoints(points, low, high);
+
+    // c0 > c1 selects the 4 color mode, equal endpoints decode every index 0 to c0
+    uint16_t c0 = packColor565(high);
+    uint16_t c1 = packColor565(low);
+    if (c0 < c1) {
+        std::swap(c0, c1);
+    }
+
+    uint32_t indices = 0;
+    if (c0 != c1) {
+        int palette[4][3];
+        unpackColor565(c0, palette[0]);
+        unpackColor565(c1, palette[1]);
+        for (int c = 0; c < 3; c++) {
+            palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+            palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+        }
+        for (int i = 0; i < 16; i++) {
+            int best = 0, bestError = INT32_MAX;
+            for (int p = 0; p < 4; p++) {
+                int error = 0;
+                for (int c = 0; c < 3; c++) {
+                    const int d = palette[p][c] - texels[i * 4 + c];
+                    error += d * d;
+                }
+                if (error < bestError) {
+                    bestError = error;
+                    best = p;
+                }
+            }
+            indices |= static_cast<uint32_t>(best) << (2 * i);
+        }
+    }
+
+    block[0] = static_cast<uint8_t>(c0);
+    block[1] = static_cast<uint8_t>(c0 >> 8);
+    block[2] = static_cast<uint8_t>(c1);
+    block[3] = static_cast<uint8_t>(c1 >> 8);
+    for (int b = 0; b < 4; b++) {
+        block[4 + b] = static_cast<uint8_t>(indices >> (8 * b));
+    }
+}
+
+void encodeBC4(const uint8_t texels[64], uint32_t channel, uint8_t block[8]) {
+    int low = 255, high = 0;
+    for (int i = 0; i < 16; i++) {
+        low = std::min<int>(low, texels[i * 4 + channel]);
+        high = std::max<int>(high, texels[i * 4 + channel]);
+    }
+
+    // red0 > red1 selects the 8 value mode, equal endpoints decode every index 0 to red0
+    uint64_t indices = 0;
+    if (high > low) {
+        int palette[8] = { high, low };
+        for (int p = 2; p < 8; p++) {
+            palette[p] = ((8 - p) * high + (p - 1) * low + 3) / 7;
+        }
+        for (int i = 0; i < 16; i++) {
+            int best = 0, bestError = INT32_MAX;
+            for (int p = 0; p < 8; p++) {
+                const int error = std::abs(palette[p] - texels[i * 4 + channel]);
+                if (error < bestError) {
+                    bestError = error;
+                    best = p;
+                }
+            }
+            indices |= static_cast<uint64_t>(best) << (3 * i);
+        }
+    }
+
+    block[0] = static_cast<uint8_t>(high);
+    block[1] = static_cast<uint8_t>(low);
+    for (int b = 0; b < 6; b++) {
+        block[2 + b] = static_cast<uint8_t>(indices >> (8 * b));
+    }
+}
+
+void encodeBC5(const uint8_t texels[64], uint8_t block[16]) {
+    encodeBC4(texels, 0, block);
+    encodeBC4(texels, 1, block + 8);
+}
+
+void encodeBC7(const uint8_t texels[64], uint8_t block[16]) {
+    float points[16][4];
+    for (int i = 0; i < 16; i++) {
+        for (int c = 0; c < 4; c++) {
+            points[i][c] = texels[i * 4 + c];
+        }
+    }
+    float low[4], high[4];
+    fitEndpoints(points, low, high);
+
+    Endpoint e0 = quantizeEndpoint(low);
+    Endpoint e1 = quantizeEndpoint(high);
+    uint8_t indices[16];
+    const float error = fitIndices(points, e0, e1, indices);
+
+    // one least squares refit of the endpoints to the chosen weights, kept when it lowers the error
+    float a = 0.0f, b = 0.0f, c = 0.0f;
+    float x0[4] = {}, x1[4] = {};
+    for (int i = 0; i < 16; i++) {
+        const float t = static_cast<float>(kWeights4[indices[i]]) / 64.0f;
+        a += (1.0f - t) * (1.0f - t);
+        b += t * (1.0f - t);
+        c += t * t;
+        for (int ch = 0; ch < 4; ch++) {
+            x0[ch] += (1.0f - t) * points[i][ch];
+            x1[ch] += t * points[i][ch];
+        }
+    }
+    const float det = a * c - b * b;
+    if (det > 1e-6f) {
+        float refitLow[4], refitHigh[4];
+        for (int ch = 0; ch < 4; ch++) {
+            refitLow[ch] = std::clamp((c * x0[ch] - b * x1[ch]) / det, 0.0f, 255.0f);
+            refitHigh[ch] = std::clamp((a * x1[ch] - b * x0[ch]) / det, 0.0f, 255.0f);
+        }
+        const Endpoint r0 = quantizeEndpoint(refitLow);
+        const Endpoint r1 = quantizeEndpoint(refitHigh);
+        uint8_t refitIndices[16];
+        if (fitIndices(points, r0, r1, refitIndices) < error) {
+            e0 = r0;
+            e1 = r1;
+            std::memcpy(indices, refitIndices, sizeof(indices));
+        }
+    }
+
+    // the top bit of the first index is implicit zero, the weights are symmetric so swapping the
+    // endpoints mirrors the indices
+    if (indices[0] & 8) {
+        std::swap(e0, e1);
+        for (uint8_t& index : indices) {
+            index = static_cast<uint8_t>(15 - index);
+        }
+    }
+
+    std::memset(block, 0, 16);
+    BitWriter writer(block);
+    writer.write(1 << 6, 7); // mode 6
+    for (int ch = 0; ch < 4; ch++) {
+        writer.write(e0.value[ch], 7);
+        writer.write(e1.value[ch], 7);
+    }
+    writer.write(e0.pbit, 1);
+    writer.write(e1.pbit, 1);
+    writer.write(indices[0], 3);
+    for (int i = 1; i < 16; i++) {
+        writer.write(indices[i], 4);
+    }
+}
+
+} // namespace ailo
@@ -0,0 +1,20 @@
+#pragma once
+
+#include <cstdint>
+
+namespace ailo {
+
+// Encoders of one 4x4 block, texels are RGBA8 in row major order. Single pass fits along the
+// principal axis of the block: fast and close to reference encoders on smooth content, without
+// their exhaustive mode and partition searches.
+
+// Opaque BC1, 4 color mode
+void encodeBC1(const uint8_t texels[64], uint8_t block[8]);
+// BC4 of one channel of the texels
+void encodeBC4(const uint8_t texels[64], uint32_t channel, uint8_t block[8]);
+// BC5 of the red and green channels
+void encodeBC5(const uint8_t texels[64], uint8_t block[16]);
+// BC7 mode 6: one subset, RGBA endpoints with a p-bit each and 4 bit indices
+void encodeBC7(const uint8_t texels[64], uint8_t block[16]);
+
+} // namespace ailo
@@ -0,0 +1,43 @@
+#include "MeshBaker.h"
+
+#include "common/JobSystem.h"
+#include "render/ModelFile.h"
+#include "render/ModelImport.h"
+
+#include <chrono>
+#include <exception>
+#include <filesystem>
+#include <iostream>
+
+namespace ailo {
+
+bool MeshBaker::bake(const std::string& inputPath, const std::string& outputPath, const MeshBakerConfig& config) {
+    const auto start = std::chrono::steady_clock::now();
+
+    JobSystem jobSystem;
+    ModelData model;
+    try {
+        const MeshImportOptions options { .quantizeVertices = config.quantizeVertices, .logMeshStats = true };
+        model = importModel(inputPath, options, &jobSystem);
+    } catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return false;
+    }
+
+    const auto outputDirectory = std::filesystem::path(outputPath).parent_path();
+    if (!outputDirectory.empty()) {
+        std::filesystem::create_directories(outputDirectory);
+    }
+    if (!writeModelFile(model, outputPath)) {
+        std::cerr << "Error: failed to write " << outputPath << std::endl;
+        return false;
+    }
+
+    const auto elapsed = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start);
+    std::cout << "Baked " << inputPath << " -> " << outputPath << ": " << model.meshes.size() << " meshes, "
+              << model.materials.size() << " materials, " << model.clips.size() << " clips, "
+              << std::filesystem::file_size(outputPath) << " bytes in " << elapsed.count() << " ms" << std::endl;
+    return true;
+}
+
+} // namespace ailo
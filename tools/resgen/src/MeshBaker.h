@@ -0,0 +1,18 @@
+#pragma once
+
+#include <string>
+
+namespace ailo {
+
+struct MeshBakerConfig {
+    bool quantizeVertices = false; // see MeshImportOptions
+};
+
+class MeshBaker {
+public:
+    // Imports a model with the engine import stage and writes it as a model file the engine
+    // maps without Assimp. Returns true on success, false on failure
+    static bool bake(const std::string& inputPath, const std::string& outputPath, const MeshBakerConfig& config = {});
+};
+
+} // namespace ailo
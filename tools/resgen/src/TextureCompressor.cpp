@@ -0,0 +1,208 @@
+#include "TextureCompressor.h"
+
+#include "BlockCompression.h"
+#include "common/JobSystem.h"
+#include "render/Ktx2.h"
+
+#include <stb_image/stb_image.h>
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <filesystem>
+#include <iostream>
+#include <vector>
+
+namespace ailo {
+
+namespace {
+
+struct MipLevel {
+    uint32_t width;
+    uint32_t height;
+    std::vector<uint8_t> texels; // RGBA8
+};
+
+enum class MipFilter {
+    Srgb,   // color, averaged in linear space
+    Linear, // data channels
+    Normal, // tangent space normals, renormalized
+};
+
+float srgbToLinear(float c) {
+    return c <= 0.04045f ? c / 12.92f : std::pow((c + 0.055f) / 1.055f, 2.4f);
+}
+
+float linearToSrgb(float c) {
+    return c <= 0.0031308f ? c * 12.92f : 1.055f * std::pow(c, 1.0f / 2.4f) - 0.055f;
+}
+
+uint8_t toUnorm8(float c) {
+    return static_cast<uint8_t>(std::lround(std::clamp(c, 0.0f, 1.0f) * 255.0f));
+}
+
+// 2x2 box filter, the last row or column of an odd size is used twice
+MipLevel downsample(const MipLevel& src, MipFilter filter) {
+    static const std::array<float, 256> toLinear = [] {
+        std::array<float, 256> table {};
+        for (uint32_t i = 0; i < 256; i++) {
+            table[i] = srgbToLinear(static_cast<float>(i) / 255.0f);
+        }
+        return table;
+    }();
+
+    MipLevel dst { std::max(src.width / 2, 1u), std::max(src.height / 2, 1u), {} };
+    dst.texels.resize(size_t(dst.width) * dst.height * 4);
+    auto texel = [&](uint32_t x, uint32_t y) {
+        return &src.texels[(size_t(std::min(y, src.height - 1)) * src.width + std::min(x, src.width - 1)) * 4];
+    };
+
+    for (uint32_t y = 0; y < dst.height; y++) {
+        for (uint32_t x = 0; x < dst.width; x++) {
+            const uint8_t* quad[4] = { texel(2 * x, 2 * y), texel(2 * x + 1, 2 * y), texel(2 * x, 2 * y + 1), texel(2 * x + 1, 2 * y + 1) };
+            uint8_t* out = &dst.texels[(size_t(y) * dst.width + x) * 4];
+
+            float sum[4] = {};
+            for (const uint8_t* t : quad) {
+                for (int c = 0; c < 4; c++) {
+                    if (c < 3 && filter == MipFilter::Srgb) {
+                        sum[c] += toLinear[t[c]];
+                    } else if (c < 3 && filter == MipFilter::Normal) {
+                        sum[c] += static_cast<float>(t[c]) / 127.5f - 1.0f;
+                    } else {
+                        sum[c] += static_cast<float>(t[c]) / 255.0f;
+                    }
+                }
+            }
+
+            if (filter == MipFilter::Normal) {
+                const float length = std::sqrt(sum[0] * sum[0] + sum[1] * sum[1] + sum[2] * sum[2]);
+                const float n[3] = { 0.0f, 0.0f, 1.0f };
+                for (int c = 0; c < 3; c++) {
+                    out[c] = toUnorm8((length > 1e-6f ? sum[c] / length : n[c]) * 0.5f + 0.5f);
+                }
+            } else {
+                for (int c = 0; c < 3; c++) {
+                    out[c] = toUnorm8(filter == MipFilter::Srgb ? linearToSrgb(sum[c] / 4.0f) : sum[c] / 4.0f);
+                }
+            }
+            out[3] = toUnorm8(sum[3] / 4.0f);
+        }
+    }
+    return dst;
+}
+
+std::vector<std::byte> compressLevel(const MipLevel& level, Ktx2Format format, JobSystem& jobSystem) {
+    const uint32_t blocksX = (level.width + 3) / 4;
+    const uint32_t blocksY = (level.height + 3) / 4;
+    const uint32_t blockSize = getBlockSize(format);
+    std::vector<std::byte> blocks(size_t(blocksX) * blocksY * blockSize);
+
+    jobSystem.parallelFor(0, blocksY, 4, [&](uint32_t first, uint32_t last) {
+        uint8_t texels[64];
+        for (uint32_t by = first; by < last; by++) {
+            for (uint32_t bx = 0; bx < blocksX; bx++) {
+                // blocks past the edge of the image repeat its last row and column
+                for (uint32_t i = 0; i < 16; i++) {
+                    const uint32_t x = std::min(bx * 4 + i % 4, level.width - 1);
+                    const uint32_t y = std::min(by * 4 + i / 4, level.height - 1);
+                    std::copy_n(&level.texels[(size_t(y) * level.width + x) * 4], 4, &texels[i * 4]);
+                }
+
+                auto* block = reinterpret_cast<uint8_t*>(&blocks[(size_t(by) * blocksX + bx) * blockSize]);
+                switch (format) {
+                    case Ktx2Format::BC1RgbUnorm:
+                    case Ktx2Format::BC1RgbSrgb: encodeBC1(texels, block); break;
+                    case Ktx2Format::BC4Unorm: encodeBC4(texels, 0, block); break;
+                    case Ktx2Format::BC5Unorm: encodeBC5(texels, block); break;
+                    case Ktx2Format::BC7Unorm:
+                    case Ktx2Format::BC7Srgb: encodeBC7(texels, block); break;
+                }
+            }
+        }
+    });
+    return blocks;
+}
+
+const char* getFormatName(Ktx2Format format) {
+    switch (format) {
+        case Ktx2Format::BC1RgbUnorm: return "BC1";
+        case Ktx2Format::BC1RgbSrgb: return "BC1 sRGB";
+        case Ktx2Format::BC4Unorm: return "BC4";
+        case Ktx2Format::BC5Unorm: return "BC5";
+        case Ktx2Format::BC7Unorm: return "BC7";
+        case Ktx2Format::BC7Srgb: return "BC7 sRGB";
+    }
+    return "unknown";
+}
+
+}
+
+bool TextureCompressor::compress(const std::string& inputPath, const std::string& outputPath, const TextureCompressorConfig& config) {
+    const auto start = std::chrono::steady_clock::now();
+
+    const size_t tags = inputPath.find('@');
+    const std::string path = inputPath.substr(0, tags);
+    const bool normalMap = config.normalMap || inputPath.find("@norm", tags) != std::string::npos;
+
+    TextureCompression compression = config.format;
+    if (compression == TextureCompression::Auto) {
+        compression = normalMap ? TextureCompression::BC5 : TextureCompression::BC7;
+    }
+
+    // sRGB unless the texels are normals or data channels
+    Ktx2Format format {};
+    MipFilter filter = normalMap ? MipFilter::Normal : MipFilter::Srgb;
+    switch (compression) {
+        case TextureCompression::BC1: format = normalMap ? Ktx2Format::BC1RgbUnorm : Ktx2Format::BC1RgbSrgb; break;
+        case TextureCompression::BC4: format = Ktx2Format::BC4Unorm; break;
+        case TextureCompression::BC5: format = Ktx2Format::BC5Unorm; break;
+        case TextureCompression::Auto:
+        case TextureCompression::BC7: format = normalMap ? Ktx2Format::BC7Unorm : Ktx2Format::BC7Srgb; break;
+    }
+    if (!normalMap && (format == Ktx2Format::BC4Unorm || format == Ktx2Format::BC5Unorm)) {
+        filter = MipFilter::Linear;
+    }
+
+    int width, height, channels;
+    stbi_uc* pixels = stbi_load(path.c_str(), &width, &height, &channels, STBI_rgb_alpha);
+    if (!pixels) {
+        std::cerr << "Failed to load image: " << path << std::endl;
+        std::cerr << "Reason: " << stbi_failure_reason() << std::endl;
+        return false;
+    }
+
+    std::vector<MipLevel> mips;
+    mips.push_back({ static_cast<uint32_t>(width), static_cast<uint32_t>(height), { pixels, pixels + size_t(width) * height * 4 } });
+    stbi_image_free(pixels);
+    while (mips.back().width > 1 || mips.back().height > 1) {
+        mips.push_back(downsample(mips.back(), filter));
+    }
+
+    JobSystem jobSystem;
+    std::vector<std::vector<std::byte>> levels;
+    size_t uncompressedSize = 0;
+    for (const MipLevel& mip : mips) {
+        levels.push_back(compressLevel(mip, format, jobSystem));
+        uncompressedSize += mip.texels.size();
+    }
+
+    const auto outputDirectory = std::filesystem::path(outputPath).parent_path();
+    if (!outputDirectory.empty()) {
+        std::filesystem::create_directories(outputDirectory);
+    }
+    if (!writeKtx2(outputPath, format, static_cast<uint32_t>(width), static_cast<uint32_t>(height), levels)) {
+        std::cerr << "Error: failed to write " << outputPath << std::endl;
+        return false;
+    }
+
+    const auto elapsed = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start);
+    const auto fileSize = std::filesystem::file_size(outputPath);
+    std::cout << "Compressed " << path << " -> " << outputPath << ": " << getFormatName(format) << ", " << width << "x" << height
+              << ", " << levels.size() << " levels, " << fileSize << " bytes (RGBA8 " << uncompressedSize << ") in "
+              << elapsed.count() << " ms" << std::endl;
+    return true;
+}
+
+} // namespace ailo
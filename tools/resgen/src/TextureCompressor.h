@@ -0,0 +1,27 @@
+#pragma once
+
+#include <string>
+
+namespace ailo {
+
+enum class TextureCompression {
+    Auto, // BC5 for normal maps, BC7 otherwise
+    BC1,
+    BC4,
+    BC5,
+    BC7,
+};
+
+struct TextureCompressorConfig {
+    TextureCompression format = TextureCompression::Auto;
+    bool normalMap = false; // also set by an @norm tag on the input, as in engine texture keys
+};
+
+class TextureCompressor {
+public:
+    // Builds the mip chain of an image and writes it block compressed as a KTX2 file the engine
+    // uploads as is. Returns true on success, false on failure
+    static bool compress(const std::string& inputPath, const std::string& outputPath, const TextureCompressorConfig& config = {});
+};
+
+} // namespace ailo
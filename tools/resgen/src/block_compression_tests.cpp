@@ -0,0 +1,316 @@
+// the checks are asserts, keep them in release builds
+#undef NDEBUG
+
+#include "BlockCompression.h"
+#include "render/Ktx2.h"
+
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <cmath>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <random>
+#include <span>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+using namespace ailo;
+
+// Reference decoders of the block layouts, independent of the encoder code
+
+void decodeBC1(const uint8_t block[8], uint8_t texels[64]) {
+    const uint16_t c0 = block[0] | block[1] << 8;
+    const uint16_t c1 = block[2] | block[3] << 8;
+    int palette[4][3];
+    for (int e = 0; e < 2; e++) {
+        const uint16_t c = e == 0 ? c0 : c1;
+        const int r = c >> 11, g = (c >> 5) & 63, b = c & 31;
+        palette[e][0] = (r << 3) | (r >> 2);
+        palette[e][1] = (g << 2) | (g >> 4);
+        palette[e][2] = (b << 3) | (b >> 2);
+    }
+    for (int c = 0; c < 3; c++) {
+        if (c0 > c1) {
+            palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+            palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+        } else {
+            palette[2][c] = (palette[0][c] + palette[1][c]) / 2;
+            palette[3][c] = 0;
+        }
+    }
+    const uint32_t indices = block[4] | block[5] << 8 | block[6] << 16 | uint32_t(block[7]) << 24;
+    for (int i = 0; i < 16; i++) {
+        const int p = (indices >> (2 * i)) & 3;
+        for (int c = 0; c < 3; c++) {
+            texels[i * 4 + c] = static_cast<uint8_t>(palette[p][c]);
+        }
+        texels[i * 4 + 3] = 255;
+    }
+}
+
+void decodeBC4(const uint8_t block[8], uint32_t channel, uint8_t texels[64]) {
+    const int r0 = block[0], r1 = block[1];
+    int palette[8] = { r0, r1 };
+    if (r0 > r1) {
+        for (int p = 2; p < 8; p++) {
+            palette[p] = ((8 - p) * r0 + (p - 1) * r1) / 7;
+        }
+    } else {
+        for (int p = 2; p < 6; p++) {
+            palette[p] = ((6 - p) * r0 + (p - 1) * r1) / 5;
+        }
+        palette[6] = 0;
+        palette[7] = 255;
+    }
+    uint64_t indices = 0;
+    for (int b = 0; b < 6; b++) {
+        indices |= uint64_t(block[2 + b]) << (8 * b);
+    }
+    for (int i = 0; i < 16; i++) {
+        texels[i * 4 + channel] = static_cast<uint8_t>(palette[(indices >> (3 * i)) & 7]);
+    }
+}
+
+// Only mode 6, returns false for blocks of another mode
+bool decodeBC7(const uint8_t block[16], uint8_t texels[64]) {
+    uint32_t offset = 0;
+    auto read = [&](uint32_t bits) {
+        uint32_t value = 0;
+        for (uint32_t i = 0; i < bits; i++, offset++) {
+            value |= uint32_t((block[offset / 8] >> (offset % 8)) & 1) << i;
+        }
+        return value;
+    };
+
+    if (read(7) != 1 << 6) {
+        return false;
+    }
+    int endpoints[2][4];
+    for (int c = 0; c < 4; c++) {
+        endpoints[0][c] = static_cast<int>(read(7));
+        endpoints[1][c] = static_cast<int>(read(7));
+    }
+    for (int e = 0; e < 2; e++) {
+        const int pbit = static_cast<int>(read(1));
+        for (int c = 0; c < 4; c++) {
+            endpoints[e][c] = endpoints[e][c] << 1 | pbit;
+        }
+    }
+    constexpr int kWeights[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+    for (int i = 0; i < 16; i++) {
+        const uint32_t index = read(i == 0 ? 3 : 4);
+        for (int c = 0; c < 4; c++) {
+            texels[i * 4 + c] = static_cast<uint8_t>(((64 - kWeights[index]) * endpoints[0][c] + kWeights[index] * endpoints[1][c] + 32) >> 6);
+        }
+    }
+    return offset == 128;
+}
+
+struct BlockError {
+    int max = 0;
+    double rms = 0.0;
+};
+
+BlockError measureError(const uint8_t (&source)[64], const uint8_t (&decoded)[64], uint32_t firstChannel, uint32_t channelCount) {
+    BlockError error;
+    for (int i = 0; i < 16; i++) {
+        for (uint32_t c = firstChannel; c < firstChannel + channelCount; c++) {
+            const int d = std::abs(int(decoded[i * 4 + c]) - int(source[i * 4 + c]));
+            error.max = std::max(error.max, d);
+            error.rms += d * d;
+        }
+    }
+    error.rms = std::sqrt(error.rms / (16.0 * channelCount));
+    return error;
+}
+
+// Test blocks: solid, a diagonal gradient, two colors and noise
+std::vector<std::pair<const char*, std::array<uint8_t, 64>>> makeBlocks() {
+    std::vector<std::pair<const char*, std::array<uint8_t, 64>>> blocks;
+    std::array<uint8_t, 64> texels {};
+
+    for (int i = 0; i < 16; i++) {
+        const uint8_t solid[4] = { 200, 90, 30, 255 };
+        std::copy_n(solid, 4, &texels[i * 4]);
+    }
+    blocks.emplace_back("solid", texels);
+
+    for (int i = 0; i < 16; i++) {
+        const int t = (i % 4 + i / 4) * 255 / 6;
+        const uint8_t gradient[4] = { uint8_t(t), uint8_t(255 - t), uint8_t(t / 2 + 64), uint8_t(255 - t / 4) };
+        std::copy_n(gradient, 4, &texels[i * 4]);
+    }
+    blocks.emplace_back("gradient", texels);
+
+    for (int i = 0; i < 16; i++) {
+        const uint8_t a[4] = { 16, 40, 220, 255 };
+        const uint8_t b[4] = { 240, 200, 24, 128 };
+        std::copy_n(((i % 4 + i / 4) % 2) ? a : b, 4, &texels[i * 4]);
+    }
+    blocks.emplace_back("two colors", texels);
+
+    std::mt19937 random(3);
+    for (uint8_t& texel : texels) {
+        texel = static_cast<uint8_t>(random() & 255);
+    }
+    blocks.emplace_back("noise", texels);
+    return blocks;
+}
+
+void checkError(const char* name, const BlockError& error, const BlockError& bound) {
+    std::cout << name << ": max " << error.max << ", rms " << error.rms << "\n";
+    assert(error.max <= bound.max);
+    assert(error.rms <= bound.rms);
+}
+
+void test_bc1() {
+    std::cout << "=== test_bc1 ===\n";
+
+    // 565 rounding, the 7 steps of the gradient fall on 4 palette entries, noise only has a bound
+    const BlockError bounds[] = { { 4, 4.0 }, { 47, 30.0 }, { 4, 4.0 }, { 128, 64.0 } };
+    const auto blocks = makeBlocks();
+    for (size_t b = 0; b < blocks.size(); b++) {
+        uint8_t source[64];
+        std::copy(blocks[b].second.begin(), blocks[b].second.end(), source);
+        uint8_t block[8];
+        encodeBC1(source, block);
+
+        // the 4 color mode, or equal endpoints with every index 0, the 3 color mode would decode black
+        assert((block[0] | block[1] << 8) >= (block[2] | block[3] << 8));
+        uint8_t decoded[64];
+        decodeBC1(block, decoded);
+        checkError(blocks[b].first, measureError(source, decoded, 0, 3), bounds[b]);
+    }
+    std::cout << "\n";
+}
+
+void test_bc4_bc5() {
+    std::cout << "=== test_bc4_bc5 ===\n";
+
+    // endpoints are the channel's extremes, so the error is at most half of a palette step
+    const BlockError bounds[] = { { 0, 0.0 }, { 18, 13.0 }, { 0, 0.0 }, { 18, 13.0 } };
+    const auto blocks = makeBlocks();
+    for (size_t b = 0; b < blocks.size(); b++) {
+        uint8_t source[64];
+        std::copy(blocks[b].second.begin(), blocks[b].second.end(), source);
+
+        for (uint32_t channel = 0; channel < 4; channel++) {
+            uint8_t block[8];
+            encodeBC4(source, channel, block);
+            uint8_t decoded[64] = {};
+            decodeBC4(block, channel, decoded);
+            const BlockError error = measureError(source, decoded, channel, 1);
+            assert(error.max <= bounds[b].max && error.rms <= bounds[b].rms);
+        }
+
+        uint8_t block[16];
+        encodeBC5(source, block);
+        uint8_t decoded[64] = {};
+        decodeBC4(block, 0, decoded);
+        decodeBC4(block + 8, 1, decoded);
+        checkError(blocks[b].first, measureError(source, decoded, 0, 2), bounds[b]);
+    }
+    std::cout << "\n";
+}
+
+void test_bc7() {
+    std::cout << "=== test_bc7 ===\n";
+
+    // 7 bit endpoints and a p-bit are exact up to 1 for one or two colors
+    const BlockError bounds[] = { { 1, 1.0 }, { 8, 4.0 }, { 1, 1.0 }, { 128, 64.0 } };
+    const auto blocks = makeBlocks();
+    for (size_t b = 0; b < blocks.size(); b++) {
+        uint8_t source[64];
+        std::copy(blocks[b].second.begin(), blocks[b].second.end(), source);
+        uint8_t block[16];
+        encodeBC7(source, block);
+
+        uint8_t decoded[64];
+        const bool mode6 = decodeBC7(block, decoded);
+        assert(mode6);
+        checkError(blocks[b].first, measureError(source, decoded, 0, 4), bounds[b]);
+    }
+    std::cout << "\n";
+}
+
+std::vector<std::byte> readFile(const std::filesystem::path& path) {
+    std::ifstream file(path, std::ios::binary);
+    std::vector<char> bytes { std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>() };
+    std::vector<std::byte> data(bytes.size());
+    std::transform(bytes.begin(), bytes.end(), data.begin(), [](char c) { return std::byte(c); });
+    return data;
+}
+
+void test_ktx2_round_trip() {
+    std::cout << "=== test_ktx2_round_trip ===\n";
+
+    const auto path = std::filesystem::temp_directory_path() / "bctest.ktx2";
+    for (Ktx2Format format : { Ktx2Format::BC1RgbSrgb, Ktx2Format::BC4Unorm, Ktx2Format::BC7Srgb }) {
+        // not a multiple of the block size, 7 levels down to 1x1
+        const uint32_t width = 70, height = 37;
+        const uint32_t blockSize = getBlockSize(format);
+        std::vector<std::vector<std::byte>> levels;
+        for (uint32_t w = width, h = height;; w = std::max(w / 2, 1u), h = std::max(h / 2, 1u)) {
+            std::vector<std::byte> level(size_t((w + 3) / 4) * ((h + 3) / 4) * blockSize);
+            for (size_t i = 0; i < level.size(); i++) {
+                level[i] = std::byte((i * 7 + levels.size() * 31) & 255);
+            }
+            levels.push_back(std::move(level));
+            if (w == 1 && h == 1) {
+                break;
+            }
+        }
+        assert(levels.size() == 7);
+        bool written = writeKtx2(path.string(), format, width, height, levels);
+        assert(written);
+
+        const std::vector<std::byte> data = readFile(path);
+        const Ktx2Image image = parseKtx2(data);
+        assert(image.format == format && image.width == width && image.height == height);
+        assert(image.levels.size() == levels.size());
+
+        for (size_t level = 0; level < levels.size(); level++) {
+            const std::span<const std::byte> parsed = image.levels[level];
+            const size_t offset = static_cast<size_t>(parsed.data() - data.data());
+            std::cout << "format " << static_cast<uint32_t>(format) << " level " << level << ": offset " << offset
+                      << ", size " << parsed.size() << "\n";
+            assert(parsed.size() == levels[level].size());
+            assert(offset % blockSize == 0);
+            assert(std::equal(parsed.begin(), parsed.end(), levels[level].begin()));
+            // smallest level first, the largest ends the file
+            if (level > 0) {
+                assert(offset + parsed.size() <= static_cast<size_t>(image.levels[level - 1].data() - data.data()));
+            }
+        }
+        assert(image.levels[0].data() + image.levels[0].size() == data.data() + data.size());
+
+        // a level of the wrong size isn't written, a truncated file isn't parsed
+        levels[1].pop_back();
+        written = writeKtx2(path.string(), format, width, height, levels);
+        assert(!written);
+        bool threw = false;
+        try {
+            parseKtx2(std::span(data).first(data.size() - 1));
+        } catch (const std::runtime_error&) {
+            threw = true;
+        }
+        assert(threw);
+    }
+    std::filesystem::remove(path);
+    std::cout << "\n";
+}
+
+int main() {
+    test_bc1();
+    test_bc4_bc5();
+    test_bc7();
+    test_ktx2_round_trip();
+
+    std::cout << "All tests passed!\n";
+    return 0;
+}
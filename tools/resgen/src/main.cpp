@@ -1,4 +1,6 @@
 #include "IrradianceMapGenerator.h"
+#include "MeshBaker.h"
+#include "TextureCompressor.h"
 #include <iostream>
 #include <string>
 
@@ -16,7 +18,20 @@ void printUsage(const char* programName) {
               << "\n"
               << "  ibl-dfg <output_path>\n"
               << "    Generate DFG LUT texture for split-sum IBL approximation.\n"
-              << "      output_path   Output path for DFG LUT (e.g. dfg.png)\n";
+              << "      output_path   Output path for DFG LUT (e.g. dfg.png)\n"
+              << "\n"
+              << "  mesh-bake <input_path> <output_path> [--quantize]\n"
+              << "    Import a model and write it as a binary model file the engine maps without Assimp.\n"
+              << "      input_path    Path to any model format Assimp reads (e.g. sponza.gltf)\n"
+              << "      output_path   Output path for the model file (e.g. sponza.amesh)\n"
+              << "      --quantize    Store vertices in the packed quantized layouts\n"
+              << "\n"
+              << "  texture-compress <input_path> <output_path> [--normal] [--format bc1|bc4|bc5|bc7]\n"
+              << "    Build the mip chain of an image and write it block compressed for the engine to upload as is.\n"
+              << "      input_path    Path to an image stb_image reads, an @norm tag marks a normal map (e.g. wall.png@norm)\n"
+              << "      output_path   Output path for the KTX2 file, next to the image to replace it (e.g. wall.ktx2)\n"
+              << "      --normal      Same as the @norm tag: renormalized mips, linear formats\n"
+              << "      --format      bc1, bc4 (red only), bc5 (red and green) or bc7 (default: bc5 for normal maps, bc7 otherwise)\n";
 }
 
 int main(int argc, char** argv) {
@@ -77,6 +92,62 @@ int main(int argc, char** argv) {
 
         return ailo::IrradianceMapGenerator::prefilter(inputPath, outputPath, config) ? 0 : 1;
 
+    } else if (command == "mesh-bake") {
+        if (argc < 4) {
+            std::cerr << "Error: mesh-bake requires <input_path> and <output_path>\n\n";
+            printUsage(argv[0]);
+            return 1;
+        }
+
+        std::string inputPath = argv[2];
+        std::string outputPath = argv[3];
+
+        ailo::MeshBakerConfig config;
+        for (int i = 4; i < argc; i++) {
+            if (std::string(argv[i]) == "--quantize") {
+                config.quantizeVertices = true;
+            } else {
+                std::cerr << "Error: unknown mesh-bake option '" << argv[i] << "'\n\n";
+                printUsage(argv[0]);
+                return 1;
+            }
+        }
+
+        return ailo::MeshBaker::bake(inputPath, outputPath, config) ? 0 : 1;
+
+    } else if (command == "texture-compress") {
+        if (argc < 4) {
+            std::cerr << "Error: texture-compress requires <input_path> and <output_path>\n\n";
+            printUsage(argv[0]);
+            return 1;
+        }
+
+        std::string inputPath = argv[2];
+        std::string outputPath = argv[3];
+
+        ailo::TextureCompressorConfig config;
+        for (int i = 4; i < argc; i++) {
+            const std::string option = argv[i];
+            const std::string format = option == "--format" && i + 1 < argc ? argv[++i] : "";
+            if (option == "--normal") {
+                config.normalMap = true;
+            } else if (format == "bc1") {
+                config.format = ailo::TextureCompression::BC1;
+            } else if (format == "bc4") {
+                config.format = ailo::TextureCompression::BC4;
+            } else if (format == "bc5") {
+                config.format = ailo::TextureCompression::BC5;
+            } else if (format == "bc7") {
+                config.format = ailo::TextureCompression::BC7;
+            } else {
+                std::cerr << "Error: unknown texture-compress option '" << option << (format.empty() ? "" : " " + format) << "'\n\n";
+                printUsage(argv[0]);
+                return 1;
+            }
+        }
+
+        return ailo::TextureCompressor::compress(inputPath, outputPath, config) ? 0 : 1;
+
     } else {
         std::cerr << "Error: unknown command '" << command << "'\n\n";
         printUsage(argv[0]);